@@ -0,0 +1,131 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "xtl/xbase64.hpp"
+
+namespace xtl
+{
+    inline std::string make_base64_payload(std::size_t size)
+    {
+        std::string res(size, '\0');
+        uint64_t state = 1;
+        for (auto& c : res)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            c = static_cast<char>(state >> 56);
+        }
+        return res;
+    }
+
+    void base64_encode(benchmark::State& state)
+    {
+        std::string input = make_base64_payload(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(base64encode(input));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void base64_decode(benchmark::State& state)
+    {
+        std::string input = base64encode(make_base64_payload(static_cast<std::size_t>(state.range(0))));
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(base64decode(input));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // Into a caller-owned buffer, without allocation
+    void base64_encode_span(benchmark::State& state)
+    {
+        std::string input = make_base64_payload(static_cast<std::size_t>(state.range(0)));
+        std::string output(base64_encoded_size(input.size()), '\0');
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(base64encode(input, span<char>(&output[0], output.size())));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void base64_decode_span(benchmark::State& state)
+    {
+        std::string input = base64encode(make_base64_payload(static_cast<std::size_t>(state.range(0))));
+        std::string output(base64_decoded_size(input), '\0');
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(base64decode(input, span<char>(&output[0], output.size())));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // Strict decoding, unpadded URL-safe alphabet
+    void base64_decode_url_span(benchmark::State& state)
+    {
+        std::string input = xbase64_url_codec::encode(make_base64_payload(static_cast<std::size_t>(state.range(0))));
+        std::string output(xbase64_url_codec::decoded_size(input), '\0');
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xbase64_url_codec::decode(input, span<char>(&output[0], output.size())));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void base64_validate(benchmark::State& state)
+    {
+        std::string input = base64encode(make_base64_payload(static_cast<std::size_t>(state.range(0))));
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xbase64_codec<>::validate(input));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(input.size()));
+    }
+
+    // Kernels without dispatch and allocation, for comparison
+    void base64_encode_scalar(benchmark::State& state)
+    {
+        std::string input = make_base64_payload(static_cast<std::size_t>(state.range(0)));
+        std::string output((input.size() + 2) / 3 * 4, '\0');
+        for (auto _ : state)
+        {
+            detail::base64_encode_scalar(reinterpret_cast<const unsigned char*>(input.data()), input.size(), &output[0]);
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void base64_decode_scalar(benchmark::State& state)
+    {
+        std::string input = base64encode(make_base64_payload(static_cast<std::size_t>(state.range(0))));
+        std::string output(input.size() / 4 * 3, '\0');
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(detail::base64_decode_scalar(reinterpret_cast<const unsigned char*>(input.data()),
+                                                                  input.size(),
+                                                                  reinterpret_cast<unsigned char*>(&output[0])));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    BENCHMARK(base64_encode)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_decode)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_encode_span)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_decode_span)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_decode_url_span)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_validate)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_encode_scalar)->RangeMultiplier(16)->Range(64, 1 << 24);
+    BENCHMARK(base64_decode_scalar)->RangeMultiplier(16)->Range(64, 1 << 24);
+}
@@ -0,0 +1,81 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xtl/xbfloat16.hpp"
+
+namespace xtl
+{
+    inline std::vector<float> make_bfloat16_input(std::size_t size)
+    {
+        std::vector<float> res(size);
+        uint64_t state = 1;
+        for (auto& f : res)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            f = static_cast<float>(static_cast<int32_t>(state >> 32)) * 1e-6f;
+        }
+        return res;
+    }
+
+    void bfloat16_to_float(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<bfloat16> input(size);
+        convert(make_bfloat16_input(size), input);
+        std::vector<float> output(size);
+        for (auto _ : state)
+        {
+            convert(input, output);
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <bfloat16_rounding R>
+    void bfloat16_from_float(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<float> input = make_bfloat16_input(size);
+        std::vector<bfloat16> output(size);
+        for (auto _ : state)
+        {
+            convert(input, output, R);
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // One value at a time through the bfloat16 constructor
+    void bfloat16_from_float_loop(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<float> input = make_bfloat16_input(size);
+        std::vector<bfloat16> output(size);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                output[i] = input[i];
+            }
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    BENCHMARK(bfloat16_to_float)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK_TEMPLATE(bfloat16_from_float, bfloat16_rounding::nearest_even)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK_TEMPLATE(bfloat16_from_float, bfloat16_rounding::truncate)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(bfloat16_from_float_loop)->RangeMultiplier(16)->Range(64, 1 << 20);
+}
@@ -0,0 +1,416 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xtl/xbitset_rank_select.hpp"
+#include "xtl/xdynamic_bitset.hpp"
+#include "xtl/xdynamic_bitset_parallel.hpp"
+
+namespace xtl
+{
+    using bitset = xdynamic_bitset<uint64_t>;
+
+    inline bitset make_random_bitset(std::size_t size, uint64_t seed)
+    {
+        bitset res(size);
+        uint64_t state = seed;
+        uint64_t* data = res.data();
+        for (std::size_t i = 0; i < res.block_count(); ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            data[i] = state;
+        }
+        res.resize(size);
+        return res;
+    }
+
+    /*********
+     * count *
+     *********/
+
+    // Byte-wise lookup table count, kept as a reference point.
+    inline std::size_t table_count(const bitset& b)
+    {
+        static constexpr unsigned char table[] =
+        {
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+            1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+            1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+            2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+            1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+            2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+            2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+            3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
+        };
+        std::size_t res = 0;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(b.data());
+        std::size_t length = b.block_count() * sizeof(uint64_t);
+        for (std::size_t i = 0; i < length; ++i, ++p)
+        {
+            res += table[*p];
+        }
+        return res;
+    }
+
+    void count_table(benchmark::State& state)
+    {
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(table_count(b));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void count_scalar(benchmark::State& state)
+    {
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(detail_bitset::popcount_scalar(b.data(), b.block_count()));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void count_dispatch(benchmark::State& state)
+    {
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(b.count());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    BENCHMARK(count_table)->Range(1 << 10, 1 << 26);
+    BENCHMARK(count_scalar)->Range(1 << 10, 1 << 26);
+    BENCHMARK(count_dispatch)->Range(1 << 10, 1 << 26);
+
+    /***********
+     * bitwise *
+     ***********/
+
+    void and_assign_scalar(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 2);
+        for (auto _ : state)
+        {
+            detail_bitset::transform_blocks_scalar<detail_bitset::bitwise_and>(a.data(), a.data(), b.data(), a.block_count());
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void and_assign(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 2);
+        for (auto _ : state)
+        {
+            a &= b;
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void xor_operator(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 2);
+        for (auto _ : state)
+        {
+            bitset c = a ^ b;
+            benchmark::DoNotOptimize(c.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void equality(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = a;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(a == b);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    BENCHMARK(and_assign_scalar)->Range(1 << 10, 1 << 26);
+    BENCHMARK(and_assign)->Range(1 << 10, 1 << 26);
+    BENCHMARK(xor_operator)->Range(1 << 10, 1 << 26);
+    BENCHMARK(equality)->Range(1 << 10, 1 << 26);
+
+    /***************
+     * expressions *
+     ***************/
+
+    // Same computation as mask_expression, with one temporary per operator
+    void mask_temporaries(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<bitset> in;
+        for (uint64_t i = 0; i < 6; ++i)
+        {
+            in.push_back(make_random_bitset(size, i + 1));
+        }
+        bitset res(size);
+        for (auto _ : state)
+        {
+            bitset t0(in[0]);
+            t0 &= in[1];
+            bitset t1(in[2]);
+            t1 ^= in[3];
+            t1.flip();
+            bitset t2(in[4]);
+            t2 |= in[5];
+            t1 &= t2;
+            t0 |= t1;
+            res = t0;
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8 * 6);
+    }
+
+    void mask_expression(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<bitset> in;
+        for (uint64_t i = 0; i < 6; ++i)
+        {
+            in.push_back(make_random_bitset(size, i + 1));
+        }
+        bitset res(size);
+        for (auto _ : state)
+        {
+            res = (in[0] & in[1]) | (~(in[2] ^ in[3]) & (in[4] | in[5]));
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8 * 6);
+    }
+
+    void mask_expression_count(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<bitset> in;
+        for (uint64_t i = 0; i < 6; ++i)
+        {
+            in.push_back(make_random_bitset(size, i + 1));
+        }
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(((in[0] & in[1]) | (~(in[2] ^ in[3]) & (in[4] | in[5]))).count());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8 * 6);
+    }
+
+    BENCHMARK(mask_temporaries)->Range(1 << 10, 1 << 26);
+    BENCHMARK(mask_expression)->Range(1 << 10, 1 << 26);
+    BENCHMARK(mask_expression_count)->Range(1 << 10, 1 << 26);
+
+    /*****************
+     * set bit scans *
+     *****************/
+
+    // One set bit every 1024 bits, as for a mostly missing optional sequence
+    inline bitset make_sparse_bitset(std::size_t size)
+    {
+        bitset res(size, false);
+        for (std::size_t i = 0; i < size; i += 1024)
+        {
+            res[i] = true;
+        }
+        return res;
+    }
+
+    void set_bits_iterator(benchmark::State& state)
+    {
+        bitset b = make_sparse_bitset(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            std::size_t sum = 0;
+            auto end = b.cend();
+            for (auto it = b.cbegin(); it != end; ++it)
+            {
+                if (*it)
+                {
+                    sum += static_cast<std::size_t>(it - b.cbegin());
+                }
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void set_bits_find_next(benchmark::State& state)
+    {
+        bitset b = make_sparse_bitset(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            std::size_t sum = 0;
+            for (std::size_t i = b.find_first(); i != bitset::npos; i = b.find_next(i))
+            {
+                sum += i;
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void set_bits_range(benchmark::State& state)
+    {
+        bitset b = make_sparse_bitset(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            std::size_t sum = 0;
+            for (std::size_t i : b.set_bits())
+            {
+                sum += i;
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void set_bits_for_each(benchmark::State& state)
+    {
+        bitset b = make_sparse_bitset(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            std::size_t sum = 0;
+            b.for_each_set_bit([&sum](std::size_t i) { sum += i; });
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    BENCHMARK(set_bits_iterator)->Range(1 << 10, 1 << 22);
+    BENCHMARK(set_bits_find_next)->Range(1 << 10, 1 << 26);
+    BENCHMARK(set_bits_range)->Range(1 << 10, 1 << 26);
+    BENCHMARK(set_bits_for_each)->Range(1 << 10, 1 << 26);
+
+    /*****************
+     * rank / select *
+     *****************/
+
+    void rank(benchmark::State& state)
+    {
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        xbitset_rank_select<bitset> rs(b);
+        std::size_t mask = b.size() - 1;
+        for (auto _ : state)
+        {
+            std::size_t sum = 0;
+            for (std::size_t i = 0; i < 1024; ++i)
+            {
+                sum += rs.rank((i * 2654435761u) & mask);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 1024);
+    }
+
+    void select(benchmark::State& state)
+    {
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        xbitset_rank_select<bitset> rs(b);
+        std::size_t count = rs.count();
+        for (auto _ : state)
+        {
+            std::size_t sum = 0;
+            for (std::size_t i = 0; i < 1024; ++i)
+            {
+                sum += rs.select((i * 2654435761u) % count);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 1024);
+    }
+
+    BENCHMARK(rank)->Range(1 << 10, 1 << 26);
+    BENCHMARK(select)->Range(1 << 10, 1 << 26);
+
+    /**********
+     * shifts *
+     **********/
+
+    void shift_left_assign(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        for (auto _ : state)
+        {
+            a <<= 37;
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void shift_or_temporaries(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 2);
+        for (auto _ : state)
+        {
+            a |= b << 37;
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void shift_or_fused(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 2);
+        for (auto _ : state)
+        {
+            a.shift_or(b, 37);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    BENCHMARK(shift_left_assign)->Range(1 << 10, 1 << 26);
+    BENCHMARK(shift_or_temporaries)->Range(1 << 10, 1 << 26);
+    BENCHMARK(shift_or_fused)->Range(1 << 10, 1 << 26);
+
+    /************
+     * parallel *
+     ************/
+
+    void count_parallel(benchmark::State& state)
+    {
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(parallel_count(b));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    void and_assign_parallel(benchmark::State& state)
+    {
+        bitset a = make_random_bitset(static_cast<std::size_t>(state.range(0)), 1);
+        bitset b = make_random_bitset(static_cast<std::size_t>(state.range(0)), 2);
+        for (auto _ : state)
+        {
+            parallel_and_assign(a, b);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0) / 8);
+    }
+
+    BENCHMARK(count_parallel)->Range(1 << 20, 1 << 30)->UseRealTime();
+    BENCHMARK(and_assign_parallel)->Range(1 << 20, 1 << 30)->UseRealTime();
+}
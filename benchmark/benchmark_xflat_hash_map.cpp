@@ -0,0 +1,157 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xtl/xbasic_fixed_string.hpp"
+#include "xtl/xflat_hash_map.hpp"
+
+namespace xtl
+{
+    using map_string_key = xfixed_string<15>;
+
+    using int_flat_map = xflat_hash_map<uint64_t, uint64_t>;
+    using int_std_map = std::unordered_map<uint64_t, uint64_t>;
+    using string_flat_map = xflat_hash_map<map_string_key, uint64_t, xstring_hash, xstring_equal>;
+    using string_std_map = std::unordered_map<map_string_key, uint64_t, xstring_hash, xstring_equal>;
+
+    // Distinct pseudo random keys, the first count ones are inserted and
+    // the next count ones are missing from the maps
+    template <class K>
+    std::vector<K> make_map_keys(std::size_t count)
+    {
+        std::vector<K> res;
+        res.reserve(2 * count);
+        uint64_t state = 1;
+        for (std::size_t i = 0; i < 2 * count; ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t key = (state & ~uint64_t(0xFFFFF)) | i;
+            if constexpr (std::is_same<K, uint64_t>::value)
+            {
+                res.push_back(key);
+            }
+            else
+            {
+                res.push_back(K(std::to_string(key).substr(0, 15 - 7).append(std::to_string(i)).c_str()));
+            }
+        }
+        return res;
+    }
+
+    template <class M>
+    M make_filled_map(const std::vector<typename M::key_type>& keys, std::size_t count)
+    {
+        M res;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            res.emplace(keys[i], i);
+        }
+        return res;
+    }
+
+    template <class M>
+    void map_insert(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        auto keys = make_map_keys<typename M::key_type>(count);
+        for (auto _ : state)
+        {
+            M map;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                map.emplace(keys[i], i);
+            }
+            benchmark::DoNotOptimize(map.size());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <class M>
+    void map_find_hit(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        auto keys = make_map_keys<typename M::key_type>(count);
+        M map = make_filled_map<M>(keys, count);
+        for (auto _ : state)
+        {
+            uint64_t sum = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                sum += map.find(keys[i])->second;
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <class M>
+    void map_find_miss(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        auto keys = make_map_keys<typename M::key_type>(count);
+        M map = make_filled_map<M>(keys, count);
+        for (auto _ : state)
+        {
+            std::size_t found = 0;
+            for (std::size_t i = count; i < 2 * count; ++i)
+            {
+                found += map.find(keys[i]) != map.end();
+            }
+            benchmark::DoNotOptimize(found);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // Each item is an erase followed by the insertion of the same key,
+    // the map size stays constant
+    template <class M>
+    void map_erase(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        auto keys = make_map_keys<typename M::key_type>(count);
+        M map = make_filled_map<M>(keys, count);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                map.erase(keys[i]);
+                map.emplace(keys[i], i);
+            }
+            benchmark::DoNotOptimize(map.size());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    BENCHMARK_TEMPLATE(map_insert, int_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_insert, int_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_insert, string_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_insert, string_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+    BENCHMARK_TEMPLATE(map_find_hit, int_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_find_hit, int_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_find_hit, string_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_find_hit, string_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+    BENCHMARK_TEMPLATE(map_find_miss, int_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_find_miss, int_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_find_miss, string_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_find_miss, string_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+    BENCHMARK_TEMPLATE(map_erase, int_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_erase, int_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_erase, string_std_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    BENCHMARK_TEMPLATE(map_erase, string_flat_map)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+}
@@ -0,0 +1,278 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xtl/xhalf_float.hpp"
+
+namespace xtl
+{
+    inline std::vector<float> make_half_float_input(std::size_t size, uint64_t seed = 1)
+    {
+        std::vector<float> res(size);
+        uint64_t state = seed;
+        for (auto& f : res)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            f = static_cast<float>(static_cast<int32_t>(state >> 32)) * 1e-6f;
+        }
+        return res;
+    }
+
+    void half_float_to_float(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> input(size);
+        convert(make_half_float_input(size), input);
+        std::vector<float> output(size);
+        for (auto _ : state)
+        {
+            convert(input, output);
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void half_float_from_float(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<float> input = make_half_float_input(size);
+        std::vector<half_float> output(size);
+        for (auto _ : state)
+        {
+            convert(input, output);
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // One value at a time through the half_float conversion operators
+    void half_float_to_float_loop(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> input(size);
+        convert(make_half_float_input(size), input);
+        std::vector<float> output(size);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                output[i] = input[i];
+            }
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void half_float_from_float_loop(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<float> input = make_half_float_input(size);
+        std::vector<half_float> output(size);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                output[i] = input[i];
+            }
+            benchmark::DoNotOptimize(output.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void half_float_fma(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x(size);
+        std::vector<half_float> y(size);
+        convert(make_half_float_input(size), x);
+        convert(make_half_float_input(size, 2), y);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            fma(x, y, x, res);
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void half_float_fma_loop(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x(size);
+        std::vector<half_float> y(size);
+        convert(make_half_float_input(size), x);
+        convert(make_half_float_input(size, 2), y);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res[i] = fma(x[i], y[i], x[i]);
+            }
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void half_float_dot(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x(size);
+        std::vector<half_float> y(size);
+        convert(make_half_float_input(size), x);
+        convert(make_half_float_input(size, 2), y);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(dot(x, y));
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // Accumulated in half_float, as a plain loop on the operators
+    void half_float_dot_loop(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x(size);
+        std::vector<half_float> y(size);
+        convert(make_half_float_input(size), x);
+        convert(make_half_float_input(size, 2), y);
+        for (auto _ : state)
+        {
+            half_float acc(0.f);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                acc = fma(x[i], y[i], acc);
+            }
+            benchmark::DoNotOptimize(acc);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void half_float_minmax(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x(size);
+        convert(make_half_float_input(size), x);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(minmax(x));
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    // Values in [-2147 * scale, 2147 * scale], or their magnitudes
+    inline std::vector<half_float> make_half_math_input(std::size_t size, float scale, bool positive, uint64_t seed = 1)
+    {
+        std::vector<float> values = make_half_float_input(size, seed);
+        for (auto& f : values)
+        {
+            f = positive ? std::fabs(f) * scale : f * scale;
+        }
+        std::vector<half_float> res(size);
+        convert(values, res);
+        return res;
+    }
+
+    template <class P>
+    void half_float_exp(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x = make_half_math_input(size, 0.004f, false);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            exp(x, res, P());
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <class P>
+    void half_float_log(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x = make_half_math_input(size, 0.01f, true);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            log(x, res, P());
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <class P>
+    void half_float_sin(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x = make_half_math_input(size, 0.01f, false);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            sin(x, res, P());
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <class P>
+    void half_float_erf(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x = make_half_math_input(size, 0.002f, false);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            erf(x, res, P());
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <class P>
+    void half_float_pow(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::vector<half_float> x = make_half_math_input(size, 0.01f, true);
+        std::vector<half_float> y = make_half_math_input(size, 0.002f, false, 2);
+        std::vector<half_float> res(size);
+        for (auto _ : state)
+        {
+            pow(x, y, res, P());
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    BENCHMARK(half_float_to_float)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_from_float)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_to_float_loop)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_from_float_loop)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_fma)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_fma_loop)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_dot)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_dot_loop)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK(half_float_minmax)->RangeMultiplier(16)->Range(64, 1 << 20);
+    BENCHMARK_TEMPLATE(half_float_exp, half_exact_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_exp, half_fast_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_log, half_exact_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_log, half_fast_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_sin, half_exact_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_sin, half_fast_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_erf, half_exact_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_erf, half_fast_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_pow, half_exact_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+    BENCHMARK_TEMPLATE(half_float_pow, half_fast_math)->RangeMultiplier(16)->Range(64, 1 << 16);
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xtl/xhash.hpp"
+
+namespace xtl
+{
+    inline std::vector<unsigned char> make_hash_input(std::size_t size)
+    {
+        std::vector<unsigned char> res(size);
+        uint64_t state = 1;
+        for (auto& c : res)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            c = static_cast<unsigned char>(state >> 56);
+        }
+        return res;
+    }
+
+    template <class F>
+    void hash_throughput(benchmark::State& state, F f)
+    {
+        std::vector<unsigned char> input = make_hash_input(static_cast<std::size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(f(input.data(), input.size()));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void hash_murmur2_x64(benchmark::State& state)
+    {
+        hash_throughput(state, [](const void* p, std::size_t n) { return murmur2_x64(p, n, 0); });
+    }
+
+    void hash_xxh3_64(benchmark::State& state)
+    {
+        hash_throughput(state, [](const void* p, std::size_t n) { return xxh3_64(p, n, 0); });
+    }
+
+    void hash_xxh3_128(benchmark::State& state)
+    {
+        hash_throughput(state, [](const void* p, std::size_t n) { return xxh3_128(p, n, 0).low; });
+    }
+
+    BENCHMARK(hash_murmur2_x64)->RangeMultiplier(4)->Range(4, 1 << 20);
+    BENCHMARK(hash_xxh3_64)->RangeMultiplier(4)->Range(4, 1 << 20);
+    BENCHMARK(hash_xxh3_128)->RangeMultiplier(4)->Range(4, 1 << 20);
+
+    template <std::size_t K>
+    void hash_keys_loop(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        std::vector<unsigned char> keys = make_hash_input(count * K);
+        std::vector<std::size_t> res(count);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                res[i] = hash_bytes(keys.data() + i * K, K, 0);
+            }
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    template <std::size_t K>
+    void hash_keys_batch(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        std::vector<unsigned char> keys = make_hash_input(count * K);
+        std::vector<std::size_t> res(count);
+        for (auto _ : state)
+        {
+            hash_bytes_batch(keys.data(), K, res, 0);
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void hash_keys_object(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        std::vector<std::array<uint32_t, 3>> keys(count);
+        std::vector<unsigned char> input = make_hash_input(count * sizeof(keys[0]));
+        std::memcpy(keys.data(), input.data(), input.size());
+        std::vector<std::size_t> res(count);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                res[i] = hash_object(keys[i], 0);
+            }
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void hash_keys_bytes(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        std::vector<std::array<uint32_t, 3>> keys(count);
+        std::vector<unsigned char> input = make_hash_input(count * sizeof(keys[0]));
+        std::memcpy(keys.data(), input.data(), input.size());
+        std::vector<std::size_t> res(count);
+        for (auto _ : state)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                res[i] = hash_bytes(keys[i].data(), sizeof(keys[i]), 0);
+            }
+            benchmark::DoNotOptimize(res.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    BENCHMARK(hash_keys_bytes)->Arg(4096);
+    BENCHMARK(hash_keys_object)->Arg(4096);
+
+    BENCHMARK_TEMPLATE(hash_keys_loop, 4)->Arg(4096);
+    BENCHMARK_TEMPLATE(hash_keys_batch, 4)->Arg(4096);
+    BENCHMARK_TEMPLATE(hash_keys_loop, 8)->Arg(4096);
+    BENCHMARK_TEMPLATE(hash_keys_batch, 8)->Arg(4096);
+    BENCHMARK_TEMPLATE(hash_keys_loop, 16)->Arg(4096);
+    BENCHMARK_TEMPLATE(hash_keys_batch, 16)->Arg(4096);
+}
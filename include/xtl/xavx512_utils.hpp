@@ -0,0 +1,55 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XAVX512_UTILS_HPP
+#define XTL_XAVX512_UTILS_HPP
+
+#include "xplatform.hpp"
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+#include <immintrin.h>
+
+namespace xtl
+{
+    namespace detail
+    {
+        /*********************************
+         * AVX-512 16-bit lane transfers *
+         *********************************/
+
+        // Loads and stores of 16 lanes of 16-bit values (binary16 or raw
+        // bits) widened to or narrowed from 32-bit lanes. GCC implements the
+        // unmasked conversion intrinsics as masked ones with an undefined
+        // pass-through operand, which it then reports as uninitialized; the
+        // zero-masking forms with a full mask give the same code.
+
+        XTL_TARGET("avx512f") inline __m512 avx512_load_ph(const void* in) noexcept
+        {
+            __m256i h = _mm256_loadu_si256(static_cast<const __m256i*>(in));
+            return _mm512_maskz_cvtph_ps(__mmask16(0xFFFF), h);
+        }
+
+        template <int R>
+        XTL_TARGET("avx512f") inline void avx512_store_ph(void* out, __m512 value) noexcept
+        {
+            _mm256_storeu_si256(static_cast<__m256i*>(out), _mm512_maskz_cvtps_ph(__mmask16(0xFFFF), value, R));
+        }
+
+        XTL_TARGET("avx512f") inline __m512i avx512_load_epu16(const void* in) noexcept
+        {
+            __m256i h = _mm256_loadu_si256(static_cast<const __m256i*>(in));
+            return _mm512_maskz_cvtepu16_epi32(__mmask16(0xFFFF), h);
+        }
+    }
+}
+
+#endif
+
+#endif
@@ -10,68 +10,1429 @@
 #ifndef XTL_BASE64_HPP
 #define XTL_BASE64_HPP
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <type_traits>
 
+#include "xbit_utils.hpp"
+#include "xplatform.hpp"
 #include "xsequence.hpp"
+#include "xspan.hpp"
+#include "xtl_config.hpp"
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+#include <immintrin.h>
+#endif
 
 namespace xtl
 {
-    inline std::string base64decode(const std::string& input)
+    namespace detail
+    {
+        template <class O>
+        using enable_base64_iterator_t = std::enable_if_t<!std::is_convertible<O, span<char>>::value &&
+                                                          !std::is_convertible<O, span<std::byte>>::value, int>;
+    }
+
+    /**
+     * base64 alphabets, which only differ by the characters of the values
+     * 62 and 63.
+     */
+    struct base64_standard_alphabet
+    {
+        static constexpr char value_62 = '+';
+        static constexpr char value_63 = '/';
+    };
+
+    struct base64_url_alphabet
+    {
+        static constexpr char value_62 = '-';
+        static constexpr char value_63 = '_';
+    };
+
+    /**
+     * Padding policy of xbase64_codec: the padding is written unless it is
+     * omitted, and decoding requires it, accepts padded and unpadded input,
+     * or rejects it.
+     */
+    enum class base64_padding
+    {
+        required,
+        optional,
+        omitted
+    };
+
+    constexpr std::size_t base64_encoded_size(std::size_t size) noexcept;
+    std::size_t base64_decoded_size(span<const char> input) noexcept;
+
+    std::string base64decode(const std::string& input);
+    std::size_t base64decode(span<const char> input, span<char> output);
+    std::size_t base64decode(span<const char> input, span<std::byte> output);
+
+    template <class O, detail::enable_base64_iterator_t<O> = 0>
+    O base64decode(span<const char> input, O output);
+
+    std::string base64encode(const std::string& input);
+    std::size_t base64encode(span<const char> input, span<char> output);
+    std::size_t base64encode(span<const std::byte> input, span<char> output);
+
+    template <class O, detail::enable_base64_iterator_t<O> = 0>
+    O base64encode(span<const char> input, O output);
+
+    template <class O, detail::enable_base64_iterator_t<O> = 0>
+    O base64encode(span<const std::byte> input, O output);
+
+    namespace detail
+    {
+        /*****************
+         * base64 tables *
+         *****************/
+
+        constexpr std::array<char, 64> make_base64_alphabet(char value_62, char value_63) noexcept
+        {
+            std::array<char, 64> res = {};
+            for (std::size_t i = 0; i < 26; ++i)
+            {
+                res[i] = static_cast<char>('A' + i);
+                res[i + 26] = static_cast<char>('a' + i);
+            }
+            for (std::size_t i = 0; i < 10; ++i)
+            {
+                res[i + 52] = static_cast<char>('0' + i);
+            }
+            res[62] = value_62;
+            res[63] = value_63;
+            return res;
+        }
+
+        // 6-bit value of each character, -1 outside of the alphabet
+        constexpr std::array<signed char, 256> make_base64_decode_table(const std::array<char, 64>& alphabet) noexcept
+        {
+            std::array<signed char, 256> res = {};
+            for (std::size_t i = 0; i < 256; ++i)
+            {
+                res[i] = -1;
+            }
+            for (std::size_t i = 0; i < 64; ++i)
+            {
+                res[static_cast<unsigned char>(alphabet[i])] = static_cast<signed char>(i);
+            }
+            return res;
+        }
+
+        // Offsets added to the 6-bit values by the vector encoders, indexed
+        // as 13 for A-Z, 0 for a-z, 1 to 10 for the digits, 11 and 12 for
+        // the values 62 and 63
+        constexpr std::array<char, 16> make_base64_encode_offsets(const std::array<char, 64>& alphabet) noexcept
+        {
+            std::array<char, 16> res = {};
+            res[0] = static_cast<char>(alphabet[26] - 26);
+            for (std::size_t i = 1; i < 11; ++i)
+            {
+                res[i] = static_cast<char>(alphabet[52] - 52);
+            }
+            res[11] = static_cast<char>(alphabet[62] - 62);
+            res[12] = static_cast<char>(alphabet[63] - 63);
+            res[13] = alphabet[0];
+            return res;
+        }
+
+        // Lookups of the vector decoders: mask has the bit h of its entry l
+        // set for the character 16 * h + l of the alphabet, shift maps the
+        // characters to their values by high nibble, but for blend_char
+        // which shares its high nibble with characters of another shift.
+        // Alphabets that need more than one such character, or that use
+        // non-ASCII characters, do not fit and are decoded by the scalar
+        // kernels.
+        struct base64_decode_luts
+        {
+            std::array<char, 16> mask;
+            std::array<char, 16> shift;
+            char blend_char;
+            char blend_shift;
+            bool fits;
+        };
+
+        constexpr base64_decode_luts make_base64_decode_luts(const std::array<char, 64>& alphabet) noexcept
+        {
+            base64_decode_luts res = {};
+            res.fits = true;
+            bool used[16] = {};
+            bool blended = false;
+            for (std::size_t i = 0; i < 64; ++i)
+            {
+                unsigned int c = static_cast<unsigned char>(alphabet[i]);
+                unsigned int high = c >> 4;
+                if (high >= 8)
+                {
+                    res.fits = false;
+                    continue;
+                }
+                char shift = static_cast<char>(static_cast<int>(i) - static_cast<int>(c));
+                res.mask[c & 0x0f] = static_cast<char>(static_cast<unsigned char>(res.mask[c & 0x0f]) | (1u << high));
+                if (!used[high])
+                {
+                    used[high] = true;
+                    res.shift[high] = shift;
+                }
+                else if (res.shift[high] != shift)
+                {
+                    res.fits = res.fits && !blended;
+                    blended = true;
+                    res.blend_char = alphabet[i];
+                    res.blend_shift = shift;
+                }
+            }
+            return res;
+        }
+
+        template <class A>
+        struct base64_tables
+        {
+            static constexpr std::array<char, 64> alphabet = make_base64_alphabet(A::value_62, A::value_63);
+            static constexpr std::array<signed char, 256> decode = make_base64_decode_table(alphabet);
+            static constexpr std::array<char, 16> encode_offsets = make_base64_encode_offsets(alphabet);
+            static constexpr base64_decode_luts decode_luts = make_base64_decode_luts(alphabet);
+        };
+
+        /******************
+         * scalar kernels *
+         ******************/
+
+        // Writes 4 * ceil(size / 3) characters, padded with '='
+        template <class A = base64_standard_alphabet>
+        inline void base64_encode_scalar(const unsigned char* in, std::size_t size, char* out) noexcept
+        {
+            const auto& alphabet = base64_tables<A>::alphabet;
+            std::size_t i = 0;
+            for (; i + 3 <= size; i += 3, out += 4)
+            {
+                uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | uint32_t(in[i + 2]);
+                out[0] = alphabet[v >> 18];
+                out[1] = alphabet[(v >> 12) & 0x3F];
+                out[2] = alphabet[(v >> 6) & 0x3F];
+                out[3] = alphabet[v & 0x3F];
+            }
+            if (i < size)
+            {
+                bool two_bytes = i + 1 < size;
+                uint32_t v = (uint32_t(in[i]) << 16) | (two_bytes ? uint32_t(in[i + 1]) << 8 : 0u);
+                out[0] = alphabet[v >> 18];
+                out[1] = alphabet[(v >> 12) & 0x3F];
+                out[2] = two_bytes ? alphabet[(v >> 6) & 0x3F] : '=';
+                out[3] = '=';
+            }
+        }
+
+        // Decodes up to the first character outside of the alphabet, usually
+        // the padding, and returns the number of bytes written. A trailing
+        // group of k < 4 characters gives floor(6 * k / 8) bytes.
+        template <class A = base64_standard_alphabet>
+        inline std::size_t base64_decode_scalar(const unsigned char* in, std::size_t size, unsigned char* out) noexcept
+        {
+            const auto& table = base64_tables<A>::decode;
+            unsigned char* first = out;
+            std::size_t i = 0;
+            for (; i + 4 <= size; i += 4, out += 3)
+            {
+                int a = table[in[i]];
+                int b = table[in[i + 1]];
+                int c = table[in[i + 2]];
+                int d = table[in[i + 3]];
+                if ((a | b | c | d) < 0)
+                {
+                    break;
+                }
+                uint32_t v = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | uint32_t(d);
+                out[0] = static_cast<unsigned char>(v >> 16);
+                out[1] = static_cast<unsigned char>(v >> 8);
+                out[2] = static_cast<unsigned char>(v);
+            }
+
+            uint32_t v = 0;
+            std::size_t count = 0;
+            for (; i < size && table[in[i]] >= 0; ++i, ++count)
+            {
+                v = (v << 6) | uint32_t(table[in[i]]);
+            }
+            if (count == 2)
+            {
+                *out++ = static_cast<unsigned char>(v >> 4);
+            }
+            else if (count == 3)
+            {
+                *out++ = static_cast<unsigned char>(v >> 10);
+                *out++ = static_cast<unsigned char>(v >> 2);
+            }
+            return static_cast<std::size_t>(out - first);
+        }
+
+        // Returns the offset of the first character outside of the
+        // alphabet, size if there is none
+        template <class A = base64_standard_alphabet>
+        inline std::size_t base64_validate_scalar(const unsigned char* in, std::size_t size) noexcept
+        {
+            const auto& table = base64_tables<A>::decode;
+            std::size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+            {
+                if ((table[in[i]] | table[in[i + 1]] | table[in[i + 2]] | table[in[i + 3]]) < 0)
+                {
+                    break;
+                }
+            }
+            while (i < size && table[in[i]] >= 0)
+            {
+                ++i;
+            }
+            return i;
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        /****************
+         * SIMD kernels *
+         ****************/
+
+        // The vector kernels follow "Faster Base64 Encoding and Decoding
+        // Using AVX2 Instructions", Mula and Lemire: 3-byte groups are spread
+        // over 4 bytes with shuffles and multiplications, and characters are
+        // mapped to and from their 6-bit values with nibble-indexed pshufb
+        // lookups. The scalar kernels process the tails.
+
+        XTL_TARGET("sse4.1") inline __m128i base64_load_lut_sse41(const std::array<char, 16>& lut) noexcept
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(lut.data()));
+        }
+
+        template <class A>
+        XTL_TARGET("sse4.1") inline __m128i base64_encode_block_sse41(__m128i in) noexcept
+        {
+            in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+            __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+            __m128i indices = _mm_or_si128(t0, t1);
+
+            __m128i offset_index = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+            __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+            offset_index = _mm_or_si128(offset_index, _mm_and_si128(upper, _mm_set1_epi8(13)));
+            const __m128i offsets = base64_load_lut_sse41(base64_tables<A>::encode_offsets);
+            return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, offset_index));
+        }
+
+        // Returns the movemask of the characters outside of the alphabet
+        template <class A>
+        XTL_TARGET("sse4.1") inline int base64_invalid_mask_sse41(__m128i in, __m128i& high) noexcept
+        {
+            const __m128i mask_lut = base64_load_lut_sse41(base64_tables<A>::decode_luts.mask);
+            const __m128i bit_lut = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80),
+                                                  0, 0, 0, 0, 0, 0, 0, 0);
+            high = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+            __m128i low = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+            __m128i valid = _mm_and_si128(_mm_shuffle_epi8(mask_lut, low), _mm_shuffle_epi8(bit_lut, high));
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(valid, _mm_setzero_si128()));
+        }
+
+        // Returns false if block holds a character outside of the alphabet
+        template <class A>
+        XTL_TARGET("sse4.1") inline bool base64_decode_block_sse41(__m128i in, __m128i& out) noexcept
+        {
+            constexpr const base64_decode_luts& luts = base64_tables<A>::decode_luts;
+            __m128i high;
+            if (base64_invalid_mask_sse41<A>(in, high) != 0)
+            {
+                return false;
+            }
+            __m128i shift = _mm_blendv_epi8(_mm_shuffle_epi8(base64_load_lut_sse41(luts.shift), high),
+                                            _mm_set1_epi8(luts.blend_shift),
+                                            _mm_cmpeq_epi8(in, _mm_set1_epi8(luts.blend_char)));
+            __m128i values = _mm_add_epi8(in, shift);
+
+            __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+            out = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+            return true;
+        }
+
+        template <class A = base64_standard_alphabet>
+        XTL_TARGET("sse4.1") XTL_NOINLINE void base64_encode_sse41(const unsigned char* in, std::size_t size, char* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 12, out += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_encode_block_sse41<A>(block));
+            }
+            base64_encode_scalar<A>(in + i, size - i, out);
+        }
+
+        // The 16-byte stores write 4 bytes past the 12 decoded ones, the loop
+        // stops early enough for them to stay within the output.
+        template <class A = base64_standard_alphabet>
+        XTL_TARGET("sse4.1") XTL_NOINLINE std::size_t base64_decode_sse41(const unsigned char* in, std::size_t size, unsigned char* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 24 <= size; i += 16)
+            {
+                __m128i block;
+                if (!base64_decode_block_sse41<A>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), block))
+                {
+                    break;
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 4 * 3), block);
+            }
+            return i / 4 * 3 + base64_decode_scalar<A>(in + i, size - i, out + i / 4 * 3);
+        }
+
+        template <class A = base64_standard_alphabet>
+        XTL_TARGET("sse4.1") XTL_NOINLINE std::size_t base64_validate_sse41(const unsigned char* in, std::size_t size) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i high;
+                int invalid = base64_invalid_mask_sse41<A>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), high);
+                if (invalid != 0)
+                {
+                    return i + detail::countr_zero(static_cast<unsigned int>(invalid));
+                }
+            }
+            return i + base64_validate_scalar<A>(in + i, size - i);
+        }
+
+        template <class A>
+        XTL_TARGET("avx2") inline __m256i base64_encode_block_avx2(__m256i in) noexcept
+        {
+            in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                                          1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+            __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+            __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+            __m256i indices = _mm256_or_si256(t0, t1);
+
+            __m256i offset_index = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+            __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+            offset_index = _mm256_or_si256(offset_index, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+            const __m256i offsets = _mm256_broadcastsi128_si256(base64_load_lut_sse41(base64_tables<A>::encode_offsets));
+            return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, offset_index));
+        }
+
+        template <class A>
+        XTL_TARGET("avx2") inline uint32_t base64_invalid_mask_avx2(__m256i in, __m256i& high) noexcept
+        {
+            const __m256i mask_lut = _mm256_broadcastsi128_si256(base64_load_lut_sse41(base64_tables<A>::decode_luts.mask));
+            const __m256i bit_lut = _mm256_broadcastsi128_si256(
+                _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0));
+            high = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+            __m256i low = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+            __m256i valid = _mm256_and_si256(_mm256_shuffle_epi8(mask_lut, low), _mm256_shuffle_epi8(bit_lut, high));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(valid, _mm256_setzero_si256())));
+        }
+
+        template <class A>
+        XTL_TARGET("avx2") inline bool base64_decode_block_avx2(__m256i in, __m256i& out) noexcept
+        {
+            constexpr const base64_decode_luts& luts = base64_tables<A>::decode_luts;
+            __m256i high;
+            if (base64_invalid_mask_avx2<A>(in, high) != 0)
+            {
+                return false;
+            }
+            const __m256i shift_lut = _mm256_broadcastsi128_si256(base64_load_lut_sse41(luts.shift));
+            __m256i shift = _mm256_blendv_epi8(_mm256_shuffle_epi8(shift_lut, high), _mm256_set1_epi8(luts.blend_shift),
+                                               _mm256_cmpeq_epi8(in, _mm256_set1_epi8(luts.blend_char)));
+            __m256i values = _mm256_add_epi8(in, shift);
+
+            __m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+                                               _mm256_set1_epi32(0x00011000));
+            merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                                  2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+            out = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+            return true;
+        }
+
+        // Each lane encodes 12 bytes, loaded from two overlapping 16-byte reads.
+        // The 16-byte tail loops are inlined rather than calling the SSE4.1
+        // kernels, whose legacy SSE encoding would pay AVX transition stalls.
+        template <class A = base64_standard_alphabet>
+        XTL_TARGET("avx2") XTL_NOINLINE void base64_encode_avx2(const unsigned char* in, std::size_t size, char* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 28 <= size; i += 24, out += 32)
+            {
+                __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+                __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), base64_encode_block_avx2<A>(block));
+            }
+            for (; i + 16 <= size; i += 12, out += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_encode_block_sse41<A>(block));
+            }
+            base64_encode_scalar<A>(in + i, size - i, out);
+        }
+
+        template <class A = base64_standard_alphabet>
+        XTL_TARGET("avx2") XTL_NOINLINE std::size_t base64_decode_avx2(const unsigned char* in, std::size_t size, unsigned char* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 44 <= size; i += 32)
+            {
+                __m256i block;
+                if (!base64_decode_block_avx2<A>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), block))
+                {
+                    break;
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i / 4 * 3), block);
+            }
+            for (; i + 24 <= size; i += 16)
+            {
+                __m128i block;
+                if (!base64_decode_block_sse41<A>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), block))
+                {
+                    break;
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 4 * 3), block);
+            }
+            return i / 4 * 3 + base64_decode_scalar<A>(in + i, size - i, out + i / 4 * 3);
+        }
+
+        template <class A = base64_standard_alphabet>
+        XTL_TARGET("avx2") XTL_NOINLINE std::size_t base64_validate_avx2(const unsigned char* in, std::size_t size) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i high;
+                uint32_t invalid = base64_invalid_mask_avx2<A>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), high);
+                if (invalid != 0)
+                {
+                    return i + detail::countr_zero(invalid);
+                }
+            }
+            return i + base64_validate_scalar<A>(in + i, size - i);
+        }
+
+#endif
+
+        struct base64_kernels
+        {
+            void (*encode)(const unsigned char*, std::size_t, char*) noexcept;
+            std::size_t (*decode)(const unsigned char*, std::size_t, unsigned char*) noexcept;
+            std::size_t (*validate)(const unsigned char*, std::size_t) noexcept;
+        };
+
+        template <class A = base64_standard_alphabet>
+        inline const base64_kernels& select_base64_kernels() noexcept
+        {
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            static const base64_kernels kernels = []() -> base64_kernels {
+                const cpu_features& features = available_cpu_features();
+                constexpr bool simd_decode = base64_tables<A>::decode_luts.fits;
+                if (features.avx2)
+                {
+                    if (simd_decode)
+                    {
+                        return {&base64_encode_avx2<A>, &base64_decode_avx2<A>, &base64_validate_avx2<A>};
+                    }
+                    return {&base64_encode_avx2<A>, &base64_decode_scalar<A>, &base64_validate_scalar<A>};
+                }
+                if (features.sse4_1)
+                {
+                    if (simd_decode)
+                    {
+                        return {&base64_encode_sse41<A>, &base64_decode_sse41<A>, &base64_validate_sse41<A>};
+                    }
+                    return {&base64_encode_sse41<A>, &base64_decode_scalar<A>, &base64_validate_scalar<A>};
+                }
+                return {&base64_encode_scalar<A>, &base64_decode_scalar<A>, &base64_validate_scalar<A>};
+            }();
+#else
+            static const base64_kernels kernels = {&base64_encode_scalar<A>, &base64_decode_scalar<A>,
+                                                   &base64_validate_scalar<A>};
+#endif
+            return kernels;
+        }
+    }
+
+    namespace detail
     {
-        std::array<int, 256> T;
-        T.fill(-1);
-        for (std::size_t i = 0; i < 64; ++i)
+        // Characters before the '=' padding, where decoding stops
+        inline std::size_t base64_unpadded_size(const char* input, std::size_t size) noexcept
+        {
+            while (size != 0 && input[size - 1] == '=')
+            {
+                --size;
+            }
+            return size;
+        }
+
+        // The kernels may store past the decoded bytes, within the
+        // 3 * size / 4 bytes given by their input size; trailing padding is
+        // removed first so that the decoded size is enough.
+        inline std::size_t base64_decode_bytes(const char* input, std::size_t size, unsigned char* output) noexcept
+        {
+            return select_base64_kernels().decode(reinterpret_cast<const unsigned char*>(input),
+                                                  base64_unpadded_size(input, size),
+                                                  output);
+        }
+
+        inline std::size_t base64_encode_bytes(const unsigned char* input, std::size_t size, span<char> output)
+        {
+            std::size_t res = base64_encoded_size(size);
+            if (output.size() < res)
+            {
+                XTL_THROW(std::length_error, "base64encode: output span is too small");
+            }
+            select_base64_kernels().encode(input, size, output.data());
+            return res;
+        }
+
+        inline std::size_t base64_decode_bytes(span<const char> input, unsigned char* output, std::size_t output_size)
         {
-            T[std::size_t("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[i])] = int(i);
+            if (output_size < base64_decoded_size(input))
+            {
+                XTL_THROW(std::length_error, "base64decode: output span is too small");
+            }
+            return base64_decode_bytes(input.data(), input.size(), output);
         }
 
-        std::string output;
-        int val = 0;
-        int valb = -8;
-        for (char c : input)
+        // Encodes through a stack buffer, in chunks of a multiple of 3 bytes,
+        // unless output is a plain pointer
+        template <class O>
+        inline O base64_encode_iterator(const unsigned char* input, std::size_t size, O output)
         {
-            if (T[std::size_t(c)] == -1)
+            if constexpr (std::is_same<O, char*>::value)
             {
-                break;
+                select_base64_kernels().encode(input, size, output);
+                return output + base64_encoded_size(size);
             }
-            val = (val << 6) + T[std::size_t(c)];
-            valb += 6;
-            if (valb >= 0)
+            constexpr std::size_t chunk_size = 768;
+            char buffer[chunk_size / 3 * 4];
+            for (std::size_t i = 0; i < size; i += chunk_size)
             {
-                output.push_back(char((val >> valb) & 0xFF));
-                valb -= 8;
+                std::size_t count = std::min(chunk_size, size - i);
+                select_base64_kernels().encode(input + i, count, buffer);
+                output = std::copy(buffer, buffer + base64_encoded_size(count), output);
             }
+            return output;
         }
+
+        // Decodes through a stack buffer. When size is a multiple of 4,
+        // complete is set to false if the decoding stopped at a character
+        // outside of the alphabet.
+        template <class O>
+        inline O base64_decode_iterator(const char* input, std::size_t size, O output, bool& complete)
+        {
+            constexpr std::size_t chunk_size = 1024;
+            unsigned char buffer[chunk_size / 4 * 3];
+            complete = true;
+            for (std::size_t i = 0; i < size && complete; i += chunk_size)
+            {
+                std::size_t count = std::min(chunk_size, size - i);
+                std::size_t written = select_base64_kernels().decode(reinterpret_cast<const unsigned char*>(input + i),
+                                                                     count, buffer);
+                output = std::transform(buffer, buffer + written, output, [](unsigned char c) { return static_cast<char>(c); });
+                complete = written == count * 3 / 4;
+            }
+            return output;
+        }
+    }
+
+    /*************************
+     * base64 implementation *
+     *************************/
+
+    /**
+     * Number of characters written by base64encode for size bytes,
+     * padding included.
+     */
+    constexpr std::size_t base64_encoded_size(std::size_t size) noexcept
+    {
+        return (size + 2) / 3 * 4;
+    }
+
+    /**
+     * Number of bytes written by base64decode for a well-formed input,
+     * with or without padding. Decoding stops early at a character outside
+     * of the alphabet, the decode functions return the actual size.
+     */
+    inline std::size_t base64_decoded_size(span<const char> input) noexcept
+    {
+        return detail::base64_unpadded_size(input.data(), input.size()) * 3 / 4;
+    }
+
+    /**
+     * Decodes input up to its first character outside of the base64
+     * alphabet, usually the '=' padding.
+     */
+    inline std::string base64decode(const std::string& input)
+    {
+        std::string output(base64_decoded_size(input), '\0');
+        std::size_t size = detail::base64_decode_bytes(input.data(), input.size(),
+                                                       reinterpret_cast<unsigned char*>(&output[0]));
+        output.resize(size);
         return output;
     }
 
+    /**
+     * Decodes input into output, which must hold at least
+     * base64_decoded_size(input) bytes. Returns the number of bytes written.
+     */
+    inline std::size_t base64decode(span<const char> input, span<char> output)
+    {
+        return detail::base64_decode_bytes(input, reinterpret_cast<unsigned char*>(output.data()), output.size());
+    }
+
+    inline std::size_t base64decode(span<const char> input, span<std::byte> output)
+    {
+        return detail::base64_decode_bytes(input, reinterpret_cast<unsigned char*>(output.data()), output.size());
+    }
+
+    /**
+     * Decodes input to the output iterator, in chunks through a stack
+     * buffer. Returns the iterator past the last written char.
+     */
+    template <class O, detail::enable_base64_iterator_t<O>>
+    inline O base64decode(span<const char> input, O output)
+    {
+        bool complete;
+        return detail::base64_decode_iterator(input.data(), detail::base64_unpadded_size(input.data(), input.size()),
+                                              output, complete);
+    }
+
     inline std::string base64encode(const std::string& input)
     {
-        std::string output;
-        int val = 0;
-        int valb = -6;
-        for (char sc : input)
+        std::string output(base64_encoded_size(input.size()), '\0');
+        detail::select_base64_kernels().encode(reinterpret_cast<const unsigned char*>(input.data()),
+                                               input.size(),
+                                               &output[0]);
+        return output;
+    }
+
+    /**
+     * Encodes input into output, which must hold at least
+     * base64_encoded_size(input.size()) chars. Returns the number of chars
+     * written.
+     */
+    inline std::size_t base64encode(span<const char> input, span<char> output)
+    {
+        return detail::base64_encode_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output);
+    }
+
+    inline std::size_t base64encode(span<const std::byte> input, span<char> output)
+    {
+        return detail::base64_encode_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output);
+    }
+
+    /**
+     * Encodes input to the output iterator, in chunks through a stack
+     * buffer. Returns the iterator past the last written char.
+     */
+    template <class O, detail::enable_base64_iterator_t<O>>
+    inline O base64encode(span<const char> input, O output)
+    {
+        return detail::base64_encode_iterator(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output);
+    }
+
+    template <class O, detail::enable_base64_iterator_t<O>>
+    inline O base64encode(span<const std::byte> input, O output)
+    {
+        return detail::base64_encode_iterator(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output);
+    }
+
+    /*****************
+     * xbase64_codec *
+     *****************/
+
+    /**
+     * Strict base64 codec, with the alphabet and the padding as policies.
+     * Unlike base64decode, decoding rejects characters outside of the
+     * alphabet, misplaced or missing padding and non-zero trailing bits,
+     * by throwing std::runtime_error. validate finds the first of them
+     * without decoding.
+     */
+    template <class A = base64_standard_alphabet, base64_padding P = base64_padding::required>
+    class xbase64_codec
+    {
+    public:
+
+        using alphabet_type = A;
+        static constexpr base64_padding padding = P;
+        static constexpr std::size_t npos = std::size_t(-1);
+
+        static constexpr std::size_t encoded_size(std::size_t size) noexcept;
+        static std::size_t decoded_size(span<const char> input) noexcept;
+
+        static std::size_t validate(span<const char> input) noexcept;
+        static bool is_valid(span<const char> input) noexcept;
+
+        static std::string encode(const std::string& input);
+        static std::size_t encode(span<const char> input, span<char> output);
+        static std::size_t encode(span<const std::byte> input, span<char> output);
+
+        static std::string decode(const std::string& input);
+        static std::size_t decode(span<const char> input, span<char> output);
+        static std::size_t decode(span<const char> input, span<std::byte> output);
+
+    private:
+
+        static std::size_t validate_tail(const char* input, std::size_t size, std::size_t unpadded) noexcept;
+        static std::size_t encode_bytes(const unsigned char* input, std::size_t size, char* output, std::size_t output_size);
+        static std::size_t decode_bytes(span<const char> input, unsigned char* output, std::size_t output_size);
+    };
+
+    using xbase64_url_codec = xbase64_codec<base64_url_alphabet, base64_padding::omitted>;
+
+    /*******************
+     * xbase64_encoder *
+     *******************/
+
+    /**
+     * Incremental base64 encoder: the input can be split at any byte, the
+     * up to 2 bytes that do not form a complete group are kept until the
+     * next call. The output is the same as base64encode on the whole input.
+     */
+    class xbase64_encoder
+    {
+    public:
+
+        xbase64_encoder() noexcept;
+
+        template <class O>
+        O update(span<const char> input, O output);
+
+        template <class O>
+        O update(span<const std::byte> input, O output);
+
+        template <class O>
+        O finalize(O output);
+
+        std::size_t update_size(std::size_t size) const noexcept;
+        std::size_t pending() const noexcept;
+
+    private:
+
+        template <class O>
+        O update_bytes(const unsigned char* input, std::size_t size, O output);
+
+        std::array<unsigned char, 3> m_buffer;
+        std::size_t m_size;
+    };
+
+    /*******************
+     * xbase64_decoder *
+     *******************/
+
+    /**
+     * Incremental base64 decoder: the input can be split at any character.
+     * As base64decode, the decoding stops at the first character outside of
+     * the alphabet, usually the padding, and the rest of the input is
+     * ignored until finalize.
+     */
+    class xbase64_decoder
+    {
+    public:
+
+        xbase64_decoder() noexcept;
+
+        template <class O>
+        O update(span<const char> input, O output);
+
+        template <class O>
+        O finalize(O output);
+
+        std::size_t update_size(std::size_t size) const noexcept;
+        bool stopped() const noexcept;
+
+    private:
+
+        template <class O>
+        O push(unsigned char c, O output);
+
+        template <class O>
+        O flush(O output);
+
+        std::array<unsigned char, 4> m_buffer;
+        std::size_t m_size;
+        bool m_stopped;
+    };
+
+    /****************************
+     * xbase64_encode_streambuf *
+     ****************************/
+
+    /**
+     * Output stream buffer encoding the bytes written to it and forwarding
+     * the characters to another stream buffer, through fixed size buffers.
+     * The padding is written by close, or on destruction.
+     */
+    class xbase64_encode_streambuf : public std::streambuf
+    {
+    public:
+
+        explicit xbase64_encode_streambuf(std::streambuf* destination);
+        ~xbase64_encode_streambuf() override;
+
+        xbase64_encode_streambuf(const xbase64_encode_streambuf&) = delete;
+        xbase64_encode_streambuf& operator=(const xbase64_encode_streambuf&) = delete;
+
+        bool close();
+
+    protected:
+
+        int_type overflow(int_type c) override;
+        int sync() override;
+
+    private:
+
+        bool encode_put_area();
+
+        static constexpr std::size_t buffer_size = 3 * 1024;
+
+        xbase64_encoder m_encoder;
+        std::streambuf* p_destination;
+        std::array<char, buffer_size> m_input;
+        std::array<char, buffer_size / 3 * 4> m_output;
+        bool m_closed;
+    };
+
+    /****************************
+     * xbase64_decode_streambuf *
+     ****************************/
+
+    /**
+     * Input stream buffer reading base64 text from another stream buffer
+     * and providing the decoded bytes, through fixed size buffers.
+     */
+    class xbase64_decode_streambuf : public std::streambuf
+    {
+    public:
+
+        explicit xbase64_decode_streambuf(std::streambuf* source);
+
+        xbase64_decode_streambuf(const xbase64_decode_streambuf&) = delete;
+        xbase64_decode_streambuf& operator=(const xbase64_decode_streambuf&) = delete;
+
+    protected:
+
+        int_type underflow() override;
+
+    private:
+
+        static constexpr std::size_t buffer_size = 4 * 1024;
+
+        xbase64_decoder m_decoder;
+        std::streambuf* p_source;
+        std::array<char, buffer_size> m_input;
+        std::array<char, buffer_size / 4 * 3 + 3> m_output;
+        bool m_finalized;
+    };
+
+    /*******************
+     * xbase64_ostream *
+     *******************/
+
+    /**
+     * Output stream writing the base64 encoding of its input to another
+     * stream.
+     */
+    class xbase64_ostream : public std::ostream
+    {
+    public:
+
+        explicit xbase64_ostream(std::ostream& destination);
+
+        void close();
+
+    private:
+
+        xbase64_encode_streambuf m_buffer;
+    };
+
+    /*******************
+     * xbase64_istream *
+     *******************/
+
+    /**
+     * Input stream decoding the base64 text read from another stream.
+     */
+    class xbase64_istream : public std::istream
+    {
+    public:
+
+        explicit xbase64_istream(std::istream& source);
+
+    private:
+
+        xbase64_decode_streambuf m_buffer;
+    };
+
+    /********************************
+     * xbase64_codec implementation *
+     ********************************/
+
+    /**
+     * Number of characters written by encode for size bytes.
+     */
+    template <class A, base64_padding P>
+    constexpr std::size_t xbase64_codec<A, P>::encoded_size(std::size_t size) noexcept
+    {
+        return P == base64_padding::omitted ? (4 * size + 2) / 3 : base64_encoded_size(size);
+    }
+
+    /**
+     * Number of bytes written by decode for a valid input.
+     */
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::decoded_size(span<const char> input) noexcept
+    {
+        return base64_decoded_size(input);
+    }
+
+    /**
+     * Returns the offset of the first character making input invalid, its
+     * size for missing padding, npos if input is valid. The characters are
+     * checked by the vector kernels, the padding and the trailing bits
+     * afterwards.
+     */
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::validate(span<const char> input) noexcept
+    {
+        std::size_t unpadded = detail::base64_unpadded_size(input.data(), input.size());
+        std::size_t res = detail::select_base64_kernels<A>().validate(reinterpret_cast<const unsigned char*>(input.data()),
+                                                                     unpadded);
+        return res != unpadded ? res : validate_tail(input.data(), input.size(), unpadded);
+    }
+
+    template <class A, base64_padding P>
+    inline bool xbase64_codec<A, P>::is_valid(span<const char> input) noexcept
+    {
+        return validate(input) == npos;
+    }
+
+    template <class A, base64_padding P>
+    inline std::string xbase64_codec<A, P>::encode(const std::string& input)
+    {
+        std::string output(encoded_size(input.size()), '\0');
+        encode_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), &output[0], output.size());
+        return output;
+    }
+
+    /**
+     * Encodes input into output, which must hold at least
+     * encoded_size(input.size()) chars. Returns the number of chars written.
+     */
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::encode(span<const char> input, span<char> output)
+    {
+        return encode_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output.data(), output.size());
+    }
+
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::encode(span<const std::byte> input, span<char> output)
+    {
+        return encode_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output.data(), output.size());
+    }
+
+    template <class A, base64_padding P>
+    inline std::string xbase64_codec<A, P>::decode(const std::string& input)
+    {
+        std::string output(decoded_size(input), '\0');
+        decode_bytes(input, reinterpret_cast<unsigned char*>(&output[0]), output.size());
+        return output;
+    }
+
+    /**
+     * Decodes input into output, which must hold at least
+     * decoded_size(input) bytes. Returns the number of bytes written.
+     */
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::decode(span<const char> input, span<char> output)
+    {
+        return decode_bytes(input, reinterpret_cast<unsigned char*>(output.data()), output.size());
+    }
+
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::decode(span<const char> input, span<std::byte> output)
+    {
+        return decode_bytes(input, reinterpret_cast<unsigned char*>(output.data()), output.size());
+    }
+
+    // Checks the length, the bits of the last character that are not
+    // decoded, and the padding
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::validate_tail(const char* input, std::size_t size, std::size_t unpadded) noexcept
+    {
+        const auto& table = detail::base64_tables<A>::decode;
+        std::size_t remainder = unpadded % 4;
+        if (remainder == 1)
+        {
+            return unpadded - 1;
+        }
+        if (remainder != 0)
+        {
+            int unused_bits = remainder == 2 ? 0x0f : 0x03;
+            if ((table[static_cast<unsigned char>(input[unpadded - 1])] & unused_bits) != 0)
+            {
+                return unpadded - 1;
+            }
+        }
+
+        std::size_t padding_size = size - unpadded;
+        std::size_t expected = (4 - remainder) % 4;
+        bool valid_padding = P == base64_padding::required ? padding_size == expected
+                           : P == base64_padding::optional ? padding_size == 0 || padding_size == expected
+                                                           : padding_size == 0;
+        if (!valid_padding)
+        {
+            return P == base64_padding::omitted ? unpadded : unpadded + std::min(padding_size, expected);
+        }
+        return npos;
+    }
+
+    // The groups of the omitted padding are encoded apart
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::encode_bytes(const unsigned char* input, std::size_t size, char* output, std::size_t output_size)
+    {
+        std::size_t res = encoded_size(size);
+        if (output_size < res)
+        {
+            XTL_THROW(std::length_error, "xbase64_codec: output span is too small");
+        }
+        std::size_t bulk = P == base64_padding::omitted ? size / 3 * 3 : size;
+        detail::select_base64_kernels<A>().encode(input, bulk, output);
+        if (bulk != size)
+        {
+            char quantum[4];
+            detail::base64_encode_scalar<A>(input + bulk, size - bulk, quantum);
+            std::copy(quantum, quantum + (size - bulk) + 1, output + bulk / 3 * 4);
+        }
+        return res;
+    }
+
+    // The decoding kernels stop at the first invalid character, so that
+    // input is valid when all the bytes are written and the tail is valid.
+    // validate only runs to report the error.
+    template <class A, base64_padding P>
+    inline std::size_t xbase64_codec<A, P>::decode_bytes(span<const char> input, unsigned char* output, std::size_t output_size)
+    {
+        std::size_t unpadded = detail::base64_unpadded_size(input.data(), input.size());
+        std::size_t res = unpadded * 3 / 4;
+        if (output_size < res)
+        {
+            XTL_THROW(std::length_error, "xbase64_codec: output span is too small");
+        }
+        if (validate_tail(input.data(), input.size(), unpadded) == npos &&
+            detail::select_base64_kernels<A>().decode(reinterpret_cast<const unsigned char*>(input.data()), unpadded, output) == res)
+        {
+            return res;
+        }
+        XTL_THROW(std::runtime_error, "xbase64_codec: invalid input at offset " + std::to_string(validate(input)));
+    }
+
+    /**********************************
+     * xbase64_encoder implementation *
+     **********************************/
+
+    inline xbase64_encoder::xbase64_encoder() noexcept
+        : m_buffer(), m_size(0)
+    {
+    }
+
+    /**
+     * Encodes the complete 3-byte groups of the pending bytes followed by
+     * input, update_size(input.size()) chars are written to output.
+     */
+    template <class O>
+    inline O xbase64_encoder::update(span<const char> input, O output)
+    {
+        return update_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output);
+    }
+
+    template <class O>
+    inline O xbase64_encoder::update(span<const std::byte> input, O output)
+    {
+        return update_bytes(reinterpret_cast<const unsigned char*>(input.data()), input.size(), output);
+    }
+
+    /**
+     * Writes the pending bytes, padded, and resets the encoder.
+     */
+    template <class O>
+    inline O xbase64_encoder::finalize(O output)
+    {
+        if (m_size != 0)
+        {
+            char quantum[4];
+            detail::base64_encode_scalar(m_buffer.data(), m_size, quantum);
+            output = std::copy(quantum, quantum + 4, output);
+            m_size = 0;
+        }
+        return output;
+    }
+
+    inline std::size_t xbase64_encoder::update_size(std::size_t size) const noexcept
+    {
+        return (m_size + size) / 3 * 4;
+    }
+
+    inline std::size_t xbase64_encoder::pending() const noexcept
+    {
+        return m_size;
+    }
+
+    template <class O>
+    inline O xbase64_encoder::update_bytes(const unsigned char* input, std::size_t size, O output)
+    {
+        std::size_t i = 0;
+        if (m_size != 0)
         {
-            unsigned char c = static_cast<unsigned char>(sc);
-            val = (val << 8) + c;
-            valb += 8;
-            while (valb >= 0)
+            for (; m_size < 3 && i < size; ++i)
+            {
+                m_buffer[m_size++] = input[i];
+            }
+            if (m_size < 3)
             {
-                output.push_back("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[(val >> valb) & 0x3F]);
-                valb -= 6;
+                return output;
             }
+            char quantum[4];
+            detail::base64_encode_scalar(m_buffer.data(), 3, quantum);
+            output = std::copy(quantum, quantum + 4, output);
+            m_size = 0;
+        }
+        std::size_t bulk = (size - i) / 3 * 3;
+        output = detail::base64_encode_iterator(input + i, bulk, output);
+        for (i += bulk; i < size; ++i)
+        {
+            m_buffer[m_size++] = input[i];
+        }
+        return output;
+    }
+
+    /**********************************
+     * xbase64_decoder implementation *
+     **********************************/
+
+    inline xbase64_decoder::xbase64_decoder() noexcept
+        : m_buffer(), m_size(0), m_stopped(false)
+    {
+    }
+
+    /**
+     * Decodes the complete 4-character groups of the pending characters
+     * followed by input, at most update_size(input.size()) bytes are written
+     * to output.
+     */
+    template <class O>
+    inline O xbase64_decoder::update(span<const char> input, O output)
+    {
+        const char* data = input.data();
+        std::size_t size = input.size();
+        std::size_t i = 0;
+        for (; i < size && m_size != 0 && !m_stopped; ++i)
+        {
+            output = push(static_cast<unsigned char>(data[i]), output);
         }
-        if (valb > -6)
+        if (m_stopped)
         {
-            output.push_back("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[((val << 8) >> (valb + 8)) & 0x3F]);
+            return output;
         }
-        while (output.size() % 4)
+
+        std::size_t bulk = (size - i) / 4 * 4;
+        bool complete;
+        output = detail::base64_decode_iterator(data + i, bulk, output, complete);
+        if (!complete)
         {
-            output.push_back('=');
+            m_stopped = true;
+            return output;
         }
+
+        for (i += bulk; i < size && !m_stopped; ++i)
+        {
+            output = push(static_cast<unsigned char>(data[i]), output);
+        }
+        return output;
+    }
+
+    /**
+     * Writes the bytes of an incomplete trailing group, as base64decode
+     * does for unpadded input, and resets the decoder.
+     */
+    template <class O>
+    inline O xbase64_decoder::finalize(O output)
+    {
+        output = flush(output);
+        m_stopped = false;
         return output;
     }
+
+    inline std::size_t xbase64_decoder::update_size(std::size_t size) const noexcept
+    {
+        return (m_size + size) * 3 / 4;
+    }
+
+    /**
+     * Returns true once a character outside of the alphabet has been seen.
+     */
+    inline bool xbase64_decoder::stopped() const noexcept
+    {
+        return m_stopped;
+    }
+
+    template <class O>
+    inline O xbase64_decoder::push(unsigned char c, O output)
+    {
+        if (detail::base64_tables<base64_standard_alphabet>::decode[c] < 0)
+        {
+            m_stopped = true;
+            return flush(output);
+        }
+        m_buffer[m_size++] = c;
+        return m_size == 4 ? flush(output) : output;
+    }
+
+    template <class O>
+    inline O xbase64_decoder::flush(O output)
+    {
+        unsigned char bytes[3];
+        std::size_t count = detail::base64_decode_scalar(m_buffer.data(), m_size, bytes);
+        m_size = 0;
+        return std::transform(bytes, bytes + count, output, [](unsigned char c) { return static_cast<char>(c); });
+    }
+
+    /*******************************************
+     * xbase64_encode_streambuf implementation *
+     *******************************************/
+
+    inline xbase64_encode_streambuf::xbase64_encode_streambuf(std::streambuf* destination)
+        : p_destination(destination), m_closed(false)
+    {
+        setp(m_input.data(), m_input.data() + m_input.size());
+    }
+
+    inline xbase64_encode_streambuf::~xbase64_encode_streambuf()
+    {
+        close();
+    }
+
+    /**
+     * Encodes the pending bytes, writes the padding and flushes the
+     * destination. Nothing can be written afterwards.
+     */
+    inline bool xbase64_encode_streambuf::close()
+    {
+        if (m_closed)
+        {
+            return true;
+        }
+        m_closed = true;
+        bool res = encode_put_area();
+        setp(nullptr, nullptr);
+        char* last = m_encoder.finalize(m_output.data());
+        std::streamsize count = last - m_output.data();
+        res = res && p_destination->sputn(m_output.data(), count) == count;
+        return res && p_destination->pubsync() == 0;
+    }
+
+    inline auto xbase64_encode_streambuf::overflow(int_type c) -> int_type
+    {
+        if (m_closed || !encode_put_area())
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    // The bytes of an incomplete group stay in the encoder, the padding
+    // can only be written by close.
+    inline int xbase64_encode_streambuf::sync()
+    {
+        if (m_closed)
+        {
+            return 0;
+        }
+        return encode_put_area() && p_destination->pubsync() == 0 ? 0 : -1;
+    }
+
+    inline bool xbase64_encode_streambuf::encode_put_area()
+    {
+        span<const char> input(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+        char* last = m_encoder.update(input, m_output.data());
+        setp(m_input.data(), m_input.data() + m_input.size());
+        std::streamsize count = last - m_output.data();
+        return p_destination->sputn(m_output.data(), count) == count;
+    }
+
+    /*******************************************
+     * xbase64_decode_streambuf implementation *
+     *******************************************/
+
+    inline xbase64_decode_streambuf::xbase64_decode_streambuf(std::streambuf* source)
+        : p_source(source), m_finalized(false)
+    {
+        setg(m_output.data(), m_output.data(), m_output.data());
+    }
+
+    inline auto xbase64_decode_streambuf::underflow() -> int_type
+    {
+        char* last = m_output.data();
+        while (last == m_output.data() && !m_finalized)
+        {
+            std::streamsize count = m_decoder.stopped() ? 0 : p_source->sgetn(m_input.data(), static_cast<std::streamsize>(m_input.size()));
+            if (count > 0)
+            {
+                last = m_decoder.update(span<const char>(m_input.data(), static_cast<std::size_t>(count)), last);
+            }
+            else
+            {
+                last = m_decoder.finalize(last);
+                m_finalized = true;
+            }
+        }
+        setg(m_output.data(), m_output.data(), last);
+        return last == m_output.data() ? traits_type::eof() : traits_type::to_int_type(m_output[0]);
+    }
+
+    /**********************************
+     * xbase64_ostream implementation *
+     **********************************/
+
+    inline xbase64_ostream::xbase64_ostream(std::ostream& destination)
+        : std::ostream(nullptr), m_buffer(destination.rdbuf())
+    {
+        rdbuf(&m_buffer);
+    }
+
+    /**
+     * Writes the padding, see xbase64_encode_streambuf::close.
+     */
+    inline void xbase64_ostream::close()
+    {
+        if (!m_buffer.close())
+        {
+            setstate(std::ios_base::badbit);
+        }
+    }
+
+    /**********************************
+     * xbase64_istream implementation *
+     **********************************/
+
+    inline xbase64_istream::xbase64_istream(std::istream& source)
+        : std::istream(nullptr), m_buffer(source.rdbuf())
+    {
+        rdbuf(&m_buffer);
+    }
 }
 #endif
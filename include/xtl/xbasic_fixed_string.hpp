@@ -17,6 +17,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <cassert>
 #include <algorithm>
 #include <type_traits>
@@ -699,6 +700,101 @@ namespace xtl
     std::basic_istream<CT, TR>& getline(std::basic_istream<CT, TR>&& input,
                                         xbasic_fixed_string<CT, N, ST, EP, TR>& str);
 
+    /*************************************
+     * Heterogeneous hashing declaration *
+     *************************************/
+
+    template <class S>
+    class xhashed_string;
+
+    /**
+     * Transparent hash of strings of CT characters.
+     *
+     * xbasic_fixed_string (including views over const characters),
+     * std::basic_string, std::basic_string_view and C strings holding the
+     * same characters hash to the same value, which is also the value of
+     * std::hash for xbasic_fixed_string. Together with xbasic_string_equal, it allows
+     * lookups in unordered containers without building a key.
+     */
+    template <class CT, class TR = std::char_traits<CT>>
+    struct xbasic_string_hash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::basic_string_view<CT, TR> str) const noexcept;
+
+        template <class C, std::size_t N, int ST, template <std::size_t> class EP, class T>
+        std::size_t operator()(const xbasic_fixed_string<C, N, ST, EP, T>& str) const noexcept;
+
+        template <class S>
+        std::size_t operator()(const xhashed_string<S>& key) const noexcept;
+    };
+
+    /**
+     * Transparent equality of strings of CT characters, accepting the same
+     * types as xbasic_string_hash.
+     */
+    template <class CT, class TR = std::char_traits<CT>>
+    struct xbasic_string_equal
+    {
+        using is_transparent = void;
+
+        template <class L, class R>
+        bool operator()(const L& lhs, const R& rhs) const noexcept;
+
+        template <class S1, class S2>
+        bool operator()(const xhashed_string<S1>& lhs, const xhashed_string<S2>& rhs) const noexcept;
+
+    private:
+
+        static std::basic_string_view<CT, TR> view(std::basic_string_view<CT, TR> str) noexcept;
+
+        template <class C, std::size_t N, int ST, template <std::size_t> class EP, class T>
+        static std::basic_string_view<CT, TR> view(const xbasic_fixed_string<C, N, ST, EP, T>& str) noexcept;
+
+        template <class S>
+        static std::basic_string_view<CT, TR> view(const xhashed_string<S>& key) noexcept;
+    };
+
+    using xstring_hash = xbasic_string_hash<char>;
+    using xstring_equal = xbasic_string_equal<char>;
+
+    /**
+     * String stored along with its hash.
+     *
+     * The hash is computed once, with xbasic_string_hash, when the string is
+     * set; hashing an xhashed_string with xbasic_string_hash or std::hash then
+     * returns it without reading the characters, and comparing two of them
+     * checks the hashes first. S is a string type such as xbasic_fixed_string,
+     * std::basic_string or std::basic_string_view.
+     */
+    template <class S>
+    class xhashed_string
+    {
+    public:
+
+        using string_type = S;
+        using value_type = std::remove_const_t<typename S::value_type>;
+        using hasher = xbasic_string_hash<value_type>;
+
+        xhashed_string();
+        explicit xhashed_string(string_type str);
+
+        const string_type& str() const noexcept;
+        std::size_t hash() const noexcept;
+
+    private:
+
+        string_type m_str;
+        std::size_t m_hash;
+    };
+
+    template <class S1, class S2>
+    bool operator==(const xhashed_string<S1>& lhs, const xhashed_string<S2>& rhs) noexcept;
+
+    template <class S1, class S2>
+    bool operator!=(const xhashed_string<S1>& lhs, const xhashed_string<S2>& rhs) noexcept;
+
 }  // namespace xtl
 
 namespace std
@@ -710,7 +806,18 @@ namespace std
         using result_type = std::size_t;
         inline result_type operator()(const argument_type& arg) const
         {
-            return ::xtl::hash_bytes(arg.data(), arg.size(), static_cast<std::size_t>(0xc70f6907UL));
+            return ::xtl::xbasic_string_hash<std::remove_const_t<CT>>()(arg);
+        }
+    };
+
+    template <class S>
+    struct hash<::xtl::xhashed_string<S>>
+    {
+        using argument_type = ::xtl::xhashed_string<S>;
+        using result_type = std::size_t;
+        inline result_type operator()(const argument_type& arg) const noexcept
+        {
+            return arg.hash();
         }
     };
 }  // namespace std
@@ -2432,6 +2539,111 @@ namespace xtl
         str = tmp;
         return ret;
     }
+
+    /****************************************
+     * Heterogeneous hashing implementation *
+     ****************************************/
+
+    namespace detail
+    {
+        constexpr std::size_t string_hash_seed = static_cast<std::size_t>(0xc70f6907UL);
+    }
+
+    template <class CT, class TR>
+    inline std::size_t xbasic_string_hash<CT, TR>::operator()(std::basic_string_view<CT, TR> str) const noexcept
+    {
+        return hash_bytes(str.data(), str.size() * sizeof(CT), detail::string_hash_seed);
+    }
+
+    template <class CT, class TR>
+    template <class C, std::size_t N, int ST, template <std::size_t> class EP, class T>
+    inline std::size_t xbasic_string_hash<CT, TR>::operator()(const xbasic_fixed_string<C, N, ST, EP, T>& str) const noexcept
+    {
+        static_assert(std::is_same<std::remove_const_t<C>, CT>::value, "xbasic_string_hash: character type mismatch");
+        return hash_bytes(str.data(), str.size() * sizeof(CT), detail::string_hash_seed);
+    }
+
+    template <class CT, class TR>
+    template <class S>
+    inline std::size_t xbasic_string_hash<CT, TR>::operator()(const xhashed_string<S>& key) const noexcept
+    {
+        return key.hash();
+    }
+
+    template <class CT, class TR>
+    template <class L, class R>
+    inline bool xbasic_string_equal<CT, TR>::operator()(const L& lhs, const R& rhs) const noexcept
+    {
+        return view(lhs) == view(rhs);
+    }
+
+    template <class CT, class TR>
+    template <class S1, class S2>
+    inline bool xbasic_string_equal<CT, TR>::operator()(const xhashed_string<S1>& lhs, const xhashed_string<S2>& rhs) const noexcept
+    {
+        return lhs.hash() == rhs.hash() && view(lhs) == view(rhs);
+    }
+
+    template <class CT, class TR>
+    inline std::basic_string_view<CT, TR> xbasic_string_equal<CT, TR>::view(std::basic_string_view<CT, TR> str) noexcept
+    {
+        return str;
+    }
+
+    template <class CT, class TR>
+    template <class C, std::size_t N, int ST, template <std::size_t> class EP, class T>
+    inline std::basic_string_view<CT, TR> xbasic_string_equal<CT, TR>::view(const xbasic_fixed_string<C, N, ST, EP, T>& str) noexcept
+    {
+        static_assert(std::is_same<std::remove_const_t<C>, CT>::value, "xbasic_string_equal: character type mismatch");
+        return std::basic_string_view<CT, TR>(str.data(), str.size());
+    }
+
+    template <class CT, class TR>
+    template <class S>
+    inline std::basic_string_view<CT, TR> xbasic_string_equal<CT, TR>::view(const xhashed_string<S>& key) noexcept
+    {
+        return view(key.str());
+    }
+
+    /*********************************
+     * xhashed_string implementation *
+     *********************************/
+
+    template <class S>
+    inline xhashed_string<S>::xhashed_string()
+        : xhashed_string(string_type())
+    {
+    }
+
+    template <class S>
+    inline xhashed_string<S>::xhashed_string(string_type str)
+        : m_str(std::move(str)), m_hash(hasher()(m_str))
+    {
+    }
+
+    template <class S>
+    inline auto xhashed_string<S>::str() const noexcept -> const string_type&
+    {
+        return m_str;
+    }
+
+    template <class S>
+    inline std::size_t xhashed_string<S>::hash() const noexcept
+    {
+        return m_hash;
+    }
+
+    template <class S1, class S2>
+    inline bool operator==(const xhashed_string<S1>& lhs, const xhashed_string<S2>& rhs) noexcept
+    {
+        return xbasic_string_equal<typename xhashed_string<S1>::value_type>()(lhs, rhs);
+    }
+
+    template <class S1, class S2>
+    inline bool operator!=(const xhashed_string<S1>& lhs, const xhashed_string<S2>& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
 }
 
 #endif  // xtl
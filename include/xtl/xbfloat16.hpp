@@ -0,0 +1,491 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XBFLOAT16_HPP
+#define XTL_XBFLOAT16_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+#include "xavx512_utils.hpp"
+#include "xplatform.hpp"
+#include "xspan.hpp"
+#include "xtl_config.hpp"
+#include "xtype_traits.hpp"
+
+namespace xtl
+{
+    /************
+     * bfloat16 *
+     ************/
+
+    /**
+     * @class bfloat16
+     * @brief Brain floating point storage type.
+     *
+     * bfloat16 keeps the upper 16 bits of an IEEE 754 single precision
+     * value: same exponent range as float, 8 bits of precision. Values
+     * are converted to float for arithmetic, construction from float
+     * rounds to nearest even.
+     */
+    class bfloat16
+    {
+    public:
+
+        constexpr bfloat16() noexcept = default;
+        bfloat16(float value) noexcept;
+
+        operator float() const noexcept;
+
+        static constexpr bfloat16 from_bits(uint16_t bits) noexcept;
+        static bfloat16 truncate(float value) noexcept;
+
+        constexpr uint16_t bits() const noexcept;
+
+        bfloat16& operator+=(float rhs) noexcept;
+        bfloat16& operator-=(float rhs) noexcept;
+        bfloat16& operator*=(float rhs) noexcept;
+        bfloat16& operator/=(float rhs) noexcept;
+
+    private:
+
+        struct bits_tag
+        {
+        };
+
+        constexpr bfloat16(uint16_t bits, bits_tag) noexcept;
+
+        uint16_t m_bits = 0;
+    };
+
+    template <>
+    struct is_scalar<bfloat16> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_arithmetic<bfloat16> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_signed<bfloat16> : std::true_type
+    {
+    };
+
+    template <>
+    struct is_floating_point<bfloat16> : std::true_type
+    {
+    };
+
+    enum class bfloat16_rounding
+    {
+        nearest_even,
+        truncate
+    };
+
+    void convert(span<const bfloat16> input, span<float> output);
+    void convert(span<const float> input, span<bfloat16> output,
+                 bfloat16_rounding rounding = bfloat16_rounding::nearest_even);
+}
+
+namespace std
+{
+    template <>
+    class numeric_limits<::xtl::bfloat16>
+    {
+    public:
+
+        static constexpr bool is_specialized = true;
+        static constexpr bool is_signed = true;
+        static constexpr bool is_integer = false;
+        static constexpr bool is_exact = false;
+        static constexpr bool is_modulo = false;
+        static constexpr bool is_bounded = true;
+        static constexpr bool is_iec559 = false;
+        static constexpr bool has_infinity = true;
+        static constexpr bool has_quiet_NaN = true;
+        static constexpr bool has_signaling_NaN = true;
+        static constexpr float_denorm_style has_denorm = denorm_present;
+        static constexpr bool has_denorm_loss = false;
+        static constexpr bool traps = false;
+        static constexpr bool tinyness_before = false;
+        static constexpr float_round_style round_style = round_to_nearest;
+        static constexpr int digits = 8;
+        static constexpr int digits10 = 2;
+        static constexpr int max_digits10 = 4;
+        static constexpr int radix = 2;
+        static constexpr int min_exponent = -125;
+        static constexpr int min_exponent10 = -37;
+        static constexpr int max_exponent = 128;
+        static constexpr int max_exponent10 = 38;
+
+        static constexpr ::xtl::bfloat16 min() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x0080);
+        }
+
+        static constexpr ::xtl::bfloat16 lowest() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0xFF7F);
+        }
+
+        static constexpr ::xtl::bfloat16 max() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x7F7F);
+        }
+
+        static constexpr ::xtl::bfloat16 epsilon() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x3C00);
+        }
+
+        static constexpr ::xtl::bfloat16 round_error() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x3F00);
+        }
+
+        static constexpr ::xtl::bfloat16 infinity() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x7F80);
+        }
+
+        static constexpr ::xtl::bfloat16 quiet_NaN() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x7FC0);
+        }
+
+        static constexpr ::xtl::bfloat16 signaling_NaN() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x7FA0);
+        }
+
+        static constexpr ::xtl::bfloat16 denorm_min() noexcept
+        {
+            return ::xtl::bfloat16::from_bits(0x0001);
+        }
+    };
+
+    // Hashes the bits with negative zero folded onto positive zero, so
+    // that values comparing equal hash equally.
+    template <>
+    struct hash<::xtl::bfloat16>
+    {
+        using argument_type = ::xtl::bfloat16;
+        using result_type = std::size_t;
+        inline result_type operator()(const argument_type& arg) const noexcept
+        {
+            uint16_t bits = arg.bits();
+            return std::hash<uint16_t>()(bits == 0x8000 ? uint16_t(0) : bits);
+        }
+    };
+}  // namespace std
+
+namespace xtl
+{
+    namespace detail
+    {
+        /***************************
+         * bfloat16 scalar kernels *
+         ***************************/
+
+        inline float bfloat16_bits_to_float(uint16_t value) noexcept
+        {
+            uint32_t bits = uint32_t(value) << 16;
+            float res;
+            std::memcpy(&res, &bits, sizeof(float));
+            return res;
+        }
+
+        // NaNs are quieted rather than rounded or truncated, which could
+        // turn them into infinities.
+        template <bool Truncate>
+        inline uint16_t float_to_bfloat16_bits(float value) noexcept
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(float));
+            if ((bits & 0x7FFFFFFFu) > 0x7F800000u)
+            {
+                return static_cast<uint16_t>((bits >> 16) | 0x40u);
+            }
+            if (!Truncate)
+            {
+                bits += 0x7FFFu + ((bits >> 16) & 1u);
+            }
+            return static_cast<uint16_t>(bits >> 16);
+        }
+
+        inline void bfloat16_to_float_scalar(const bfloat16* in, std::size_t size, float* out) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                out[i] = bfloat16_bits_to_float(in[i].bits());
+            }
+        }
+
+        template <bool Truncate>
+        inline void float_to_bfloat16_scalar(const float* in, std::size_t size, bfloat16* out) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                out[i] = bfloat16::from_bits(float_to_bfloat16_bits<Truncate>(in[i]));
+            }
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        /*************************
+         * bfloat16 SIMD kernels *
+         *************************/
+
+        // Integer emulation of float_to_bfloat16_bits. The AVX512-BF16
+        // conversions are not used: they flush denormals to zero and only
+        // round to nearest even.
+
+        XTL_TARGET("avx2") XTL_NOINLINE void bfloat16_to_float_avx2(const bfloat16* in, std::size_t size, float* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), bits);
+            }
+            bfloat16_to_float_scalar(in + i, size - i, out + i);
+        }
+
+        template <bool Truncate>
+        XTL_TARGET("avx2") inline __m256i float_to_bfloat16_block_avx2(const float* in) noexcept
+        {
+            __m256 value = _mm256_loadu_ps(in);
+            __m256i bits = _mm256_castps_si256(value);
+            __m256i res = bits;
+            if (!Truncate)
+            {
+                __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+                res = _mm256_add_epi32(res, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF)));
+            }
+            res = _mm256_srli_epi32(res, 16);
+            __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(value, value, _CMP_UNORD_Q));
+            __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+            return _mm256_blendv_epi8(res, quiet, nan);
+        }
+
+        template <bool Truncate>
+        XTL_TARGET("avx2") XTL_NOINLINE void float_to_bfloat16_avx2(const float* in, std::size_t size, bfloat16* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m256i lo = float_to_bfloat16_block_avx2<Truncate>(in + i);
+                __m256i hi = float_to_bfloat16_block_avx2<Truncate>(in + i + 8);
+                // packus interleaves the 128-bit lanes of its operands
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+            }
+            float_to_bfloat16_scalar<Truncate>(in + i, size - i, out + i);
+        }
+
+        // The tail is copied to a zeroed buffer and stored with a mask
+        XTL_TARGET("avx512f") XTL_NOINLINE void bfloat16_to_float_avx512(const bfloat16* in, std::size_t size, float* out) noexcept
+        {
+            const __mmask16 full = __mmask16(0xFFFF);
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m512i bits = _mm512_maskz_slli_epi32(full, avx512_load_epu16(in + i), 16);
+                _mm512_storeu_si512(out + i, bits);
+            }
+            if (i != size)
+            {
+                __mmask16 mask = static_cast<__mmask16>((1u << (size - i)) - 1u);
+                uint16_t buffer[16] = {};
+                std::memcpy(buffer, in + i, (size - i) * sizeof(bfloat16));
+                __m512i bits = _mm512_maskz_slli_epi32(full, avx512_load_epu16(buffer), 16);
+                _mm512_mask_storeu_epi32(out + i, mask, bits);
+            }
+        }
+
+        template <bool Truncate>
+        XTL_TARGET("avx512f") inline __m256i float_to_bfloat16_block_avx512(__m512 value) noexcept
+        {
+            const __mmask16 full = __mmask16(0xFFFF);
+            __m512i bits = _mm512_castps_si512(value);
+            __m512i res = bits;
+            if (!Truncate)
+            {
+                __m512i odd = _mm512_and_si512(_mm512_maskz_srli_epi32(full, bits, 16), _mm512_set1_epi32(1));
+                res = _mm512_add_epi32(res, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7FFF)));
+            }
+            res = _mm512_maskz_srli_epi32(full, res, 16);
+            __mmask16 nan = _mm512_cmp_ps_mask(value, value, _CMP_UNORD_Q);
+            __m512i quiet = _mm512_or_si512(_mm512_maskz_srli_epi32(full, bits, 16), _mm512_set1_epi32(0x40));
+            return _mm512_maskz_cvtepi32_epi16(full, _mm512_mask_blend_epi32(nan, res, quiet));
+        }
+
+        template <bool Truncate>
+        XTL_TARGET("avx512f") XTL_NOINLINE void float_to_bfloat16_avx512(const float* in, std::size_t size, bfloat16* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m256i h = float_to_bfloat16_block_avx512<Truncate>(_mm512_loadu_ps(in + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+            }
+            if (i != size)
+            {
+                __mmask16 mask = static_cast<__mmask16>((1u << (size - i)) - 1u);
+                __m256i h = float_to_bfloat16_block_avx512<Truncate>(_mm512_maskz_loadu_ps(mask, in + i));
+                std::memcpy(static_cast<void*>(out + i), &h, (size - i) * sizeof(bfloat16));
+            }
+        }
+
+#endif
+
+        struct bfloat16_kernels
+        {
+            void (*to_float)(const bfloat16*, std::size_t, float*) noexcept;
+            void (*from_float_nearest)(const float*, std::size_t, bfloat16*) noexcept;
+            void (*from_float_truncate)(const float*, std::size_t, bfloat16*) noexcept;
+        };
+
+        inline const bfloat16_kernels& select_bfloat16_kernels() noexcept
+        {
+            static const bfloat16_kernels kernels = []() -> bfloat16_kernels {
+                bfloat16_kernels res = {&bfloat16_to_float_scalar, &float_to_bfloat16_scalar<false>,
+                                        &float_to_bfloat16_scalar<true>};
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+                const cpu_features& features = available_cpu_features();
+                if (features.avx2)
+                {
+                    res = {&bfloat16_to_float_avx2, &float_to_bfloat16_avx2<false>,
+                           &float_to_bfloat16_avx2<true>};
+                }
+                if (features.avx512f)
+                {
+                    res = {&bfloat16_to_float_avx512, &float_to_bfloat16_avx512<false>,
+                           &float_to_bfloat16_avx512<true>};
+                }
+#endif
+                return res;
+            }();
+            return kernels;
+        }
+    }
+
+    /***************************
+     * bfloat16 implementation *
+     ***************************/
+
+    inline bfloat16::bfloat16(float value) noexcept
+        : m_bits(detail::float_to_bfloat16_bits<false>(value))
+    {
+    }
+
+    constexpr bfloat16::bfloat16(uint16_t bits, bits_tag) noexcept
+        : m_bits(bits)
+    {
+    }
+
+    /**
+     * Widens to single precision, this is exact.
+     */
+    inline bfloat16::operator float() const noexcept
+    {
+        return detail::bfloat16_bits_to_float(m_bits);
+    }
+
+    /**
+     * Builds a bfloat16 from its binary representation.
+     */
+    constexpr bfloat16 bfloat16::from_bits(uint16_t bits) noexcept
+    {
+        return bfloat16(bits, bits_tag());
+    }
+
+    /**
+     * Converts value by dropping the low 16 bits of its mantissa. NaNs
+     * stay NaNs.
+     */
+    inline bfloat16 bfloat16::truncate(float value) noexcept
+    {
+        return from_bits(detail::float_to_bfloat16_bits<true>(value));
+    }
+
+    /**
+     * Returns the binary representation.
+     */
+    constexpr uint16_t bfloat16::bits() const noexcept
+    {
+        return m_bits;
+    }
+
+    inline bfloat16& bfloat16::operator+=(float rhs) noexcept
+    {
+        *this = bfloat16(float(*this) + rhs);
+        return *this;
+    }
+
+    inline bfloat16& bfloat16::operator-=(float rhs) noexcept
+    {
+        *this = bfloat16(float(*this) - rhs);
+        return *this;
+    }
+
+    inline bfloat16& bfloat16::operator*=(float rhs) noexcept
+    {
+        *this = bfloat16(float(*this) * rhs);
+        return *this;
+    }
+
+    inline bfloat16& bfloat16::operator/=(float rhs) noexcept
+    {
+        *this = bfloat16(float(*this) / rhs);
+        return *this;
+    }
+
+    /*****************************
+     * conversion implementation *
+     *****************************/
+
+    /**
+     * Converts input to single precision, output must hold at least
+     * input.size() values.
+     */
+    inline void convert(span<const bfloat16> input, span<float> output)
+    {
+        if (output.size() < input.size())
+        {
+            XTL_THROW(std::length_error, "convert: output span is too small");
+        }
+        detail::select_bfloat16_kernels().to_float(input.data(), input.size(), output.data());
+    }
+
+    /**
+     * Converts input to bfloat16 with the given rounding. output must hold
+     * at least input.size() values.
+     */
+    inline void convert(span<const float> input, span<bfloat16> output, bfloat16_rounding rounding)
+    {
+        if (output.size() < input.size())
+        {
+            XTL_THROW(std::length_error, "convert: output span is too small");
+        }
+        const detail::bfloat16_kernels& kernels = detail::select_bfloat16_kernels();
+        auto kernel = rounding == bfloat16_rounding::truncate ? kernels.from_float_truncate
+                                                              : kernels.from_float_nearest;
+        kernel(input.data(), input.size(), output.data());
+    }
+}
+
+#endif
@@ -0,0 +1,85 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XBIT_UTILS_HPP
+#define XTL_XBIT_UTILS_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<bit>)
+#include <bit>
+#endif
+#endif
+
+namespace xtl
+{
+    namespace detail
+    {
+        /******************************
+         * portable bit manipulations *
+         ******************************/
+
+        template <class T>
+        inline std::size_t popcount(T block) noexcept
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+            auto value = static_cast<unsigned_type>(block);
+#if defined(__cpp_lib_bitops)
+            return static_cast<std::size_t>(std::popcount(value));
+#elif defined(__GNUC__) || defined(__clang__)
+            if constexpr (sizeof(unsigned_type) <= sizeof(unsigned int))
+            {
+                return static_cast<std::size_t>(__builtin_popcount(value));
+            }
+            else
+            {
+                return static_cast<std::size_t>(__builtin_popcountll(value));
+            }
+#else
+            std::size_t res = 0;
+            for (; value != 0; value &= static_cast<unsigned_type>(value - 1u))
+            {
+                ++res;
+            }
+            return res;
+#endif
+        }
+
+        // Index of the lowest set bit, block must not be 0
+        template <class T>
+        inline std::size_t countr_zero(T block) noexcept
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+            auto value = static_cast<unsigned_type>(block);
+#if defined(__cpp_lib_bitops)
+            return static_cast<std::size_t>(std::countr_zero(value));
+#elif defined(__GNUC__) || defined(__clang__)
+            if constexpr (sizeof(unsigned_type) <= sizeof(unsigned int))
+            {
+                return static_cast<std::size_t>(__builtin_ctz(value));
+            }
+            else
+            {
+                return static_cast<std::size_t>(__builtin_ctzll(value));
+            }
+#else
+            std::size_t res = 0;
+            for (; (value & unsigned_type(1)) == 0; value = static_cast<unsigned_type>(value >> 1))
+            {
+                ++res;
+            }
+            return res;
+#endif
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,281 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XBITSET_RANK_SELECT_HPP
+#define XTL_XBITSET_RANK_SELECT_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xdynamic_bitset.hpp"
+
+namespace xtl
+{
+    /***********************
+     * xbitset_rank_select *
+     ***********************/
+
+    /**
+     * Succinct rank / select directory over an immutable xdynamic_bitset or
+     * xdynamic_bitset_view.
+     *
+     * The bitset is split in superblocks of 2048 bits, each one described by
+     * a single 64-bit entry holding the number of set bits before it (relative
+     * to the enclosing 2^32 bits range) and the counts of its first three
+     * 512-bit basic blocks. rank therefore reads one entry and at most one
+     * cache line of the bitset. The position of every 8192-th set bit is
+     * sampled to bound the search done by select. The directory costs about
+     * 3.2% of the bitset memory.
+     *
+     * The directory does not track the bitset: it must be rebuilt explicitly
+     * after any mutation, and the bitset must outlive it.
+     */
+    template <class B>
+    class xbitset_rank_select
+    {
+    public:
+
+        using bitset_type = B;
+        using block_type = typename bitset_type::block_type;
+        using size_type = std::size_t;
+
+        static constexpr size_type npos = static_cast<size_type>(-1);
+
+        explicit xbitset_rank_select(const bitset_type& bitset);
+
+        void rebuild();
+        void rebuild(const bitset_type& bitset);
+
+        const bitset_type& bitset() const noexcept;
+        size_type size() const noexcept;
+        size_type count() const noexcept;
+
+        size_type rank(size_type pos) const noexcept;
+        size_type select(size_type k) const noexcept;
+
+        size_type memory_usage() const noexcept;
+
+    private:
+
+        static constexpr size_type s_bits_per_block = CHAR_BIT * sizeof(block_type);
+        static constexpr size_type s_basic_bits = 512;
+        static constexpr size_type s_super_bits = 2048;
+        static constexpr size_type s_basic_per_super = s_super_bits / s_basic_bits;
+        static constexpr size_type s_blocks_per_basic = s_basic_bits / s_bits_per_block;
+        static constexpr size_type s_supers_per_upper = size_type(1) << 21;
+        static constexpr size_type s_select_sample = 8192;
+        static constexpr size_type s_basic_count_bits = 10;
+
+        uint64_t basic_count(size_type first_block, size_type last_block) const noexcept;
+        uint64_t super_rank(size_type i) const noexcept;
+
+        const bitset_type* p_bitset;
+        std::vector<uint64_t> m_upper;
+        std::vector<uint64_t> m_super;
+        std::vector<uint32_t> m_samples;
+        size_type m_count;
+    };
+
+    /**************************************
+     * xbitset_rank_select implementation *
+     **************************************/
+
+    template <class B>
+    inline xbitset_rank_select<B>::xbitset_rank_select(const bitset_type& bitset)
+        : p_bitset(&bitset), m_count(0)
+    {
+        rebuild();
+    }
+
+    template <class B>
+    inline void xbitset_rank_select<B>::rebuild(const bitset_type& bitset)
+    {
+        p_bitset = &bitset;
+        rebuild();
+    }
+
+    /**
+     * Recomputes the directory from the current content of the bitset.
+     */
+    template <class B>
+    inline void xbitset_rank_select<B>::rebuild()
+    {
+        size_type size = p_bitset->size();
+        size_type block_count = p_bitset->block_count();
+        size_type super_count = size / s_super_bits + 1;
+
+        m_upper.assign(super_count / s_supers_per_upper + 1, 0);
+        m_super.assign(super_count, 0);
+        m_samples.clear();
+
+        uint64_t total = 0;
+        for (size_type i = 0; i < super_count; ++i)
+        {
+            if (i % s_supers_per_upper == 0)
+            {
+                m_upper[i / s_supers_per_upper] = total;
+            }
+            uint64_t entry = total - m_upper[i / s_supers_per_upper];
+            uint64_t super_first = total;
+            size_type first_block = i * (s_super_bits / s_bits_per_block);
+            for (size_type j = 0; j < s_basic_per_super; ++j)
+            {
+                size_type begin = std::min(first_block + j * s_blocks_per_basic, block_count);
+                size_type end = std::min(begin + s_blocks_per_basic, block_count);
+                uint64_t c = basic_count(begin, end);
+                if (j + 1 < s_basic_per_super)
+                {
+                    entry |= c << (32 + j * s_basic_count_bits);
+                }
+                total += c;
+            }
+            m_super[i] = entry;
+            // A superblock holds less set bits than the sampling rate,
+            // hence at most one sample per superblock.
+            if ((super_first + s_select_sample - 1) / s_select_sample < (total + s_select_sample - 1) / s_select_sample)
+            {
+                m_samples.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        m_count = static_cast<size_type>(total);
+    }
+
+    template <class B>
+    inline auto xbitset_rank_select<B>::bitset() const noexcept -> const bitset_type&
+    {
+        return *p_bitset;
+    }
+
+    template <class B>
+    inline auto xbitset_rank_select<B>::size() const noexcept -> size_type
+    {
+        return p_bitset->size();
+    }
+
+    template <class B>
+    inline auto xbitset_rank_select<B>::count() const noexcept -> size_type
+    {
+        return m_count;
+    }
+
+    /**
+     * Returns the number of set bits in [0, pos), pos must not exceed size().
+     */
+    template <class B>
+    inline auto xbitset_rank_select<B>::rank(size_type pos) const noexcept -> size_type
+    {
+        size_type i = pos / s_super_bits;
+        uint64_t entry = m_super[i];
+        uint64_t res = super_rank(i);
+        size_type j = (pos % s_super_bits) / s_basic_bits;
+        for (size_type k = 0; k < j; ++k)
+        {
+            res += (entry >> (32 + k * s_basic_count_bits)) & ((uint64_t(1) << s_basic_count_bits) - 1);
+        }
+
+        const block_type* data = p_bitset->data();
+        size_type first_block = (i * s_super_bits + j * s_basic_bits) / s_bits_per_block;
+        size_type last_block = pos / s_bits_per_block;
+        res += basic_count(first_block, last_block);
+        size_type offset = pos % s_bits_per_block;
+        if (offset != 0)
+        {
+            block_type mask = static_cast<block_type>(static_cast<block_type>(~block_type(0)) >> (s_bits_per_block - offset));
+            res += detail_bitset::popcount(static_cast<block_type>(data[last_block] & mask));
+        }
+        return static_cast<size_type>(res);
+    }
+
+    /**
+     * Returns the position of the k-th (0-based) set bit, or npos if the
+     * bitset holds less than k + 1 set bits.
+     */
+    template <class B>
+    inline auto xbitset_rank_select<B>::select(size_type k) const noexcept -> size_type
+    {
+        if (k >= m_count)
+        {
+            return npos;
+        }
+
+        // Last superblock whose rank is not greater than k, searched between two samples
+        size_type sample = k / s_select_sample;
+        size_type lo = m_samples[sample];
+        size_type hi = sample + 1 < m_samples.size() ? size_type(m_samples[sample + 1]) + 1 : m_super.size();
+        while (hi - lo > 1)
+        {
+            size_type mid = lo + (hi - lo) / 2;
+            if (super_rank(mid) <= k)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        uint64_t remaining = k - super_rank(lo);
+        uint64_t entry = m_super[lo];
+        size_type j = 0;
+        for (; j + 1 < s_basic_per_super; ++j)
+        {
+            uint64_t c = (entry >> (32 + j * s_basic_count_bits)) & ((uint64_t(1) << s_basic_count_bits) - 1);
+            if (remaining < c)
+            {
+                break;
+            }
+            remaining -= c;
+        }
+
+        const block_type* data = p_bitset->data();
+        size_type block = (lo * s_super_bits + j * s_basic_bits) / s_bits_per_block;
+        for (;; ++block)
+        {
+            uint64_t c = detail_bitset::popcount(data[block]);
+            if (remaining < c)
+            {
+                return block * s_bits_per_block + detail_bitset::select_in_block(data[block], static_cast<size_type>(remaining));
+            }
+            remaining -= c;
+        }
+    }
+
+    /**
+     * Returns the number of bytes used by the directory.
+     */
+    template <class B>
+    inline auto xbitset_rank_select<B>::memory_usage() const noexcept -> size_type
+    {
+        return m_upper.size() * sizeof(uint64_t) + m_super.size() * sizeof(uint64_t) + m_samples.size() * sizeof(uint32_t);
+    }
+
+    template <class B>
+    inline uint64_t xbitset_rank_select<B>::basic_count(size_type first_block, size_type last_block) const noexcept
+    {
+        const block_type* data = p_bitset->data();
+        uint64_t res = 0;
+        for (size_type i = first_block; i < last_block; ++i)
+        {
+            res += detail_bitset::popcount(data[i]);
+        }
+        return res;
+    }
+
+    template <class B>
+    inline uint64_t xbitset_rank_select<B>::super_rank(size_type i) const noexcept
+    {
+        return m_upper[i / s_supers_per_upper] + (m_super[i] & 0xFFFFFFFFu);
+    }
+}
+
+#endif
@@ -0,0 +1,425 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XBITSET_SERIALIZATION_HPP
+#define XTL_XBITSET_SERIALIZATION_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "xdynamic_bitset.hpp"
+#include "xplatform.hpp"
+#include "xtl_config.hpp"
+
+namespace xtl
+{
+    /************************
+     * bitset binary format *
+     ************************/
+
+    // A serialized bitset is a 32 bytes header followed by the blocks of the
+    // bitset, as they are laid out in memory on the machine that wrote them:
+    //
+    //   offset  size  content
+    //   0       4     magic number "XTLB"
+    //   4       1     format version (1)
+    //   5       1     byte order of the writer: 0 little endian, 1 big endian
+    //   6       1     size of a block in bytes
+    //   7       1     reserved (0)
+    //   8       8     number of bits, in the byte order of the writer
+    //   16      8     number of blocks, in the byte order of the writer
+    //   24      8     reserved (0)
+    //
+    // The blocks start 32 bytes after the beginning of the buffer, so a
+    // buffer aligned for the block type (e.g. a mapped file) can be wrapped
+    // in an xdynamic_bitset_view without copy when it has been written on a
+    // machine with the same byte order and the same block size.
+
+    constexpr std::size_t bitset_header_size = 32;
+
+    struct xbitset_header
+    {
+        std::size_t size;
+        std::size_t block_count;
+        std::size_t block_size;
+        endian byte_order;
+    };
+
+    template <class B>
+    std::size_t serialized_size(const xdynamic_bitset_base<B>& b) noexcept;
+
+    template <class B>
+    std::size_t serialize(const xdynamic_bitset_base<B>& b, void* buffer, std::size_t capacity);
+    template <class B>
+    std::ostream& serialize(std::ostream& out, const xdynamic_bitset_base<B>& b);
+
+    xbitset_header read_bitset_header(const void* buffer, std::size_t capacity);
+
+    template <class T, class A = std::allocator<T>>
+    xdynamic_bitset<T, A> deserialize_bitset(const void* buffer, std::size_t capacity);
+    template <class T, class A = std::allocator<T>>
+    xdynamic_bitset<T, A> deserialize_bitset(std::istream& in);
+
+    template <class T>
+    xdynamic_bitset_view<T> deserialize_bitset_view(void* buffer, std::size_t capacity);
+    template <class T>
+    xdynamic_bitset_view<const T> deserialize_bitset_view(const void* buffer, std::size_t capacity);
+
+    /***************************************
+     * bitset serialization implementation *
+     ***************************************/
+
+    namespace detail_bitset
+    {
+        constexpr char serialization_magic[4] = {'X', 'T', 'L', 'B'};
+        constexpr uint8_t serialization_version = 1;
+
+        template <class T>
+        inline T byteswap(T value) noexcept
+        {
+            T res = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+            {
+                res = static_cast<T>((res << CHAR_BIT) | (value & T(0xFF)));
+                value = static_cast<T>(value >> CHAR_BIT);
+            }
+            return res;
+        }
+
+        inline void write_header(const xbitset_header& header, unsigned char* out) noexcept
+        {
+            std::memset(out, 0, bitset_header_size);
+            std::memcpy(out, serialization_magic, sizeof(serialization_magic));
+            out[4] = serialization_version;
+            out[5] = header.byte_order == endian::big_endian ? 1 : 0;
+            out[6] = static_cast<unsigned char>(header.block_size);
+            uint64_t size = header.size;
+            uint64_t block_count = header.block_count;
+            std::memcpy(out + 8, &size, sizeof(size));
+            std::memcpy(out + 16, &block_count, sizeof(block_count));
+        }
+
+        template <class B>
+        inline xbitset_header make_header(const xdynamic_bitset_base<B>& b) noexcept
+        {
+            using block_type = typename xdynamic_bitset_base<B>::block_type;
+            return {b.size(), b.block_count(), sizeof(block_type), endianness()};
+        }
+
+        // Copies blocks of any size and byte order into native blocks of type T.
+        // The bit i of the bitset is the bit i % w of the block i / w in both
+        // layouts, w being the number of bits of the blocks.
+        template <class T>
+        inline void convert_blocks(const unsigned char* src, const xbitset_header& header, T* dst, std::size_t dst_count) noexcept
+        {
+            std::size_t src_size = header.block_size;
+            bool src_little = header.byte_order == endian::little_endian;
+            std::size_t src_bytes = header.block_count * src_size;
+            for (std::size_t i = 0; i < dst_count; ++i)
+            {
+                T value = 0;
+                for (std::size_t k = 0; k < sizeof(T); ++k)
+                {
+                    // Byte k (from the least significant one) of the destination block
+                    std::size_t byte = i * sizeof(T) + k;
+                    if (byte >= src_bytes)
+                    {
+                        break;
+                    }
+                    std::size_t block = byte / src_size;
+                    std::size_t offset = byte % src_size;
+                    std::size_t index = block * src_size + (src_little ? offset : src_size - 1 - offset);
+                    value = static_cast<T>(value | static_cast<T>(T(src[index]) << (k * CHAR_BIT)));
+                }
+                dst[i] = value;
+            }
+        }
+
+        template <class T>
+        inline bool is_native_layout(const xbitset_header& header) noexcept
+        {
+            return header.block_size == sizeof(T) && header.byte_order == endianness();
+        }
+
+        // Returns the number of bytes left in the stream, or -1 if the stream
+        // cannot be repositioned (e.g. a pipe).
+        inline std::streamoff remaining_stream_size(std::istream& in)
+        {
+            std::istream::pos_type pos = in.tellg();
+            if (pos == std::istream::pos_type(-1))
+            {
+                return -1;
+            }
+            if (!in.seekg(0, std::ios_base::end))
+            {
+                in.clear();
+                in.seekg(pos);
+                return -1;
+            }
+            std::istream::pos_type end = in.tellg();
+            in.seekg(pos);
+            return end - pos;
+        }
+
+        // Reads bytes bytes from the stream, growing out by bounded chunks so
+        // that a corrupt header cannot make it allocate more than what the
+        // stream actually holds.
+        inline bool read_stream_blocks(std::istream& in, std::vector<unsigned char>& out, std::size_t bytes)
+        {
+            constexpr std::size_t chunk_size = std::size_t(1) << 20;
+            out.clear();
+            while (out.size() < bytes)
+            {
+                std::size_t offset = out.size();
+                std::size_t count = (std::min)(chunk_size, bytes - offset);
+                out.resize(offset + count);
+                if (!in.read(reinterpret_cast<char*>(out.data() + offset), static_cast<std::streamsize>(count)))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Checks that the blocks of buffer can be viewed as blocks of type T
+        template <class T>
+        inline xbitset_header read_view_header(const void* buffer, std::size_t capacity)
+        {
+            xbitset_header header = read_bitset_header(buffer, capacity);
+            if (!is_native_layout<T>(header))
+            {
+                XTL_THROW(std::runtime_error, "deserialize_bitset_view: block size or byte order mismatch");
+            }
+            const unsigned char* blocks = static_cast<const unsigned char*>(buffer) + bitset_header_size;
+            if (reinterpret_cast<std::uintptr_t>(blocks) % alignof(T) != 0)
+            {
+                XTL_THROW(std::runtime_error, "deserialize_bitset_view: misaligned buffer");
+            }
+            return header;
+        }
+
+        template <class T, class A>
+        inline void finalize_bitset(xdynamic_bitset<T, A>& b)
+        {
+            // Clears the bits past the size, which a foreign writer may have set
+            std::size_t extra_bits = b.size() % (CHAR_BIT * sizeof(T));
+            if (extra_bits != 0)
+            {
+                b.data()[b.block_count() - 1] &= static_cast<T>(~(static_cast<T>(~T(0)) << extra_bits));
+            }
+        }
+    }
+
+    /**
+     * Returns the number of bytes written by serialize(b, ...).
+     */
+    template <class B>
+    inline std::size_t serialized_size(const xdynamic_bitset_base<B>& b) noexcept
+    {
+        using block_type = typename xdynamic_bitset_base<B>::block_type;
+        return bitset_header_size + b.block_count() * sizeof(block_type);
+    }
+
+    /**
+     * Writes b to buffer, which must hold at least serialized_size(b) bytes.
+     * Returns the number of bytes written.
+     */
+    template <class B>
+    inline std::size_t serialize(const xdynamic_bitset_base<B>& b, void* buffer, std::size_t capacity)
+    {
+        using block_type = typename xdynamic_bitset_base<B>::block_type;
+        std::size_t size = serialized_size(b);
+        if (capacity < size)
+        {
+            XTL_THROW(std::length_error, "serialize: buffer too small for the bitset");
+        }
+        unsigned char* out = static_cast<unsigned char*>(buffer);
+        detail_bitset::write_header(detail_bitset::make_header(b), out);
+        if (b.block_count() != 0)
+        {
+            std::memcpy(out + bitset_header_size, b.data(), b.block_count() * sizeof(block_type));
+        }
+        return size;
+    }
+
+    template <class B>
+    inline std::ostream& serialize(std::ostream& out, const xdynamic_bitset_base<B>& b)
+    {
+        using block_type = typename xdynamic_bitset_base<B>::block_type;
+        unsigned char header[bitset_header_size];
+        detail_bitset::write_header(detail_bitset::make_header(b), header);
+        out.write(reinterpret_cast<const char*>(header), static_cast<std::streamsize>(bitset_header_size));
+        out.write(reinterpret_cast<const char*>(b.data()), static_cast<std::streamsize>(b.block_count() * sizeof(block_type)));
+        return out;
+    }
+
+    /**
+     * Reads and validates the header of a serialized bitset. Throws if the
+     * header is invalid or if the buffer cannot hold the blocks it announces.
+     */
+    inline xbitset_header read_bitset_header(const void* buffer, std::size_t capacity)
+    {
+        const unsigned char* in = static_cast<const unsigned char*>(buffer);
+        if (capacity < bitset_header_size || std::memcmp(in, detail_bitset::serialization_magic, sizeof(detail_bitset::serialization_magic)) != 0)
+        {
+            XTL_THROW(std::runtime_error, "read_bitset_header: not a serialized bitset");
+        }
+        if (in[4] != detail_bitset::serialization_version || in[5] > 1 || in[7] != 0)
+        {
+            XTL_THROW(std::runtime_error, "read_bitset_header: unsupported bitset format");
+        }
+        std::size_t block_size = in[6];
+        if (block_size != 1 && block_size != 2 && block_size != 4 && block_size != 8)
+        {
+            XTL_THROW(std::runtime_error, "read_bitset_header: unsupported block size");
+        }
+
+        xbitset_header header;
+        header.byte_order = in[5] == 1 ? endian::big_endian : endian::little_endian;
+        header.block_size = block_size;
+        uint64_t size = 0;
+        uint64_t block_count = 0;
+        std::memcpy(&size, in + 8, sizeof(size));
+        std::memcpy(&block_count, in + 16, sizeof(block_count));
+        if (header.byte_order != endianness())
+        {
+            size = detail_bitset::byteswap(size);
+            block_count = detail_bitset::byteswap(block_count);
+        }
+        uint64_t block_bits = CHAR_BIT * block_size;
+        if (block_count != size / block_bits + (size % block_bits != 0 ? 1u : 0u)
+            || block_count > (capacity - bitset_header_size) / block_size)
+        {
+            XTL_THROW(std::runtime_error, "read_bitset_header: truncated or inconsistent bitset");
+        }
+        header.size = static_cast<std::size_t>(size);
+        header.block_count = static_cast<std::size_t>(block_count);
+        return header;
+    }
+
+    /**
+     * Reads a bitset from buffer into a new xdynamic_bitset. The blocks are
+     * converted if they were written with another block size or byte order.
+     */
+    template <class T, class A>
+    inline xdynamic_bitset<T, A> deserialize_bitset(const void* buffer, std::size_t capacity)
+    {
+        xbitset_header header = read_bitset_header(buffer, capacity);
+        const unsigned char* blocks = static_cast<const unsigned char*>(buffer) + bitset_header_size;
+        xdynamic_bitset<T, A> res(header.size);
+        if (res.block_count() == 0)
+        {
+            return res;
+        }
+        if (detail_bitset::is_native_layout<T>(header))
+        {
+            std::memcpy(res.data(), blocks, res.block_count() * sizeof(T));
+        }
+        else
+        {
+            detail_bitset::convert_blocks(blocks, header, res.data(), res.block_count());
+        }
+        detail_bitset::finalize_bitset(res);
+        return res;
+    }
+
+    /**
+     * Reads a bitset from a stream. The result is only allocated once the
+     * stream is known to hold all the blocks announced by the header: the
+     * remaining length is checked when the stream can be repositioned, the
+     * blocks are otherwise read by bounded chunks first. A truncated or
+     * corrupt stream throws std::runtime_error.
+     */
+    template <class T, class A>
+    inline xdynamic_bitset<T, A> deserialize_bitset(std::istream& in)
+    {
+        unsigned char header_buffer[bitset_header_size];
+        if (!in.read(reinterpret_cast<char*>(header_buffer), static_cast<std::streamsize>(bitset_header_size)))
+        {
+            XTL_THROW(std::runtime_error, "deserialize_bitset: not a serialized bitset");
+        }
+        // The block count is checked against the stream contents below
+        xbitset_header header = read_bitset_header(header_buffer, static_cast<std::size_t>(-1));
+        std::size_t bytes = header.block_count * header.block_size;
+        std::streamoff remaining = detail_bitset::remaining_stream_size(in);
+        bool native = detail_bitset::is_native_layout<T>(header);
+        if (remaining >= 0 && static_cast<uint64_t>(remaining) < bytes)
+        {
+            XTL_THROW(std::runtime_error, "deserialize_bitset: truncated bitset");
+        }
+
+        std::vector<unsigned char> blocks;
+        if ((remaining < 0 || !native) && !detail_bitset::read_stream_blocks(in, blocks, bytes))
+        {
+            XTL_THROW(std::runtime_error, "deserialize_bitset: truncated bitset");
+        }
+        xdynamic_bitset<T, A> res(header.size);
+        if (res.block_count() == 0)
+        {
+            return res;
+        }
+        if (!native)
+        {
+            detail_bitset::convert_blocks(blocks.data(), header, res.data(), res.block_count());
+        }
+        else if (remaining < 0)
+        {
+            std::memcpy(res.data(), blocks.data(), bytes);
+        }
+        else if (!in.read(reinterpret_cast<char*>(res.data()), static_cast<std::streamsize>(bytes)))
+        {
+            XTL_THROW(std::runtime_error, "deserialize_bitset: truncated bitset");
+        }
+        detail_bitset::finalize_bitset(res);
+        return res;
+    }
+
+    /**
+     * Wraps the blocks of a serialized bitset in a view, without copy. The
+     * buffer must have been written with blocks of type T on a machine with
+     * the same byte order, and its blocks must be aligned for T. Loading a
+     * mapped file this way only costs the page faults of the accessed blocks.
+     * Use the const overload for read-only buffers.
+     */
+    template <class T>
+    inline xdynamic_bitset_view<T> deserialize_bitset_view(void* buffer, std::size_t capacity)
+    {
+        xbitset_header header = detail_bitset::read_view_header<T>(buffer, capacity);
+        T* blocks = reinterpret_cast<T*>(static_cast<unsigned char*>(buffer) + bitset_header_size);
+        return xdynamic_bitset_view<T>(blocks, header.size);
+    }
+
+    /**
+     * Wraps the blocks of a read-only serialized bitset, e.g. a read-only
+     * mapped file, in a view that cannot modify them. Since the view cannot
+     * clear the bits past the size, the buffer is rejected if any is set.
+     */
+    template <class T>
+    inline xdynamic_bitset_view<const T> deserialize_bitset_view(const void* buffer, std::size_t capacity)
+    {
+        xbitset_header header = detail_bitset::read_view_header<T>(buffer, capacity);
+        const T* blocks = reinterpret_cast<const T*>(static_cast<const unsigned char*>(buffer) + bitset_header_size);
+        std::size_t extra_bits = header.size % (CHAR_BIT * sizeof(T));
+        if (extra_bits != 0 && (blocks[header.block_count - 1] >> extra_bits) != 0)
+        {
+            XTL_THROW(std::runtime_error, "deserialize_bitset_view: bits set past the size");
+        }
+        return xdynamic_bitset_view<const T>(blocks, header.size);
+    }
+}
+
+#endif
@@ -0,0 +1,342 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XCONCURRENT_BITSET_HPP
+#define XTL_XCONCURRENT_BITSET_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "xdynamic_bitset.hpp"
+
+namespace xtl
+{
+    /***********************************
+     * atomic operations on raw blocks *
+     ***********************************/
+
+    namespace detail_bitset
+    {
+        // Atomic read-modify-write operations on blocks that are not
+        // std::atomic objects: std::atomic_ref when available, the GCC / clang
+        // builtins otherwise, and as a last resort an std::atomic with the
+        // same representation as the block.
+#if defined(__cpp_lib_atomic_ref)
+        template <class T>
+        inline T atomic_load(const T* p, std::memory_order order) noexcept
+        {
+            return std::atomic_ref<T>(*const_cast<T*>(p)).load(order);
+        }
+
+        template <class T>
+        inline T atomic_fetch_or(T* p, T value, std::memory_order order) noexcept
+        {
+            return std::atomic_ref<T>(*p).fetch_or(value, order);
+        }
+
+        template <class T>
+        inline T atomic_fetch_and(T* p, T value, std::memory_order order) noexcept
+        {
+            return std::atomic_ref<T>(*p).fetch_and(value, order);
+        }
+
+        template <class T>
+        inline T atomic_fetch_xor(T* p, T value, std::memory_order order) noexcept
+        {
+            return std::atomic_ref<T>(*p).fetch_xor(value, order);
+        }
+#elif defined(__GNUC__)
+        constexpr int builtin_memory_order(std::memory_order order) noexcept
+        {
+            return order == std::memory_order_relaxed ? __ATOMIC_RELAXED
+                 : order == std::memory_order_consume ? __ATOMIC_CONSUME
+                 : order == std::memory_order_acquire ? __ATOMIC_ACQUIRE
+                 : order == std::memory_order_release ? __ATOMIC_RELEASE
+                 : order == std::memory_order_acq_rel ? __ATOMIC_ACQ_REL
+                 : __ATOMIC_SEQ_CST;
+        }
+
+        template <class T>
+        inline T atomic_load(const T* p, std::memory_order order) noexcept
+        {
+            return __atomic_load_n(p, builtin_memory_order(order));
+        }
+
+        template <class T>
+        inline T atomic_fetch_or(T* p, T value, std::memory_order order) noexcept
+        {
+            return __atomic_fetch_or(p, value, builtin_memory_order(order));
+        }
+
+        template <class T>
+        inline T atomic_fetch_and(T* p, T value, std::memory_order order) noexcept
+        {
+            return __atomic_fetch_and(p, value, builtin_memory_order(order));
+        }
+
+        template <class T>
+        inline T atomic_fetch_xor(T* p, T value, std::memory_order order) noexcept
+        {
+            return __atomic_fetch_xor(p, value, builtin_memory_order(order));
+        }
+#else
+        template <class T>
+        inline std::atomic<T>* as_atomic(const T* p) noexcept
+        {
+            static_assert(sizeof(std::atomic<T>) == sizeof(T) && std::atomic<T>::is_always_lock_free,
+                          "blocks must have the representation of a lock-free atomic");
+            return reinterpret_cast<std::atomic<T>*>(const_cast<T*>(p));
+        }
+
+        template <class T>
+        inline T atomic_load(const T* p, std::memory_order order) noexcept
+        {
+            return as_atomic(p)->load(order);
+        }
+
+        template <class T>
+        inline T atomic_fetch_or(T* p, T value, std::memory_order order) noexcept
+        {
+            return as_atomic(p)->fetch_or(value, order);
+        }
+
+        template <class T>
+        inline T atomic_fetch_and(T* p, T value, std::memory_order order) noexcept
+        {
+            return as_atomic(p)->fetch_and(value, order);
+        }
+
+        template <class T>
+        inline T atomic_fetch_xor(T* p, T value, std::memory_order order) noexcept
+        {
+            return as_atomic(p)->fetch_xor(value, order);
+        }
+#endif
+    }
+
+    /**********************
+     * xconcurrent_bitset *
+     **********************/
+
+    /**
+     * Bitset whose single-bit operations may be called concurrently.
+     *
+     * B is an xdynamic_bitset, which the concurrent bitset owns, or an
+     * xdynamic_bitset_view over external blocks. set, reset, flip and the
+     * test_and_* operations are atomic read-modify-writes on the block
+     * holding the bit, so several threads may update bits of the same block
+     * without synchronization. The operations on the whole bitset go through
+     * bitset() or view(), which give access to the underlying blocks without
+     * copy; they must not overlap with concurrent updates.
+     */
+    template <class B>
+    class xconcurrent_bitset
+    {
+    public:
+
+        using self_type = xconcurrent_bitset<B>;
+        using bitset_type = B;
+        using block_type = typename bitset_type::block_type;
+        using view_type = xdynamic_bitset_view<block_type>;
+        using size_type = std::size_t;
+
+        static_assert(std::is_integral<block_type>::value && std::is_unsigned<block_type>::value,
+                      "xconcurrent_bitset requires unsigned integral blocks");
+
+        xconcurrent_bitset() = default;
+        explicit xconcurrent_bitset(size_type size, bool value = false);
+        explicit xconcurrent_bitset(bitset_type bitset);
+
+        size_type size() const noexcept;
+        size_type block_count() const noexcept;
+
+        bool test(size_type pos, std::memory_order order = std::memory_order_seq_cst) const noexcept;
+        bool operator[](size_type pos) const noexcept;
+
+        void set(size_type pos, std::memory_order order = std::memory_order_seq_cst) noexcept;
+        void set(size_type pos, bool value, std::memory_order order = std::memory_order_seq_cst) noexcept;
+        void reset(size_type pos, std::memory_order order = std::memory_order_seq_cst) noexcept;
+        void flip(size_type pos, std::memory_order order = std::memory_order_seq_cst) noexcept;
+
+        bool test_and_set(size_type pos, std::memory_order order = std::memory_order_seq_cst) noexcept;
+        bool test_and_reset(size_type pos, std::memory_order order = std::memory_order_seq_cst) noexcept;
+        bool test_and_flip(size_type pos, std::memory_order order = std::memory_order_seq_cst) noexcept;
+
+        bitset_type& bitset() & noexcept;
+        const bitset_type& bitset() const & noexcept;
+        bitset_type bitset() &&;
+
+        view_type view() noexcept;
+
+    private:
+
+        static constexpr size_type s_bits_per_block = CHAR_BIT * sizeof(block_type);
+
+        block_type* block(size_type pos) noexcept;
+        const block_type* block(size_type pos) const noexcept;
+        static block_type bit_mask(size_type pos) noexcept;
+
+        bitset_type m_bitset;
+    };
+
+    /*************************************
+     * xconcurrent_bitset implementation *
+     *************************************/
+
+    template <class B>
+    inline xconcurrent_bitset<B>::xconcurrent_bitset(size_type size, bool value)
+        : m_bitset(size, value)
+    {
+    }
+
+    template <class B>
+    inline xconcurrent_bitset<B>::xconcurrent_bitset(bitset_type bitset)
+        : m_bitset(std::move(bitset))
+    {
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::size() const noexcept -> size_type
+    {
+        return m_bitset.size();
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::block_count() const noexcept -> size_type
+    {
+        return m_bitset.block_count();
+    }
+
+    template <class B>
+    inline bool xconcurrent_bitset<B>::test(size_type pos, std::memory_order order) const noexcept
+    {
+        return (detail_bitset::atomic_load(block(pos), order) & bit_mask(pos)) != block_type(0);
+    }
+
+    template <class B>
+    inline bool xconcurrent_bitset<B>::operator[](size_type pos) const noexcept
+    {
+        return test(pos);
+    }
+
+    template <class B>
+    inline void xconcurrent_bitset<B>::set(size_type pos, std::memory_order order) noexcept
+    {
+        test_and_set(pos, order);
+    }
+
+    template <class B>
+    inline void xconcurrent_bitset<B>::set(size_type pos, bool value, std::memory_order order) noexcept
+    {
+        if (value)
+        {
+            test_and_set(pos, order);
+        }
+        else
+        {
+            test_and_reset(pos, order);
+        }
+    }
+
+    template <class B>
+    inline void xconcurrent_bitset<B>::reset(size_type pos, std::memory_order order) noexcept
+    {
+        test_and_reset(pos, order);
+    }
+
+    template <class B>
+    inline void xconcurrent_bitset<B>::flip(size_type pos, std::memory_order order) noexcept
+    {
+        test_and_flip(pos, order);
+    }
+
+    /**
+     * Sets the bit at pos and returns its previous value.
+     */
+    template <class B>
+    inline bool xconcurrent_bitset<B>::test_and_set(size_type pos, std::memory_order order) noexcept
+    {
+        block_type mask = bit_mask(pos);
+        return (detail_bitset::atomic_fetch_or(block(pos), mask, order) & mask) != block_type(0);
+    }
+
+    /**
+     * Clears the bit at pos and returns its previous value.
+     */
+    template <class B>
+    inline bool xconcurrent_bitset<B>::test_and_reset(size_type pos, std::memory_order order) noexcept
+    {
+        block_type mask = bit_mask(pos);
+        return (detail_bitset::atomic_fetch_and(block(pos), static_cast<block_type>(~mask), order) & mask) != block_type(0);
+    }
+
+    /**
+     * Flips the bit at pos and returns its previous value.
+     */
+    template <class B>
+    inline bool xconcurrent_bitset<B>::test_and_flip(size_type pos, std::memory_order order) noexcept
+    {
+        block_type mask = bit_mask(pos);
+        return (detail_bitset::atomic_fetch_xor(block(pos), mask, order) & mask) != block_type(0);
+    }
+
+    /**
+     * Returns the underlying bitset, for the phases without concurrent updates.
+     */
+    template <class B>
+    inline auto xconcurrent_bitset<B>::bitset() & noexcept -> bitset_type&
+    {
+        return m_bitset;
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::bitset() const & noexcept -> const bitset_type&
+    {
+        return m_bitset;
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::bitset() && -> bitset_type
+    {
+        return std::move(m_bitset);
+    }
+
+    /**
+     * Returns a view over the blocks of the bitset, for the phases without
+     * concurrent updates.
+     */
+    template <class B>
+    inline auto xconcurrent_bitset<B>::view() noexcept -> view_type
+    {
+        return view_type(m_bitset.data(), m_bitset.size());
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::block(size_type pos) noexcept -> block_type*
+    {
+        return m_bitset.data() + pos / s_bits_per_block;
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::block(size_type pos) const noexcept -> const block_type*
+    {
+        return m_bitset.data() + pos / s_bits_per_block;
+    }
+
+    template <class B>
+    inline auto xconcurrent_bitset<B>::bit_mask(size_type pos) noexcept -> block_type
+    {
+        return static_cast<block_type>(block_type(1) << (pos % s_bits_per_block));
+    }
+}
+
+#endif
@@ -17,8 +17,11 @@
 #include <iterator>
 #include <memory>
 #include <algorithm>
+#include <tuple>
+#include <utility>
 
 #include "xclosure.hpp"
+#include "xdynamic_bitset_kernels.hpp"
 #include "xspan.hpp"
 #include "xiterator_base.hpp"
 #include "xtype_traits.hpp"
@@ -31,6 +34,12 @@ namespace xtl
     template <class B, bool is_const>
     class xbitset_iterator;
 
+    template <class B>
+    class xset_bit_iterator;
+
+    template <class B>
+    class xset_bit_range;
+
     /******************
      * xdyamic_bitset *
      ******************/
@@ -47,11 +56,15 @@ namespace xtl
     template <class X>
     struct xdynamic_bitset_traits;
 
+    template <class D>
+    class xbitset_expression;
+
     template <class B, class A>
     struct xdynamic_bitset_traits<xdynamic_bitset<B, A>>
     {
         using storage_type = std::vector<B, A>;
         using block_type = typename storage_type::value_type;
+        static constexpr bool is_read_only = false;
     };
 
     template <class X>
@@ -59,6 +72,8 @@ namespace xtl
     {
         using storage_type = xtl::span<X>;
         using block_type = typename storage_type::value_type;
+        // Views over const blocks only hand out const references
+        static constexpr bool is_read_only = std::is_const<X>::value;
     };
 
     template <class X>
@@ -94,23 +109,28 @@ namespace xtl
 
         using storage_type = typename xdynamic_bitset_traits<B>::storage_type;
         using block_type = typename xdynamic_bitset_traits<B>::block_type;
+        using block_pointer = std::conditional_t<xdynamic_bitset_traits<B>::is_read_only, const block_type*, block_type*>;
         using temporary_type = xdynamic_bitset<block_type, std::allocator<block_type>>;
 
         using allocator_type = typename container_internals<storage_type>::allocator_type;
         using value_type = bool;
-        using reference = xbitset_reference<derived_class, false>;
+        using reference = xbitset_reference<derived_class, xdynamic_bitset_traits<B>::is_read_only>;
         using const_reference = xbitset_reference<derived_class, true>;
 
         using pointer = typename reference::pointer;
         using const_pointer = typename const_reference::pointer;
         using size_type = typename container_internals<storage_type>::size_type;
         using difference_type = typename storage_type::difference_type;
-        using iterator = xbitset_iterator<derived_class, false>;
+        using iterator = xbitset_iterator<derived_class, xdynamic_bitset_traits<B>::is_read_only>;
         using const_iterator = xbitset_iterator<derived_class, true>;
         using reverse_iterator = std::reverse_iterator<iterator>;
         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
         using const_block_iterator = typename storage_type::const_iterator;
+        using set_bit_iterator = xset_bit_iterator<derived_class>;
+        using set_bit_range = xset_bit_range<derived_class>;
+
+        static constexpr size_type npos = static_cast<size_type>(-1);
 
         bool empty() const noexcept;
         size_type size() const noexcept;
@@ -157,11 +177,23 @@ namespace xtl
         template <class R>
         self_type& operator^=(const xdynamic_bitset_base<R>& rhs);
 
-        temporary_type operator<<(size_type pos);
+        template <class D>
+        self_type& operator&=(const xbitset_expression<D>& rhs);
+        template <class D>
+        self_type& operator|=(const xbitset_expression<D>& rhs);
+        template <class D>
+        self_type& operator^=(const xbitset_expression<D>& rhs);
+
+        temporary_type operator<<(size_type pos) const;
         self_type& operator<<=(size_type pos);
-        temporary_type operator>>(size_type pos);
+        temporary_type operator>>(size_type pos) const;
         self_type& operator>>=(size_type pos);
 
+        template <class R>
+        self_type& shift_and(const xdynamic_bitset_base<R>& rhs, difference_type shift);
+        template <class R>
+        self_type& shift_or(const xdynamic_bitset_base<R>& rhs, difference_type shift);
+
         self_type& set();
         self_type& set(size_type pos, value_type value = true);
 
@@ -176,8 +208,18 @@ namespace xtl
         bool none() const noexcept;
         size_type count() const noexcept;
 
+        size_type find_first() const noexcept;
+        size_type find_next(size_type pos) const noexcept;
+
+        set_bit_range set_bits() const noexcept;
+
+        template <class F>
+        void for_each_set_bit(F&& f) const;
+        template <class F>
+        void for_each_set_block(F&& f) const;
+
         size_type block_count() const noexcept;
-        block_type* data() noexcept;
+        block_pointer data() noexcept;
         const block_type* data() const noexcept;
 
         template <class Y>
@@ -185,6 +227,11 @@ namespace xtl
         template <class Y>
         bool operator!=(const xdynamic_bitset_base<Y>& rhs) const noexcept;
 
+        template <class D>
+        bool operator==(const xbitset_expression<D>& rhs) const noexcept;
+        template <class D>
+        bool operator!=(const xbitset_expression<D>& rhs) const noexcept;
+
         derived_class& derived_cast();
         const derived_class& derived_cast() const;
 
@@ -209,6 +256,16 @@ namespace xtl
         block_type bit_mask(size_type pos) const noexcept;
         size_type count_extra_bits() const noexcept;
         void zero_unused_bits();
+
+        template <class D>
+        void evaluate(const xbitset_expression<D>& e);
+
+        template <class OP, class D>
+        void compute_assign(const xbitset_expression<D>& e);
+
+        template <class OP, class R>
+        void shift_assign(const xdynamic_bitset_base<R>& rhs, difference_type shift);
+
     private:
 
         // Make views and buffers friends
@@ -216,7 +273,8 @@ namespace xtl
         friend class xdynamic_bitset_base;
     };
 
-    // NOTE this view ZEROS out remaining bits!
+    // NOTE this view ZEROS out remaining bits! A view over const blocks
+    // cannot do it, the bits past the size must already be clear.
     template <class X>
     class xdynamic_bitset_view
         : public xdynamic_bitset_base<xdynamic_bitset_view<X>>
@@ -227,7 +285,7 @@ namespace xtl
         using storage_type = typename base_class::storage_type;
         using block_type = typename base_class::block_type;
 
-        xdynamic_bitset_view(block_type* ptr, std::size_t size);
+        xdynamic_bitset_view(X* ptr, std::size_t size);
 
         xdynamic_bitset_view() = default;
         ~xdynamic_bitset_view() = default;
@@ -236,6 +294,10 @@ namespace xtl
         xdynamic_bitset_view& operator=(const xdynamic_bitset_view& rhs) = default;
         xdynamic_bitset_view& operator=(xdynamic_bitset_view&& rhs) = default;
 
+        // Evaluates the expression into the viewed blocks
+        template <class D>
+        xdynamic_bitset_view& operator=(const xbitset_expression<D>& e);
+
         void resize(std::size_t sz);
     };
 
@@ -249,10 +311,22 @@ namespace xtl
     }
 
     template <class X>
-    inline xdynamic_bitset_view<X>::xdynamic_bitset_view(block_type* ptr, std::size_t size)
+    inline xdynamic_bitset_view<X>::xdynamic_bitset_view(X* ptr, std::size_t size)
         : base_class(storage_type(ptr, detail_bitset::integer_ceil(size, base_class::s_bits_per_block)), size)
     {
-        base_class::zero_unused_bits();
+        if constexpr (!std::is_const<X>::value)
+        {
+            base_class::zero_unused_bits();
+        }
+    }
+
+    template <class X>
+    template <class D>
+    inline auto xdynamic_bitset_view<X>::operator=(const xbitset_expression<D>& e) -> xdynamic_bitset_view&
+    {
+        resize(e.derived_cast().size());
+        base_class::evaluate(e);
+        return *this;
     }
 
     template <class X>
@@ -271,17 +345,33 @@ namespace xtl
     template <class B, class A = std::allocator<B>>
     class xdynamic_bitset;
 
-    template <class B>
-    auto operator~(const xdynamic_bitset_base<B>& lhs);
+    namespace detail_bitset
+    {
+        template <class B>
+        std::true_type is_bitset_operand_impl(const xdynamic_bitset_base<B>*);
 
-    template <class L, class R>
-    auto operator&(const xdynamic_bitset_base<L>& lhs, const xdynamic_bitset_base<R>& rhs);
+        template <class D>
+        std::true_type is_bitset_operand_impl(const xbitset_expression<D>*);
 
-    template <class L, class R>
-    auto operator|(const xdynamic_bitset_base<L>& lhs, const xdynamic_bitset_base<R>& rhs);
+        std::false_type is_bitset_operand_impl(...);
 
-    template <class L, class R>
-    auto operator^(const xdynamic_bitset_base<L>& lhs, const xdynamic_bitset_base<R>& rhs);
+    }
+
+    // true for bitsets, bitset views and lazy bitset expressions
+    template <class E>
+    using is_xbitset_operand = decltype(detail_bitset::is_bitset_operand_impl(std::declval<std::remove_reference_t<E>*>()));
+
+    template <class E, XTL_REQUIRES(is_xbitset_operand<E>)>
+    auto operator~(E&& e);
+
+    template <class L, class R, XTL_REQUIRES(is_xbitset_operand<L>, is_xbitset_operand<R>)>
+    auto operator&(L&& lhs, R&& rhs);
+
+    template <class L, class R, XTL_REQUIRES(is_xbitset_operand<L>, is_xbitset_operand<R>)>
+    auto operator|(L&& lhs, R&& rhs);
+
+    template <class L, class R, XTL_REQUIRES(is_xbitset_operand<L>, is_xbitset_operand<R>)>
+    auto operator^(L&& lhs, R&& rhs);
 
     template <class B>
     void swap(const xdynamic_bitset_base<B>& lhs, const xdynamic_bitset_base<B>& rhs);
@@ -394,6 +484,70 @@ namespace xtl
         size_type m_index;
     };
 
+    /*********************
+     * xset_bit_iterator *
+     *********************/
+
+    // Forward iterator over the indices of the set bits. The current block
+    // is consumed with count-trailing-zeros and zero blocks are skipped.
+    template <class B>
+    class xset_bit_iterator
+    {
+    public:
+
+        using self_type = xset_bit_iterator<B>;
+        using container_type = xdynamic_bitset_base<B>;
+        using block_type = typename container_type::block_type;
+        using size_type = typename container_type::size_type;
+        using value_type = size_type;
+        using reference = size_type;
+        using pointer = const size_type*;
+        using difference_type = typename container_type::difference_type;
+        using iterator_category = std::forward_iterator_tag;
+
+        xset_bit_iterator() noexcept;
+        xset_bit_iterator(const block_type* data, size_type block_count, size_type block_index) noexcept;
+
+        self_type& operator++();
+        self_type operator++(int);
+
+        reference operator*() const;
+
+        bool operator==(const self_type& rhs) const;
+        bool operator!=(const self_type& rhs) const;
+
+    private:
+
+        void next_block() noexcept;
+
+        static constexpr size_type s_bits_per_block = CHAR_BIT * sizeof(block_type);
+
+        const block_type* p_data;
+        size_type m_block_count;
+        size_type m_block_index;
+        block_type m_block;
+    };
+
+    template <class B>
+    class xset_bit_range
+    {
+    public:
+
+        using container_type = xdynamic_bitset_base<B>;
+        using iterator = xset_bit_iterator<B>;
+        using const_iterator = iterator;
+        using size_type = typename container_type::size_type;
+
+        explicit xset_bit_range(const container_type& c) noexcept;
+
+        iterator begin() const noexcept;
+        iterator end() const noexcept;
+
+    private:
+
+        const container_type* p_container;
+    };
+
     template <class B, class Allocator>
     class xdynamic_bitset
         : public xdynamic_bitset_base<xdynamic_bitset<B, Allocator>>
@@ -445,11 +599,17 @@ namespace xtl
         template <class Y>
         xdynamic_bitset(const xdynamic_bitset_base<Y>& rhs);
 
+        template <class D>
+        xdynamic_bitset(const xbitset_expression<D>& e);
+
         ~xdynamic_bitset() = default;
         xdynamic_bitset(xdynamic_bitset&& rhs) = default;
         xdynamic_bitset& operator=(const xdynamic_bitset& rhs) = default;
         xdynamic_bitset& operator=(xdynamic_bitset&& rhs) = default;
 
+        template <class D>
+        xdynamic_bitset& operator=(const xbitset_expression<D>& e);
+
         void assign(size_type count, bool b);
         template <class BlockInputIt>
         void assign(BlockInputIt first, BlockInputIt last);
@@ -467,6 +627,400 @@ namespace xtl
         void pop_back();
     };
 
+    /**********************
+     * xbitset_expression *
+     **********************/
+
+    // Base class of lazy bitset expressions. An expression is evaluated
+    // tile by tile when it is assigned to a bitset or reduced with count(),
+    // any() or all(), so no temporary bitset is allocated for intermediate
+    // results.
+    template <class D>
+    class xbitset_expression
+    {
+    public:
+
+        using derived_type = D;
+
+        const derived_type& derived_cast() const & noexcept;
+
+    protected:
+
+        xbitset_expression() = default;
+        ~xbitset_expression() = default;
+
+        xbitset_expression(const xbitset_expression&) = default;
+        xbitset_expression& operator=(const xbitset_expression&) = default;
+
+        xbitset_expression(xbitset_expression&&) = default;
+        xbitset_expression& operator=(xbitset_expression&&) = default;
+    };
+
+    /********************
+     * xbitset_function *
+     ********************/
+
+    // OP is one of the block operators of xdynamic_bitset_kernels.hpp; CT are
+    // the closure types of the operands (references to bitsets, or values
+    // for temporary bitsets and sub-expressions).
+    template <class OP, class... CT>
+    class xbitset_function : public xbitset_expression<xbitset_function<OP, CT...>>
+    {
+    public:
+
+        static_assert(sizeof...(CT) == 1 || sizeof...(CT) == 2, "bitset functions are unary or binary");
+
+        using self_type = xbitset_function<OP, CT...>;
+        using block_type = typename std::decay_t<std::tuple_element_t<0, std::tuple<CT...>>>::block_type;
+        using size_type = std::size_t;
+        using value_type = bool;
+        using temporary_type = xdynamic_bitset<block_type, std::allocator<block_type>>;
+
+        template <class... E>
+        explicit xbitset_function(OP, E&&... e);
+
+        bool empty() const noexcept;
+        size_type size() const noexcept;
+        size_type block_count() const noexcept;
+
+        bool operator[](size_type i) const noexcept;
+
+        bool all() const noexcept;
+        bool any() const noexcept;
+        bool none() const noexcept;
+        size_type count() const noexcept;
+
+        template <class Y>
+        bool operator==(const xdynamic_bitset_base<Y>& rhs) const noexcept;
+        template <class Y>
+        bool operator!=(const xdynamic_bitset_base<Y>& rhs) const noexcept;
+        template <class D>
+        bool operator==(const xbitset_expression<D>& rhs) const noexcept;
+        template <class D>
+        bool operator!=(const xbitset_expression<D>& rhs) const noexcept;
+
+        // Evaluation interface, used by bitsets and enclosing expressions
+        block_type block(size_type i) const noexcept;
+        const block_type* tile(size_type first, size_type n, block_type* out) const noexcept;
+        bool overlaps(const void* first, const void* last) const noexcept;
+
+    private:
+
+        std::tuple<CT...> m_e;
+    };
+
+    /*****************************************
+     * xbitset_expression helper and kernels *
+     *****************************************/
+
+    namespace detail_bitset
+    {
+        // Number of blocks evaluated at once by bitset expressions; the
+        // intermediate results of a tile remain in L1 cache.
+        template <class T>
+        constexpr std::size_t expression_tile_size = 2048 / sizeof(T);
+
+        template <class B>
+        inline auto operand_block(const xdynamic_bitset_base<B>& b, std::size_t i) noexcept
+        {
+            return b.data()[i];
+        }
+
+        template <class D>
+        inline auto operand_block(const xbitset_expression<D>& e, std::size_t i) noexcept
+        {
+            return e.derived_cast().block(i);
+        }
+
+        // Returns a pointer to the blocks [first, first + n) of the operand, either
+        // in the operand itself or computed into out.
+        template <class B, class T>
+        inline const T* operand_tile(const xdynamic_bitset_base<B>& b, std::size_t first, std::size_t, T*) noexcept
+        {
+            return b.data() + first;
+        }
+
+        template <class D, class T>
+        inline const T* operand_tile(const xbitset_expression<D>& e, std::size_t first, std::size_t n, T* out) noexcept
+        {
+            return e.derived_cast().tile(first, n, out);
+        }
+
+        template <class B>
+        inline bool operand_overlaps(const xdynamic_bitset_base<B>& b, const void* first, const void* last) noexcept
+        {
+            auto lhs_first = reinterpret_cast<std::uintptr_t>(b.data());
+            auto lhs_last = reinterpret_cast<std::uintptr_t>(b.data() + b.block_count());
+            return lhs_first < reinterpret_cast<std::uintptr_t>(last)
+                && reinterpret_cast<std::uintptr_t>(first) < lhs_last;
+        }
+
+        template <class D>
+        inline bool operand_overlaps(const xbitset_expression<D>& e, const void* first, const void* last) noexcept
+        {
+            return e.derived_cast().overlaps(first, last);
+        }
+
+        // Same as operand_tile, but the bits past the size of the operand are
+        // cleared. Bitsets always keep these bits cleared, expressions may not.
+        template <class E, class T>
+        inline const T* masked_tile(const E& e, std::size_t first, std::size_t n, T* out) noexcept
+        {
+            const T* res = operand_tile(e, first, n, out);
+            std::size_t extra_bits = e.size() % (CHAR_BIT * sizeof(T));
+            if (res == out && extra_bits != 0 && first + n == e.block_count())
+            {
+                out[n - 1] &= static_cast<T>(~(~T(0) << extra_bits));
+            }
+            return res;
+        }
+
+        // Evaluates e into dst, which holds e.block_count() blocks and may be
+        // one of the operands of e.
+        template <class E, class T>
+        inline void evaluate_expression(const E& e, T* dst) noexcept
+        {
+            constexpr std::size_t tile_size = expression_tile_size<T>;
+            T buffer[tile_size];
+            std::size_t n = e.block_count();
+            bool alias = e.overlaps(dst, dst + n);
+            for (std::size_t first = 0; first < n; first += tile_size)
+            {
+                std::size_t m = std::min(tile_size, n - first);
+                const T* res = e.tile(first, m, alias ? buffer : dst + first);
+                if (res != dst + first)
+                {
+                    std::copy(res, res + m, dst + first);
+                }
+            }
+        }
+    }
+
+    /*************************************
+     * xbitset_expression implementation *
+     *************************************/
+
+    template <class D>
+    inline auto xbitset_expression<D>::derived_cast() const & noexcept -> const derived_type&
+    {
+        return *static_cast<const derived_type*>(this);
+    }
+
+    /***********************************
+     * xbitset_function implementation *
+     ***********************************/
+
+    template <class OP, class... CT>
+    template <class... E>
+    inline xbitset_function<OP, CT...>::xbitset_function(OP, E&&... e)
+        : m_e(std::forward<E>(e)...)
+    {
+    }
+
+    template <class OP, class... CT>
+    inline bool xbitset_function<OP, CT...>::empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    template <class OP, class... CT>
+    inline auto xbitset_function<OP, CT...>::size() const noexcept -> size_type
+    {
+        return std::get<0>(m_e).size();
+    }
+
+    template <class OP, class... CT>
+    inline auto xbitset_function<OP, CT...>::block_count() const noexcept -> size_type
+    {
+        return std::get<0>(m_e).block_count();
+    }
+
+    template <class OP, class... CT>
+    inline bool xbitset_function<OP, CT...>::operator[](size_type i) const noexcept
+    {
+        constexpr size_type bits_per_block = CHAR_BIT * sizeof(block_type);
+        block_type mask = static_cast<block_type>(block_type(1) << (i % bits_per_block));
+        return (block(i / bits_per_block) & mask) != 0;
+    }
+
+    template <class OP, class... CT>
+    inline bool xbitset_function<OP, CT...>::all() const noexcept
+    {
+        constexpr size_type tile_size = detail_bitset::expression_tile_size<block_type>;
+        constexpr size_type bits_per_block = CHAR_BIT * sizeof(block_type);
+        block_type buffer[tile_size];
+        size_type n = block_count();
+        size_type extra_bits = size() % bits_per_block;
+        for (size_type first = 0; first < n; first += tile_size)
+        {
+            size_type m = std::min(tile_size, n - first);
+            const block_type* res = tile(first, m, buffer);
+            for (size_type i = 0; i < m; ++i)
+            {
+                block_type expected = extra_bits != 0 && first + i == n - 1
+                    ? static_cast<block_type>(~(~block_type(0) << extra_bits))
+                    : static_cast<block_type>(~block_type(0));
+                if ((res[i] & expected) != expected)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <class OP, class... CT>
+    inline bool xbitset_function<OP, CT...>::any() const noexcept
+    {
+        constexpr size_type tile_size = detail_bitset::expression_tile_size<block_type>;
+        block_type buffer[tile_size];
+        size_type n = block_count();
+        for (size_type first = 0; first < n; first += tile_size)
+        {
+            size_type m = std::min(tile_size, n - first);
+            const block_type* res = detail_bitset::masked_tile(*this, first, m, buffer);
+            for (size_type i = 0; i < m; ++i)
+            {
+                if (res[i] != block_type(0))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <class OP, class... CT>
+    inline bool xbitset_function<OP, CT...>::none() const noexcept
+    {
+        return !any();
+    }
+
+    template <class OP, class... CT>
+    inline auto xbitset_function<OP, CT...>::count() const noexcept -> size_type
+    {
+        constexpr size_type tile_size = detail_bitset::expression_tile_size<block_type>;
+        block_type buffer[tile_size];
+        size_type n = block_count();
+        size_type res = 0;
+        for (size_type first = 0; first < n; first += tile_size)
+        {
+            size_type m = std::min(tile_size, n - first);
+            res += detail_bitset::popcount(detail_bitset::masked_tile(*this, first, m, buffer), m);
+        }
+        return res;
+    }
+
+    template <class OP, class... CT>
+    template <class Y>
+    inline bool xbitset_function<OP, CT...>::operator==(const xdynamic_bitset_base<Y>& rhs) const noexcept
+    {
+        if (size() != rhs.size())
+        {
+            return false;
+        }
+        constexpr size_type tile_size = detail_bitset::expression_tile_size<block_type>;
+        block_type buffer[tile_size];
+        size_type n = block_count();
+        for (size_type first = 0; first < n; first += tile_size)
+        {
+            size_type m = std::min(tile_size, n - first);
+            const block_type* res = detail_bitset::masked_tile(*this, first, m, buffer);
+            if (!detail_bitset::equal_blocks(res, rhs.data() + first, m))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <class OP, class... CT>
+    template <class Y>
+    inline bool xbitset_function<OP, CT...>::operator!=(const xdynamic_bitset_base<Y>& rhs) const noexcept
+    {
+        return !(*this == rhs);
+    }
+
+    template <class OP, class... CT>
+    template <class D>
+    inline bool xbitset_function<OP, CT...>::operator==(const xbitset_expression<D>& rhs) const noexcept
+    {
+        const auto& de = rhs.derived_cast();
+        if (size() != de.size())
+        {
+            return false;
+        }
+        constexpr size_type tile_size = detail_bitset::expression_tile_size<block_type>;
+        block_type lhs_buffer[tile_size];
+        block_type rhs_buffer[tile_size];
+        size_type n = block_count();
+        for (size_type first = 0; first < n; first += tile_size)
+        {
+            size_type m = std::min(tile_size, n - first);
+            const block_type* lhs_res = detail_bitset::masked_tile(*this, first, m, lhs_buffer);
+            const block_type* rhs_res = detail_bitset::masked_tile(de, first, m, rhs_buffer);
+            if (!detail_bitset::equal_blocks(lhs_res, rhs_res, m))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <class OP, class... CT>
+    template <class D>
+    inline bool xbitset_function<OP, CT...>::operator!=(const xbitset_expression<D>& rhs) const noexcept
+    {
+        return !(*this == rhs);
+    }
+
+    template <class OP, class... CT>
+    inline auto xbitset_function<OP, CT...>::block(size_type i) const noexcept -> block_type
+    {
+        block_type lhs = detail_bitset::operand_block(std::get<0>(m_e), i);
+        if constexpr (sizeof...(CT) == 1)
+        {
+            return OP::apply(lhs, lhs);
+        }
+        else
+        {
+            return OP::apply(lhs, detail_bitset::operand_block(std::get<1>(m_e), i));
+        }
+    }
+
+    template <class OP, class... CT>
+    inline auto xbitset_function<OP, CT...>::tile(size_type first, size_type n, block_type* out) const noexcept -> const block_type*
+    {
+        // The first operand is computed in out, so only binary nodes
+        // need additional storage.
+        const block_type* lhs = detail_bitset::operand_tile(std::get<0>(m_e), first, n, out);
+        if constexpr (sizeof...(CT) == 1)
+        {
+            detail_bitset::transform_blocks<OP>(out, lhs, lhs, n);
+        }
+        else
+        {
+            block_type buffer[detail_bitset::expression_tile_size<block_type>];
+            const block_type* rhs = detail_bitset::operand_tile(std::get<1>(m_e), first, n, buffer);
+            detail_bitset::transform_blocks<OP>(out, lhs, rhs, n);
+        }
+        return out;
+    }
+
+    template <class OP, class... CT>
+    inline bool xbitset_function<OP, CT...>::overlaps(const void* first, const void* last) const noexcept
+    {
+        if constexpr (sizeof...(CT) == 1)
+        {
+            return detail_bitset::operand_overlaps(std::get<0>(m_e), first, last);
+        }
+        else
+        {
+            return detail_bitset::operand_overlaps(std::get<0>(m_e), first, last)
+                || detail_bitset::operand_overlaps(std::get<1>(m_e), first, last);
+        }
+    }
+
     /**********************************
      * xdynamic_bitset implementation *
      **********************************/
@@ -485,7 +1039,7 @@ namespace xtl
 
     template <class B, class A>
     inline xdynamic_bitset<B, A>::xdynamic_bitset(size_type count, bool b, const allocator_type& alloc)
-        : base_type(storage_type(this->compute_block_count(count), b ? ~block_type(0) : block_type(0), alloc), count)
+        : base_type(storage_type(this->compute_block_count(count), b ? static_cast<block_type>(~block_type(0)) : block_type(0), alloc), count)
     {
         this->zero_unused_bits();
     }
@@ -523,6 +1077,31 @@ namespace xtl
     {
     }
 
+    template <class B, class A>
+    template <class D>
+    inline xdynamic_bitset<B, A>::xdynamic_bitset(const xbitset_expression<D>& e)
+        : base_type(storage_type(this->compute_block_count(e.derived_cast().size())), e.derived_cast().size())
+    {
+        this->evaluate(e);
+    }
+
+    template <class B, class A>
+    template <class D>
+    inline auto xdynamic_bitset<B, A>::operator=(const xbitset_expression<D>& e) -> xdynamic_bitset&
+    {
+        if (e.derived_cast().size() != size())
+        {
+            // resizing could invalidate the operands of e
+            self_type tmp(e);
+            this->swap(tmp);
+        }
+        else
+        {
+            this->evaluate(e);
+        }
+        return *this;
+    }
+
     template <class B, class A>
     inline void xdynamic_bitset<B, A>::assign(size_type count, bool b)
     {
@@ -586,7 +1165,7 @@ namespace xtl
     {
         size_type old_block_count = base_type::block_count();
         size_type new_block_count = base_type::compute_block_count(asize);
-        block_type value = b ? ~block_type(0) : block_type(0);
+        block_type value = b ? static_cast<block_type>(~block_type(0)) : block_type(0);
 
         if (new_block_count != old_block_count)
         {
@@ -598,7 +1177,7 @@ namespace xtl
             size_type extra_bits = base_type::count_extra_bits();
             if (extra_bits > 0)
             {
-                base_type::m_buffer[old_block_count - 1] |= (value << extra_bits);
+                base_type::m_buffer[old_block_count - 1] |= static_cast<block_type>(value << extra_bits);
             }
         }
 
@@ -782,11 +1361,7 @@ namespace xtl
     template <class R>
     inline auto xdynamic_bitset_base<B>::operator&=(const xdynamic_bitset_base<R>& rhs) -> self_type&
     {
-        size_type size = block_count();
-        for (size_type i = 0; i < size; ++i)
-        {
-            m_buffer[i] &= rhs.m_buffer[i];
-        }
+        detail_bitset::transform_blocks<detail_bitset::bitwise_and>(data(), data(), rhs.data(), block_count());
         return *this;
     }
 
@@ -794,11 +1369,7 @@ namespace xtl
     template <class R>
     inline auto xdynamic_bitset_base<B>::operator|=(const xdynamic_bitset_base<R>& rhs) -> self_type&
     {
-        size_type size = block_count();
-        for (size_type i = 0; i < size; ++i)
-        {
-            m_buffer[i] |= rhs.m_buffer[i];
-        }
+        detail_bitset::transform_blocks<detail_bitset::bitwise_or>(data(), data(), rhs.data(), block_count());
         return *this;
     }
 
@@ -806,19 +1377,43 @@ namespace xtl
     template <class R>
     inline auto xdynamic_bitset_base<B>::operator^=(const xdynamic_bitset_base<R>& rhs) -> self_type&
     {
-        size_type size = block_count();
-        for (size_type i = 0; i < size; ++i)
-        {
-            m_buffer[i] ^= rhs.m_buffer[i];
-        }
+        detail_bitset::transform_blocks<detail_bitset::bitwise_xor>(data(), data(), rhs.data(), block_count());
+        return *this;
+    }
+
+    template <class B>
+    template <class D>
+    inline auto xdynamic_bitset_base<B>::operator&=(const xbitset_expression<D>& rhs) -> self_type&
+    {
+        compute_assign<detail_bitset::bitwise_and>(rhs);
+        return *this;
+    }
+
+    template <class B>
+    template <class D>
+    inline auto xdynamic_bitset_base<B>::operator|=(const xbitset_expression<D>& rhs) -> self_type&
+    {
+        compute_assign<detail_bitset::bitwise_or>(rhs);
         return *this;
     }
 
     template <class B>
-    inline auto xdynamic_bitset_base<B>::operator<<(size_type pos) -> temporary_type
+    template <class D>
+    inline auto xdynamic_bitset_base<B>::operator^=(const xbitset_expression<D>& rhs) -> self_type&
     {
-        temporary_type tmp(this->derived_cast());
-        tmp <<= pos;
+        compute_assign<detail_bitset::bitwise_xor>(rhs);
+        return *this;
+    }
+
+    template <class B>
+    inline auto xdynamic_bitset_base<B>::operator<<(size_type pos) const -> temporary_type
+    {
+        temporary_type tmp(m_size);
+        if (pos < m_size)
+        {
+            detail_bitset::shift_left_blocks<detail_bitset::bitwise_assign>(tmp.data(), data(), block_count(), pos);
+            tmp.zero_unused_bits();
+        }
         return tmp;
     }
 
@@ -830,42 +1425,19 @@ namespace xtl
             return reset();
         }
 
-        if (pos > 0)
-        {
-            size_type last = block_count() - 1;
-            size_type div = pos / s_bits_per_block;
-            size_type r = bit_index(pos);
-            block_type* b = &m_buffer[0];
-
-            if (r != 0)
-            {
-                size_type rs = s_bits_per_block - r;
-                for (size_type i = last - div; i > 0; --i)
-                {
-                    b[i + div] = (b[i] << r) | (b[i - 1] >> rs);
-                }
-                b[div] = b[0] << r;
-            }
-            else
-            {
-                for (size_type i = last - div; i > 0; --i)
-                {
-                    b[i + div] = b[i];
-                }
-                b[div] = b[0];
-            }
-
-            std::fill_n(m_buffer.begin(), div, block_type(0));
-            zero_unused_bits();
-        }
+        detail_bitset::shift_left_blocks<detail_bitset::bitwise_assign>(data(), data(), block_count(), pos);
+        zero_unused_bits();
         return *this;
     }
 
     template <class B>
-    inline auto xdynamic_bitset_base<B>::operator>>(size_type pos) -> temporary_type
+    inline auto xdynamic_bitset_base<B>::operator>>(size_type pos) const -> temporary_type
     {
-        temporary_type tmp(this->derived_cast());
-        tmp >>= pos;
+        temporary_type tmp(m_size);
+        if (pos < m_size)
+        {
+            detail_bitset::shift_right_blocks<detail_bitset::bitwise_assign>(tmp.data(), data(), block_count(), pos);
+        }
         return tmp;
     }
 
@@ -877,32 +1449,33 @@ namespace xtl
             return reset();
         }
 
-        if (pos > 0)
-        {
-            size_type last = block_count() - 1;
-            size_type div = pos / s_bits_per_block;
-            size_type r = bit_index(pos);
-            block_type* b = &m_buffer[0];
+        detail_bitset::shift_right_blocks<detail_bitset::bitwise_assign>(data(), data(), block_count(), pos);
+        return *this;
+    }
 
-            if (r != 0)
-            {
-                size_type ls = s_bits_per_block - r;
-                for (size_type i = div; i < last; ++i)
-                {
-                    b[i - div] = (b[i] >> r) | (b[i + 1] << ls);
-                }
-                b[last - div] = b[last] >> r;
-            }
-            else
-            {
-                for (size_type i = div; i <= last; ++i)
-                {
-                    b[i - div] = b[i];
-                }
-            }
+    /**
+     * Computes *this &= (rhs << shift) in a single pass, without temporary.
+     * A negative shift shifts rhs to the right. rhs must have the same size
+     * as *this and may be *this.
+     */
+    template <class B>
+    template <class R>
+    inline auto xdynamic_bitset_base<B>::shift_and(const xdynamic_bitset_base<R>& rhs, difference_type shift) -> self_type&
+    {
+        shift_assign<detail_bitset::bitwise_and>(rhs, shift);
+        return *this;
+    }
 
-            std::fill_n(m_buffer.begin() + static_cast<std::ptrdiff_t>(block_count() - div), div, block_type(0));
-        }
+    /**
+     * Computes *this |= (rhs << shift) in a single pass, without temporary.
+     * A negative shift shifts rhs to the right. rhs must have the same size
+     * as *this and may be *this.
+     */
+    template <class B>
+    template <class R>
+    inline auto xdynamic_bitset_base<B>::shift_or(const xdynamic_bitset_base<R>& rhs, difference_type shift) -> self_type&
+    {
+        shift_assign<detail_bitset::bitwise_or>(rhs, shift);
         return *this;
     }
 
@@ -938,18 +1511,14 @@ namespace xtl
     template <class B>
     inline auto xdynamic_bitset_base<B>::reset(size_type pos) -> self_type&
     {
-        m_buffer[block_index(pos)] &= ~bit_mask(pos);
+        m_buffer[block_index(pos)] &= static_cast<block_type>(~bit_mask(pos));
         return *this;
     }
 
     template <class B>
     inline auto xdynamic_bitset_base<B>::flip() -> self_type&
     {
-        size_type size = block_count();
-        for (size_type i = 0; i < size; ++i)
-        {
-            m_buffer[i] = ~m_buffer[i];
-        }
+        detail_bitset::transform_blocks<detail_bitset::bitwise_not>(data(), data(), data(), block_count());
         zero_unused_bits();
         return *this;
     }
@@ -1008,25 +1577,74 @@ namespace xtl
     template <class B>
     inline auto xdynamic_bitset_base<B>::count() const noexcept -> size_type
     {
-        static constexpr unsigned char table[] =
+        return detail_bitset::popcount(m_buffer.data(), m_buffer.size());
+    }
+
+    template <class B>
+    inline auto xdynamic_bitset_base<B>::find_first() const noexcept -> size_type
+    {
+        size_type n = block_count();
+        size_type i = detail_bitset::find_nonzero_block(m_buffer.data(), size_type(0), n);
+        return i == n ? npos : i * s_bits_per_block + detail_bitset::countr_zero(m_buffer[i]);
+    }
+
+    /**
+     * Returns the index of the first set bit after pos, or npos.
+     */
+    template <class B>
+    inline auto xdynamic_bitset_base<B>::find_next(size_type pos) const noexcept -> size_type
+    {
+        if (pos == npos || ++pos >= m_size)
         {
-            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-            1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-            1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-            2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-            1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-            2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-            2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-            3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
-        };
-        size_type res = 0;
-        const unsigned char* p = static_cast<const unsigned char*>(static_cast<const void*>(&m_buffer[0]));
-        size_type length = m_buffer.size() * sizeof(block_type);
-        for (size_type i = 0; i < length; ++i, ++p)
+            return npos;
+        }
+        size_type i = block_index(pos);
+        block_type block = static_cast<block_type>(m_buffer[i] & static_cast<block_type>(static_cast<block_type>(~block_type(0)) << bit_index(pos)));
+        if (block != block_type(0))
         {
-            res += table[*p];
+            return i * s_bits_per_block + detail_bitset::countr_zero(block);
+        }
+        size_type n = block_count();
+        i = detail_bitset::find_nonzero_block(m_buffer.data(), i + 1, n);
+        return i == n ? npos : i * s_bits_per_block + detail_bitset::countr_zero(m_buffer[i]);
+    }
+
+    template <class B>
+    inline auto xdynamic_bitset_base<B>::set_bits() const noexcept -> set_bit_range
+    {
+        return set_bit_range(*this);
+    }
+
+    /**
+     * Calls f(index) for each set bit, in increasing order.
+     */
+    template <class B>
+    template <class F>
+    inline void xdynamic_bitset_base<B>::for_each_set_bit(F&& f) const
+    {
+        for_each_set_block([&f](size_type first, block_type block) {
+            for (; block != block_type(0); block = detail_bitset::clear_lowest_bit(block))
+            {
+                f(first + detail_bitset::countr_zero(block));
+            }
+        });
+    }
+
+    /**
+     * Calls f(first, block) for each non-zero block, where first is the
+     * index of the bit 0 of block. Unused bits of the last block are zero.
+     */
+    template <class B>
+    template <class F>
+    inline void xdynamic_bitset_base<B>::for_each_set_block(F&& f) const
+    {
+        const block_type* d = m_buffer.data();
+        size_type n = block_count();
+        for (size_type i = detail_bitset::find_nonzero_block(d, size_type(0), n); i < n;
+             i = detail_bitset::find_nonzero_block(d, i + 1, n))
+        {
+            f(i * s_bits_per_block, d[i]);
         }
-        return res;
     }
 
     template <class B>
@@ -1036,7 +1654,7 @@ namespace xtl
     }
 
     template <class B>
-    inline auto xdynamic_bitset_base<B>::data() noexcept -> block_type*
+    inline auto xdynamic_bitset_base<B>::data() noexcept -> block_pointer
     {
         return m_buffer.data();
     }
@@ -1055,17 +1673,7 @@ namespace xtl
         if (!is_equal) { return false; }
 
         // we know that block type of lhs & rhs is the same
-        auto n_blocks = block_count();
-
-        for (std::size_t i = 0; i < n_blocks; ++i)
-        {
-            if (m_buffer[i] != rhs.m_buffer[i])
-            {
-                return false;
-            }
-        }
-
-        return true;
+        return detail_bitset::equal_blocks(data(), rhs.data(), block_count());
     }
 
     template <class B>
@@ -1075,6 +1683,20 @@ namespace xtl
         return !(*this == rhs);
     }
 
+    template <class B>
+    template <class D>
+    inline bool xdynamic_bitset_base<B>::operator==(const xbitset_expression<D>& rhs) const noexcept
+    {
+        return rhs.derived_cast() == *this;
+    }
+
+    template <class B>
+    template <class D>
+    inline bool xdynamic_bitset_base<B>::operator!=(const xbitset_expression<D>& rhs) const noexcept
+    {
+        return !(rhs.derived_cast() == *this);
+    }
+
     template <class B>
     inline auto xdynamic_bitset_base<B>::derived_cast() -> derived_class&
     {
@@ -1115,7 +1737,7 @@ namespace xtl
     template <class B>
     inline auto xdynamic_bitset_base<B>::bit_mask(size_type pos) const noexcept -> block_type
     {
-        return block_type(1) << bit_index(pos);
+        return static_cast<block_type>(block_type(1) << bit_index(pos));
     }
 
     template <class B>
@@ -1127,47 +1749,86 @@ namespace xtl
     template <class B>
     inline void xdynamic_bitset_base<B>::zero_unused_bits()
     {
+        // Blocks that are already clean are not written, so that views can
+        // wrap read-only memory such as a read-only mapped file.
         size_type extra_bits = count_extra_bits();
         if (extra_bits != 0)
         {
-            m_buffer.back() &= ~(~block_type(0) << extra_bits);
+            block_type mask = static_cast<block_type>(~(static_cast<block_type>(~block_type(0)) << extra_bits));
+            if ((m_buffer.back() & static_cast<block_type>(~mask)) != block_type(0))
+            {
+                m_buffer.back() &= mask;
+            }
         }
     }
 
     template <class B>
-    inline auto operator~(const xdynamic_bitset_base<B>& lhs)
+    template <class D>
+    inline void xdynamic_bitset_base<B>::evaluate(const xbitset_expression<D>& e)
     {
-        using temporary_type = typename xdynamic_bitset_base<B>::temporary_type;
-        temporary_type res(lhs.derived_cast());
-        res.flip();
-        return res;
+        detail_bitset::evaluate_expression(e.derived_cast(), data());
+        zero_unused_bits();
+    }
+
+    template <class B>
+    template <class OP, class D>
+    inline void xdynamic_bitset_base<B>::compute_assign(const xbitset_expression<D>& e)
+    {
+        constexpr size_type tile_size = detail_bitset::expression_tile_size<block_type>;
+        block_type buffer[tile_size];
+        const auto& de = e.derived_cast();
+        size_type n = block_count();
+        for (size_type first = 0; first < n; first += tile_size)
+        {
+            size_type m = std::min(tile_size, n - first);
+            const block_type* rhs = de.tile(first, m, buffer);
+            detail_bitset::transform_blocks<OP>(data() + first, data() + first, rhs, m);
+        }
+        zero_unused_bits();
     }
 
-    template <class L, class R>
-    inline auto operator&(const xdynamic_bitset_base<L>& lhs, const xdynamic_bitset_base<R>& rhs)
+    template <class B>
+    template <class OP, class R>
+    inline void xdynamic_bitset_base<B>::shift_assign(const xdynamic_bitset_base<R>& rhs, difference_type shift)
     {
-        using temporary_type = typename xdynamic_bitset_base<L>::temporary_type;
-        temporary_type res(lhs.derived_cast());
-        res &= rhs;
-        return res;
+        size_type pos = static_cast<size_type>(shift < 0 ? -shift : shift);
+        if (shift < 0)
+        {
+            detail_bitset::shift_right_blocks<OP>(data(), rhs.data(), block_count(), std::min(pos, m_size));
+        }
+        else
+        {
+            detail_bitset::shift_left_blocks<OP>(data(), rhs.data(), block_count(), std::min(pos, m_size));
+            zero_unused_bits();
+        }
     }
 
-    template <class L, class R>
-    inline auto operator|(const xdynamic_bitset_base<L>& lhs, const xdynamic_bitset_base<R>& rhs)
+    template <class E, check_requires<is_xbitset_operand<E>>>
+    inline auto operator~(E&& e)
     {
-        using temporary_type = typename xdynamic_bitset_base<L>::temporary_type;
-        temporary_type res(lhs.derived_cast());
-        res |= rhs;
-        return res;
+        using function_type = xbitset_function<detail_bitset::bitwise_not, const_closure_type_t<E>>;
+        return function_type(detail_bitset::bitwise_not(), std::forward<E>(e));
     }
 
-    template <class L, class R>
-    inline auto operator^(const xdynamic_bitset_base<L>& lhs, const xdynamic_bitset_base<R>& rhs)
+    template <class L, class R, check_requires<is_xbitset_operand<L>, is_xbitset_operand<R>>>
+    inline auto operator&(L&& lhs, R&& rhs)
     {
-        using temporary_type = typename xdynamic_bitset_base<L>::temporary_type;
-        temporary_type res(lhs.derived_cast());
-        res ^= rhs;
-        return res;
+        using function_type = xbitset_function<detail_bitset::bitwise_and, const_closure_type_t<L>, const_closure_type_t<R>>;
+        return function_type(detail_bitset::bitwise_and(), std::forward<L>(lhs), std::forward<R>(rhs));
+    }
+
+    template <class L, class R, check_requires<is_xbitset_operand<L>, is_xbitset_operand<R>>>
+    inline auto operator|(L&& lhs, R&& rhs)
+    {
+        using function_type = xbitset_function<detail_bitset::bitwise_or, const_closure_type_t<L>, const_closure_type_t<R>>;
+        return function_type(detail_bitset::bitwise_or(), std::forward<L>(lhs), std::forward<R>(rhs));
+    }
+
+    template <class L, class R, check_requires<is_xbitset_operand<L>, is_xbitset_operand<R>>>
+    inline auto operator^(L&& lhs, R&& rhs)
+    {
+        using function_type = xbitset_function<detail_bitset::bitwise_xor, const_closure_type_t<L>, const_closure_type_t<R>>;
+        return function_type(detail_bitset::bitwise_xor(), std::forward<L>(lhs), std::forward<R>(rhs));
     }
 
     template <class B>
@@ -1351,6 +2012,96 @@ namespace xtl
     {
         return p_container == rhs.p_container && m_index < rhs.m_index;
     }
+
+    /************************************
+     * xset_bit_iterator implementation *
+     ************************************/
+
+    template <class B>
+    inline xset_bit_iterator<B>::xset_bit_iterator() noexcept
+        : p_data(nullptr), m_block_count(0), m_block_index(0), m_block(0)
+    {
+    }
+
+    template <class B>
+    inline xset_bit_iterator<B>::xset_bit_iterator(const block_type* data, size_type block_count, size_type block_index) noexcept
+        : p_data(data), m_block_count(block_count), m_block_index(block_index), m_block(0)
+    {
+        if (m_block_index < m_block_count)
+        {
+            m_block = p_data[m_block_index];
+            if (m_block == block_type(0))
+            {
+                next_block();
+            }
+        }
+    }
+
+    template <class B>
+    inline auto xset_bit_iterator<B>::operator++() -> self_type&
+    {
+        m_block = detail_bitset::clear_lowest_bit(m_block);
+        if (m_block == block_type(0))
+        {
+            next_block();
+        }
+        return *this;
+    }
+
+    template <class B>
+    inline auto xset_bit_iterator<B>::operator++(int) -> self_type
+    {
+        self_type tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+
+    template <class B>
+    inline auto xset_bit_iterator<B>::operator*() const -> reference
+    {
+        return m_block_index * s_bits_per_block + detail_bitset::countr_zero(m_block);
+    }
+
+    template <class B>
+    inline bool xset_bit_iterator<B>::operator==(const self_type& rhs) const
+    {
+        return p_data == rhs.p_data && m_block_index == rhs.m_block_index && m_block == rhs.m_block;
+    }
+
+    template <class B>
+    inline bool xset_bit_iterator<B>::operator!=(const self_type& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    template <class B>
+    inline void xset_bit_iterator<B>::next_block() noexcept
+    {
+        m_block_index = detail_bitset::find_nonzero_block(p_data, m_block_index + 1, m_block_count);
+        m_block = m_block_index < m_block_count ? p_data[m_block_index] : block_type(0);
+    }
+
+    /*********************************
+     * xset_bit_range implementation *
+     *********************************/
+
+    template <class B>
+    inline xset_bit_range<B>::xset_bit_range(const container_type& c) noexcept
+        : p_container(&c)
+    {
+    }
+
+    template <class B>
+    inline auto xset_bit_range<B>::begin() const noexcept -> iterator
+    {
+        return iterator(p_container->data(), p_container->block_count(), 0);
+    }
+
+    template <class B>
+    inline auto xset_bit_range<B>::end() const noexcept -> iterator
+    {
+        return iterator(p_container->data(), p_container->block_count(), p_container->block_count());
+    }
 }
 
 #endif
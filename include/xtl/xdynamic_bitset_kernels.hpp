@@ -0,0 +1,804 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XDYNAMIC_BITSET_KERNELS_HPP
+#define XTL_XDYNAMIC_BITSET_KERNELS_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "xbit_utils.hpp"
+#include "xplatform.hpp"
+
+#if defined(XTL_X86_RUNTIME_DISPATCH) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/*************************************************************************
+ * Block kernels used by xdynamic_bitset. They operate on raw buffers of *
+ * blocks, the SIMD versions are selected at runtime on x86-64.          *
+ *************************************************************************/
+
+namespace xtl
+{
+    namespace detail_bitset
+    {
+        using detail::countr_zero;
+        using detail::popcount;
+
+        // Clears the lowest set bit
+        template <class T>
+        inline T clear_lowest_bit(T block) noexcept
+        {
+            return static_cast<T>(block & static_cast<T>(block - T(1)));
+        }
+
+        // Index of the k-th (0-based) set bit, block must have more than k set bits
+        template <class T>
+        inline std::size_t select_in_block(T block, std::size_t k) noexcept
+        {
+            auto value = static_cast<uint64_t>(static_cast<std::make_unsigned_t<T>>(block));
+#if defined(__BMI2__) && defined(__x86_64__)
+            return countr_zero(_pdep_u64(uint64_t(1) << k, value));
+#else
+            std::size_t offset = 0;
+            std::size_t c = popcount(static_cast<uint8_t>(value));
+            while (k >= c)
+            {
+                k -= c;
+                offset += 8;
+                c = popcount(static_cast<uint8_t>(value >> offset));
+            }
+            value >>= offset;
+            for (; k != 0; --k)
+            {
+                value = clear_lowest_bit(value);
+            }
+            return offset + countr_zero(value);
+#endif
+        }
+
+        // Index of the first non-zero block in [first, n), or n
+        template <class T>
+        inline std::size_t find_nonzero_block(const T* data, std::size_t first, std::size_t n) noexcept
+        {
+            for (; first < n && data[first] == T(0); ++first)
+            {
+            }
+            return first;
+        }
+
+        template <class T>
+        inline std::size_t popcount_scalar(const T* data, std::size_t n) noexcept
+        {
+            // Independent accumulators so that consecutive popcounts do not
+            // form a single dependency chain.
+            std::size_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+            std::size_t last = n - n % 4;
+            for (std::size_t i = 0; i < last; i += 4)
+            {
+                r0 += popcount(data[i]);
+                r1 += popcount(data[i + 1]);
+                r2 += popcount(data[i + 2]);
+                r3 += popcount(data[i + 3]);
+            }
+            for (std::size_t i = last; i < n; ++i)
+            {
+                r0 += popcount(data[i]);
+            }
+            return r0 + r1 + r2 + r3;
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        template <class T>
+        XTL_TARGET("popcnt") XTL_NOINLINE inline std::size_t popcount_popcnt(const T* data, std::size_t n) noexcept
+        {
+            return popcount_scalar(data, n);
+        }
+
+        XTL_TARGET("avx2") inline __m256i popcount_epi64_avx2(__m256i v) noexcept
+        {
+            const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m256i low_mask = _mm256_set1_epi8(0x0f);
+            __m256i lo = _mm256_and_si256(v, low_mask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+            __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+            return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+        }
+
+        // Carry-save adder: h receives the carries and l the sums of a + b + c
+        XTL_TARGET("avx2") inline void csa_avx2(__m256i& h, __m256i& l, __m256i a, __m256i b, __m256i c) noexcept
+        {
+            __m256i u = _mm256_xor_si256(a, b);
+            h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+            l = _mm256_xor_si256(u, c);
+        }
+
+        // Harley-Seal popcount, see Mula, Kurz and Lemire, "Faster Population
+        // Counts Using AVX2 Instructions". Counts the bits of n 32-byte chunks.
+        XTL_TARGET("avx2") XTL_NOINLINE inline std::size_t popcount_avx2(const void* buffer, std::size_t n) noexcept
+        {
+            const __m256i* data = static_cast<const __m256i*>(buffer);
+            __m256i total = _mm256_setzero_si256();
+            __m256i ones = _mm256_setzero_si256();
+            __m256i twos = _mm256_setzero_si256();
+            __m256i fours = _mm256_setzero_si256();
+            __m256i eights = _mm256_setzero_si256();
+            __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                csa_avx2(twos_a, ones, ones, _mm256_loadu_si256(data + i), _mm256_loadu_si256(data + i + 1));
+                csa_avx2(twos_b, ones, ones, _mm256_loadu_si256(data + i + 2), _mm256_loadu_si256(data + i + 3));
+                csa_avx2(fours_a, twos, twos, twos_a, twos_b);
+                csa_avx2(twos_a, ones, ones, _mm256_loadu_si256(data + i + 4), _mm256_loadu_si256(data + i + 5));
+                csa_avx2(twos_b, ones, ones, _mm256_loadu_si256(data + i + 6), _mm256_loadu_si256(data + i + 7));
+                csa_avx2(fours_b, twos, twos, twos_a, twos_b);
+                csa_avx2(eights_a, fours, fours, fours_a, fours_b);
+                csa_avx2(twos_a, ones, ones, _mm256_loadu_si256(data + i + 8), _mm256_loadu_si256(data + i + 9));
+                csa_avx2(twos_b, ones, ones, _mm256_loadu_si256(data + i + 10), _mm256_loadu_si256(data + i + 11));
+                csa_avx2(fours_a, twos, twos, twos_a, twos_b);
+                csa_avx2(twos_a, ones, ones, _mm256_loadu_si256(data + i + 12), _mm256_loadu_si256(data + i + 13));
+                csa_avx2(twos_b, ones, ones, _mm256_loadu_si256(data + i + 14), _mm256_loadu_si256(data + i + 15));
+                csa_avx2(fours_b, twos, twos, twos_a, twos_b);
+                csa_avx2(eights_b, fours, fours, fours_a, fours_b);
+                csa_avx2(sixteens, eights, eights, eights_a, eights_b);
+                total = _mm256_add_epi64(total, popcount_epi64_avx2(sixteens));
+            }
+
+            total = _mm256_slli_epi64(total, 4);
+            total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_epi64_avx2(eights), 3));
+            total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_epi64_avx2(fours), 2));
+            total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_epi64_avx2(twos), 1));
+            total = _mm256_add_epi64(total, popcount_epi64_avx2(ones));
+            for (; i < n; ++i)
+            {
+                total = _mm256_add_epi64(total, popcount_epi64_avx2(_mm256_loadu_si256(data + i)));
+            }
+
+            return static_cast<std::size_t>(_mm256_extract_epi64(total, 0))
+                + static_cast<std::size_t>(_mm256_extract_epi64(total, 1))
+                + static_cast<std::size_t>(_mm256_extract_epi64(total, 2))
+                + static_cast<std::size_t>(_mm256_extract_epi64(total, 3));
+        }
+
+        // Counts the bits of n 64-byte chunks with VPOPCNTQ.
+        XTL_TARGET("avx512f,avx512vpopcntdq") XTL_NOINLINE inline std::size_t popcount_avx512(const void* buffer, std::size_t n) noexcept
+        {
+            const char* data = static_cast<const char*>(buffer);
+            __m512i acc0 = _mm512_setzero_si512();
+            __m512i acc1 = _mm512_setzero_si512();
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(data + 64 * i)));
+                acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_loadu_si512(data + 64 * (i + 1))));
+            }
+            if (i < n)
+            {
+                acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(data + 64 * i)));
+            }
+            alignas(64) std::uint64_t lanes[8];
+            _mm512_store_si512(lanes, _mm512_add_epi64(acc0, acc1));
+            std::uint64_t res = 0;
+            for (std::uint64_t lane : lanes)
+            {
+                res += lane;
+            }
+            return static_cast<std::size_t>(res);
+        }
+
+#endif
+
+        // Below this size (in bytes), the SIMD kernels do not pay off.
+        constexpr std::size_t popcount_simd_threshold = 512;
+
+        template <class T>
+        inline std::size_t popcount(const T* data, std::size_t n) noexcept
+        {
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            if constexpr (64 % sizeof(T) == 0)
+            {
+                const cpu_features& features = available_cpu_features();
+                std::size_t bytes = n * sizeof(T);
+                if (bytes >= popcount_simd_threshold && (features.avx512_vpopcntdq || features.avx2))
+                {
+                    std::size_t chunk_size = features.avx512_vpopcntdq ? 64 : 32;
+                    std::size_t chunks = bytes / chunk_size;
+                    std::size_t res = features.avx512_vpopcntdq ? popcount_avx512(data, chunks)
+                                                                : popcount_avx2(data, chunks);
+                    std::size_t done = chunks * chunk_size / sizeof(T);
+                    return res + popcount_scalar(data + done, n - done);
+                }
+#if !defined(__POPCNT__)
+                if (features.popcnt)
+                {
+                    return popcount_popcnt(data, n);
+                }
+#endif
+            }
+#endif
+            return popcount_scalar(data, n);
+        }
+
+        /*******************
+         * bitwise kernels *
+         *******************/
+
+        struct bitwise_and
+        {
+            template <class T>
+            static T apply(T lhs, T rhs) noexcept
+            {
+                return static_cast<T>(lhs & rhs);
+            }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            XTL_TARGET("sse2") static __m128i apply(__m128i lhs, __m128i rhs) noexcept
+            {
+                return _mm_and_si128(lhs, rhs);
+            }
+
+            XTL_TARGET("avx2") static __m256i apply(__m256i lhs, __m256i rhs) noexcept
+            {
+                return _mm256_and_si256(lhs, rhs);
+            }
+
+            XTL_TARGET("avx512f") static __m512i apply(__m512i lhs, __m512i rhs) noexcept
+            {
+                return _mm512_and_si512(lhs, rhs);
+            }
+#endif
+        };
+
+        struct bitwise_or
+        {
+            template <class T>
+            static T apply(T lhs, T rhs) noexcept
+            {
+                return static_cast<T>(lhs | rhs);
+            }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            XTL_TARGET("sse2") static __m128i apply(__m128i lhs, __m128i rhs) noexcept
+            {
+                return _mm_or_si128(lhs, rhs);
+            }
+
+            XTL_TARGET("avx2") static __m256i apply(__m256i lhs, __m256i rhs) noexcept
+            {
+                return _mm256_or_si256(lhs, rhs);
+            }
+
+            XTL_TARGET("avx512f") static __m512i apply(__m512i lhs, __m512i rhs) noexcept
+            {
+                return _mm512_or_si512(lhs, rhs);
+            }
+#endif
+        };
+
+        struct bitwise_xor
+        {
+            template <class T>
+            static T apply(T lhs, T rhs) noexcept
+            {
+                return static_cast<T>(lhs ^ rhs);
+            }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            XTL_TARGET("sse2") static __m128i apply(__m128i lhs, __m128i rhs) noexcept
+            {
+                return _mm_xor_si128(lhs, rhs);
+            }
+
+            XTL_TARGET("avx2") static __m256i apply(__m256i lhs, __m256i rhs) noexcept
+            {
+                return _mm256_xor_si256(lhs, rhs);
+            }
+
+            XTL_TARGET("avx512f") static __m512i apply(__m512i lhs, __m512i rhs) noexcept
+            {
+                return _mm512_xor_si512(lhs, rhs);
+            }
+#endif
+        };
+
+        // lhs is ignored, so that unary negation fits the binary kernels
+        struct bitwise_not
+        {
+            template <class T>
+            static T apply(T, T rhs) noexcept
+            {
+                return static_cast<T>(~rhs);
+            }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            XTL_TARGET("sse2") static __m128i apply(__m128i, __m128i rhs) noexcept
+            {
+                return _mm_xor_si128(rhs, _mm_set1_epi32(-1));
+            }
+
+            XTL_TARGET("avx2") static __m256i apply(__m256i, __m256i rhs) noexcept
+            {
+                return _mm256_xor_si256(rhs, _mm256_set1_epi32(-1));
+            }
+
+            XTL_TARGET("avx512f") static __m512i apply(__m512i, __m512i rhs) noexcept
+            {
+                return _mm512_ternarylogic_epi32(rhs, rhs, rhs, 0x55);
+            }
+#endif
+        };
+
+        // Ignores lhs, used by kernels writing their result as is
+        struct bitwise_assign
+        {
+            template <class T>
+            static T apply(T, T rhs) noexcept
+            {
+                return rhs;
+            }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            XTL_TARGET("sse2") static __m128i apply(__m128i, __m128i rhs) noexcept
+            {
+                return rhs;
+            }
+
+            XTL_TARGET("avx2") static __m256i apply(__m256i, __m256i rhs) noexcept
+            {
+                return rhs;
+            }
+
+            XTL_TARGET("avx512f") static __m512i apply(__m512i, __m512i rhs) noexcept
+            {
+                return rhs;
+            }
+#endif
+        };
+
+        // dst[i] = OP(lhs[i], rhs[i]), dst may alias lhs or rhs
+        template <class OP, class T>
+        inline void transform_blocks_scalar(T* dst, const T* lhs, const T* rhs, std::size_t n) noexcept
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                dst[i] = OP::apply(lhs[i], rhs[i]);
+            }
+        }
+
+        template <class T>
+        inline bool equal_blocks_scalar(const T* lhs, const T* rhs, std::size_t n) noexcept
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (lhs[i] != rhs[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        // The SIMD kernels process whole registers and return the number of
+        // bytes processed; the caller handles the remaining blocks.
+
+        template <class OP>
+        XTL_TARGET("sse2") XTL_NOINLINE inline std::size_t transform_bytes_sse2(void* dst, const void* lhs, const void* rhs, std::size_t bytes) noexcept
+        {
+            char* d = static_cast<char*>(dst);
+            const char* l = static_cast<const char*>(lhs);
+            const char* r = static_cast<const char*>(rhs);
+            std::size_t i = 0;
+            for (; i + 32 <= bytes; i += 32)
+            {
+                __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i));
+                __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i + 16));
+                __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+                __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i + 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), OP::apply(a0, b0));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i + 16), OP::apply(a1, b1));
+            }
+            for (; i + 16 <= bytes; i += 16)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), OP::apply(a, b));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("avx2") XTL_NOINLINE inline std::size_t transform_bytes_avx2(void* dst, const void* lhs, const void* rhs, std::size_t bytes) noexcept
+        {
+            char* d = static_cast<char*>(dst);
+            const char* l = static_cast<const char*>(lhs);
+            const char* r = static_cast<const char*>(rhs);
+            std::size_t i = 0;
+            for (; i + 64 <= bytes; i += 64)
+            {
+                __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i));
+                __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i + 32));
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i));
+                __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i + 32));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), OP::apply(a0, b0));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i + 32), OP::apply(a1, b1));
+            }
+            for (; i + 32 <= bytes; i += 32)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), OP::apply(a, b));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("avx512f") XTL_NOINLINE inline std::size_t transform_bytes_avx512(void* dst, const void* lhs, const void* rhs, std::size_t bytes) noexcept
+        {
+            char* d = static_cast<char*>(dst);
+            const char* l = static_cast<const char*>(lhs);
+            const char* r = static_cast<const char*>(rhs);
+            std::size_t i = 0;
+            for (; i + 128 <= bytes; i += 128)
+            {
+                __m512i a0 = _mm512_loadu_si512(l + i);
+                __m512i a1 = _mm512_loadu_si512(l + i + 64);
+                __m512i b0 = _mm512_loadu_si512(r + i);
+                __m512i b1 = _mm512_loadu_si512(r + i + 64);
+                _mm512_storeu_si512(d + i, OP::apply(a0, b0));
+                _mm512_storeu_si512(d + i + 64, OP::apply(a1, b1));
+            }
+            for (; i + 64 <= bytes; i += 64)
+            {
+                _mm512_storeu_si512(d + i, OP::apply(_mm512_loadu_si512(l + i), _mm512_loadu_si512(r + i)));
+            }
+            return i;
+        }
+
+        XTL_TARGET("sse2") XTL_NOINLINE inline std::size_t equal_bytes_sse2(const void* lhs, const void* rhs, std::size_t bytes, bool& equal) noexcept
+        {
+            const char* l = static_cast<const char*>(lhs);
+            const char* r = static_cast<const char*>(rhs);
+            std::size_t i = 0;
+            for (; i + 16 <= bytes; i += 16)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF)
+                {
+                    equal = false;
+                    return i;
+                }
+            }
+            equal = true;
+            return i;
+        }
+
+        XTL_TARGET("avx2") XTL_NOINLINE inline std::size_t equal_bytes_avx2(const void* lhs, const void* rhs, std::size_t bytes, bool& equal) noexcept
+        {
+            const char* l = static_cast<const char*>(lhs);
+            const char* r = static_cast<const char*>(rhs);
+            std::size_t i = 0;
+            for (; i + 64 <= bytes; i += 64)
+            {
+                __m256i d0 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i)),
+                                              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i)));
+                __m256i d1 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i + 32)),
+                                              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i + 32)));
+                __m256i d = _mm256_or_si256(d0, d1);
+                if (!_mm256_testz_si256(d, d))
+                {
+                    equal = false;
+                    return i;
+                }
+            }
+            for (; i + 32 <= bytes; i += 32)
+            {
+                __m256i d = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i)),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i)));
+                if (!_mm256_testz_si256(d, d))
+                {
+                    equal = false;
+                    return i;
+                }
+            }
+            equal = true;
+            return i;
+        }
+
+        XTL_TARGET("avx512f") XTL_NOINLINE inline std::size_t equal_bytes_avx512(const void* lhs, const void* rhs, std::size_t bytes, bool& equal) noexcept
+        {
+            const char* l = static_cast<const char*>(lhs);
+            const char* r = static_cast<const char*>(rhs);
+            std::size_t i = 0;
+            for (; i + 64 <= bytes; i += 64)
+            {
+                if (_mm512_cmpneq_epi64_mask(_mm512_loadu_si512(l + i), _mm512_loadu_si512(r + i)) != 0)
+                {
+                    equal = false;
+                    return i;
+                }
+            }
+            equal = true;
+            return i;
+        }
+
+#endif
+
+        // Below this size (in bytes), the bitwise kernels stay scalar.
+        constexpr std::size_t bitwise_simd_threshold = 64;
+
+        template <class OP, class T>
+        inline void transform_blocks(T* dst, const T* lhs, const T* rhs, std::size_t n) noexcept
+        {
+            std::size_t done = 0;
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            if constexpr (16 % sizeof(T) == 0)
+            {
+                std::size_t bytes = n * sizeof(T);
+                if (bytes >= bitwise_simd_threshold)
+                {
+                    const cpu_features& features = available_cpu_features();
+                    std::size_t done_bytes = features.avx512f ? transform_bytes_avx512<OP>(dst, lhs, rhs, bytes)
+                                           : features.avx2 ? transform_bytes_avx2<OP>(dst, lhs, rhs, bytes)
+                                           : transform_bytes_sse2<OP>(dst, lhs, rhs, bytes);
+                    done = done_bytes / sizeof(T);
+                }
+            }
+#endif
+            transform_blocks_scalar<OP>(dst + done, lhs + done, rhs + done, n - done);
+        }
+
+        template <class T>
+        inline bool equal_blocks(const T* lhs, const T* rhs, std::size_t n) noexcept
+        {
+            std::size_t done = 0;
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            if constexpr (16 % sizeof(T) == 0)
+            {
+                std::size_t bytes = n * sizeof(T);
+                if (bytes >= bitwise_simd_threshold)
+                {
+                    const cpu_features& features = available_cpu_features();
+                    bool equal = true;
+                    std::size_t done_bytes = features.avx512f ? equal_bytes_avx512(lhs, rhs, bytes, equal)
+                                           : features.avx2 ? equal_bytes_avx2(lhs, rhs, bytes, equal)
+                                           : equal_bytes_sse2(lhs, rhs, bytes, equal);
+                    if (!equal)
+                    {
+                        return false;
+                    }
+                    done = done_bytes / sizeof(T);
+                }
+            }
+#endif
+            return equal_blocks_scalar(lhs + done, rhs + done, n - done);
+        }
+
+        /*****************
+         * shift kernels *
+         *****************/
+
+        // The shift kernels compute dst[i] = OP(dst[i], s[i]) where s is src
+        // shifted by pos bits towards the higher (left) or lower (right)
+        // indices; s[i] is a funnel shift of two consecutive blocks of src.
+        // Left shifts run downwards and right shifts upwards, so that dst may
+        // alias src.
+
+        template <class T>
+        inline T funnel_left(T high, T low, std::size_t r) noexcept
+        {
+            constexpr std::size_t bits = CHAR_BIT * sizeof(T);
+            return r == 0 ? high : static_cast<T>(static_cast<T>(high << r) | static_cast<T>(low >> (bits - r)));
+        }
+
+        template <class T>
+        inline T funnel_right(T low, T high, std::size_t r) noexcept
+        {
+            constexpr std::size_t bits = CHAR_BIT * sizeof(T);
+            return r == 0 ? low : static_cast<T>(static_cast<T>(low >> r) | static_cast<T>(high << (bits - r)));
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        // SIMD funnel shifts over 64-bit words (the AVX-512 ones use the
+        // zero-masked shifts, the unmasked ones trigger maybe-uninitialized
+        // warnings with GCC 12). The left kernels process
+        // [first, last) downwards and return the lower bound of what they
+        // did not process, the right kernels process [0, last) upwards and
+        // return the number of words processed.
+
+        template <class OP>
+        XTL_TARGET("sse2") XTL_NOINLINE inline std::size_t shift_left_words_sse2(uint64_t* dst, const uint64_t* src, std::size_t first, std::size_t last, std::size_t div, std::size_t r) noexcept
+        {
+            __m128i cl = _mm_cvtsi64_si128(static_cast<long long>(r));
+            __m128i cr = _mm_cvtsi64_si128(static_cast<long long>(64 - r));
+            std::size_t i = last;
+            for (; i >= first + 2; i -= 2)
+            {
+                __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i - 2 - div));
+                __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i - 3 - div));
+                __m128i shifted = _mm_or_si128(_mm_sll_epi64(high, cl), _mm_srl_epi64(low, cr));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i - 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i - 2), OP::apply(d, shifted));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("avx2") XTL_NOINLINE inline std::size_t shift_left_words_avx2(uint64_t* dst, const uint64_t* src, std::size_t first, std::size_t last, std::size_t div, std::size_t r) noexcept
+        {
+            __m128i cl = _mm_cvtsi64_si128(static_cast<long long>(r));
+            __m128i cr = _mm_cvtsi64_si128(static_cast<long long>(64 - r));
+            std::size_t i = last;
+            for (; i >= first + 4; i -= 4)
+            {
+                __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i - 4 - div));
+                __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i - 5 - div));
+                __m256i shifted = _mm256_or_si256(_mm256_sll_epi64(high, cl), _mm256_srl_epi64(low, cr));
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i - 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i - 4), OP::apply(d, shifted));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("avx512f") XTL_NOINLINE inline std::size_t shift_left_words_avx512(uint64_t* dst, const uint64_t* src, std::size_t first, std::size_t last, std::size_t div, std::size_t r) noexcept
+        {
+            __m128i cl = _mm_cvtsi64_si128(static_cast<long long>(r));
+            __m128i cr = _mm_cvtsi64_si128(static_cast<long long>(64 - r));
+            std::size_t i = last;
+            for (; i >= first + 8; i -= 8)
+            {
+                __m512i high = _mm512_loadu_si512(src + i - 8 - div);
+                __m512i low = _mm512_loadu_si512(src + i - 9 - div);
+                __m512i shifted = _mm512_or_si512(_mm512_maskz_sll_epi64(0xFF, high, cl), _mm512_maskz_srl_epi64(0xFF, low, cr));
+                _mm512_storeu_si512(dst + i - 8, OP::apply(_mm512_loadu_si512(dst + i - 8), shifted));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("sse2") XTL_NOINLINE inline std::size_t shift_right_words_sse2(uint64_t* dst, const uint64_t* src, std::size_t last, std::size_t div, std::size_t r) noexcept
+        {
+            __m128i cr = _mm_cvtsi64_si128(static_cast<long long>(r));
+            __m128i cl = _mm_cvtsi64_si128(static_cast<long long>(64 - r));
+            std::size_t i = 0;
+            for (; i + 2 <= last; i += 2)
+            {
+                __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + div));
+                __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + div + 1));
+                __m128i shifted = _mm_or_si128(_mm_srl_epi64(low, cr), _mm_sll_epi64(high, cl));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), OP::apply(d, shifted));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("avx2") XTL_NOINLINE inline std::size_t shift_right_words_avx2(uint64_t* dst, const uint64_t* src, std::size_t last, std::size_t div, std::size_t r) noexcept
+        {
+            __m128i cr = _mm_cvtsi64_si128(static_cast<long long>(r));
+            __m128i cl = _mm_cvtsi64_si128(static_cast<long long>(64 - r));
+            std::size_t i = 0;
+            for (; i + 4 <= last; i += 4)
+            {
+                __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + div));
+                __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + div + 1));
+                __m256i shifted = _mm256_or_si256(_mm256_srl_epi64(low, cr), _mm256_sll_epi64(high, cl));
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), OP::apply(d, shifted));
+            }
+            return i;
+        }
+
+        template <class OP>
+        XTL_TARGET("avx512f") XTL_NOINLINE inline std::size_t shift_right_words_avx512(uint64_t* dst, const uint64_t* src, std::size_t last, std::size_t div, std::size_t r) noexcept
+        {
+            __m128i cr = _mm_cvtsi64_si128(static_cast<long long>(r));
+            __m128i cl = _mm_cvtsi64_si128(static_cast<long long>(64 - r));
+            std::size_t i = 0;
+            for (; i + 8 <= last; i += 8)
+            {
+                __m512i low = _mm512_loadu_si512(src + i + div);
+                __m512i high = _mm512_loadu_si512(src + i + div + 1);
+                __m512i shifted = _mm512_or_si512(_mm512_maskz_srl_epi64(0xFF, low, cr), _mm512_maskz_sll_epi64(0xFF, high, cl));
+                _mm512_storeu_si512(dst + i, OP::apply(_mm512_loadu_si512(dst + i), shifted));
+            }
+            return i;
+        }
+
+#endif
+
+        template <class OP, class T>
+        inline void shift_left_blocks(T* dst, const T* src, std::size_t n, std::size_t pos) noexcept
+        {
+            constexpr std::size_t bits = CHAR_BIT * sizeof(T);
+            std::size_t div = std::min(pos / bits, n);
+            std::size_t r = pos % bits;
+            std::size_t i = n;
+            if (div < n)
+            {
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+                if constexpr (sizeof(T) == sizeof(uint64_t))
+                {
+                    if ((n - div) * sizeof(T) >= bitwise_simd_threshold)
+                    {
+                        uint64_t* d = reinterpret_cast<uint64_t*>(dst);
+                        const uint64_t* s = reinterpret_cast<const uint64_t*>(src);
+                        const cpu_features& features = available_cpu_features();
+                        i = features.avx512f ? shift_left_words_avx512<OP>(d, s, div + 1, n, div, r)
+                          : features.avx2 ? shift_left_words_avx2<OP>(d, s, div + 1, n, div, r)
+                          : shift_left_words_sse2<OP>(d, s, div + 1, n, div, r);
+                    }
+                }
+#endif
+                for (; i > div + 1; --i)
+                {
+                    dst[i - 1] = OP::apply(dst[i - 1], funnel_left(src[i - 1 - div], src[i - 2 - div], r));
+                }
+                dst[div] = OP::apply(dst[div], funnel_left(src[0], T(0), r));
+                i = div;
+            }
+            for (; i > 0; --i)
+            {
+                dst[i - 1] = OP::apply(dst[i - 1], T(0));
+            }
+        }
+
+        template <class OP, class T>
+        inline void shift_right_blocks(T* dst, const T* src, std::size_t n, std::size_t pos) noexcept
+        {
+            constexpr std::size_t bits = CHAR_BIT * sizeof(T);
+            std::size_t div = std::min(pos / bits, n);
+            std::size_t r = pos % bits;
+            std::size_t i = 0;
+            if (div < n)
+            {
+                std::size_t last = n - div - 1;
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+                if constexpr (sizeof(T) == sizeof(uint64_t))
+                {
+                    if (last * sizeof(T) >= bitwise_simd_threshold)
+                    {
+                        uint64_t* d = reinterpret_cast<uint64_t*>(dst);
+                        const uint64_t* s = reinterpret_cast<const uint64_t*>(src);
+                        const cpu_features& features = available_cpu_features();
+                        i = features.avx512f ? shift_right_words_avx512<OP>(d, s, last, div, r)
+                          : features.avx2 ? shift_right_words_avx2<OP>(d, s, last, div, r)
+                          : shift_right_words_sse2<OP>(d, s, last, div, r);
+                    }
+                }
+#endif
+                for (; i < last; ++i)
+                {
+                    dst[i] = OP::apply(dst[i], funnel_right(src[i + div], src[i + div + 1], r));
+                }
+                dst[last] = OP::apply(dst[last], funnel_right(src[n - 1], T(0), r));
+                i = last + 1;
+            }
+            for (; i < n; ++i)
+            {
+                dst[i] = OP::apply(dst[i], T(0));
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,310 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XDYNAMIC_BITSET_PARALLEL_HPP
+#define XTL_XDYNAMIC_BITSET_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <vector>
+
+#include "xdynamic_bitset.hpp"
+#include "xthread_pool.hpp"
+
+namespace xtl
+{
+    /*********************************
+     * parallel xdynamic_bitset_base *
+     *********************************/
+
+    // Multi-threaded variants of the reductions and compound operators of
+    // xdynamic_bitset_base, for bitsets that do not fit in the cache. The
+    // blocks are split in chunks of bitset_parallel_grain bytes, run as the
+    // tasks of an executor (see xthread_pool for the requirements); the
+    // overloads without executor use default_thread_pool(). Bitsets smaller
+    // than bitset_parallel_threshold bytes are processed serially.
+
+    constexpr std::size_t bitset_parallel_threshold = std::size_t(1) << 20;
+    constexpr std::size_t bitset_parallel_grain = std::size_t(1) << 18;
+
+    template <class B, class E>
+    std::size_t parallel_count(const xdynamic_bitset_base<B>& b, E& executor);
+    template <class B>
+    std::size_t parallel_count(const xdynamic_bitset_base<B>& b);
+
+    template <class B, class E>
+    bool parallel_any(const xdynamic_bitset_base<B>& b, E& executor);
+    template <class B>
+    bool parallel_any(const xdynamic_bitset_base<B>& b);
+
+    template <class B, class E>
+    bool parallel_none(const xdynamic_bitset_base<B>& b, E& executor);
+    template <class B>
+    bool parallel_none(const xdynamic_bitset_base<B>& b);
+
+    template <class B, class E>
+    bool parallel_all(const xdynamic_bitset_base<B>& b, E& executor);
+    template <class B>
+    bool parallel_all(const xdynamic_bitset_base<B>& b);
+
+    template <class B, class R, class E>
+    xdynamic_bitset_base<B>& parallel_and_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor);
+    template <class B, class R>
+    xdynamic_bitset_base<B>& parallel_and_assign(xdynamic_bitset_base<B>& lhs, const R& rhs);
+
+    template <class B, class R, class E>
+    xdynamic_bitset_base<B>& parallel_or_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor);
+    template <class B, class R>
+    xdynamic_bitset_base<B>& parallel_or_assign(xdynamic_bitset_base<B>& lhs, const R& rhs);
+
+    template <class B, class R, class E>
+    xdynamic_bitset_base<B>& parallel_xor_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor);
+    template <class B, class R>
+    xdynamic_bitset_base<B>& parallel_xor_assign(xdynamic_bitset_base<B>& lhs, const R& rhs);
+
+    /************************************************
+     * parallel xdynamic_bitset_base implementation *
+     ************************************************/
+
+    namespace detail_bitset
+    {
+        // Number of tasks used to process n blocks of type T, 1 for a serial run.
+        template <class T>
+        inline std::size_t parallel_task_count(std::size_t n) noexcept
+        {
+            std::size_t bytes = n * sizeof(T);
+            return bytes < bitset_parallel_threshold ? std::size_t(1) : (bytes + bitset_parallel_grain - 1) / bitset_parallel_grain;
+        }
+
+        // Calls f(first, last) on chunks of [0, n) spread over the tasks of the executor.
+        template <class T, class E, class F>
+        inline void parallel_blocks(std::size_t n, E& executor, F&& f)
+        {
+            std::size_t task_count = parallel_task_count<T>(n);
+            if (task_count == 1)
+            {
+                f(std::size_t(0), n);
+                return;
+            }
+            constexpr std::size_t chunk = bitset_parallel_grain / sizeof(T);
+            executor.parallel_for(task_count, [&f, n](std::size_t i) {
+                std::size_t first = i * chunk;
+                f(first, std::min(first + chunk, n));
+            });
+        }
+
+        template <class T>
+        inline bool all_ones_blocks(const T* data, std::size_t first, std::size_t last) noexcept
+        {
+            constexpr T all_ones = static_cast<T>(~T(0));
+            for (; first < last && data[first] == all_ones; ++first)
+            {
+            }
+            return first == last;
+        }
+
+        template <class OP, class T, class R, class E>
+        inline void parallel_compute_assign(T* dst, const xdynamic_bitset_base<R>& rhs, std::size_t n, E& executor)
+        {
+            const T* src = rhs.data();
+            parallel_blocks<T>(n, executor, [dst, src](std::size_t first, std::size_t last) {
+                transform_blocks<OP>(dst + first, dst + first, src + first, last - first);
+            });
+        }
+
+        template <class OP, class T, class D, class E>
+        inline void parallel_compute_assign(T* dst, const xbitset_expression<D>& rhs, std::size_t n, E& executor)
+        {
+            // Each chunk only reads the same blocks of the operands, so chunks
+            // can be evaluated independently even if rhs refers to dst.
+            const D& e = rhs.derived_cast();
+            parallel_blocks<T>(n, executor, [dst, &e](std::size_t first, std::size_t last) {
+                constexpr std::size_t tile_size = expression_tile_size<T>;
+                T buffer[tile_size];
+                for (; first < last; first += tile_size)
+                {
+                    std::size_t m = std::min(tile_size, last - first);
+                    const T* res = e.tile(first, m, buffer);
+                    transform_blocks<OP>(dst + first, dst + first, res, m);
+                }
+            });
+            std::size_t extra_bits = e.size() % (CHAR_BIT * sizeof(T));
+            if (extra_bits != 0)
+            {
+                dst[n - 1] &= static_cast<T>(~(static_cast<T>(~T(0)) << extra_bits));
+            }
+        }
+
+        template <class OP, class B, class R, class E>
+        inline xdynamic_bitset_base<B>& parallel_compute_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor)
+        {
+            parallel_compute_assign<OP>(lhs.data(), rhs, lhs.block_count(), executor);
+            return lhs;
+        }
+    }
+
+    /**
+     * Returns the number of set bits of b, counted by the tasks of executor.
+     */
+    template <class B, class E>
+    inline std::size_t parallel_count(const xdynamic_bitset_base<B>& b, E& executor)
+    {
+        using block_type = typename xdynamic_bitset_base<B>::block_type;
+        const block_type* data = b.data();
+        std::size_t n = b.block_count();
+        std::size_t task_count = detail_bitset::parallel_task_count<block_type>(n);
+        if (task_count == 1)
+        {
+            return detail_bitset::popcount(data, n);
+        }
+        // One counter per cache line to prevent false sharing
+        constexpr std::size_t stride = 64 / sizeof(std::size_t);
+        std::vector<std::size_t> counts(task_count * stride, 0);
+        constexpr std::size_t chunk = bitset_parallel_grain / sizeof(block_type);
+        detail_bitset::parallel_blocks<block_type>(n, executor, [data, &counts](std::size_t first, std::size_t last) {
+            counts[first / chunk * stride] = detail_bitset::popcount(data + first, last - first);
+        });
+        std::size_t res = 0;
+        for (std::size_t i = 0; i < task_count; ++i)
+        {
+            res += counts[i * stride];
+        }
+        return res;
+    }
+
+    template <class B>
+    inline std::size_t parallel_count(const xdynamic_bitset_base<B>& b)
+    {
+        return parallel_count(b, default_thread_pool());
+    }
+
+    /**
+     * Checks whether any bit of b is set. The tasks stop scanning as soon as
+     * one of them finds a set bit.
+     */
+    template <class B, class E>
+    inline bool parallel_any(const xdynamic_bitset_base<B>& b, E& executor)
+    {
+        using block_type = typename xdynamic_bitset_base<B>::block_type;
+        const block_type* data = b.data();
+        std::atomic<bool> found(false);
+        detail_bitset::parallel_blocks<block_type>(b.block_count(), executor, [data, &found](std::size_t first, std::size_t last) {
+            if (!found.load(std::memory_order_relaxed) && detail_bitset::find_nonzero_block(data, first, last) != last)
+            {
+                found.store(true, std::memory_order_relaxed);
+            }
+        });
+        return found.load();
+    }
+
+    template <class B>
+    inline bool parallel_any(const xdynamic_bitset_base<B>& b)
+    {
+        return parallel_any(b, default_thread_pool());
+    }
+
+    template <class B, class E>
+    inline bool parallel_none(const xdynamic_bitset_base<B>& b, E& executor)
+    {
+        return !parallel_any(b, executor);
+    }
+
+    template <class B>
+    inline bool parallel_none(const xdynamic_bitset_base<B>& b)
+    {
+        return !parallel_any(b);
+    }
+
+    /**
+     * Checks whether all the bits of b are set. The tasks stop scanning as
+     * soon as one of them finds a cleared bit.
+     */
+    template <class B, class E>
+    inline bool parallel_all(const xdynamic_bitset_base<B>& b, E& executor)
+    {
+        using block_type = typename xdynamic_bitset_base<B>::block_type;
+        const block_type* data = b.data();
+        std::size_t n = b.block_count();
+        std::size_t extra_bits = b.size() % (CHAR_BIT * sizeof(block_type));
+        if (extra_bits != 0)
+        {
+            --n;
+            if (data[n] != static_cast<block_type>(~(static_cast<block_type>(~block_type(0)) << extra_bits)))
+            {
+                return false;
+            }
+        }
+        std::atomic<bool> cleared(false);
+        detail_bitset::parallel_blocks<block_type>(n, executor, [data, &cleared](std::size_t first, std::size_t last) {
+            if (!cleared.load(std::memory_order_relaxed) && !detail_bitset::all_ones_blocks(data, first, last))
+            {
+                cleared.store(true, std::memory_order_relaxed);
+            }
+        });
+        return !cleared.load();
+    }
+
+    template <class B>
+    inline bool parallel_all(const xdynamic_bitset_base<B>& b)
+    {
+        return parallel_all(b, default_thread_pool());
+    }
+
+    /**
+     * Parallel equivalent of lhs &= rhs, where rhs is a bitset or a bitset
+     * expression of the same size.
+     */
+    template <class B, class R, class E>
+    inline xdynamic_bitset_base<B>& parallel_and_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor)
+    {
+        return detail_bitset::parallel_compute_assign<detail_bitset::bitwise_and>(lhs, rhs, executor);
+    }
+
+    template <class B, class R>
+    inline xdynamic_bitset_base<B>& parallel_and_assign(xdynamic_bitset_base<B>& lhs, const R& rhs)
+    {
+        return parallel_and_assign(lhs, rhs, default_thread_pool());
+    }
+
+    /**
+     * Parallel equivalent of lhs |= rhs, where rhs is a bitset or a bitset
+     * expression of the same size.
+     */
+    template <class B, class R, class E>
+    inline xdynamic_bitset_base<B>& parallel_or_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor)
+    {
+        return detail_bitset::parallel_compute_assign<detail_bitset::bitwise_or>(lhs, rhs, executor);
+    }
+
+    template <class B, class R>
+    inline xdynamic_bitset_base<B>& parallel_or_assign(xdynamic_bitset_base<B>& lhs, const R& rhs)
+    {
+        return parallel_or_assign(lhs, rhs, default_thread_pool());
+    }
+
+    /**
+     * Parallel equivalent of lhs ^= rhs, where rhs is a bitset or a bitset
+     * expression of the same size.
+     */
+    template <class B, class R, class E>
+    inline xdynamic_bitset_base<B>& parallel_xor_assign(xdynamic_bitset_base<B>& lhs, const R& rhs, E& executor)
+    {
+        return detail_bitset::parallel_compute_assign<detail_bitset::bitwise_xor>(lhs, rhs, executor);
+    }
+
+    template <class B, class R>
+    inline xdynamic_bitset_base<B>& parallel_xor_assign(xdynamic_bitset_base<B>& lhs, const R& rhs)
+    {
+        return parallel_xor_assign(lhs, rhs, default_thread_pool());
+    }
+}
+
+#endif
@@ -0,0 +1,1449 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XFLAT_HASH_MAP_HPP
+#define XTL_XFLAT_HASH_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "xbit_utils.hpp"
+#include "xhash.hpp"
+#include "xtl_config.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XTL_FLAT_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace xtl
+{
+    namespace detail_flat_hash
+    {
+        /*****************
+         * control bytes *
+         *****************/
+
+        // Every slot has a control byte: empty, deleted, or the 7 low bits of
+        // the hash of its key (H2) when it is full. The byte at index capacity
+        // is a sentinel that stops iterations; it is followed by a copy of the
+        // first group::width - 1 bytes so that a group can be loaded at any
+        // slot index.
+        using ctrl_t = signed char;
+
+        constexpr ctrl_t ctrl_empty = -128;
+        constexpr ctrl_t ctrl_deleted = -2;
+        constexpr ctrl_t ctrl_sentinel = -1;
+
+        constexpr bool is_full(ctrl_t c) noexcept
+        {
+            return c >= 0;
+        }
+
+        // Control bytes of a table without slots, probing it finds nothing
+        inline ctrl_t* empty_group() noexcept
+        {
+            alignas(16) static constexpr ctrl_t group[16] = {
+                ctrl_sentinel, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+                ctrl_empty,    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty};
+            return const_cast<ctrl_t*>(group);
+        }
+
+        /***********
+         * bitmask *
+         ***********/
+
+        // Set of slot offsets in a group, one bit per offset every 2^Shift bits
+        template <class T, std::size_t Shift>
+        class bitmask
+        {
+        public:
+
+            explicit bitmask(T mask) noexcept
+                : m_mask(mask)
+            {
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return m_mask != 0;
+            }
+
+            std::size_t lowest() const noexcept
+            {
+                return detail::countr_zero(m_mask) >> Shift;
+            }
+
+            void clear_lowest() noexcept
+            {
+                m_mask = static_cast<T>(m_mask & (m_mask - 1));
+            }
+
+        private:
+
+            T m_mask;
+        };
+
+        /*********
+         * group *
+         *********/
+
+#if defined(XTL_FLAT_HASH_SSE2)
+
+        // 16 control bytes compared at once with SSE2
+        class group
+        {
+        public:
+
+            static constexpr std::size_t width = 16;
+            using mask_type = bitmask<uint32_t, 0>;
+
+            explicit group(const ctrl_t* ctrl) noexcept
+                : m_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)))
+            {
+            }
+
+            mask_type match(ctrl_t h2) const noexcept
+            {
+                return to_mask(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(h2)), m_ctrl));
+            }
+
+            mask_type match_empty() const noexcept
+            {
+                return to_mask(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(ctrl_empty)), m_ctrl));
+            }
+
+            mask_type match_empty_or_deleted() const noexcept
+            {
+                return to_mask(_mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(ctrl_sentinel)), m_ctrl));
+            }
+
+            std::size_t count_leading_empty_or_deleted() const noexcept
+            {
+                __m128i full_or_sentinel = _mm_cmpgt_epi8(m_ctrl, _mm_set1_epi8(static_cast<char>(ctrl_deleted)));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(full_or_sentinel)) | (uint32_t(1) << width);
+                return detail::countr_zero(mask);
+            }
+
+        private:
+
+            static mask_type to_mask(__m128i cmp) noexcept
+            {
+                return mask_type(static_cast<uint32_t>(_mm_movemask_epi8(cmp)));
+            }
+
+            __m128i m_ctrl;
+        };
+
+#else
+
+        // 8 control bytes compared at once in a 64-bit word
+        class group
+        {
+        public:
+
+            static constexpr std::size_t width = 8;
+            using mask_type = bitmask<uint64_t, 3>;
+
+            explicit group(const ctrl_t* ctrl) noexcept
+                : m_ctrl(detail::xxh_read64(reinterpret_cast<const unsigned char*>(ctrl)))
+            {
+            }
+
+            // May report false positives, which are discarded by the key comparison
+            mask_type match(ctrl_t h2) const noexcept
+            {
+                uint64_t x = m_ctrl ^ (lsbs * static_cast<uint8_t>(h2));
+                return mask_type((x - lsbs) & ~x & msbs);
+            }
+
+            mask_type match_empty() const noexcept
+            {
+                return mask_type(m_ctrl & (~m_ctrl << 6) & msbs);
+            }
+
+            mask_type match_empty_or_deleted() const noexcept
+            {
+                return mask_type(m_ctrl & (~m_ctrl << 7) & msbs);
+            }
+
+            std::size_t count_leading_empty_or_deleted() const noexcept
+            {
+                uint64_t full_or_sentinel = ~(m_ctrl & (~m_ctrl << 7)) & msbs;
+                return full_or_sentinel == 0 ? width : detail::countr_zero(full_or_sentinel) >> 3;
+            }
+
+        private:
+
+            static constexpr uint64_t lsbs = 0x0101010101010101ULL;
+            static constexpr uint64_t msbs = 0x8080808080808080ULL;
+
+            uint64_t m_ctrl;
+        };
+
+#endif
+
+        /*************
+         * probe_seq *
+         *************/
+
+        // Triangular probing over groups: since the capacity + 1 is a power of
+        // two multiple of the group width, every group is visited once.
+        class probe_seq
+        {
+        public:
+
+            probe_seq(std::size_t hash, std::size_t mask) noexcept
+                : m_mask(mask), m_offset(hash & mask), m_index(0)
+            {
+            }
+
+            std::size_t offset() const noexcept
+            {
+                return m_offset;
+            }
+
+            std::size_t offset(std::size_t i) const noexcept
+            {
+                return (m_offset + i) & m_mask;
+            }
+
+            void next() noexcept
+            {
+                m_index += group::width;
+                m_offset = (m_offset + m_index) & m_mask;
+            }
+
+        private:
+
+            std::size_t m_mask;
+            std::size_t m_offset;
+            std::size_t m_index;
+        };
+
+        /******************
+         * hash splitting *
+         ******************/
+
+        // Hashers such as std::hash<int> may be the identity, the result is
+        // mixed before its bits are split between the probe start (H1) and the
+        // control byte (H2).
+        inline std::size_t mix_hash(std::size_t hash) noexcept
+        {
+            hash128 product = detail::xxh_mult64to128(static_cast<uint64_t>(hash), 0x9E3779B97F4A7C15ULL);
+            return static_cast<std::size_t>(product.low ^ product.high);
+        }
+
+        inline std::size_t h1(std::size_t hash) noexcept
+        {
+            return hash >> 7;
+        }
+
+        inline ctrl_t h2(std::size_t hash) noexcept
+        {
+            return static_cast<ctrl_t>(hash & 0x7F);
+        }
+
+        /*******************
+         * capacity growth *
+         *******************/
+
+        // Capacities are 2^n - 1 so that they are also the probing mask
+        inline std::size_t normalize_capacity(std::size_t n) noexcept
+        {
+            std::size_t res = 15;
+            while (res < n)
+            {
+                res = res * 2 + 1;
+            }
+            return res;
+        }
+
+        // The maximum load factor is 7/8
+        inline std::size_t capacity_to_growth(std::size_t capacity) noexcept
+        {
+            return capacity - capacity / 8;
+        }
+
+        inline std::size_t growth_to_capacity(std::size_t growth) noexcept
+        {
+            return growth == 0 ? 0 : growth + (growth - 1) / 7;
+        }
+
+        /************
+         * policies *
+         ************/
+
+        template <class K>
+        struct set_policy
+        {
+            using key_type = K;
+            using value_type = K;
+            static constexpr bool constant_iterators = true;
+
+            static const key_type& key(const value_type& value) noexcept
+            {
+                return value;
+            }
+        };
+
+        template <class K, class T>
+        struct map_policy
+        {
+            using key_type = K;
+            using value_type = std::pair<const K, T>;
+            static constexpr bool constant_iterators = false;
+
+            static const key_type& key(const value_type& value) noexcept
+            {
+                return value.first;
+            }
+        };
+
+        /******************
+         * key_arg_helper *
+         ******************/
+
+        template <class F, class = void>
+        struct is_transparent : std::false_type
+        {
+        };
+
+        template <class F>
+        struct is_transparent<F, std::void_t<typename F::is_transparent>> : std::true_type
+        {
+        };
+
+        // Lookup functions accept any key type when both the hasher and the
+        // key comparator are transparent, and key_type otherwise.
+        template <bool transparent>
+        struct key_arg_helper
+        {
+            template <class K, class KT>
+            using type = KT;
+        };
+
+        template <>
+        struct key_arg_helper<true>
+        {
+            template <class K, class KT>
+            using type = K;
+        };
+    }
+
+    template <class P, class H, class E, class A>
+    class xflat_hash_table;
+
+    /***********************
+     * xflat_hash_iterator *
+     ***********************/
+
+    template <class P, bool is_const>
+    class xflat_hash_iterator
+    {
+    public:
+
+        using self_type = xflat_hash_iterator<P, is_const>;
+        using slot_type = typename P::value_type;
+        using value_type = slot_type;
+        using reference = std::conditional_t<is_const || P::constant_iterators, const value_type&, value_type&>;
+        using pointer = std::conditional_t<is_const || P::constant_iterators, const value_type*, value_type*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        xflat_hash_iterator() noexcept;
+        xflat_hash_iterator(const detail_flat_hash::ctrl_t* ctrl, slot_type* slot) noexcept;
+
+        template <bool C, class = std::enable_if_t<is_const && !C>>
+        xflat_hash_iterator(const xflat_hash_iterator<P, C>& rhs) noexcept;
+
+        self_type& operator++() noexcept;
+        self_type operator++(int) noexcept;
+
+        reference operator*() const noexcept;
+        pointer operator->() const noexcept;
+
+        bool operator==(const self_type& rhs) const noexcept;
+        bool operator!=(const self_type& rhs) const noexcept;
+
+    private:
+
+        void skip_empty_or_deleted() noexcept;
+
+        const detail_flat_hash::ctrl_t* p_ctrl;
+        slot_type* p_slot;
+
+        template <class, bool>
+        friend class xflat_hash_iterator;
+
+        template <class, class, class, class>
+        friend class xflat_hash_table;
+    };
+
+    /********************
+     * xflat_hash_table *
+     ********************/
+
+    /**
+     * Open addressing hash table shared by xflat_hash_map and xflat_hash_set.
+     *
+     * Values are stored inline in an array of slots, next to an array of
+     * control bytes holding 7 bits of the hash of each key. Lookups compare
+     * a whole group of control bytes at once (16 with SSE2, 8 otherwise) and
+     * only compare the keys whose control byte matches. Erased slots are
+     * marked deleted and reclaimed when the table is rehashed.
+     *
+     * Unlike the std unordered containers, rehashing invalidates references
+     * to the elements.
+     */
+    template <class P, class H, class E, class A>
+    class xflat_hash_table
+    {
+    public:
+
+        using self_type = xflat_hash_table<P, H, E, A>;
+        using policy_type = P;
+        using key_type = typename P::key_type;
+        using value_type = typename P::value_type;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using hasher = H;
+        using key_equal = E;
+        using allocator_type = A;
+        using reference = value_type&;
+        using const_reference = const value_type&;
+        using pointer = value_type*;
+        using const_pointer = const value_type*;
+        using iterator = xflat_hash_iterator<P, false>;
+        using const_iterator = xflat_hash_iterator<P, true>;
+
+        static constexpr bool is_transparent = detail_flat_hash::is_transparent<H>::value &&
+                                               detail_flat_hash::is_transparent<E>::value;
+
+        template <class K>
+        using key_arg = typename detail_flat_hash::key_arg_helper<is_transparent>::template type<K, key_type>;
+
+        xflat_hash_table();
+        explicit xflat_hash_table(size_type bucket_count,
+                                  const hasher& hash = hasher(),
+                                  const key_equal& equal = key_equal(),
+                                  const allocator_type& alloc = allocator_type());
+
+        template <class It>
+        xflat_hash_table(It first, It last,
+                         size_type bucket_count = 0,
+                         const hasher& hash = hasher(),
+                         const key_equal& equal = key_equal(),
+                         const allocator_type& alloc = allocator_type());
+
+        xflat_hash_table(std::initializer_list<value_type> init,
+                         size_type bucket_count = 0,
+                         const hasher& hash = hasher(),
+                         const key_equal& equal = key_equal(),
+                         const allocator_type& alloc = allocator_type());
+
+        ~xflat_hash_table();
+
+        xflat_hash_table(const self_type& rhs);
+        xflat_hash_table(self_type&& rhs) noexcept;
+
+        self_type& operator=(const self_type& rhs);
+        self_type& operator=(self_type&& rhs) noexcept;
+
+        iterator begin() noexcept;
+        const_iterator begin() const noexcept;
+        const_iterator cbegin() const noexcept;
+
+        iterator end() noexcept;
+        const_iterator end() const noexcept;
+        const_iterator cend() const noexcept;
+
+        bool empty() const noexcept;
+        size_type size() const noexcept;
+        size_type max_size() const noexcept;
+
+        void clear() noexcept;
+
+        std::pair<iterator, bool> insert(const value_type& value);
+        std::pair<iterator, bool> insert(value_type&& value);
+
+        template <class It>
+        void insert(It first, It last);
+
+        void insert(std::initializer_list<value_type> init);
+
+        template <class... Args>
+        std::pair<iterator, bool> emplace(Args&&... args);
+
+        iterator erase(iterator pos);
+        iterator erase(const_iterator pos);
+
+        template <class K = key_type>
+        size_type erase(const key_arg<K>& key);
+
+        void swap(self_type& rhs) noexcept;
+
+        template <class K = key_type>
+        iterator find(const key_arg<K>& key);
+
+        template <class K = key_type>
+        const_iterator find(const key_arg<K>& key) const;
+
+        template <class K = key_type>
+        bool contains(const key_arg<K>& key) const;
+
+        template <class K = key_type>
+        size_type count(const key_arg<K>& key) const;
+
+        size_type bucket_count() const noexcept;
+        float load_factor() const noexcept;
+        float max_load_factor() const noexcept;
+
+        void rehash(size_type count);
+        void reserve(size_type count);
+
+        hasher hash_function() const;
+        key_equal key_eq() const;
+        allocator_type get_allocator() const noexcept;
+
+    protected:
+
+        template <class K, class F>
+        std::pair<iterator, bool> find_or_construct(const K& key, F&& construct);
+
+        template <class... Args>
+        void construct(pointer slot, Args&&... args);
+
+    private:
+
+        using ctrl_t = detail_flat_hash::ctrl_t;
+        using allocator_traits = std::allocator_traits<allocator_type>;
+        using ctrl_allocator_type = typename allocator_traits::template rebind_alloc<ctrl_t>;
+        using ctrl_allocator_traits = std::allocator_traits<ctrl_allocator_type>;
+
+        template <class K>
+        size_type hash_key(const K& key) const;
+
+        template <class K>
+        bool find_index(const K& key, size_type hash, size_type& index) const;
+
+        size_type find_first_non_full(size_type hash) const noexcept;
+        size_type prepare_insert(size_type hash);
+        void commit_insert(size_type index, size_type hash) noexcept;
+        void erase_at(size_type index) noexcept;
+
+        void set_ctrl(size_type index, ctrl_t h) noexcept;
+        void reset_ctrl() noexcept;
+
+        void allocate(size_type capacity);
+        void deallocate() noexcept;
+        void destroy_slots() noexcept;
+        void copy_slots(const self_type& rhs);
+        void resize(size_type capacity);
+        void rehash_and_grow();
+
+        iterator iterator_at(size_type index) noexcept;
+        const_iterator iterator_at(size_type index) const noexcept;
+
+        ctrl_t* p_ctrl;
+        pointer p_slots;
+        size_type m_size;
+        size_type m_capacity;
+        size_type m_growth_left;
+        hasher m_hasher;
+        key_equal m_key_equal;
+        allocator_type m_allocator;
+    };
+
+    template <class P, class H, class E, class A>
+    bool operator==(const xflat_hash_table<P, H, E, A>& lhs, const xflat_hash_table<P, H, E, A>& rhs);
+
+    template <class P, class H, class E, class A>
+    bool operator!=(const xflat_hash_table<P, H, E, A>& lhs, const xflat_hash_table<P, H, E, A>& rhs);
+
+    template <class P, class H, class E, class A>
+    void swap(xflat_hash_table<P, H, E, A>& lhs, xflat_hash_table<P, H, E, A>& rhs) noexcept;
+
+    /******************
+     * xflat_hash_set *
+     ******************/
+
+    /**
+     * Hash set storing its keys inline, see xflat_hash_table.
+     *
+     * With xbasic_fixed_string keys, xstring_hash and xstring_equal allow
+     * lookups from string views without building a key.
+     */
+    template <class K,
+              class H = std::hash<K>,
+              class E = std::equal_to<K>,
+              class A = std::allocator<K>>
+    class xflat_hash_set : public xflat_hash_table<detail_flat_hash::set_policy<K>, H, E, A>
+    {
+    public:
+
+        using base_type = xflat_hash_table<detail_flat_hash::set_policy<K>, H, E, A>;
+
+        using base_type::base_type;
+    };
+
+    /******************
+     * xflat_hash_map *
+     ******************/
+
+    /**
+     * Hash map storing its key-value pairs inline, see xflat_hash_table.
+     */
+    template <class K,
+              class T,
+              class H = std::hash<K>,
+              class E = std::equal_to<K>,
+              class A = std::allocator<std::pair<const K, T>>>
+    class xflat_hash_map : public xflat_hash_table<detail_flat_hash::map_policy<K, T>, H, E, A>
+    {
+    public:
+
+        using base_type = xflat_hash_table<detail_flat_hash::map_policy<K, T>, H, E, A>;
+        using key_type = typename base_type::key_type;
+        using mapped_type = T;
+        using value_type = typename base_type::value_type;
+        using iterator = typename base_type::iterator;
+        using const_iterator = typename base_type::const_iterator;
+
+        template <class K2>
+        using key_arg = typename base_type::template key_arg<K2>;
+
+        using base_type::base_type;
+
+        template <class... Args>
+        std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args);
+
+        template <class... Args>
+        std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args);
+
+        template <class M>
+        std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj);
+
+        template <class M>
+        std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj);
+
+        mapped_type& operator[](const key_type& key);
+        mapped_type& operator[](key_type&& key);
+
+        template <class K2 = key_type>
+        mapped_type& at(const key_arg<K2>& key);
+
+        template <class K2 = key_type>
+        const mapped_type& at(const key_arg<K2>& key) const;
+    };
+
+    /**************************************
+     * xflat_hash_iterator implementation *
+     **************************************/
+
+    template <class P, bool is_const>
+    inline xflat_hash_iterator<P, is_const>::xflat_hash_iterator() noexcept
+        : p_ctrl(nullptr), p_slot(nullptr)
+    {
+    }
+
+    template <class P, bool is_const>
+    inline xflat_hash_iterator<P, is_const>::xflat_hash_iterator(const detail_flat_hash::ctrl_t* ctrl, slot_type* slot) noexcept
+        : p_ctrl(ctrl), p_slot(slot)
+    {
+    }
+
+    template <class P, bool is_const>
+    template <bool C, class>
+    inline xflat_hash_iterator<P, is_const>::xflat_hash_iterator(const xflat_hash_iterator<P, C>& rhs) noexcept
+        : p_ctrl(rhs.p_ctrl), p_slot(rhs.p_slot)
+    {
+    }
+
+    template <class P, bool is_const>
+    inline auto xflat_hash_iterator<P, is_const>::operator++() noexcept -> self_type&
+    {
+        ++p_ctrl;
+        ++p_slot;
+        skip_empty_or_deleted();
+        return *this;
+    }
+
+    template <class P, bool is_const>
+    inline auto xflat_hash_iterator<P, is_const>::operator++(int) noexcept -> self_type
+    {
+        self_type tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+
+    template <class P, bool is_const>
+    inline auto xflat_hash_iterator<P, is_const>::operator*() const noexcept -> reference
+    {
+        return *p_slot;
+    }
+
+    template <class P, bool is_const>
+    inline auto xflat_hash_iterator<P, is_const>::operator->() const noexcept -> pointer
+    {
+        return p_slot;
+    }
+
+    template <class P, bool is_const>
+    inline bool xflat_hash_iterator<P, is_const>::operator==(const self_type& rhs) const noexcept
+    {
+        return p_ctrl == rhs.p_ctrl;
+    }
+
+    template <class P, bool is_const>
+    inline bool xflat_hash_iterator<P, is_const>::operator!=(const self_type& rhs) const noexcept
+    {
+        return p_ctrl != rhs.p_ctrl;
+    }
+
+    // Stops on a full slot or on the sentinel
+    template <class P, bool is_const>
+    inline void xflat_hash_iterator<P, is_const>::skip_empty_or_deleted() noexcept
+    {
+        while (*p_ctrl < detail_flat_hash::ctrl_sentinel)
+        {
+            std::size_t shift = detail_flat_hash::group(p_ctrl).count_leading_empty_or_deleted();
+            p_ctrl += shift;
+            p_slot += shift;
+        }
+    }
+
+    /***********************************
+     * xflat_hash_table implementation *
+     ***********************************/
+
+    template <class P, class H, class E, class A>
+    inline xflat_hash_table<P, H, E, A>::xflat_hash_table()
+        : xflat_hash_table(0)
+    {
+    }
+
+    template <class P, class H, class E, class A>
+    inline xflat_hash_table<P, H, E, A>::xflat_hash_table(size_type bucket_count,
+                                                          const hasher& hash,
+                                                          const key_equal& equal,
+                                                          const allocator_type& alloc)
+        : p_ctrl(detail_flat_hash::empty_group()), p_slots(nullptr), m_size(0), m_capacity(0), m_growth_left(0),
+          m_hasher(hash), m_key_equal(equal), m_allocator(alloc)
+    {
+        if (bucket_count != 0)
+        {
+            allocate(detail_flat_hash::normalize_capacity(bucket_count));
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    template <class It>
+    inline xflat_hash_table<P, H, E, A>::xflat_hash_table(It first, It last,
+                                                          size_type bucket_count,
+                                                          const hasher& hash,
+                                                          const key_equal& equal,
+                                                          const allocator_type& alloc)
+        : xflat_hash_table(bucket_count, hash, equal, alloc)
+    {
+        insert(first, last);
+    }
+
+    template <class P, class H, class E, class A>
+    inline xflat_hash_table<P, H, E, A>::xflat_hash_table(std::initializer_list<value_type> init,
+                                                          size_type bucket_count,
+                                                          const hasher& hash,
+                                                          const key_equal& equal,
+                                                          const allocator_type& alloc)
+        : xflat_hash_table(init.begin(), init.end(), bucket_count, hash, equal, alloc)
+    {
+    }
+
+    template <class P, class H, class E, class A>
+    inline xflat_hash_table<P, H, E, A>::~xflat_hash_table()
+    {
+        destroy_slots();
+        deallocate();
+    }
+
+    template <class P, class H, class E, class A>
+    inline xflat_hash_table<P, H, E, A>::xflat_hash_table(const self_type& rhs)
+        : p_ctrl(detail_flat_hash::empty_group()), p_slots(nullptr), m_size(0), m_capacity(0), m_growth_left(0),
+          m_hasher(rhs.m_hasher), m_key_equal(rhs.m_key_equal),
+          m_allocator(allocator_traits::select_on_container_copy_construction(rhs.m_allocator))
+    {
+        copy_slots(rhs);
+    }
+
+    template <class P, class H, class E, class A>
+    inline xflat_hash_table<P, H, E, A>::xflat_hash_table(self_type&& rhs) noexcept
+        : p_ctrl(rhs.p_ctrl), p_slots(rhs.p_slots), m_size(rhs.m_size), m_capacity(rhs.m_capacity),
+          m_growth_left(rhs.m_growth_left), m_hasher(std::move(rhs.m_hasher)),
+          m_key_equal(std::move(rhs.m_key_equal)), m_allocator(std::move(rhs.m_allocator))
+    {
+        rhs.p_ctrl = detail_flat_hash::empty_group();
+        rhs.p_slots = nullptr;
+        rhs.m_size = 0;
+        rhs.m_capacity = 0;
+        rhs.m_growth_left = 0;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::operator=(const self_type& rhs) -> self_type&
+    {
+        if (this != &rhs)
+        {
+            self_type tmp(rhs);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::operator=(self_type&& rhs) noexcept -> self_type&
+    {
+        self_type tmp(std::move(rhs));
+        swap(tmp);
+        return *this;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::begin() noexcept -> iterator
+    {
+        iterator it(p_ctrl, p_slots);
+        it.skip_empty_or_deleted();
+        return it;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::begin() const noexcept -> const_iterator
+    {
+        return const_cast<self_type*>(this)->begin();
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::cbegin() const noexcept -> const_iterator
+    {
+        return begin();
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::end() noexcept -> iterator
+    {
+        return iterator_at(m_capacity);
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::end() const noexcept -> const_iterator
+    {
+        return iterator_at(m_capacity);
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::cend() const noexcept -> const_iterator
+    {
+        return end();
+    }
+
+    template <class P, class H, class E, class A>
+    inline bool xflat_hash_table<P, H, E, A>::empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::size() const noexcept -> size_type
+    {
+        return m_size;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::max_size() const noexcept -> size_type
+    {
+        return std::numeric_limits<size_type>::max() / (sizeof(value_type) + 1) / 2;
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::clear() noexcept
+    {
+        destroy_slots();
+        m_size = 0;
+        if (m_capacity != 0)
+        {
+            reset_ctrl();
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::insert(const value_type& value) -> std::pair<iterator, bool>
+    {
+        return find_or_construct(P::key(value), [&](pointer slot) { construct(slot, value); });
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::insert(value_type&& value) -> std::pair<iterator, bool>
+    {
+        return find_or_construct(P::key(value), [&](pointer slot) { construct(slot, std::move(value)); });
+    }
+
+    template <class P, class H, class E, class A>
+    template <class It>
+    inline void xflat_hash_table<P, H, E, A>::insert(It first, It last)
+    {
+        if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                      typename std::iterator_traits<It>::iterator_category>::value)
+        {
+            reserve(m_size + static_cast<size_type>(std::distance(first, last)));
+        }
+        for (; first != last; ++first)
+        {
+            insert(*first);
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::insert(std::initializer_list<value_type> init)
+    {
+        insert(init.begin(), init.end());
+    }
+
+    /**
+     * Builds the value first, its key is only known afterwards. try_emplace
+     * avoids this temporary in maps.
+     */
+    template <class P, class H, class E, class A>
+    template <class... Args>
+    inline auto xflat_hash_table<P, H, E, A>::emplace(Args&&... args) -> std::pair<iterator, bool>
+    {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    /**
+     * Erases the element at pos and returns an iterator to the next one.
+     */
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::erase(iterator pos) -> iterator
+    {
+        erase_at(static_cast<size_type>(pos.p_slot - p_slots));
+        ++pos;
+        return pos;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::erase(const_iterator pos) -> iterator
+    {
+        return erase(iterator(pos.p_ctrl, pos.p_slot));
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline auto xflat_hash_table<P, H, E, A>::erase(const key_arg<K>& key) -> size_type
+    {
+        size_type index;
+        if (!find_index(key, hash_key(key), index))
+        {
+            return 0;
+        }
+        erase_at(index);
+        return 1;
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::swap(self_type& rhs) noexcept
+    {
+        using std::swap;
+        swap(p_ctrl, rhs.p_ctrl);
+        swap(p_slots, rhs.p_slots);
+        swap(m_size, rhs.m_size);
+        swap(m_capacity, rhs.m_capacity);
+        swap(m_growth_left, rhs.m_growth_left);
+        swap(m_hasher, rhs.m_hasher);
+        swap(m_key_equal, rhs.m_key_equal);
+        swap(m_allocator, rhs.m_allocator);
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline auto xflat_hash_table<P, H, E, A>::find(const key_arg<K>& key) -> iterator
+    {
+        size_type index;
+        return find_index(key, hash_key(key), index) ? iterator_at(index) : end();
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline auto xflat_hash_table<P, H, E, A>::find(const key_arg<K>& key) const -> const_iterator
+    {
+        size_type index;
+        return find_index(key, hash_key(key), index) ? iterator_at(index) : end();
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline bool xflat_hash_table<P, H, E, A>::contains(const key_arg<K>& key) const
+    {
+        size_type index;
+        return find_index(key, hash_key(key), index);
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline auto xflat_hash_table<P, H, E, A>::count(const key_arg<K>& key) const -> size_type
+    {
+        return contains<K>(key) ? 1 : 0;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::bucket_count() const noexcept -> size_type
+    {
+        return m_capacity;
+    }
+
+    template <class P, class H, class E, class A>
+    inline float xflat_hash_table<P, H, E, A>::load_factor() const noexcept
+    {
+        return m_capacity == 0 ? 0.f : static_cast<float>(m_size) / static_cast<float>(m_capacity);
+    }
+
+    template <class P, class H, class E, class A>
+    inline float xflat_hash_table<P, H, E, A>::max_load_factor() const noexcept
+    {
+        return 0.875f;
+    }
+
+    /**
+     * Rehashes the elements in a table of at least count slots, also
+     * reclaiming the slots of erased elements. rehash(0) on an empty table
+     * releases its memory.
+     */
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::rehash(size_type count)
+    {
+        if (count == 0 && m_size == 0)
+        {
+            deallocate();
+            return;
+        }
+        size_type min_capacity = std::max(count, detail_flat_hash::growth_to_capacity(m_size));
+        resize(detail_flat_hash::normalize_capacity(min_capacity));
+    }
+
+    /**
+     * Makes room for count elements without rehashing.
+     */
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::reserve(size_type count)
+    {
+        if (count > m_size + m_growth_left)
+        {
+            resize(detail_flat_hash::normalize_capacity(detail_flat_hash::growth_to_capacity(count)));
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::hash_function() const -> hasher
+    {
+        return m_hasher;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::key_eq() const -> key_equal
+    {
+        return m_key_equal;
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::get_allocator() const noexcept -> allocator_type
+    {
+        return m_allocator;
+    }
+
+    /**
+     * Returns the element with the given key, or calls construct(slot) to
+     * build it in a free slot. The table is left unchanged if construct throws.
+     */
+    template <class P, class H, class E, class A>
+    template <class K, class F>
+    inline auto xflat_hash_table<P, H, E, A>::find_or_construct(const K& key, F&& construct) -> std::pair<iterator, bool>
+    {
+        size_type hash = hash_key(key);
+        size_type index;
+        if (find_index(key, hash, index))
+        {
+            return {iterator_at(index), false};
+        }
+        index = prepare_insert(hash);
+        construct(p_slots + index);
+        commit_insert(index, hash);
+        return {iterator_at(index), true};
+    }
+
+    template <class P, class H, class E, class A>
+    template <class... Args>
+    inline void xflat_hash_table<P, H, E, A>::construct(pointer slot, Args&&... args)
+    {
+        allocator_traits::construct(m_allocator, slot, std::forward<Args>(args)...);
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline auto xflat_hash_table<P, H, E, A>::hash_key(const K& key) const -> size_type
+    {
+        return detail_flat_hash::mix_hash(static_cast<size_type>(m_hasher(key)));
+    }
+
+    template <class P, class H, class E, class A>
+    template <class K>
+    inline bool xflat_hash_table<P, H, E, A>::find_index(const K& key, size_type hash, size_type& index) const
+    {
+        detail_flat_hash::probe_seq seq(detail_flat_hash::h1(hash), m_capacity);
+        const ctrl_t h2 = detail_flat_hash::h2(hash);
+        while (true)
+        {
+            detail_flat_hash::group g(p_ctrl + seq.offset());
+            for (auto match = g.match(h2); match; match.clear_lowest())
+            {
+                size_type i = seq.offset(match.lowest());
+                if (m_key_equal(P::key(p_slots[i]), key))
+                {
+                    index = i;
+                    return true;
+                }
+            }
+            if (g.match_empty())
+            {
+                return false;
+            }
+            seq.next();
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::find_first_non_full(size_type hash) const noexcept -> size_type
+    {
+        detail_flat_hash::probe_seq seq(detail_flat_hash::h1(hash), m_capacity);
+        while (true)
+        {
+            auto mask = detail_flat_hash::group(p_ctrl + seq.offset()).match_empty_or_deleted();
+            if (mask)
+            {
+                return seq.offset(mask.lowest());
+            }
+            seq.next();
+        }
+    }
+
+    // Reusing a deleted slot does not consume the growth budget
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::prepare_insert(size_type hash) -> size_type
+    {
+        size_type index = find_first_non_full(hash);
+        if (m_growth_left == 0 && p_ctrl[index] != detail_flat_hash::ctrl_deleted)
+        {
+            rehash_and_grow();
+            index = find_first_non_full(hash);
+        }
+        return index;
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::commit_insert(size_type index, size_type hash) noexcept
+    {
+        ++m_size;
+        m_growth_left -= static_cast<size_type>(p_ctrl[index] == detail_flat_hash::ctrl_empty);
+        set_ctrl(index, detail_flat_hash::h2(hash));
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::erase_at(size_type index) noexcept
+    {
+        allocator_traits::destroy(m_allocator, p_slots + index);
+        --m_size;
+        set_ctrl(index, detail_flat_hash::ctrl_deleted);
+    }
+
+    // Also updates the copy of the byte past the sentinel
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::set_ctrl(size_type index, ctrl_t h) noexcept
+    {
+        constexpr size_type cloned = detail_flat_hash::group::width - 1;
+        p_ctrl[index] = h;
+        p_ctrl[((index - cloned) & m_capacity) + cloned] = h;
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::reset_ctrl() noexcept
+    {
+        std::fill(p_ctrl, p_ctrl + m_capacity + detail_flat_hash::group::width, detail_flat_hash::ctrl_empty);
+        p_ctrl[m_capacity] = detail_flat_hash::ctrl_sentinel;
+        m_growth_left = detail_flat_hash::capacity_to_growth(m_capacity) - m_size;
+    }
+
+    // Replaces the arrays without moving the elements. The table is only
+    // modified once both arrays are allocated, so it is left unchanged if
+    // the allocation of the slots throws.
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::allocate(size_type capacity)
+    {
+        struct ctrl_guard
+        {
+            ctrl_allocator_type alloc;
+            ctrl_t* ptr;
+            size_type size;
+
+            ~ctrl_guard()
+            {
+                if (ptr != nullptr)
+                {
+                    ctrl_allocator_traits::deallocate(alloc, ptr, size);
+                }
+            }
+        };
+
+        size_type ctrl_size = capacity + detail_flat_hash::group::width;
+        ctrl_guard guard = {ctrl_allocator_type(m_allocator), nullptr, ctrl_size};
+        guard.ptr = ctrl_allocator_traits::allocate(guard.alloc, ctrl_size);
+        pointer slots = allocator_traits::allocate(m_allocator, capacity);
+        p_ctrl = guard.ptr;
+        p_slots = slots;
+        m_capacity = capacity;
+        guard.ptr = nullptr;
+        reset_ctrl();
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::deallocate() noexcept
+    {
+        if (m_capacity != 0)
+        {
+            ctrl_allocator_type ctrl_alloc(m_allocator);
+            ctrl_allocator_traits::deallocate(ctrl_alloc, p_ctrl, m_capacity + detail_flat_hash::group::width);
+            allocator_traits::deallocate(m_allocator, p_slots, m_capacity);
+            p_ctrl = detail_flat_hash::empty_group();
+            p_slots = nullptr;
+            m_capacity = 0;
+            m_growth_left = 0;
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::destroy_slots() noexcept
+    {
+        if (!std::is_trivially_destructible<value_type>::value)
+        {
+            for (size_type i = 0; i < m_capacity; ++i)
+            {
+                if (detail_flat_hash::is_full(p_ctrl[i]))
+                {
+                    allocator_traits::destroy(m_allocator, p_slots + i);
+                }
+            }
+        }
+    }
+
+    // The keys of rhs are distinct, they are inserted without lookup
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::copy_slots(const self_type& rhs)
+    {
+        reserve(rhs.m_size);
+        for (const auto& value : rhs)
+        {
+            size_type hash = hash_key(P::key(value));
+            size_type index = find_first_non_full(hash);
+            construct(p_slots + index, value);
+            commit_insert(index, hash);
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::resize(size_type capacity)
+    {
+        ctrl_t* old_ctrl = p_ctrl;
+        pointer old_slots = p_slots;
+        size_type old_capacity = m_capacity;
+
+        allocate(capacity);
+        for (size_type i = 0; i < old_capacity; ++i)
+        {
+            if (detail_flat_hash::is_full(old_ctrl[i]))
+            {
+                size_type hash = hash_key(P::key(old_slots[i]));
+                size_type index = find_first_non_full(hash);
+                construct(p_slots + index, std::move(old_slots[i]));
+                set_ctrl(index, detail_flat_hash::h2(hash));
+                allocator_traits::destroy(m_allocator, old_slots + i);
+            }
+        }
+        m_growth_left = detail_flat_hash::capacity_to_growth(m_capacity) - m_size;
+
+        if (old_capacity != 0)
+        {
+            ctrl_allocator_type ctrl_alloc(m_allocator);
+            ctrl_allocator_traits::deallocate(ctrl_alloc, old_ctrl, old_capacity + detail_flat_hash::group::width);
+            allocator_traits::deallocate(m_allocator, old_slots, old_capacity);
+        }
+    }
+
+    // When the table is mostly made of deleted slots, rehashing at the same
+    // capacity is enough to reclaim them.
+    template <class P, class H, class E, class A>
+    inline void xflat_hash_table<P, H, E, A>::rehash_and_grow()
+    {
+        if (m_capacity > detail_flat_hash::group::width && m_size * 32 <= m_capacity * 25)
+        {
+            resize(m_capacity);
+        }
+        else
+        {
+            resize(detail_flat_hash::normalize_capacity(m_capacity * 2 + 1));
+        }
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::iterator_at(size_type index) noexcept -> iterator
+    {
+        return iterator(p_ctrl + index, p_slots + index);
+    }
+
+    template <class P, class H, class E, class A>
+    inline auto xflat_hash_table<P, H, E, A>::iterator_at(size_type index) const noexcept -> const_iterator
+    {
+        return const_iterator(p_ctrl + index, p_slots + index);
+    }
+
+    /*********************************
+     * free functions implementation *
+     *********************************/
+
+    template <class P, class H, class E, class A>
+    inline bool operator==(const xflat_hash_table<P, H, E, A>& lhs, const xflat_hash_table<P, H, E, A>& rhs)
+    {
+        if (lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        for (const auto& value : lhs)
+        {
+            auto it = rhs.find(P::key(value));
+            if (it == rhs.end() || !(*it == value))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <class P, class H, class E, class A>
+    inline bool operator!=(const xflat_hash_table<P, H, E, A>& lhs, const xflat_hash_table<P, H, E, A>& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template <class P, class H, class E, class A>
+    inline void swap(xflat_hash_table<P, H, E, A>& lhs, xflat_hash_table<P, H, E, A>& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+
+    /*********************************
+     * xflat_hash_map implementation *
+     *********************************/
+
+    template <class K, class T, class H, class E, class A>
+    template <class... Args>
+    inline auto xflat_hash_map<K, T, H, E, A>::try_emplace(const key_type& key, Args&&... args) -> std::pair<iterator, bool>
+    {
+        return this->find_or_construct(key, [&](value_type* slot) {
+            this->construct(slot, std::piecewise_construct, std::forward_as_tuple(key),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+        });
+    }
+
+    template <class K, class T, class H, class E, class A>
+    template <class... Args>
+    inline auto xflat_hash_map<K, T, H, E, A>::try_emplace(key_type&& key, Args&&... args) -> std::pair<iterator, bool>
+    {
+        return this->find_or_construct(key, [&](value_type* slot) {
+            this->construct(slot, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+        });
+    }
+
+    template <class K, class T, class H, class E, class A>
+    template <class M>
+    inline auto xflat_hash_map<K, T, H, E, A>::insert_or_assign(const key_type& key, M&& obj) -> std::pair<iterator, bool>
+    {
+        auto res = try_emplace(key, std::forward<M>(obj));
+        if (!res.second)
+        {
+            res.first->second = std::forward<M>(obj);
+        }
+        return res;
+    }
+
+    template <class K, class T, class H, class E, class A>
+    template <class M>
+    inline auto xflat_hash_map<K, T, H, E, A>::insert_or_assign(key_type&& key, M&& obj) -> std::pair<iterator, bool>
+    {
+        auto res = try_emplace(std::move(key), std::forward<M>(obj));
+        if (!res.second)
+        {
+            res.first->second = std::forward<M>(obj);
+        }
+        return res;
+    }
+
+    template <class K, class T, class H, class E, class A>
+    inline auto xflat_hash_map<K, T, H, E, A>::operator[](const key_type& key) -> mapped_type&
+    {
+        return try_emplace(key).first->second;
+    }
+
+    template <class K, class T, class H, class E, class A>
+    inline auto xflat_hash_map<K, T, H, E, A>::operator[](key_type&& key) -> mapped_type&
+    {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    template <class K, class T, class H, class E, class A>
+    template <class K2>
+    inline auto xflat_hash_map<K, T, H, E, A>::at(const key_arg<K2>& key) -> mapped_type&
+    {
+        auto it = this->template find<K2>(key);
+        if (it == this->end())
+        {
+            XTL_THROW(std::out_of_range, "xflat_hash_map::at: key not found");
+        }
+        return it->second;
+    }
+
+    template <class K, class T, class H, class E, class A>
+    template <class K2>
+    inline auto xflat_hash_map<K, T, H, E, A>::at(const key_arg<K2>& key) const -> const mapped_type&
+    {
+        auto it = this->template find<K2>(key);
+        if (it == this->end())
+        {
+            XTL_THROW(std::out_of_range, "xflat_hash_map::at: key not found");
+        }
+        return it->second;
+    }
+}
+
+#endif
@@ -10,8 +10,21 @@
 #ifndef XTL_XHALF_FLOAT_HPP
 #define XTL_XHALF_FLOAT_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "xplatform.hpp"
+#include "xspan.hpp"
+#include "xtl_config.hpp"
 #include "xtype_traits.hpp"
 #include "xhalf_float_impl.hpp"
+#include "xavx512_utils.hpp"
 
 namespace xtl
 {
@@ -36,6 +49,904 @@ namespace xtl
     struct is_floating_point<half_float> : std::true_type
     {
     };
+
+    namespace literals
+    {
+        // 1.5_h is a constant expression, rounded as HALF_ROUND_STYLE.
+        using ::half_float::literal::operator""_h;
+    }
+
+    void convert(span<const half_float> input, span<float> output);
+    void convert(span<const float> input, span<half_float> output);
+
+    void add(span<const half_float> x, span<const half_float> y, span<half_float> res);
+    void multiply(span<const half_float> x, span<const half_float> y, span<half_float> res);
+    void fma(span<const half_float> x, span<const half_float> y, span<const half_float> z, span<half_float> res);
+    float dot(span<const half_float> x, span<const half_float> y);
+    float sum(span<const half_float> x);
+    std::pair<half_float, half_float> minmax(span<const half_float> x);
+
+    /**
+     * Policy tag selecting the half_float math functions, which are exact to
+     * rounding or within 1 ULP as documented for each of them.
+     */
+    struct half_exact_math
+    {
+    };
+
+    /**
+     * Policy tag selecting math functions evaluated in single precision by
+     * the standard library and rounded once to half precision. With a libm
+     * accurate to a few float ULPs, the results are within 1 ULP of the
+     * exact value and sqrt is correctly rounded. Floating-point exceptions
+     * are not raised through the half_float error handling.
+     */
+    struct half_fast_math
+    {
+    };
+
+    // The math functions below are defined for both policies, on values:
+    //     half_float exp(half_float x, Policy);
+    // and on spans, with res.size() >= x.size():
+    //     void exp(span<const half_float> x, span<half_float> res, Policy);
+    // Unary: exp, exp2, expm1, log, log10, log2, log1p, sqrt, cbrt, sin,
+    // cos, tan, asin, acos, atan, sinh, cosh, tanh, asinh, acosh, atanh,
+    // erf, erfc, tgamma, lgamma. Binary: pow, atan2, hypot.
+
+    namespace detail
+    {
+        /*****************************
+         * half_float scalar kernels *
+         *****************************/
+
+        constexpr std::float_round_style half_round_style = static_cast<std::float_round_style>(HALF_ROUND_STYLE);
+
+        // Exponent rebias on the bits, subnormals are normalized by a float
+        // subtraction rather than the mantissa table of half2float.
+        inline float half_bits_to_float(uint16_t value) noexcept
+        {
+            constexpr uint32_t shifted_exp = uint32_t(0x7C00) << 13;
+            uint32_t bits = (uint32_t(value) & 0x7FFFu) << 13;
+            uint32_t exp = bits & shifted_exp;
+            bits += uint32_t(127 - 15) << 23;
+            float res;
+            if (exp == shifted_exp)
+            {
+                bits += uint32_t(128 - 16) << 23;
+            }
+            else if (exp == 0)
+            {
+                constexpr uint32_t magic_bits = uint32_t(113) << 23;
+                float magic;
+                std::memcpy(&magic, &magic_bits, sizeof(float));
+                bits += uint32_t(1) << 23;
+                std::memcpy(&res, &bits, sizeof(float));
+                res -= magic;
+                std::memcpy(&bits, &res, sizeof(float));
+            }
+            bits |= (uint32_t(value) & 0x8000u) << 16;
+            std::memcpy(&res, &bits, sizeof(float));
+            return res;
+        }
+
+        inline void half_to_float_scalar(const half_float* in, std::size_t size, float* out) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                out[i] = half_bits_to_float(in[i].get_data());
+            }
+        }
+
+        inline void float_to_half_scalar(const float* in, std::size_t size, half_float* out) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                uint16_t bits = static_cast<uint16_t>(::half_float::detail::float2half<half_round_style>(in[i]));
+                std::memcpy(static_cast<void*>(out + i), &bits, sizeof(uint16_t));
+            }
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        /***************************
+         * half_float SIMD kernels *
+         ***************************/
+
+        // The hardware conversions round as HALF_ROUND_STYLE, through the
+        // MXCSR rounding mode when it is indeterminate. Unlike the scalar
+        // kernels, they quiet signaling NaNs. The tails go through a
+        // zeroed 8-lane buffer.
+
+        constexpr int half_round_imm = half_round_style == std::round_to_nearest ? 0x00
+                                     : half_round_style == std::round_toward_neg_infinity ? 0x01
+                                     : half_round_style == std::round_toward_infinity ? 0x02
+                                     : half_round_style == std::round_toward_zero ? 0x03
+                                                                                  : 0x04;
+
+        XTL_TARGET("avx,f16c") inline void half_to_float_tail_f16c(const half_float* in, std::size_t size, float* out) noexcept
+        {
+            uint16_t buffer[8] = {};
+            float res[8];
+            std::memcpy(buffer, in, size * sizeof(uint16_t));
+            _mm256_storeu_ps(res, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer))));
+            std::memcpy(out, res, size * sizeof(float));
+        }
+
+        XTL_TARGET("avx,f16c") inline void float_to_half_tail_f16c(const float* in, std::size_t size, half_float* out) noexcept
+        {
+            float buffer[8] = {};
+            uint16_t res[8];
+            std::memcpy(buffer, in, size * sizeof(float));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(res), _mm256_cvtps_ph(_mm256_loadu_ps(buffer), half_round_imm));
+            std::memcpy(static_cast<void*>(out), res, size * sizeof(uint16_t));
+        }
+
+        XTL_TARGET("avx,f16c") XTL_NOINLINE void half_to_float_f16c(const half_float* in, std::size_t size, float* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+            }
+            if (i != size)
+            {
+                half_to_float_tail_f16c(in + i, size - i, out + i);
+            }
+        }
+
+        XTL_TARGET("avx,f16c") XTL_NOINLINE void float_to_half_f16c(const float* in, std::size_t size, half_float* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), half_round_imm);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+            }
+            if (i != size)
+            {
+                float_to_half_tail_f16c(in + i, size - i, out + i);
+            }
+        }
+
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE void half_to_float_avx512(const half_float* in, std::size_t size, float* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                _mm512_storeu_ps(out + i, avx512_load_ph(in + i));
+            }
+            for (; i + 8 <= size; i += 8)
+            {
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+            }
+            if (i != size)
+            {
+                half_to_float_tail_f16c(in + i, size - i, out + i);
+            }
+        }
+
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE void float_to_half_avx512(const float* in, std::size_t size, half_float* out) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                avx512_store_ph<half_round_imm>(out + i, _mm512_loadu_ps(in + i));
+            }
+            for (; i + 8 <= size; i += 8)
+            {
+                __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), half_round_imm);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+            }
+            if (i != size)
+            {
+                float_to_half_tail_f16c(in + i, size - i, out + i);
+            }
+        }
+
+#endif
+
+        /****************************
+         * half_float array kernels *
+         ****************************/
+
+        // Sums are accumulated in 16 float lanes, the element i in the lane
+        // i % 16, and the lanes are added pairwise at the end, so that all
+        // the kernels return the same value. The products of two halves are
+        // exact in single precision.
+        constexpr std::size_t half_float_lanes = 16;
+
+        inline float half_reduce_lanes(float* acc) noexcept
+        {
+            for (std::size_t step = half_float_lanes / 2; step != 0; step /= 2)
+            {
+                for (std::size_t j = 0; j < step; ++j)
+                {
+                    acc[j] += acc[j + step];
+                }
+            }
+            return acc[0];
+        }
+
+        inline void half_dot_lanes(const half_float* x, const half_float* y, std::size_t size, float* acc) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                acc[i % half_float_lanes] += half_bits_to_float(x[i].get_data()) * half_bits_to_float(y[i].get_data());
+            }
+        }
+
+        inline void half_sum_lanes(const half_float* x, std::size_t size, float* acc) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                acc[i % half_float_lanes] += half_bits_to_float(x[i].get_data());
+            }
+        }
+
+        // Unsigned key ordering the halves as their values, -0 before +0.
+        // NaNs are left out of min_key and max_key, which stay at 0xFFFF
+        // and 0 when there is no other value.
+        inline uint16_t half_order_key(uint16_t bits) noexcept
+        {
+            return static_cast<uint16_t>((bits & 0x8000) ? ~bits : bits | 0x8000);
+        }
+
+        inline void half_minmax_keys(const half_float* x, std::size_t size, uint16_t& min_key, uint16_t& max_key) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                uint16_t bits = x[i].get_data();
+                if ((bits & 0x7FFF) <= 0x7C00)
+                {
+                    uint16_t key = half_order_key(bits);
+                    min_key = key < min_key ? key : min_key;
+                    max_key = key > max_key ? key : max_key;
+                }
+            }
+        }
+
+        inline void half_add_scalar(const half_float* x, const half_float* y, std::size_t size, half_float* res)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res[i] = x[i] + y[i];
+            }
+        }
+
+        inline void half_multiply_scalar(const half_float* x, const half_float* y, std::size_t size, half_float* res)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res[i] = x[i] * y[i];
+            }
+        }
+
+        inline void half_fma_scalar(const half_float* x, const half_float* y, const half_float* z, std::size_t size, half_float* res)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res[i] = ::half_float::fma(x[i], y[i], z[i]);
+            }
+        }
+
+        inline float half_dot_scalar(const half_float* x, const half_float* y, std::size_t size) noexcept
+        {
+            float acc[half_float_lanes] = {};
+            half_dot_lanes(x, y, size, acc);
+            return half_reduce_lanes(acc);
+        }
+
+        inline float half_sum_scalar(const half_float* x, std::size_t size) noexcept
+        {
+            float acc[half_float_lanes] = {};
+            half_sum_lanes(x, size, acc);
+            return half_reduce_lanes(acc);
+        }
+
+        inline void half_minmax_scalar(const half_float* x, std::size_t size, uint16_t& min_key, uint16_t& max_key) noexcept
+        {
+            min_key = 0xFFFF;
+            max_key = 0;
+            half_minmax_keys(x, size, min_key, max_key);
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+
+        /*********************************
+         * half_float SIMD array kernels *
+         *********************************/
+
+        // The elementwise kernels compute in single precision and round once
+        // to half, which gives the results of the scalar operators: sums and
+        // products of halves rounded to float are exact or rounded finely
+        // enough (24 >= 2 * 11 + 2 bits) for the second rounding to be
+        // harmless. For fma, the float sum is rounded to odd through its
+        // TwoSum error first. They are only selected for round to nearest,
+        // NaN results may differ in their payload.
+
+        XTL_TARGET("avx2,f16c") inline __m256 half_load_avx2(const half_float* in) noexcept
+        {
+            return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+        }
+
+        XTL_TARGET("avx2,f16c") inline __m256 half_load_partial_avx2(const half_float* in, std::size_t size) noexcept
+        {
+            uint16_t buffer[8] = {};
+            std::memcpy(buffer, in, size * sizeof(uint16_t));
+            return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer)));
+        }
+
+        XTL_TARGET("avx2,f16c") inline void half_store_avx2(__m256 value, half_float* out) noexcept
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_cvtps_ph(value, half_round_imm));
+        }
+
+        XTL_TARGET("avx2,f16c") inline void half_store_partial_avx2(__m256 value, std::size_t size, half_float* out) noexcept
+        {
+            uint16_t buffer[8];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer), _mm256_cvtps_ph(value, half_round_imm));
+            std::memcpy(static_cast<void*>(out), buffer, size * sizeof(uint16_t));
+        }
+
+        // Rounds the exact x * y + z to odd: when the float sum is even and
+        // inexact, it is moved by one ulp towards the exact value.
+        XTL_TARGET("avx2,f16c") inline __m256 half_fma_block_avx2(__m256 x, __m256 y, __m256 z) noexcept
+        {
+            __m256 p = _mm256_mul_ps(x, y);
+            __m256 s = _mm256_add_ps(p, z);
+            __m256 bz = _mm256_sub_ps(s, p);
+            __m256 e = _mm256_add_ps(_mm256_sub_ps(p, _mm256_sub_ps(s, bz)), _mm256_sub_ps(z, bz));
+            __m256i s_bits = _mm256_castps_si256(s);
+            __m256i even = _mm256_cmpeq_epi32(_mm256_and_si256(s_bits, _mm256_set1_epi32(1)), _mm256_setzero_si256());
+            __m256i inexact = _mm256_castps_si256(_mm256_cmp_ps(e, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+            __m256i step = _mm256_or_si256(_mm256_srai_epi32(_mm256_xor_si256(s_bits, _mm256_castps_si256(e)), 31),
+                                           _mm256_set1_epi32(1));
+            s_bits = _mm256_add_epi32(s_bits, _mm256_and_si256(step, _mm256_and_si256(even, inexact)));
+            return _mm256_castsi256_ps(s_bits);
+        }
+
+        XTL_TARGET("avx2,f16c") XTL_NOINLINE void half_add_avx2(const half_float* x, const half_float* y, std::size_t size, half_float* res) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                half_store_avx2(_mm256_add_ps(half_load_avx2(x + i), half_load_avx2(y + i)), res + i);
+            }
+            if (i != size)
+            {
+                __m256 value = _mm256_add_ps(half_load_partial_avx2(x + i, size - i), half_load_partial_avx2(y + i, size - i));
+                half_store_partial_avx2(value, size - i, res + i);
+            }
+        }
+
+        XTL_TARGET("avx2,f16c") XTL_NOINLINE void half_multiply_avx2(const half_float* x, const half_float* y, std::size_t size, half_float* res) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                half_store_avx2(_mm256_mul_ps(half_load_avx2(x + i), half_load_avx2(y + i)), res + i);
+            }
+            if (i != size)
+            {
+                __m256 value = _mm256_mul_ps(half_load_partial_avx2(x + i, size - i), half_load_partial_avx2(y + i, size - i));
+                half_store_partial_avx2(value, size - i, res + i);
+            }
+        }
+
+        XTL_TARGET("avx2,f16c") XTL_NOINLINE void half_fma_avx2(const half_float* x, const half_float* y, const half_float* z, std::size_t size, half_float* res) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                half_store_avx2(half_fma_block_avx2(half_load_avx2(x + i), half_load_avx2(y + i), half_load_avx2(z + i)), res + i);
+            }
+            if (i != size)
+            {
+                std::size_t n = size - i;
+                __m256 value = half_fma_block_avx2(half_load_partial_avx2(x + i, n), half_load_partial_avx2(y + i, n),
+                                                   half_load_partial_avx2(z + i, n));
+                half_store_partial_avx2(value, n, res + i);
+            }
+        }
+
+        XTL_TARGET("avx2,f16c") XTL_NOINLINE float half_dot_avx2(const half_float* x, const half_float* y, std::size_t size) noexcept
+        {
+            __m256 low = _mm256_setzero_ps();
+            __m256 high = _mm256_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                low = _mm256_add_ps(low, _mm256_mul_ps(half_load_avx2(x + i), half_load_avx2(y + i)));
+                high = _mm256_add_ps(high, _mm256_mul_ps(half_load_avx2(x + i + 8), half_load_avx2(y + i + 8)));
+            }
+            float acc[half_float_lanes];
+            _mm256_storeu_ps(acc, low);
+            _mm256_storeu_ps(acc + 8, high);
+            half_dot_lanes(x + i, y + i, size - i, acc);
+            return half_reduce_lanes(acc);
+        }
+
+        XTL_TARGET("avx2,f16c") XTL_NOINLINE float half_sum_avx2(const half_float* x, std::size_t size) noexcept
+        {
+            __m256 low = _mm256_setzero_ps();
+            __m256 high = _mm256_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                low = _mm256_add_ps(low, half_load_avx2(x + i));
+                high = _mm256_add_ps(high, half_load_avx2(x + i + 8));
+            }
+            float acc[half_float_lanes];
+            _mm256_storeu_ps(acc, low);
+            _mm256_storeu_ps(acc + 8, high);
+            half_sum_lanes(x + i, size - i, acc);
+            return half_reduce_lanes(acc);
+        }
+
+        XTL_TARGET("avx2") XTL_NOINLINE void half_minmax_avx2(const half_float* x, std::size_t size, uint16_t& min_key, uint16_t& max_key) noexcept
+        {
+            __m256i vmin = _mm256_set1_epi16(-1);
+            __m256i vmax = _mm256_setzero_si256();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+                __m256i key = _mm256_xor_si256(bits, _mm256_or_si256(_mm256_srai_epi16(bits, 15), _mm256_set1_epi16(-0x8000)));
+                __m256i nan = _mm256_cmpgt_epi16(_mm256_and_si256(bits, _mm256_set1_epi16(0x7FFF)), _mm256_set1_epi16(0x7C00));
+                vmin = _mm256_min_epu16(vmin, _mm256_or_si256(key, nan));
+                vmax = _mm256_max_epu16(vmax, _mm256_andnot_si256(nan, key));
+            }
+            uint16_t mins[16];
+            uint16_t maxs[16];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), vmin);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+            min_key = 0xFFFF;
+            max_key = 0;
+            for (std::size_t j = 0; j < 16; ++j)
+            {
+                min_key = mins[j] < min_key ? mins[j] : min_key;
+                max_key = maxs[j] > max_key ? maxs[j] : max_key;
+            }
+            half_minmax_keys(x + i, size - i, min_key, max_key);
+        }
+
+        XTL_TARGET("avx512f,f16c") inline __m512 half_load_avx512(const half_float* in) noexcept
+        {
+            return avx512_load_ph(in);
+        }
+
+        XTL_TARGET("avx512f,f16c") inline void half_store_avx512(__m512 value, half_float* out) noexcept
+        {
+            avx512_store_ph<half_round_imm>(out, value);
+        }
+
+        XTL_TARGET("avx512f,f16c") inline __m512 half_fma_block_avx512(__m512 x, __m512 y, __m512 z) noexcept
+        {
+            __m512 p = _mm512_mul_ps(x, y);
+            __m512 s = _mm512_add_ps(p, z);
+            __m512 bz = _mm512_sub_ps(s, p);
+            __m512 e = _mm512_add_ps(_mm512_sub_ps(p, _mm512_sub_ps(s, bz)), _mm512_sub_ps(z, bz));
+            __m512i s_bits = _mm512_castps_si512(s);
+            __mmask16 even = _mm512_testn_epi32_mask(s_bits, _mm512_set1_epi32(1));
+            __mmask16 inexact = _mm512_cmp_ps_mask(e, _mm512_setzero_ps(), _CMP_NEQ_OQ);
+            __m512i step = _mm512_or_si512(_mm512_maskz_srai_epi32(__mmask16(0xFFFF), _mm512_xor_si512(s_bits, _mm512_castps_si512(e)), 31),
+                                           _mm512_set1_epi32(1));
+            return _mm512_castsi512_ps(_mm512_mask_add_epi32(s_bits, static_cast<__mmask16>(even & inexact), s_bits, step));
+        }
+
+        // The tails of the elementwise kernels use the 8-lane kernels
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE void half_add_avx512(const half_float* x, const half_float* y, std::size_t size, half_float* res) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                half_store_avx512(_mm512_add_ps(half_load_avx512(x + i), half_load_avx512(y + i)), res + i);
+            }
+            half_add_avx2(x + i, y + i, size - i, res + i);
+        }
+
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE void half_multiply_avx512(const half_float* x, const half_float* y, std::size_t size, half_float* res) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                half_store_avx512(_mm512_mul_ps(half_load_avx512(x + i), half_load_avx512(y + i)), res + i);
+            }
+            half_multiply_avx2(x + i, y + i, size - i, res + i);
+        }
+
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE void half_fma_avx512(const half_float* x, const half_float* y, const half_float* z, std::size_t size, half_float* res) noexcept
+        {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                half_store_avx512(half_fma_block_avx512(half_load_avx512(x + i), half_load_avx512(y + i), half_load_avx512(z + i)), res + i);
+            }
+            half_fma_avx2(x + i, y + i, z + i, size - i, res + i);
+        }
+
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE float half_dot_avx512(const half_float* x, const half_float* y, std::size_t size) noexcept
+        {
+            __m512 sum = _mm512_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                sum = _mm512_add_ps(sum, _mm512_mul_ps(half_load_avx512(x + i), half_load_avx512(y + i)));
+            }
+            float acc[half_float_lanes];
+            _mm512_storeu_ps(acc, sum);
+            half_dot_lanes(x + i, y + i, size - i, acc);
+            return half_reduce_lanes(acc);
+        }
+
+        XTL_TARGET("avx512f,f16c") XTL_NOINLINE float half_sum_avx512(const half_float* x, std::size_t size) noexcept
+        {
+            __m512 sum = _mm512_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                sum = _mm512_add_ps(sum, half_load_avx512(x + i));
+            }
+            float acc[half_float_lanes];
+            _mm512_storeu_ps(acc, sum);
+            half_sum_lanes(x + i, size - i, acc);
+            return half_reduce_lanes(acc);
+        }
+
+        XTL_TARGET("avx512f,avx512bw") XTL_NOINLINE void half_minmax_avx512(const half_float* x, std::size_t size, uint16_t& min_key, uint16_t& max_key) noexcept
+        {
+            __m512i vmin = _mm512_set1_epi16(-1);
+            __m512i vmax = _mm512_setzero_si512();
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m512i bits = _mm512_loadu_si512(reinterpret_cast<const void*>(x + i));
+                __m512i key = _mm512_xor_si512(bits, _mm512_or_si512(_mm512_maskz_srai_epi16(__mmask32(0xFFFFFFFF), bits, 15), _mm512_set1_epi16(-0x8000)));
+                __mmask32 valid = _mm512_cmple_epu16_mask(_mm512_and_si512(bits, _mm512_set1_epi16(0x7FFF)), _mm512_set1_epi16(0x7C00));
+                vmin = _mm512_mask_min_epu16(vmin, valid, vmin, key);
+                vmax = _mm512_mask_max_epu16(vmax, valid, vmax, key);
+            }
+            uint16_t mins[32];
+            uint16_t maxs[32];
+            _mm512_storeu_si512(reinterpret_cast<void*>(mins), vmin);
+            _mm512_storeu_si512(reinterpret_cast<void*>(maxs), vmax);
+            min_key = 0xFFFF;
+            max_key = 0;
+            for (std::size_t j = 0; j < 32; ++j)
+            {
+                min_key = mins[j] < min_key ? mins[j] : min_key;
+                max_key = maxs[j] > max_key ? maxs[j] : max_key;
+            }
+            half_minmax_keys(x + i, size - i, min_key, max_key);
+        }
+
+#endif
+
+        struct half_float_kernels
+        {
+            void (*to_float)(const half_float*, std::size_t, float*) noexcept;
+            void (*from_float)(const float*, std::size_t, half_float*) noexcept;
+            void (*add)(const half_float*, const half_float*, std::size_t, half_float*);
+            void (*multiply)(const half_float*, const half_float*, std::size_t, half_float*);
+            void (*fma)(const half_float*, const half_float*, const half_float*, std::size_t, half_float*);
+            float (*dot)(const half_float*, const half_float*, std::size_t) noexcept;
+            float (*sum)(const half_float*, std::size_t) noexcept;
+            void (*minmax)(const half_float*, std::size_t, uint16_t&, uint16_t&) noexcept;
+        };
+
+        inline const half_float_kernels& select_half_float_kernels() noexcept
+        {
+            static const half_float_kernels kernels = []() -> half_float_kernels {
+                half_float_kernels res = {&half_to_float_scalar, &float_to_half_scalar, &half_add_scalar,
+                                          &half_multiply_scalar, &half_fma_scalar, &half_dot_scalar,
+                                          &half_sum_scalar, &half_minmax_scalar};
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+                const cpu_features& features = available_cpu_features();
+                bool nearest = half_round_style == std::round_to_nearest;
+                if (features.f16c)
+                {
+                    res.to_float = &half_to_float_f16c;
+                    res.from_float = &float_to_half_f16c;
+                }
+                if (features.avx2)
+                {
+                    res.minmax = &half_minmax_avx2;
+                }
+                if (features.avx2 && features.f16c)
+                {
+                    res.dot = &half_dot_avx2;
+                    res.sum = &half_sum_avx2;
+                    if (nearest)
+                    {
+                        res.add = &half_add_avx2;
+                        res.multiply = &half_multiply_avx2;
+                        res.fma = &half_fma_avx2;
+                    }
+                }
+                if (features.avx512f && features.f16c)
+                {
+                    res.to_float = &half_to_float_avx512;
+                    res.from_float = &float_to_half_avx512;
+                }
+                if (features.avx512f && features.avx2 && features.f16c)
+                {
+                    res.dot = &half_dot_avx512;
+                    res.sum = &half_sum_avx512;
+                    if (nearest)
+                    {
+                        res.add = &half_add_avx512;
+                        res.multiply = &half_multiply_avx512;
+                        res.fma = &half_fma_avx512;
+                    }
+                }
+                if (features.avx512bw)
+                {
+                    res.minmax = &half_minmax_avx512;
+                }
+#endif
+                return res;
+            }();
+            return kernels;
+        }
+
+        inline half_float half_from_bits(uint16_t bits) noexcept
+        {
+            half_float res;
+            std::memcpy(static_cast<void*>(&res), &bits, sizeof(uint16_t));
+            return res;
+        }
+
+        inline void check_half_float_sizes(std::size_t size, std::size_t other_size, std::size_t res_size)
+        {
+            if (other_size != size)
+            {
+                XTL_THROW(std::invalid_argument, "half_float kernels: inputs have different sizes");
+            }
+            if (res_size < size)
+            {
+                XTL_THROW(std::length_error, "half_float kernels: output span is too small");
+            }
+        }
+
+        /*******************************
+         * half_float fast math blocks *
+         *******************************/
+
+        // Values go through a float buffer converted by the SIMD kernels, so
+        // the loop applying f only sees single precision values and is
+        // vectorized wherever the compiler has vector math functions.
+        constexpr std::size_t half_math_block_size = 256;
+
+        template <class F>
+        inline void half_fast_math_unary(const half_float* x, std::size_t size, half_float* res, F f)
+        {
+            const half_float_kernels& kernels = select_half_float_kernels();
+            float buffer[half_math_block_size];
+            for (std::size_t i = 0; i < size; i += half_math_block_size)
+            {
+                std::size_t n = std::min(half_math_block_size, size - i);
+                kernels.to_float(x + i, n, buffer);
+                for (std::size_t j = 0; j < n; ++j)
+                {
+                    buffer[j] = f(buffer[j]);
+                }
+                kernels.from_float(buffer, n, res + i);
+            }
+        }
+
+        template <class F>
+        inline void half_fast_math_binary(const half_float* x, const half_float* y, std::size_t size, half_float* res, F f)
+        {
+            const half_float_kernels& kernels = select_half_float_kernels();
+            float buffer[half_math_block_size];
+            float other[half_math_block_size];
+            for (std::size_t i = 0; i < size; i += half_math_block_size)
+            {
+                std::size_t n = std::min(half_math_block_size, size - i);
+                kernels.to_float(x + i, n, buffer);
+                kernels.to_float(y + i, n, other);
+                for (std::size_t j = 0; j < n; ++j)
+                {
+                    buffer[j] = f(buffer[j], other[j]);
+                }
+                kernels.from_float(buffer, n, res + i);
+            }
+        }
+    }
+
+    /*****************************
+     * conversion implementation *
+     *****************************/
+
+    /**
+     * Converts input to single precision, output must hold at least
+     * input.size() values.
+     */
+    inline void convert(span<const half_float> input, span<float> output)
+    {
+        if (output.size() < input.size())
+        {
+            XTL_THROW(std::length_error, "convert: output span is too small");
+        }
+        detail::select_half_float_kernels().to_float(input.data(), input.size(), output.data());
+    }
+
+    /**
+     * Converts input to half precision, rounded as HALF_ROUND_STYLE. output
+     * must hold at least input.size() values.
+     */
+    inline void convert(span<const float> input, span<half_float> output)
+    {
+        if (output.size() < input.size())
+        {
+            XTL_THROW(std::length_error, "convert: output span is too small");
+        }
+        detail::select_half_float_kernels().from_float(input.data(), input.size(), output.data());
+    }
+
+    /********************************
+     * array kernels implementation *
+     ********************************/
+
+    /**
+     * Elementwise x + y, rounded as the half_float operator. res must hold
+     * at least x.size() values and may be one of the inputs.
+     */
+    inline void add(span<const half_float> x, span<const half_float> y, span<half_float> res)
+    {
+        detail::check_half_float_sizes(x.size(), y.size(), res.size());
+        detail::select_half_float_kernels().add(x.data(), y.data(), x.size(), res.data());
+    }
+
+    /**
+     * Elementwise x * y, rounded as the half_float operator.
+     */
+    inline void multiply(span<const half_float> x, span<const half_float> y, span<half_float> res)
+    {
+        detail::check_half_float_sizes(x.size(), y.size(), res.size());
+        detail::select_half_float_kernels().multiply(x.data(), y.data(), x.size(), res.data());
+    }
+
+    /**
+     * Elementwise x * y + z, rounded once as half_float::fma.
+     */
+    inline void fma(span<const half_float> x, span<const half_float> y, span<const half_float> z, span<half_float> res)
+    {
+        detail::check_half_float_sizes(x.size(), y.size(), res.size());
+        detail::check_half_float_sizes(x.size(), z.size(), res.size());
+        detail::select_half_float_kernels().fma(x.data(), y.data(), z.data(), x.size(), res.data());
+    }
+
+    /**
+     * Dot product accumulated in single precision. The result does not
+     * depend on the instruction set, but differs from a loop on half_float
+     * values, which rounds every partial sum to half.
+     */
+    inline float dot(span<const half_float> x, span<const half_float> y)
+    {
+        detail::check_half_float_sizes(x.size(), y.size(), x.size());
+        return detail::select_half_float_kernels().dot(x.data(), y.data(), x.size());
+    }
+
+    /**
+     * Sum accumulated in single precision, as dot.
+     */
+    inline float sum(span<const half_float> x)
+    {
+        return detail::select_half_float_kernels().sum(x.data(), x.size());
+    }
+
+    /**
+     * Smallest and largest values, ignoring NaNs as fmin and fmax, with -0
+     * ordered before +0. Both are a quiet NaN if x holds no other value.
+     */
+    inline std::pair<half_float, half_float> minmax(span<const half_float> x)
+    {
+        uint16_t min_key;
+        uint16_t max_key;
+        detail::select_half_float_kernels().minmax(x.data(), x.size(), min_key, max_key);
+        if (min_key == 0xFFFF)
+        {
+            half_float nan = std::numeric_limits<half_float>::quiet_NaN();
+            return {nan, nan};
+        }
+        auto to_bits = [](uint16_t key) { return static_cast<uint16_t>((key & 0x8000) ? key ^ 0x8000 : ~key); };
+        return {detail::half_from_bits(to_bits(min_key)), detail::half_from_bits(to_bits(max_key))};
+    }
+
+    /*********************************
+     * math functions implementation *
+     *********************************/
+
+#define XTL_HALF_FLOAT_UNARY_MATH(NAME)                                                            \
+    inline half_float NAME(half_float x, half_exact_math)                                          \
+    {                                                                                              \
+        return ::half_float::NAME(x);                                                              \
+    }                                                                                              \
+                                                                                                   \
+    inline half_float NAME(half_float x, half_fast_math)                                           \
+    {                                                                                              \
+        return half_float(std::NAME(static_cast<float>(x)));                                       \
+    }                                                                                              \
+                                                                                                   \
+    inline void NAME(span<const half_float> x, span<half_float> res, half_exact_math)              \
+    {                                                                                              \
+        detail::check_half_float_sizes(x.size(), x.size(), res.size());                            \
+        for (std::size_t i = 0; i < x.size(); ++i)                                                 \
+        {                                                                                          \
+            res[i] = ::half_float::NAME(x[i]);                                                     \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    inline void NAME(span<const half_float> x, span<half_float> res, half_fast_math)               \
+    {                                                                                              \
+        detail::check_half_float_sizes(x.size(), x.size(), res.size());                            \
+        detail::half_fast_math_unary(x.data(), x.size(), res.data(),                               \
+                                     [](float v) { return std::NAME(v); });                        \
+    }
+
+#define XTL_HALF_FLOAT_BINARY_MATH(NAME)                                                           \
+    inline half_float NAME(half_float x, half_float y, half_exact_math)                            \
+    {                                                                                              \
+        return ::half_float::NAME(x, y);                                                           \
+    }                                                                                              \
+                                                                                                   \
+    inline half_float NAME(half_float x, half_float y, half_fast_math)                             \
+    {                                                                                              \
+        return half_float(std::NAME(static_cast<float>(x), static_cast<float>(y)));                \
+    }                                                                                              \
+                                                                                                   \
+    inline void NAME(span<const half_float> x, span<const half_float> y, span<half_float> res,     \
+                     half_exact_math)                                                              \
+    {                                                                                              \
+        detail::check_half_float_sizes(x.size(), y.size(), res.size());                            \
+        for (std::size_t i = 0; i < x.size(); ++i)                                                 \
+        {                                                                                          \
+            res[i] = ::half_float::NAME(x[i], y[i]);                                               \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    inline void NAME(span<const half_float> x, span<const half_float> y, span<half_float> res,     \
+                     half_fast_math)                                                               \
+    {                                                                                              \
+        detail::check_half_float_sizes(x.size(), y.size(), res.size());                            \
+        detail::half_fast_math_binary(x.data(), y.data(), x.size(), res.data(),                    \
+                                      [](float u, float v) { return std::NAME(u, v); });           \
+    }
+
+    XTL_HALF_FLOAT_UNARY_MATH(exp)
+    XTL_HALF_FLOAT_UNARY_MATH(exp2)
+    XTL_HALF_FLOAT_UNARY_MATH(expm1)
+    XTL_HALF_FLOAT_UNARY_MATH(log)
+    XTL_HALF_FLOAT_UNARY_MATH(log10)
+    XTL_HALF_FLOAT_UNARY_MATH(log2)
+    XTL_HALF_FLOAT_UNARY_MATH(log1p)
+    XTL_HALF_FLOAT_UNARY_MATH(sqrt)
+    XTL_HALF_FLOAT_UNARY_MATH(cbrt)
+    XTL_HALF_FLOAT_UNARY_MATH(sin)
+    XTL_HALF_FLOAT_UNARY_MATH(cos)
+    XTL_HALF_FLOAT_UNARY_MATH(tan)
+    XTL_HALF_FLOAT_UNARY_MATH(asin)
+    XTL_HALF_FLOAT_UNARY_MATH(acos)
+    XTL_HALF_FLOAT_UNARY_MATH(atan)
+    XTL_HALF_FLOAT_UNARY_MATH(sinh)
+    XTL_HALF_FLOAT_UNARY_MATH(cosh)
+    XTL_HALF_FLOAT_UNARY_MATH(tanh)
+    XTL_HALF_FLOAT_UNARY_MATH(asinh)
+    XTL_HALF_FLOAT_UNARY_MATH(acosh)
+    XTL_HALF_FLOAT_UNARY_MATH(atanh)
+    XTL_HALF_FLOAT_UNARY_MATH(erf)
+    XTL_HALF_FLOAT_UNARY_MATH(erfc)
+    XTL_HALF_FLOAT_UNARY_MATH(tgamma)
+    XTL_HALF_FLOAT_UNARY_MATH(lgamma)
+    XTL_HALF_FLOAT_BINARY_MATH(pow)
+    XTL_HALF_FLOAT_BINARY_MATH(atan2)
+    XTL_HALF_FLOAT_BINARY_MATH(hypot)
+
+#undef XTL_HALF_FLOAT_BINARY_MATH
+#undef XTL_HALF_FLOAT_UNARY_MATH
 }
 
 #endif
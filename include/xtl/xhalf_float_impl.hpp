@@ -43,6 +43,21 @@
 	#define constexpr_NOERR	constexpr
 #endif
 
+// support constexpr conversions between half and float
+#if defined(__has_include)
+	#if __has_include(<version>)
+		#include <version>
+	#endif
+#endif
+#if defined(__cpp_lib_bit_cast) && defined(__cpp_lib_is_constant_evaluated) && !HALF_ERRHANDLING
+	#include <bit>
+	#define HALF_ENABLE_CONSTEXPR_CONVERSION 1
+	#define constexpr_CONV	constexpr
+#else
+	#define HALF_ENABLE_CONSTEXPR_CONVERSION 0
+	#define constexpr_CONV
+#endif
+
 #include <utility>
 #include <algorithm>
 #include <istream>
@@ -179,7 +194,7 @@ namespace half_float {
 	/// half_float::half = 4.2_h;
 	/// ~~~~
 	namespace literal {
-		half operator""_h(long double);
+		constexpr_NOERR half operator""_h(long double);
 	}
 
 	/// \internal
@@ -547,26 +562,15 @@ namespace half_float {
 			return rounded<R,I>(sign+(exp<<10)+(m>>(F-10)), (m>>(F-11))&1, s|((m&((static_cast<uint32>(1)<<(F-11))-1))!=0));
 		}
 
-		/// Convert IEEE single-precision to half-precision.
-		/// Credit for this goes to [Jeroen van der Zijp](ftp://ftp.fox-toolkit.org/pub/fasthalffloatconversion.pdf).
+		/// Convert IEEE single-precision bits to half-precision.
+		/// This only uses integer operations, so it can be evaluated at compile time.
 		/// \tparam R rounding mode to use
-		/// \param value single-precision value to convert
+		/// \param fbits bits of the single-precision value to convert
 		/// \return rounded half-precision value
 		/// \exception FE_OVERFLOW on overflows
 		/// \exception FE_UNDERFLOW on underflows
 		/// \exception FE_INEXACT if value had to be rounded
-		template<std::float_round_style R> unsigned int float2half_impl(float value, true_type) {
-		#if HALF_ENABLE_F16C_INTRINSICS
-			return _mm_cvtsi128_si32(_mm_cvtps_ph(_mm_set_ss(value),
-				(R==std::round_to_nearest) ? _MM_FROUND_TO_NEAREST_INT :
-				(R==std::round_toward_zero) ? _MM_FROUND_TO_ZERO :
-				(R==std::round_toward_infinity) ? _MM_FROUND_TO_POS_INF :
-				(R==std::round_toward_neg_infinity) ? _MM_FROUND_TO_NEG_INF :
-				_MM_FROUND_CUR_DIRECTION));
-		#else
-			bits_t<float> fbits;
-			std::memcpy(&fbits, &value, sizeof(float));
-		#if 1
+		template<std::float_round_style R> constexpr_NOERR unsigned int float2half_bits(bits_t<float> fbits) {
 			unsigned int sign = (fbits>>16) & 0x8000;
 			fbits &= 0x7FFFFFFF;
 			if(fbits >= 0x7F800000)
@@ -584,6 +588,29 @@ namespace half_float {
 			if(fbits != 0)
 				return underflow<R>(sign);
 			return sign;
+		}
+
+		/// Convert IEEE single-precision to half-precision.
+		/// Credit for this goes to [Jeroen van der Zijp](ftp://ftp.fox-toolkit.org/pub/fasthalffloatconversion.pdf).
+		/// \tparam R rounding mode to use
+		/// \param value single-precision value to convert
+		/// \return rounded half-precision value
+		/// \exception FE_OVERFLOW on overflows
+		/// \exception FE_UNDERFLOW on underflows
+		/// \exception FE_INEXACT if value had to be rounded
+		template<std::float_round_style R> unsigned int float2half_impl(float value, true_type) {
+		#if HALF_ENABLE_F16C_INTRINSICS
+			return _mm_cvtsi128_si32(_mm_cvtps_ph(_mm_set_ss(value),
+				(R==std::round_to_nearest) ? _MM_FROUND_TO_NEAREST_INT :
+				(R==std::round_toward_zero) ? _MM_FROUND_TO_ZERO :
+				(R==std::round_toward_infinity) ? _MM_FROUND_TO_POS_INF :
+				(R==std::round_toward_neg_infinity) ? _MM_FROUND_TO_NEG_INF :
+				_MM_FROUND_CUR_DIRECTION));
+		#else
+			bits_t<float> fbits;
+			std::memcpy(&fbits, &value, sizeof(float));
+		#if 1
+			return float2half_bits<R>(fbits);
 		#else
 			static const uint16 base_table[512] = {
 				0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 
@@ -707,11 +734,44 @@ namespace half_float {
 		/// \exception FE_OVERFLOW on overflows
 		/// \exception FE_UNDERFLOW on underflows
 		/// \exception FE_INEXACT if value had to be rounded
-		template<std::float_round_style R,class T> unsigned int float2half(T value) {
+		template<std::float_round_style R,class T> constexpr_CONV unsigned int float2half(T value) {
+		#if HALF_ENABLE_CONSTEXPR_CONVERSION
+			if constexpr(std::is_same<T,float>::value) {
+				if(std::is_constant_evaluated())
+					return float2half_bits<R>(std::bit_cast<bits_t<float>>(value));
+			}
+		#endif
 			return float2half_impl<R>(value, bool_type<std::numeric_limits<T>::is_iec559&&sizeof(bits_t<T>)==sizeof(T)>());
 		}
-		template<class T> unsigned int float2half(T value) {
-			return float2half_impl<(std::float_round_style)(HALF_ROUND_STYLE)>(value, bool_type<std::numeric_limits<T>::is_iec559&&sizeof(bits_t<T>)==sizeof(T)>());
+		template<class T> constexpr_CONV unsigned int float2half(T value) {
+			return float2half<(std::float_round_style)(HALF_ROUND_STYLE)>(value);
+		}
+
+		/// Convert non-negative literal value to half-precision.
+		/// Same algorithm as the non-IEEE conversion, with std::frexp and std::modf replaced by exact scalings by 2, 
+		/// so it can be evaluated at compile time.
+		/// \tparam R rounding mode to use
+		/// \param value literal value to convert
+		/// \return rounded half-precision value
+		/// \exception FE_OVERFLOW on overflows
+		/// \exception FE_UNDERFLOW on underflows
+		/// \exception FE_INEXACT if value had to be rounded
+		template<std::float_round_style R> constexpr_NOERR unsigned int literal2half(long double value) {
+			if(value == 0.0L)
+				return 0;
+			if(value >= 65536.0L)
+				return overflow<R>();
+			unsigned int hbits = 0;
+			if(value < 1.0L/16384.0L)
+				value *= 33554432.0L;
+			else {
+				int shift = 0;
+				for(; value>=4096.0L; value*=0.5L,--shift) ;
+				for(; value<2048.0L; value*=2.0L,++shift) ;
+				hbits = static_cast<unsigned int>(25-shift) << 10;
+			}
+			int m = static_cast<int>(value);
+			return rounded<R,false>(hbits+static_cast<unsigned int>(m>>1), m&1, value!=static_cast<long double>(m));
 		}
 
 		/// Convert integer to half-precision floating-point.
@@ -736,6 +796,22 @@ namespace half_float {
 			return (exp>24) ? rounded<R,false>(bits, (value>>(exp-25))&1, (((1<<(exp-25))-1)&value)!=0) : bits;
 		}
 
+		/// Convert half-precision to IEEE single-precision bits.
+		/// This only uses integer operations, so it can be evaluated at compile time.
+		/// \param value half-precision value to convert
+		/// \return bits of the single-precision value
+		inline constexpr bits_t<float> half2float_bits(unsigned int value) {
+			bits_t<float> fbits = static_cast<bits_t<float>>(value&0x8000) << 16;
+			unsigned int abs = value & 0x7FFF;
+			if(abs)
+			{
+				fbits |= static_cast<bits_t<float>>(0x38000000) << static_cast<unsigned>(abs>=0x7C00);
+				for(; abs<0x400; abs<<=1,fbits-=0x800000) ;
+				fbits += static_cast<bits_t<float>>(abs) << 13;
+			}
+			return fbits;
+		}
+
 		/// Convert half-precision to IEEE single-precision.
 		/// Credit for this goes to [Jeroen van der Zijp](ftp://ftp.fox-toolkit.org/pub/fasthalffloatconversion.pdf).
 		/// \param value half-precision value to convert
@@ -745,14 +821,7 @@ namespace half_float {
 			return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(value)));
 		#else
 		#if 0
-			bits_t<float> fbits = static_cast<bits_t<float>>(value&0x8000) << 16;
-			int abs = value & 0x7FFF;
-			if(abs)
-			{
-				fbits |= 0x38000000 << static_cast<unsigned>(abs>=0x7C00);
-				for(; abs<0x400; abs<<=1,fbits-=0x800000) ;
-				fbits += static_cast<bits_t<float>>(abs) << 13;
-			}
+			bits_t<float> fbits = half2float_bits(value);
 		#else
 			static const bits_t<float> mantissa_table[2048] = {
 				0x00000000, 0x33800000, 0x34000000, 0x34400000, 0x34800000, 0x34A00000, 0x34C00000, 0x34E00000, 0x35000000, 0x35100000, 0x35200000, 0x35300000, 0x35400000, 0x35500000, 0x35600000, 0x35700000, 
@@ -943,7 +1012,13 @@ namespace half_float {
 		/// \tparam T type to convert to (builtin integer type)
 		/// \param value half-precision value to convert
 		/// \return floating-point value
-		template<class T> T half2float(unsigned int value) {
+		template<class T> constexpr_CONV T half2float(unsigned int value) {
+		#if HALF_ENABLE_CONSTEXPR_CONVERSION
+			if constexpr(std::is_same<T,float>::value) {
+				if(std::is_constant_evaluated())
+					return std::bit_cast<float>(half2float_bits(value));
+			}
+		#endif
 			return half2float_impl(value, T(), bool_type<std::numeric_limits<T>::is_iec559&&sizeof(bits_t<T>)==sizeof(T)>());
 		}
 
@@ -1605,11 +1680,11 @@ namespace half_float {
 		/// \param rhs float to convert
 		/// \exception FE_OVERFLOW, ...UNDERFLOW, ...INEXACT according to rounding
 		template<class T>
-		half(T rhs) : data_(static_cast<detail::uint16>(detail::float2half<round_style>(static_cast<float>(rhs)))) {}
+		constexpr_CONV half(T rhs) : data_(static_cast<detail::uint16>(detail::float2half<round_style>(static_cast<float>(rhs)))) {}
 
 		/// Conversion to single-precision.
 		/// \return single precision value representing expression value
-		operator float() const { return detail::half2float<float>(data_); }
+		constexpr_CONV operator float() const { return detail::half2float<float>(data_); }
 
 		/// Assignment operator.
 		/// \param rhs single-precision value to copy from
@@ -1702,7 +1777,7 @@ namespace half_float {
 		/// \exception FE_... according to operator-(half,half)
 		half operator--(int) { half out(*this); --*this; return out; }
 		/// \}
-		detail::uint16 get_data()const{ return data_; }
+		constexpr detail::uint16 get_data()const{ return data_; }
 	
 	private:
 		/// Rounding mode to use
@@ -1820,18 +1895,17 @@ namespace half_float {
 		template<class,class,std::float_round_style> friend struct detail::half_caster;
 		friend class std::numeric_limits<half>;
 		friend struct std::hash<half>;
-		friend half literal::operator""_h(long double);
+		friend constexpr_NOERR half literal::operator""_h(long double);
 	};
 
 	namespace literal {
 		/// Half literal.
-		/// While this returns a properly rounded half-precision value, half literals can unfortunately not be constant 
-		/// expressions due to rather involved conversions. So don't expect this to be a literal literal without involving 
-		/// conversion operations at runtime. It is a convenience feature, not a performance optimization.
+		/// This returns a properly rounded half-precision value and is a constant expression unless error handling is 
+		/// enabled, so tables of half literals are built at compile time.
 		/// \param value literal value
 		/// \return half with of given value (possibly rounded)
 		/// \exception FE_OVERFLOW, ...UNDERFLOW, ...INEXACT according to rounding
-		inline half operator""_h(long double value) { return half(detail::binary, detail::float2half<half::round_style>(value)); }
+		inline constexpr_NOERR half operator""_h(long double value) { return half(detail::binary, detail::literal2half<half::round_style>(value)); }
 	}
 
 	namespace detail {
@@ -4028,6 +4102,7 @@ namespace half_float {
 
 #undef HALF_UNUSED_NOERR
 #undef constexpr_NOERR
+#undef constexpr_CONV
 #undef HALF_TWOS_COMPLEMENT_INT
 #ifdef HALF_POP_WARNINGS
 	#pragma warning(pop)
@@ -10,183 +10,1307 @@
 #ifndef XTL_HASH_HPP
 #define XTL_HASH_HPP
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
 
 #include <type_traits>
+#include <utility>
+
+#include "xplatform.hpp"
+#include "xspan.hpp"
+#include "xtl_config.hpp"
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+#include <immintrin.h>
+#endif
 
 namespace xtl
 {
+    struct hash128
+    {
+        uint64_t low;
+        uint64_t high;
+    };
+
+    bool operator==(const hash128& lhs, const hash128& rhs) noexcept;
+    bool operator!=(const hash128& lhs, const hash128& rhs) noexcept;
 
     std::size_t hash_bytes(const void* buffer, std::size_t length, std::size_t seed);
+    constexpr std::size_t hash_string(std::string_view str, std::size_t seed) noexcept;
+
+    template <class T>
+    std::size_t hash_object(const T& value, std::size_t seed) noexcept;
+
+    // Hash many keys at once, with the same results as hash_bytes
+    void hash_bytes_batch(const void* keys, std::size_t key_size, span<std::size_t> out, std::size_t seed);
+    void hash_bytes_batch(span<const int32_t> offsets, const void* data, span<std::size_t> out, std::size_t seed);
+    void hash_bytes_batch(span<const int64_t> offsets, const void* data, span<std::size_t> out, std::size_t seed);
 
     uint32_t murmur2_x86(const void* buffer, std::size_t length, uint32_t seed);
     uint64_t murmur2_x64(const void* buffer, std::size_t length, uint64_t seed);
 
+    // XXH3 hashes: much faster than murmur2 on both short keys and long
+    // buffers, which are processed with SIMD instructions when available.
+    uint64_t xxh3_64(const void* buffer, std::size_t length, uint64_t seed);
+    hash128 xxh3_128(const void* buffer, std::size_t length, uint64_t seed);
+
     /******************************
      *  hash_bytes implementation *
      ******************************/
 
     namespace detail
     {
-        // Dummy hash implementation for unusual sizeof(std::size_t)
-        template <std::size_t N>
-        std::size_t murmur_hash(const void* buffer, std::size_t length, std::size_t seed)
+        // Block loads of the murmur cores. The runtime loaders read through
+        // memcpy, with an alignment hint when the input is suitably aligned;
+        // the constant-evaluation loader assembles the bytes one by one, in
+        // the native byte order so that it gives the same hashes.
+        struct unaligned_block_load
         {
-            std::size_t hash = seed;
-            const char* data = static_cast<const char*>(buffer);
-            for (; length != 0; --length)
+            template <class T>
+            static T load(const unsigned char* p) noexcept
             {
-                hash = (hash * 131) + static_cast<std::size_t>(*data++);
+                T res;
+                std::memcpy(&res, p, sizeof(T));
+                return res;
+            }
+        };
+
+        struct aligned_block_load
+        {
+            template <class T>
+            static T load(const unsigned char* p) noexcept
+            {
+                T res;
+#if defined(__GNUC__)
+                std::memcpy(&res, __builtin_assume_aligned(p, sizeof(T)), sizeof(T));
+#else
+                std::memcpy(&res, p, sizeof(T));
+#endif
+                return res;
             }
-            return hash;
+        };
+
+        struct constexpr_block_load
+        {
+            template <class T, class C>
+            static constexpr T load(const C* p) noexcept
+            {
+                T res = 0;
+                for (std::size_t i = 0; i < sizeof(T); ++i)
+                {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                    res = static_cast<T>((res << 8) | static_cast<unsigned char>(p[i]));
+#else
+                    res = static_cast<T>(res | (T(static_cast<unsigned char>(p[i])) << (8 * i)));
+#endif
+                }
+                return res;
+            }
+        };
+
+        // Little-endian load of the n < sizeof(T) trailing bytes
+        template <class T, class C>
+        constexpr T load_bytes(const C* p, std::size_t n) noexcept
+        {
+            T result = 0;
+            while (n != 0)
+            {
+                --n;
+                result = static_cast<T>((result << 8) + static_cast<unsigned char>(p[n]));
+            }
+            return result;
+        }
+
+        // Same as load_bytes with n known at compile time
+        template <class T, std::size_t N>
+        inline T load_bytes(const unsigned char* p) noexcept
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return load_bytes<T>(p, N);
+#else
+            T result = 0;
+            std::memcpy(&result, p, N);
+            return result;
+#endif
+        }
+
+        // Mixing steps shared by the one-shot, incremental and batched hashes
+        constexpr uint32_t murmur32_m = 0x5bd1e995;
+
+        constexpr uint32_t murmur32_block(uint32_t h, uint32_t k) noexcept
+        {
+            k *= murmur32_m;
+            k ^= k >> 24;
+            k *= murmur32_m;
+            h *= murmur32_m;
+            return h ^ k;
+        }
+
+        constexpr uint32_t murmur32_finalize(uint32_t h) noexcept
+        {
+            h ^= h >> 13;
+            h *= murmur32_m;
+            return h ^ (h >> 15);
+        }
+
+        constexpr uint64_t murmur64_m = (uint64_t(0xc6a4a793UL) << 32) + uint64_t(0x5bd1e995UL);
+        constexpr int murmur64_r = 47;
+
+        constexpr uint64_t murmur64_block(uint64_t hash, uint64_t k) noexcept
+        {
+            k *= murmur64_m;
+            k ^= k >> murmur64_r;
+            k *= murmur64_m;
+            return (hash ^ k) * murmur64_m;
+        }
+
+        constexpr uint64_t murmur64_finalize(uint64_t hash) noexcept
+        {
+            hash ^= hash >> murmur64_r;
+            hash *= murmur64_m;
+            return hash ^ (hash >> murmur64_r);
         }
 
         // Murmur hash is an algorithm written by Austin Appleby. See https://github.com/aappleby/smhasher/blob/master/src/MurmurHash2.cpp
-        inline uint32_t murmur2_x86_impl(const void* buffer, std::size_t length, uint32_t seed)
+        template <class L, class C>
+        constexpr uint32_t murmur2_x86_core(const C* data, std::size_t length, uint32_t seed) noexcept
         {
-            const uint32_t m = 0x5bd1e995;
             uint32_t len = static_cast<uint32_t>(length);
 
             // Initialize the hash to a 'random' value
             uint32_t h = seed ^ len;
 
             // Mix 4 bytes at a time into the hash
-            const unsigned char * data = (const unsigned char *)buffer;
-            
-            while(len >= 4)
-            {
-                uint32_t k = *(uint32_t*)data;
-                k *= m;
-                k ^= k >> 24;
-                k *= m;
-                
-                h *= m;
-                h ^= k;
-                
-                data += 4;
-                len -= 4;
-            }
-            
+            for (; len >= 4; len -= 4, data += 4)
+            {
+                h = murmur32_block(h, L::template load<uint32_t>(data));
+            }
+
             // Handle the last few bytes of the input array
-            switch(len)
+            if (len != 0)
             {
-            case 3: h ^= static_cast<uint32_t>(data[2] << 16);
-            case 2: h ^= static_cast<uint32_t>(data[1] << 8);
-            case 1: h ^= static_cast<uint32_t>(data[0]);
-                h *= m;
-            };
+                h ^= load_bytes<uint32_t>(data, len);
+                h *= murmur32_m;
+            }
 
             // Do a few final mixes of the hash to ensure the last few
-            // // bytes are well-incorporated.
-            h ^= h >> 13;
-            h *= m;
-            h ^= h >> 15;
-            
-            return h;
+            // bytes are well-incorporated.
+            return murmur32_finalize(h);
         }
 
-        template <>
-        inline std::size_t murmur_hash<4>(const void* buffer, std::size_t length, std::size_t seed)
+        // 64-bits hash for 64-bits platform
+        template <class L, class C>
+        constexpr uint64_t murmur2_x64_core(const C* data, std::size_t length, uint64_t seed) noexcept
         {
-            return std::size_t(murmur2_x86_impl(buffer, length, static_cast<uint32_t>(seed)));
+            uint64_t hash = seed ^ (length * murmur64_m);
+            for (std::size_t i = 0; i < length / 8; ++i, data += 8)
+            {
+                hash = murmur64_block(hash, L::template load<uint64_t>(data));
+            }
+            if ((length & 0x7) != 0)
+            {
+                hash = (hash ^ load_bytes<uint64_t>(data, length & 0x7)) * murmur64_m;
+            }
+            return murmur64_finalize(hash);
         }
 
-        inline std::size_t load_bytes(const char* p, int n)
+        // 64-bits hash for 32-bits platform
+        template <class L, class C>
+        constexpr uint32_t murmur2_x64b_core(const C* data, std::size_t length, uint32_t seed) noexcept
         {
-            std::size_t result = 0;
-            --n;
-            do
+            uint32_t h = seed;
+            for (std::size_t i = 0; i < length / 4; ++i, data += 4)
             {
-                result = (result << 8) + static_cast<unsigned char>(p[n]);
-            } while (--n >= 0);
-            return result;
+                h = murmur32_block(h, L::template load<uint32_t>(data));
+            }
+            h = murmur32_block(h, load_bytes<uint32_t>(data, length & 0x3));
+            h = murmur32_block(h, static_cast<uint32_t>(length));
+            return murmur32_finalize(h);
+        }
+
+        // Whether the call is part of a constant evaluation. Compilers that
+        // cannot tell always take the path usable in constant expressions.
+        constexpr bool is_constant_evaluated() noexcept
+        {
+#if defined(__cpp_lib_is_constant_evaluated)
+            return std::is_constant_evaluated();
+#elif (defined(__clang__) && __clang_major__ >= 9) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 9) \
+    || (defined(_MSC_VER) && _MSC_VER >= 1925)
+            return __builtin_is_constant_evaluated();
+#else
+            return true;
+#endif
         }
 
+        // Dispatches to the core matching sizeof(std::size_t) == N, with a
+        // dummy implementation for unusual sizes
+        template <std::size_t N, class L, class C>
+        constexpr std::size_t murmur_core(const C* data, std::size_t length, std::size_t seed) noexcept
+        {
+            if constexpr (N == 4)
+            {
+                return std::size_t(murmur2_x86_core<L>(data, length, static_cast<uint32_t>(seed)));
+            }
+            else if constexpr (N == 8)
+            {
 #if INTPTR_MAX == INT64_MAX
-        // 64-bits hash for 64-bits platform
-        template <>
-        inline std::size_t murmur_hash<8>(const void* buffer, std::size_t length, std::size_t seed)
-        {
-            constexpr std::size_t m = (static_cast<std::size_t>(0xc6a4a793UL) << 32UL) +
-                static_cast<std::size_t>(0x5bd1e995UL);
-            constexpr int r = 47;
-            const char* data = static_cast<const char*>(buffer);
-            const char* end = data + (length & std::size_t(~0x7));
-            std::size_t hash = seed ^ (length * m);
-            while (data != end)
-            {
-                std::size_t k;
-                std::memcpy(&k, data, sizeof(k));
-                k *= m;
-                k ^= k >> r;
-                k *= m;
-                hash ^= k;
-                hash *= m;
-                data += 8;
+                return static_cast<std::size_t>(murmur2_x64_core<L>(data, length, seed));
+#elif INTPTR_MAX == INT32_MAX
+                return std::size_t(murmur2_x64b_core<L>(data, length, static_cast<uint32_t>(seed)));
+#else
+#error Unknown pointer size or missing size macros!
+#endif
             }
-            if ((length & 0x7) != 0)
+            else
             {
-                std::size_t k = load_bytes(end, length & 0x7);
-                hash ^= k;
-                hash *= m;
+                std::size_t hash = seed;
+                for (; length != 0; --length)
+                {
+                    hash = (hash * 131) + static_cast<std::size_t>(static_cast<char>(*data++));
+                }
+                return hash;
             }
-            hash ^= hash >> r;
-            hash *= m;
-            hash ^= hash >> r;
+        }
 
-            return hash;
+        template <std::size_t N>
+        inline std::size_t murmur_hash(const void* buffer, std::size_t length, std::size_t seed)
+        {
+            constexpr std::size_t block_size = N == 8 && INTPTR_MAX == INT64_MAX ? 8 : 4;
+            const unsigned char* data = static_cast<const unsigned char*>(buffer);
+            if (reinterpret_cast<std::uintptr_t>(data) % block_size == 0)
+            {
+                return murmur_core<N, aligned_block_load>(data, length, seed);
+            }
+            return murmur_core<N, unaligned_block_load>(data, length, seed);
         }
-#elif INTPTR_MAX == INT32_MAX
-        //64-bits hash for 32-bits platform
-        inline void mmix(uint32_t& h, uint32_t& k, uint32_t m, int r)
+
+        // Hash of an input whose length L is a compile time constant:
+        // the blocks are mixed without a loop.
+        template <std::size_t L, std::size_t... I>
+        inline std::size_t murmur_hash_fixed(const unsigned char* data, std::size_t seed, std::index_sequence<I...>) noexcept
+        {
+#if INTPTR_MAX == INT64_MAX
+            uint64_t hash = seed ^ (L * murmur64_m);
+            ((hash = murmur64_block(hash, unaligned_block_load::load<uint64_t>(data + 8 * I))), ...);
+            if constexpr ((L & 0x7) != 0)
+            {
+                hash = (hash ^ load_bytes<uint64_t, (L & 0x7)>(data + (L & ~std::size_t(0x7)))) * murmur64_m;
+            }
+            return static_cast<std::size_t>(murmur64_finalize(hash));
+#else
+            return murmur_core<sizeof(std::size_t), unaligned_block_load>(data, L, seed);
+#endif
+        }
+
+        template <std::size_t L>
+        inline std::size_t murmur_hash_fixed(const unsigned char* data, std::size_t seed) noexcept
         {
-            k *= m; k ^= k >> r; k *= m; h *= m; h ^= k;
+            return murmur_hash_fixed<L>(data, seed, std::make_index_sequence<L / 8>());
         }
+    }
+
+    /****************************
+     * streaming murmur2 states *
+     ****************************/
+
+    namespace detail
+    {
+        // Splits a stream of bytes into blocks of B bytes, keeping the
+        // incomplete trailing block between two calls to update.
+        template <std::size_t B>
+        class hash_block_buffer
+        {
+        public:
+
+            template <class F>
+            void update(const unsigned char* data, std::size_t length, F&& process)
+            {
+                if (length == 0)
+                {
+                    return;
+                }
+                if (m_tail_size != 0)
+                {
+                    std::size_t n = B - m_tail_size < length ? B - m_tail_size : length;
+                    std::memcpy(m_tail + m_tail_size, data, n);
+                    m_tail_size += n;
+                    data += n;
+                    length -= n;
+                    if (m_tail_size != B)
+                    {
+                        return;
+                    }
+                    process(m_tail);
+                    m_tail_size = 0;
+                }
+                const unsigned char* end = data + (length - length % B);
+                for (; data != end; data += B)
+                {
+                    process(data);
+                }
+                m_tail_size = length % B;
+                if (m_tail_size != 0)
+                {
+                    std::memcpy(m_tail, data, m_tail_size);
+                }
+            }
+
+            const unsigned char* tail() const noexcept
+            {
+                return m_tail;
+            }
+
+            std::size_t tail_size() const noexcept
+            {
+                return m_tail_size;
+            }
+
+        private:
+
+            unsigned char m_tail[B] = {};
+            std::size_t m_tail_size = 0;
+        };
+
+        // Incremental counterparts of murmur_hash<N>
+        template <std::size_t N>
+        class murmur_state
+        {
+        public:
+
+            murmur_state(std::size_t, std::size_t seed) noexcept
+                : m_hash(seed)
+            {
+            }
+
+            void update(const unsigned char* data, std::size_t length) noexcept
+            {
+                for (; length != 0; --length)
+                {
+                    m_hash = (m_hash * 131) + static_cast<std::size_t>(static_cast<char>(*data++));
+                }
+            }
+
+            std::size_t finalize() const noexcept
+            {
+                return m_hash;
+            }
+
+        private:
+
+            std::size_t m_hash;
+        };
 
         template <>
-        inline std::size_t murmur_hash<8>(const void* buffer, std::size_t length, std::size_t seed)
+        class murmur_state<4>
         {
-            const uint32_t m = 0x5bd1e995;
-            const int r = 24;
-            uint32_t l = length;
+        public:
 
-            const auto* data = reinterpret_cast<const unsigned char*>(buffer);
+            murmur_state(std::size_t length, std::size_t seed) noexcept
+                : m_hash(static_cast<uint32_t>(seed) ^ static_cast<uint32_t>(length))
+            {
+            }
 
-            uint32_t h = seed;
+            void update(const unsigned char* data, std::size_t length) noexcept
+            {
+                uint32_t& h = m_hash;
+                m_buffer.update(data, length, [&h](const unsigned char* block) {
+                    h = murmur32_block(h, unaligned_block_load::load<uint32_t>(block));
+                });
+            }
 
-            while (length >= 4)
+            std::size_t finalize() const noexcept
             {
-                uint32_t k = *(uint32_t*)data;
+                uint32_t h = m_hash;
+                if (m_buffer.tail_size() != 0)
+                {
+                    h ^= load_bytes<uint32_t>(m_buffer.tail(), m_buffer.tail_size());
+                    h *= murmur32_m;
+                }
+                return std::size_t(murmur32_finalize(h));
+            }
+
+        private:
 
-                mmix(h, k, m, r);
+            hash_block_buffer<4> m_buffer;
+            uint32_t m_hash;
+        };
+
+#if INTPTR_MAX == INT64_MAX
+        template <>
+        class murmur_state<8>
+        {
+        public:
 
-                data += 4;
-                length -= 4;
+            murmur_state(std::size_t length, std::size_t seed) noexcept
+                : m_hash(seed ^ (length * murmur64_m))
+            {
             }
 
-            uint32_t t = 0;
+            void update(const unsigned char* data, std::size_t length) noexcept
+            {
+                uint64_t& hash = m_hash;
+                m_buffer.update(data, length, [&hash](const unsigned char* block) {
+                    hash = murmur64_block(hash, unaligned_block_load::load<uint64_t>(block));
+                });
+            }
 
-            switch (length)
+            std::size_t finalize() const noexcept
             {
-            case 3: t ^= data[2] << 16;
-            case 2: t ^= data[1] << 8;
-            case 1: t ^= data[0];
-            };
+                uint64_t hash = m_hash;
+                if (m_buffer.tail_size() != 0)
+                {
+                    hash = (hash ^ load_bytes<uint64_t>(m_buffer.tail(), m_buffer.tail_size())) * murmur64_m;
+                }
+                return static_cast<std::size_t>(murmur64_finalize(hash));
+            }
 
-            mmix(h, t, m, r);
-            mmix(h, l, m, r);
+        private:
 
-            h ^= h >> 13;
-            h *= m;
-            h ^= h >> 15;
+            hash_block_buffer<8> m_buffer;
+            uint64_t m_hash;
+        };
+#elif INTPTR_MAX == INT32_MAX
+        template <>
+        class murmur_state<8>
+        {
+        public:
+
+            murmur_state(std::size_t length, std::size_t seed) noexcept
+                : m_hash(static_cast<uint32_t>(seed)), m_length(static_cast<uint32_t>(length))
+            {
+            }
+
+            void update(const unsigned char* data, std::size_t length) noexcept
+            {
+                uint32_t& h = m_hash;
+                m_buffer.update(data, length, [&h](const unsigned char* block) {
+                    h = murmur32_block(h, unaligned_block_load::load<uint32_t>(block));
+                });
+            }
+
+            std::size_t finalize() const noexcept
+            {
+                uint32_t h = murmur32_block(m_hash, load_bytes<uint32_t>(m_buffer.tail(), m_buffer.tail_size()));
+                h = murmur32_block(h, m_length);
+                return murmur32_finalize(h);
+            }
+
+        private:
+
+            hash_block_buffer<4> m_buffer;
+            uint32_t m_hash;
+            uint32_t m_length;
+        };
+#endif
+    }
+
+    /*************************************
+     * batched hash_bytes implementation *
+     *************************************/
+
+    namespace detail
+    {
+        using hash_batch_function = void (*)(const unsigned char*, std::size_t*, std::size_t, std::size_t);
+
+        template <std::size_t K>
+        inline void hash_fixed_batch_scalar(const unsigned char* keys, std::size_t* out, std::size_t count, std::size_t seed) noexcept
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                out[i] = murmur_hash_fixed<K>(keys + i * K, seed);
+            }
+        }
+
+#if INTPTR_MAX == INT64_MAX && defined(XTL_X86_RUNTIME_DISPATCH)
+        // Eight or four keys are hashed in parallel, one per 64-bit lane.
+        // The keys are split in the same 8-byte blocks as in murmur_hash<8>,
+        // which the blocks of the different keys go through side by side.
+
+        XTL_TARGET("avx512f,avx512dq") inline __m512i murmur64_mix_avx512(__m512i h, __m512i k, __m512i m) noexcept
+        {
+            k = _mm512_maskz_mullo_epi64(0xFF, k, m);
+            k = _mm512_xor_si512(k, _mm512_maskz_srli_epi64(0xFF, k, 47));
+            k = _mm512_maskz_mullo_epi64(0xFF, k, m);
+            return _mm512_maskz_mullo_epi64(0xFF, _mm512_xor_si512(h, k), m);
+        }
+
+        template <std::size_t K>
+        XTL_TARGET("avx512f,avx512dq") XTL_NOINLINE void hash_fixed_batch_avx512(const unsigned char* keys, std::size_t* out, std::size_t count, std::size_t seed) noexcept
+        {
+            const __m512i m = _mm512_set1_epi64(static_cast<long long>(murmur64_m));
+            const __m512i h0 = _mm512_set1_epi64(static_cast<long long>(seed ^ (K * murmur64_m)));
+            const __m512i even = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+            const __m512i odd = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const unsigned char* p = keys + i * K;
+                __m512i h;
+                if constexpr (K == 4)
+                {
+                    // Short keys are a tail block: no premixing
+                    __m512i k = _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+                    h = _mm512_maskz_mullo_epi64(0xFF, _mm512_xor_si512(h0, k), m);
+                }
+                else if constexpr (K == 8)
+                {
+                    h = murmur64_mix_avx512(h0, _mm512_loadu_si512(p), m);
+                }
+                else
+                {
+                    __m512i lo = _mm512_loadu_si512(p);
+                    __m512i hi = _mm512_loadu_si512(p + 64);
+                    h = murmur64_mix_avx512(h0, _mm512_maskz_permutex2var_epi64(0xFF, lo, even, hi), m);
+                    h = murmur64_mix_avx512(h, _mm512_maskz_permutex2var_epi64(0xFF, lo, odd, hi), m);
+                }
+                h = _mm512_xor_si512(h, _mm512_maskz_srli_epi64(0xFF, h, 47));
+                h = _mm512_maskz_mullo_epi64(0xFF, h, m);
+                h = _mm512_xor_si512(h, _mm512_maskz_srli_epi64(0xFF, h, 47));
+                _mm512_storeu_si512(out + i, h);
+            }
+            hash_fixed_batch_scalar<K>(keys + i * K, out + i, count - i, seed);
+        }
+
+        // AVX2 has no 64-bit multiplication: it is built from three 32-bit ones
+        XTL_TARGET("avx2") inline __m256i murmur64_mul_avx2(__m256i a, __m256i m, __m256i m_high) noexcept
+        {
+            __m256i low = _mm256_mul_epu32(a, m);
+            __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), m), _mm256_mul_epu32(a, m_high));
+            return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+        }
+
+        XTL_TARGET("avx2") inline __m256i murmur64_mix_avx2(__m256i h, __m256i k, __m256i m, __m256i m_high) noexcept
+        {
+            k = murmur64_mul_avx2(k, m, m_high);
+            k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 47));
+            k = murmur64_mul_avx2(k, m, m_high);
+            return murmur64_mul_avx2(_mm256_xor_si256(h, k), m, m_high);
+        }
+
+        template <std::size_t K>
+        XTL_TARGET("avx2") XTL_NOINLINE void hash_fixed_batch_avx2(const unsigned char* keys, std::size_t* out, std::size_t count, std::size_t seed) noexcept
+        {
+            const __m256i m = _mm256_set1_epi64x(static_cast<long long>(murmur64_m));
+            const __m256i m_high = _mm256_set1_epi64x(static_cast<long long>(murmur64_m >> 32));
+            const __m256i h0 = _mm256_set1_epi64x(static_cast<long long>(seed ^ (K * murmur64_m)));
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const unsigned char* p = keys + i * K;
+                __m256i h;
+                if constexpr (K == 4)
+                {
+                    __m256i k = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+                    h = murmur64_mul_avx2(_mm256_xor_si256(h0, k), m, m_high);
+                }
+                else if constexpr (K == 8)
+                {
+                    h = murmur64_mix_avx2(h0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), m, m_high);
+                }
+                else
+                {
+                    // Lanes hold the keys in the order 0, 2, 1, 3
+                    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+                    h = murmur64_mix_avx2(h0, _mm256_unpacklo_epi64(lo, hi), m, m_high);
+                    h = murmur64_mix_avx2(h, _mm256_unpackhi_epi64(lo, hi), m, m_high);
+                    h = _mm256_permute4x64_epi64(h, 0xD8);
+                }
+                h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 47));
+                h = murmur64_mul_avx2(h, m, m_high);
+                h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 47));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+            }
+            hash_fixed_batch_scalar<K>(keys + i * K, out + i, count - i, seed);
+        }
+#endif
+
+        template <std::size_t K>
+        inline hash_batch_function select_hash_fixed_batch() noexcept
+        {
+#if INTPTR_MAX == INT64_MAX && defined(XTL_X86_RUNTIME_DISPATCH)
+            static const hash_batch_function kernel = []() -> hash_batch_function {
+                const cpu_features& features = available_cpu_features();
+                if (features.avx512dq)
+                {
+                    return &hash_fixed_batch_avx512<K>;
+                }
+                if (features.avx2)
+                {
+                    return &hash_fixed_batch_avx2<K>;
+                }
+                return &hash_fixed_batch_scalar<K>;
+            }();
+            return kernel;
+#else
+            return &hash_fixed_batch_scalar<K>;
+#endif
+        }
+
+        template <class O>
+        inline void hash_string_batch(span<const O> offsets, const void* data, span<std::size_t> out, std::size_t seed)
+        {
+            if (offsets.size() != out.size() + 1)
+            {
+                XTL_THROW(std::length_error, "hash_bytes_batch: offsets must have one more element than out");
+            }
+            const unsigned char* chars = static_cast<const unsigned char*>(data);
+            const O* bounds = offsets.data();
+            // Checked before hashing so that bad offsets leave out untouched
+            if (bounds[0] < O(0) || !std::is_sorted(bounds, bounds + offsets.size()))
+            {
+                XTL_THROW(std::length_error, "hash_bytes_batch: offsets must be non-negative and non-decreasing");
+            }
+            std::size_t* res = out.data();
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                std::size_t begin = static_cast<std::size_t>(bounds[i]);
+                std::size_t end = static_cast<std::size_t>(bounds[i + 1]);
+                res[i] = murmur_hash<sizeof(std::size_t)>(chars + begin, end - begin, seed);
+            }
+        }
+    }
+
+    /***********
+     * xhasher *
+     ***********/
+
+    /**
+     * Incremental computation of hash_bytes.
+     *
+     * The data is fed in any number of chunks with update, which does not
+     * copy it; finalize then returns the value hash_bytes would return for
+     * the concatenation of the chunks. murmur2 mixes the total length into
+     * its initial state, hence this length must be given at construction.
+     */
+    class xhasher
+    {
+    public:
+
+        xhasher(std::size_t length, std::size_t seed) noexcept;
+
+        xhasher& update(const void* buffer, std::size_t length);
+        std::size_t finalize() const;
+
+    private:
+
+        detail::murmur_state<sizeof(std::size_t)> m_state;
+        std::size_t m_remaining;
+    };
+
+    /***********************
+     * xxh3 implementation *
+     ***********************/
+
+    namespace detail
+    {
+        // XXH3 is an algorithm written by Yann Collet. See https://github.com/Cyan4973/xxHash
+        // The functions below produce the same values as XXH3_64bits_withSeed
+        // and XXH3_128bits_withSeed with the default secret.
+
+        constexpr uint32_t xxh_prime32_1 = 0x9E3779B1U;
+        constexpr uint32_t xxh_prime32_2 = 0x85EBCA77U;
+        constexpr uint32_t xxh_prime32_3 = 0xC2B2AE3DU;
+        constexpr uint64_t xxh_prime64_1 = 0x9E3779B185EBCA87ULL;
+        constexpr uint64_t xxh_prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr uint64_t xxh_prime64_3 = 0x165667B19E3779F9ULL;
+        constexpr uint64_t xxh_prime64_4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr uint64_t xxh_prime64_5 = 0x27D4EB2F165667C5ULL;
+        constexpr uint64_t xxh_prime_mx1 = 0x165667919E3779F9ULL;
+        constexpr uint64_t xxh_prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+        constexpr std::size_t xxh3_secret_size = 192;
+        constexpr std::size_t xxh3_stripe_size = 64;
+        constexpr std::size_t xxh3_secret_consume_rate = 8;
+        constexpr std::size_t xxh3_stripes_per_block = (xxh3_secret_size - xxh3_stripe_size) / xxh3_secret_consume_rate;
+        constexpr std::size_t xxh3_block_size = xxh3_stripe_size * xxh3_stripes_per_block;
+        constexpr std::size_t xxh3_midsize_max = 240;
+
+        alignas(64) constexpr unsigned char xxh3_default_secret[xxh3_secret_size] = {
+            0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+            0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+            0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+            0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+            0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+            0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+            0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+            0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+            0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+            0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+            0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+            0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+        };
+
+        inline uint32_t xxh_swap32(uint32_t x) noexcept
+        {
+            return ((x << 24) & 0xff000000U) | ((x << 8) & 0x00ff0000U) | ((x >> 8) & 0x0000ff00U) | ((x >> 24) & 0x000000ffU);
+        }
+
+        inline uint64_t xxh_swap64(uint64_t x) noexcept
+        {
+            return (uint64_t(xxh_swap32(static_cast<uint32_t>(x))) << 32) | uint64_t(xxh_swap32(static_cast<uint32_t>(x >> 32)));
+        }
+
+        inline uint32_t xxh_read32(const unsigned char* p) noexcept
+        {
+            uint32_t res;
+            std::memcpy(&res, p, sizeof(res));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            res = xxh_swap32(res);
+#endif
+            return res;
+        }
 
+        inline uint64_t xxh_read64(const unsigned char* p) noexcept
+        {
+            uint64_t res;
+            std::memcpy(&res, p, sizeof(res));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            res = xxh_swap64(res);
+#endif
+            return res;
+        }
+
+        inline void xxh_write64(unsigned char* p, uint64_t value) noexcept
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = xxh_swap64(value);
+#endif
+            std::memcpy(p, &value, sizeof(value));
+        }
+
+        inline uint64_t xxh_rotl64(uint64_t x, int r) noexcept
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline hash128 xxh_mult64to128(uint64_t lhs, uint64_t rhs) noexcept
+        {
+#if defined(__SIZEOF_INT128__)
+            __extension__ using uint128_type = unsigned __int128;
+            uint128_type product = uint128_type(lhs) * uint128_type(rhs);
+            return {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+#else
+            uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+            uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+            uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+            uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+            uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+            uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+            uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+            return {lower, upper};
+#endif
+        }
+
+        inline uint64_t xxh_mul128_fold64(uint64_t lhs, uint64_t rhs) noexcept
+        {
+            hash128 product = xxh_mult64to128(lhs, rhs);
+            return product.low ^ product.high;
+        }
+
+        inline uint64_t xxh64_avalanche(uint64_t h) noexcept
+        {
+            h ^= h >> 33;
+            h *= xxh_prime64_2;
+            h ^= h >> 29;
+            h *= xxh_prime64_3;
+            h ^= h >> 32;
+            return h;
+        }
+
+        inline uint64_t xxh3_avalanche(uint64_t h) noexcept
+        {
+            h ^= h >> 37;
+            h *= xxh_prime_mx1;
+            h ^= h >> 32;
             return h;
         }
+
+        inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t length) noexcept
+        {
+            h ^= xxh_rotl64(h, 49) ^ xxh_rotl64(h, 24);
+            h *= xxh_prime_mx2;
+            h ^= (h >> 35) + length;
+            h *= xxh_prime_mx2;
+            return h ^ (h >> 28);
+        }
+
+        inline uint64_t xxh3_mix16(const unsigned char* input, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            return xxh_mul128_fold64(xxh_read64(input) ^ (xxh_read64(secret) + seed),
+                                     xxh_read64(input + 8) ^ (xxh_read64(secret + 8) - seed));
+        }
+
+        inline void xxh3_mix32(hash128& acc, const unsigned char* input1, const unsigned char* input2,
+                               const unsigned char* secret, uint64_t seed) noexcept
+        {
+            acc.low += xxh3_mix16(input1, secret, seed);
+            acc.low ^= xxh_read64(input2) + xxh_read64(input2 + 8);
+            acc.high += xxh3_mix16(input2, secret + 16, seed);
+            acc.high ^= xxh_read64(input1) + xxh_read64(input1 + 8);
+        }
+
+        /***************************
+         * xxh3 long input kernels *
+         ***************************/
+
+        // The long input loop keeps 8 64-bit accumulators. accumulate mixes
+        // stripe_count stripes of 64 bytes into them, scramble is applied
+        // after each block of xxh3_block_size bytes.
+
+        inline void xxh3_accumulate_scalar(uint64_t* acc, const unsigned char* input, const unsigned char* secret, std::size_t stripe_count) noexcept
+        {
+            for (std::size_t n = 0; n < stripe_count; ++n)
+            {
+                const unsigned char* in = input + n * xxh3_stripe_size;
+                const unsigned char* sec = secret + n * xxh3_secret_consume_rate;
+                for (std::size_t i = 0; i < 8; ++i)
+                {
+                    uint64_t data_val = xxh_read64(in + 8 * i);
+                    uint64_t data_key = data_val ^ xxh_read64(sec + 8 * i);
+                    acc[i ^ 1] += data_val;
+                    acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+                }
+            }
+        }
+
+        inline void xxh3_scramble_scalar(uint64_t* acc, const unsigned char* secret) noexcept
+        {
+            for (std::size_t i = 0; i < 8; ++i)
+            {
+                uint64_t a = acc[i];
+                a ^= a >> 47;
+                a ^= xxh_read64(secret + 8 * i);
+                a *= xxh_prime32_1;
+                acc[i] = a;
+            }
+        }
+
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        XTL_TARGET("sse2") inline void xxh3_accumulate_sse2(uint64_t* acc, const unsigned char* input, const unsigned char* secret, std::size_t stripe_count) noexcept
+        {
+            __m128i a[4];
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+            }
+            for (std::size_t n = 0; n < stripe_count; ++n)
+            {
+                const __m128i* in = reinterpret_cast<const __m128i*>(input + n * xxh3_stripe_size);
+                const __m128i* sec = reinterpret_cast<const __m128i*>(secret + n * xxh3_secret_consume_rate);
+                for (std::size_t i = 0; i < 4; ++i)
+                {
+                    __m128i data_vec = _mm_loadu_si128(in + i);
+                    __m128i data_key = _mm_xor_si128(data_vec, _mm_loadu_si128(sec + i));
+                    __m128i product = _mm_mul_epu32(data_key, _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)));
+                    __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+                    a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, data_swap));
+                }
+            }
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, a[i]);
+            }
+        }
+
+        XTL_TARGET("sse2") inline void xxh3_scramble_sse2(uint64_t* acc, const unsigned char* secret) noexcept
+        {
+            const __m128i prime = _mm_set1_epi32(static_cast<int>(xxh_prime32_1));
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+                a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+                a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+                __m128i product_lo = _mm_mul_epu32(a, prime);
+                __m128i product_hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32)));
+            }
+        }
+
+        XTL_TARGET("avx2") inline void xxh3_accumulate_avx2(uint64_t* acc, const unsigned char* input, const unsigned char* secret, std::size_t stripe_count) noexcept
+        {
+            __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+            __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + 1);
+            for (std::size_t n = 0; n < stripe_count; ++n)
+            {
+                const __m256i* in = reinterpret_cast<const __m256i*>(input + n * xxh3_stripe_size);
+                const __m256i* sec = reinterpret_cast<const __m256i*>(secret + n * xxh3_secret_consume_rate);
+                __m256i data0 = _mm256_loadu_si256(in);
+                __m256i data1 = _mm256_loadu_si256(in + 1);
+                __m256i key0 = _mm256_xor_si256(data0, _mm256_loadu_si256(sec));
+                __m256i key1 = _mm256_xor_si256(data1, _mm256_loadu_si256(sec + 1));
+                __m256i product0 = _mm256_mul_epu32(key0, _mm256_srli_epi64(key0, 32));
+                __m256i product1 = _mm256_mul_epu32(key1, _mm256_srli_epi64(key1, 32));
+                a0 = _mm256_add_epi64(a0, _mm256_add_epi64(product0, _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2))));
+                a1 = _mm256_add_epi64(a1, _mm256_add_epi64(product1, _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2))));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), a0);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + 1, a1);
+        }
+
+        XTL_TARGET("avx2") inline void xxh3_scramble_avx2(uint64_t* acc, const unsigned char* secret) noexcept
+        {
+            const __m256i prime = _mm256_set1_epi32(static_cast<int>(xxh_prime32_1));
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+                a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+                a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+                __m256i product_lo = _mm256_mul_epu32(a, prime);
+                __m256i product_hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, _mm256_add_epi64(product_lo, _mm256_slli_epi64(product_hi, 32)));
+            }
+        }
+
+        // The zero-masked AVX-512 intrinsics avoid spurious uninitialized
+        // warnings with GCC 12.
+        XTL_TARGET("avx512f") inline void xxh3_accumulate_avx512(uint64_t* acc, const unsigned char* input, const unsigned char* secret, std::size_t stripe_count) noexcept
+        {
+            __m512i a = _mm512_loadu_si512(acc);
+            for (std::size_t n = 0; n < stripe_count; ++n)
+            {
+                __m512i data = _mm512_loadu_si512(input + n * xxh3_stripe_size);
+                __m512i key = _mm512_xor_si512(data, _mm512_loadu_si512(secret + n * xxh3_secret_consume_rate));
+                __m512i product = _mm512_maskz_mul_epu32(0xFF, key, _mm512_maskz_srli_epi64(0xFF, key, 32));
+                a = _mm512_add_epi64(a, _mm512_add_epi64(product, _mm512_maskz_shuffle_epi32(0xFFFF, data, _MM_PERM_BADC)));
+            }
+            _mm512_storeu_si512(acc, a);
+        }
+
+        XTL_TARGET("avx512f") inline void xxh3_scramble_avx512(uint64_t* acc, const unsigned char* secret) noexcept
+        {
+            const __m512i prime = _mm512_set1_epi32(static_cast<int>(xxh_prime32_1));
+            __m512i a = _mm512_loadu_si512(acc);
+            a = _mm512_xor_si512(a, _mm512_maskz_srli_epi64(0xFF, a, 47));
+            a = _mm512_xor_si512(a, _mm512_loadu_si512(secret));
+            __m512i product_lo = _mm512_maskz_mul_epu32(0xFF, a, prime);
+            __m512i product_hi = _mm512_maskz_mul_epu32(0xFF, _mm512_maskz_srli_epi64(0xFF, a, 32), prime);
+            _mm512_storeu_si512(acc, _mm512_add_epi64(product_lo, _mm512_maskz_slli_epi64(0xFF, product_hi, 32)));
+        }
+#endif
+
+        struct xxh3_kernels
+        {
+            void (*accumulate)(uint64_t*, const unsigned char*, const unsigned char*, std::size_t) noexcept;
+            void (*scramble)(uint64_t*, const unsigned char*) noexcept;
+        };
+
+        inline const xxh3_kernels& select_xxh3_kernels() noexcept
+        {
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            static const xxh3_kernels kernels = []() -> xxh3_kernels {
+                const cpu_features& features = available_cpu_features();
+                if (features.avx512f)
+                {
+                    return {&xxh3_accumulate_avx512, &xxh3_scramble_avx512};
+                }
+                if (features.avx2)
+                {
+                    return {&xxh3_accumulate_avx2, &xxh3_scramble_avx2};
+                }
+                return {&xxh3_accumulate_sse2, &xxh3_scramble_sse2};
+            }();
 #else
-#error Unknown pointer size or missing size macros!
+            static const xxh3_kernels kernels = {&xxh3_accumulate_scalar, &xxh3_scramble_scalar};
 #endif
+            return kernels;
+        }
+
+        inline void xxh3_init_accumulators(uint64_t* acc) noexcept
+        {
+            acc[0] = xxh_prime32_3;
+            acc[1] = xxh_prime64_1;
+            acc[2] = xxh_prime64_2;
+            acc[3] = xxh_prime64_3;
+            acc[4] = xxh_prime64_4;
+            acc[5] = xxh_prime32_2;
+            acc[6] = xxh_prime64_5;
+            acc[7] = xxh_prime32_1;
+        }
+
+        // Fills secret with the default secret adjusted by seed
+        inline void xxh3_init_secret(unsigned char* secret, uint64_t seed) noexcept
+        {
+            for (std::size_t i = 0; i < xxh3_secret_size; i += 16)
+            {
+                xxh_write64(secret + i, xxh_read64(xxh3_default_secret + i) + seed);
+                xxh_write64(secret + i + 8, xxh_read64(xxh3_default_secret + i + 8) - seed);
+            }
+        }
+
+        inline void xxh3_hash_long(uint64_t* acc, const unsigned char* input, std::size_t length, const unsigned char* secret) noexcept
+        {
+            const xxh3_kernels& kernels = select_xxh3_kernels();
+            xxh3_init_accumulators(acc);
+            std::size_t block_count = (length - 1) / xxh3_block_size;
+            for (std::size_t n = 0; n < block_count; ++n)
+            {
+                kernels.accumulate(acc, input + n * xxh3_block_size, secret, xxh3_stripes_per_block);
+                kernels.scramble(acc, secret + xxh3_secret_size - xxh3_stripe_size);
+            }
+            std::size_t stripe_count = ((length - 1) - xxh3_block_size * block_count) / xxh3_stripe_size;
+            kernels.accumulate(acc, input + block_count * xxh3_block_size, secret, stripe_count);
+            // Last stripe, which may overlap the previous one
+            kernels.accumulate(acc, input + length - xxh3_stripe_size, secret + xxh3_secret_size - xxh3_stripe_size - 7, 1);
+        }
+
+        inline uint64_t xxh3_merge_accumulators(const uint64_t* acc, const unsigned char* secret, uint64_t start) noexcept
+        {
+            uint64_t res = start;
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                res += xxh_mul128_fold64(acc[2 * i] ^ xxh_read64(secret + 16 * i), acc[2 * i + 1] ^ xxh_read64(secret + 16 * i + 8));
+            }
+            return xxh3_avalanche(res);
+        }
+
+        /****************
+         * xxh3 64 bits *
+         ****************/
+
+        inline uint64_t xxh3_64_0to16(const unsigned char* input, std::size_t length, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            if (length > 8)
+            {
+                uint64_t bitflip1 = (xxh_read64(secret + 24) ^ xxh_read64(secret + 32)) + seed;
+                uint64_t bitflip2 = (xxh_read64(secret + 40) ^ xxh_read64(secret + 48)) - seed;
+                uint64_t input_lo = xxh_read64(input) ^ bitflip1;
+                uint64_t input_hi = xxh_read64(input + length - 8) ^ bitflip2;
+                uint64_t acc = length + xxh_swap64(input_lo) + input_hi + xxh_mul128_fold64(input_lo, input_hi);
+                return xxh3_avalanche(acc);
+            }
+            if (length >= 4)
+            {
+                seed ^= uint64_t(xxh_swap32(static_cast<uint32_t>(seed))) << 32;
+                uint64_t input1 = xxh_read32(input);
+                uint64_t input2 = xxh_read32(input + length - 4);
+                uint64_t bitflip = (xxh_read64(secret + 8) ^ xxh_read64(secret + 16)) - seed;
+                uint64_t input64 = input2 + (input1 << 32);
+                return xxh3_rrmxmx(input64 ^ bitflip, length);
+            }
+            if (length > 0)
+            {
+                uint32_t combined = (uint32_t(input[0]) << 16) | (uint32_t(input[length >> 1]) << 24)
+                                  | uint32_t(input[length - 1]) | (static_cast<uint32_t>(length) << 8);
+                uint64_t bitflip = (uint64_t(xxh_read32(secret)) ^ uint64_t(xxh_read32(secret + 4))) + seed;
+                return xxh64_avalanche(uint64_t(combined) ^ bitflip);
+            }
+            return xxh64_avalanche(seed ^ (xxh_read64(secret + 56) ^ xxh_read64(secret + 64)));
+        }
+
+        inline uint64_t xxh3_64_17to128(const unsigned char* input, std::size_t length, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            uint64_t acc = length * xxh_prime64_1;
+            if (length > 32)
+            {
+                if (length > 64)
+                {
+                    if (length > 96)
+                    {
+                        acc += xxh3_mix16(input + 48, secret + 96, seed);
+                        acc += xxh3_mix16(input + length - 64, secret + 112, seed);
+                    }
+                    acc += xxh3_mix16(input + 32, secret + 64, seed);
+                    acc += xxh3_mix16(input + length - 48, secret + 80, seed);
+                }
+                acc += xxh3_mix16(input + 16, secret + 32, seed);
+                acc += xxh3_mix16(input + length - 32, secret + 48, seed);
+            }
+            acc += xxh3_mix16(input, secret, seed);
+            acc += xxh3_mix16(input + length - 16, secret + 16, seed);
+            return xxh3_avalanche(acc);
+        }
+
+        inline uint64_t xxh3_64_129to240(const unsigned char* input, std::size_t length, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            uint64_t acc = length * xxh_prime64_1;
+            std::size_t round_count = length / 16;
+            for (std::size_t i = 0; i < 8; ++i)
+            {
+                acc += xxh3_mix16(input + 16 * i, secret + 16 * i, seed);
+            }
+            uint64_t acc_end = xxh3_mix16(input + length - 16, secret + 136 - 17, seed);
+            acc = xxh3_avalanche(acc);
+            for (std::size_t i = 8; i < round_count; ++i)
+            {
+                acc_end += xxh3_mix16(input + 16 * i, secret + 16 * (i - 8) + 3, seed);
+            }
+            return xxh3_avalanche(acc + acc_end);
+        }
+
+        inline uint64_t xxh3_64_long(const unsigned char* input, std::size_t length, uint64_t seed) noexcept
+        {
+            alignas(64) unsigned char custom_secret[xxh3_secret_size];
+            const unsigned char* secret = xxh3_default_secret;
+            if (seed != 0)
+            {
+                xxh3_init_secret(custom_secret, seed);
+                secret = custom_secret;
+            }
+            alignas(64) uint64_t acc[8];
+            xxh3_hash_long(acc, input, length, secret);
+            return xxh3_merge_accumulators(acc, secret + 11, length * xxh_prime64_1);
+        }
+
+        inline uint64_t xxh3_64_impl(const void* buffer, std::size_t length, uint64_t seed) noexcept
+        {
+            const unsigned char* input = static_cast<const unsigned char*>(buffer);
+            if (length <= 16)
+            {
+                return xxh3_64_0to16(input, length, xxh3_default_secret, seed);
+            }
+            if (length <= 128)
+            {
+                return xxh3_64_17to128(input, length, xxh3_default_secret, seed);
+            }
+            if (length <= xxh3_midsize_max)
+            {
+                return xxh3_64_129to240(input, length, xxh3_default_secret, seed);
+            }
+            return xxh3_64_long(input, length, seed);
+        }
+
+        /*****************
+         * xxh3 128 bits *
+         *****************/
+
+        inline hash128 xxh3_128_0to16(const unsigned char* input, std::size_t length, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            if (length > 8)
+            {
+                uint64_t bitflipl = (xxh_read64(secret + 32) ^ xxh_read64(secret + 40)) - seed;
+                uint64_t bitfliph = (xxh_read64(secret + 48) ^ xxh_read64(secret + 56)) + seed;
+                uint64_t input_lo = xxh_read64(input);
+                uint64_t input_hi = xxh_read64(input + length - 8);
+                hash128 m128 = xxh_mult64to128(input_lo ^ input_hi ^ bitflipl, xxh_prime64_1);
+                m128.low += uint64_t(length - 1) << 54;
+                input_hi ^= bitfliph;
+                m128.high += input_hi + (input_hi & 0xFFFFFFFF) * (xxh_prime32_2 - 1);
+                m128.low ^= xxh_swap64(m128.high);
+                hash128 h128 = xxh_mult64to128(m128.low, xxh_prime64_2);
+                h128.high += m128.high * xxh_prime64_2;
+                return {xxh3_avalanche(h128.low), xxh3_avalanche(h128.high)};
+            }
+            if (length >= 4)
+            {
+                seed ^= uint64_t(xxh_swap32(static_cast<uint32_t>(seed))) << 32;
+                uint64_t input_lo = xxh_read32(input);
+                uint64_t input_hi = xxh_read32(input + length - 4);
+                uint64_t input64 = input_lo + (input_hi << 32);
+                uint64_t bitflip = (xxh_read64(secret + 16) ^ xxh_read64(secret + 24)) + seed;
+                hash128 m128 = xxh_mult64to128(input64 ^ bitflip, xxh_prime64_1 + (uint64_t(length) << 2));
+                m128.high += m128.low << 1;
+                m128.low ^= m128.high >> 3;
+                m128.low ^= m128.low >> 35;
+                m128.low *= xxh_prime_mx2;
+                m128.low ^= m128.low >> 28;
+                m128.high = xxh3_avalanche(m128.high);
+                return m128;
+            }
+            if (length > 0)
+            {
+                uint32_t combinedl = (uint32_t(input[0]) << 16) | (uint32_t(input[length >> 1]) << 24)
+                                   | uint32_t(input[length - 1]) | (static_cast<uint32_t>(length) << 8);
+                uint32_t swapped = xxh_swap32(combinedl);
+                uint32_t combinedh = (swapped << 13) | (swapped >> 19);
+                uint64_t bitflipl = (uint64_t(xxh_read32(secret)) ^ uint64_t(xxh_read32(secret + 4))) + seed;
+                uint64_t bitfliph = (uint64_t(xxh_read32(secret + 8)) ^ uint64_t(xxh_read32(secret + 12))) - seed;
+                return {xxh64_avalanche(uint64_t(combinedl) ^ bitflipl), xxh64_avalanche(uint64_t(combinedh) ^ bitfliph)};
+            }
+            return {xxh64_avalanche(seed ^ xxh_read64(secret + 64) ^ xxh_read64(secret + 72)),
+                    xxh64_avalanche(seed ^ xxh_read64(secret + 80) ^ xxh_read64(secret + 88))};
+        }
+
+        inline hash128 xxh3_128_finalize(const hash128& acc, std::size_t length, uint64_t seed) noexcept
+        {
+            uint64_t low = acc.low + acc.high;
+            uint64_t high = acc.low * xxh_prime64_1 + acc.high * xxh_prime64_4 + (uint64_t(length) - seed) * xxh_prime64_2;
+            return {xxh3_avalanche(low), uint64_t(0) - xxh3_avalanche(high)};
+        }
+
+        inline hash128 xxh3_128_17to128(const unsigned char* input, std::size_t length, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            hash128 acc = {length * xxh_prime64_1, 0};
+            if (length > 32)
+            {
+                if (length > 64)
+                {
+                    if (length > 96)
+                    {
+                        xxh3_mix32(acc, input + 48, input + length - 64, secret + 96, seed);
+                    }
+                    xxh3_mix32(acc, input + 32, input + length - 48, secret + 64, seed);
+                }
+                xxh3_mix32(acc, input + 16, input + length - 32, secret + 32, seed);
+            }
+            xxh3_mix32(acc, input, input + length - 16, secret, seed);
+            return xxh3_128_finalize(acc, length, seed);
+        }
+
+        inline hash128 xxh3_128_129to240(const unsigned char* input, std::size_t length, const unsigned char* secret, uint64_t seed) noexcept
+        {
+            hash128 acc = {length * xxh_prime64_1, 0};
+            for (std::size_t i = 32; i < 160; i += 32)
+            {
+                xxh3_mix32(acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+            }
+            acc.low = xxh3_avalanche(acc.low);
+            acc.high = xxh3_avalanche(acc.high);
+            for (std::size_t i = 160; i <= length; i += 32)
+            {
+                xxh3_mix32(acc, input + i - 32, input + i - 16, secret + 3 + i - 160, seed);
+            }
+            xxh3_mix32(acc, input + length - 16, input + length - 32, secret + 136 - 17 - 16, uint64_t(0) - seed);
+            return xxh3_128_finalize(acc, length, seed);
+        }
+
+        inline hash128 xxh3_128_long(const unsigned char* input, std::size_t length, uint64_t seed) noexcept
+        {
+            alignas(64) unsigned char custom_secret[xxh3_secret_size];
+            const unsigned char* secret = xxh3_default_secret;
+            if (seed != 0)
+            {
+                xxh3_init_secret(custom_secret, seed);
+                secret = custom_secret;
+            }
+            alignas(64) uint64_t acc[8];
+            xxh3_hash_long(acc, input, length, secret);
+            return {xxh3_merge_accumulators(acc, secret + 11, length * xxh_prime64_1),
+                    xxh3_merge_accumulators(acc, secret + xxh3_secret_size - xxh3_stripe_size - 11, ~(length * xxh_prime64_2))};
+        }
+
+        inline hash128 xxh3_128_impl(const void* buffer, std::size_t length, uint64_t seed) noexcept
+        {
+            const unsigned char* input = static_cast<const unsigned char*>(buffer);
+            if (length <= 16)
+            {
+                return xxh3_128_0to16(input, length, xxh3_default_secret, seed);
+            }
+            if (length <= 128)
+            {
+                return xxh3_128_17to128(input, length, xxh3_default_secret, seed);
+            }
+            if (length <= xxh3_midsize_max)
+            {
+                return xxh3_128_129to240(input, length, xxh3_default_secret, seed);
+            }
+            return xxh3_128_long(input, length, seed);
+        }
+    }
+
+    inline bool operator==(const hash128& lhs, const hash128& rhs) noexcept
+    {
+        return lhs.low == rhs.low && lhs.high == rhs.high;
+    }
+
+    inline bool operator!=(const hash128& lhs, const hash128& rhs) noexcept
+    {
+        return !(lhs == rhs);
     }
 
     inline std::size_t hash_bytes(const void* buffer, std::size_t length, std::size_t seed)
@@ -194,15 +1318,134 @@ namespace xtl
         return detail::murmur_hash<sizeof(std::size_t)>(buffer, length, seed);
     }
 
+    /**
+     * Same as hash_bytes(str.data(), str.size(), seed), usable in constant
+     * expressions, e.g. to hash string literals at compile time.
+     */
+    inline constexpr std::size_t hash_string(std::string_view str, std::size_t seed) noexcept
+    {
+        if (!detail::is_constant_evaluated())
+        {
+            return detail::murmur_hash<sizeof(std::size_t)>(str.data(), str.size(), seed);
+        }
+        return detail::murmur_core<sizeof(std::size_t), detail::constexpr_block_load>(str.data(), str.size(), seed);
+    }
+
+    /**
+     * Same as hash_bytes(&value, sizeof(T), seed), with the length known at
+     * compile time so that no loop is run. T must be trivially copyable and
+     * have no padding bytes, like std::array or packed fixed-width structs.
+     */
+    template <class T>
+    inline std::size_t hash_object(const T& value, std::size_t seed) noexcept
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "hash_object requires a trivially copyable type");
+        return detail::murmur_hash_fixed<sizeof(T)>(reinterpret_cast<const unsigned char*>(std::addressof(value)), seed);
+    }
+
+    /**
+     * Hashes out.size() contiguous keys of key_size bytes each: out[i] is
+     * hash_bytes(keys + i * key_size, key_size, seed). Keys of 4, 8 and 16
+     * bytes are hashed several at a time with SIMD instructions when available.
+     */
+    inline void hash_bytes_batch(const void* keys, std::size_t key_size, span<std::size_t> out, std::size_t seed)
+    {
+        const unsigned char* data = static_cast<const unsigned char*>(keys);
+        switch (key_size)
+        {
+        case 4:
+            detail::select_hash_fixed_batch<4>()(data, out.data(), out.size(), seed);
+            break;
+        case 8:
+            detail::select_hash_fixed_batch<8>()(data, out.data(), out.size(), seed);
+            break;
+        case 16:
+            detail::select_hash_fixed_batch<16>()(data, out.data(), out.size(), seed);
+            break;
+        default:
+        {
+            std::size_t* res = out.data();
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                res[i] = hash_bytes(data + i * key_size, key_size, seed);
+            }
+        }
+        }
+    }
+
+    /**
+     * Hashes the strings of a column stored as offsets and characters:
+     * string i spans [data + offsets[i], data + offsets[i + 1]), hence
+     * offsets.size() must be out.size() + 1. Throws if the offsets are
+     * negative or decreasing; data must hold at least offsets.back() bytes.
+     */
+    inline void hash_bytes_batch(span<const int32_t> offsets, const void* data, span<std::size_t> out, std::size_t seed)
+    {
+        detail::hash_string_batch(offsets, data, out, seed);
+    }
+
+    inline void hash_bytes_batch(span<const int64_t> offsets, const void* data, span<std::size_t> out, std::size_t seed)
+    {
+        detail::hash_string_batch(offsets, data, out, seed);
+    }
+
     inline uint32_t murmur2_x86(const void* buffer, std::size_t length, uint32_t seed)
     {
-        return detail::murmur2_x86_impl(buffer, length, seed);
+        return static_cast<uint32_t>(detail::murmur_hash<4>(buffer, length, seed));
     }
 
     inline uint64_t murmur2_x64(const void* buffer, std::size_t length, uint64_t seed)
     {
         return detail::murmur_hash<8>(buffer, length, seed);
     }
+
+    inline uint64_t xxh3_64(const void* buffer, std::size_t length, uint64_t seed)
+    {
+        return detail::xxh3_64_impl(buffer, length, seed);
+    }
+
+    inline hash128 xxh3_128(const void* buffer, std::size_t length, uint64_t seed)
+    {
+        return detail::xxh3_128_impl(buffer, length, seed);
+    }
+
+    /**************************
+     * xhasher implementation *
+     **************************/
+
+    /**
+     * Builds a hasher for length bytes, equivalent to hash_bytes(..., length, seed).
+     */
+    inline xhasher::xhasher(std::size_t length, std::size_t seed) noexcept
+        : m_state(length, seed), m_remaining(length)
+    {
+    }
+
+    /**
+     * Hashes the next length bytes of the input.
+     */
+    inline xhasher& xhasher::update(const void* buffer, std::size_t length)
+    {
+        if (length > m_remaining)
+        {
+            XTL_THROW(std::length_error, "xhasher::update: more bytes than announced");
+        }
+        m_state.update(static_cast<const unsigned char*>(buffer), length);
+        m_remaining -= length;
+        return *this;
+    }
+
+    /**
+     * Returns the hash of the input, once all its bytes went through update.
+     */
+    inline std::size_t xhasher::finalize() const
+    {
+        if (m_remaining != 0)
+        {
+            XTL_THROW(std::length_error, "xhasher::finalize: fewer bytes than announced");
+        }
+        return m_state.finalize();
+    }
 }
 
 #endif
@@ -13,6 +13,15 @@
 #include <cstring>
 #include <cstdint>
 
+// Runtime dispatch to instruction set specific kernels is available with
+// GCC and Clang on x86-64. Define XTL_NO_RUNTIME_DISPATCH to only use the
+// portable implementations.
+#if !defined(XTL_NO_RUNTIME_DISPATCH) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define XTL_X86_RUNTIME_DISPATCH
+#define XTL_TARGET(arch) __attribute__((target(arch)))
+#define XTL_NOINLINE __attribute__((noinline))
+#endif
+
 namespace xtl
 {
     enum class endian
@@ -37,6 +46,153 @@ namespace xtl
             return endian::mixed;
         }
     }
+
+    /****************
+     * cpu_features *
+     ****************/
+
+    // Instruction sets that are supported by both the CPU and the OS.
+    // All fields are false when runtime dispatch is not available.
+    struct cpu_features
+    {
+        bool sse2 = false;
+        bool sse4_1 = false;
+        bool popcnt = false;
+        bool avx2 = false;
+        bool fma = false;
+        bool f16c = false;
+        bool avx512f = false;
+        bool avx512bw = false;
+        bool avx512dq = false;
+        bool avx512vl = false;
+        bool avx512_vpopcntdq = false;
+        bool avx512_bf16 = false;
+        bool avx512_fp16 = false;
+    };
+
+    const cpu_features& available_cpu_features();
+}
+
+/*******************************
+ * cpu_features implementation *
+ *******************************/
+
+// The intrinsics headers are only pulled in when runtime dispatch is enabled
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace xtl
+{
+    namespace detail
+    {
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        // Highest standard leaf supported by the cpuid instruction
+        inline unsigned int cpuid_max_leaf() noexcept
+        {
+#if defined(_MSC_VER)
+            int regs[4];
+            __cpuid(regs, 0);
+            return static_cast<unsigned int>(regs[0]);
+#else
+            return __get_cpuid_max(0, nullptr);
+#endif
+        }
+
+        inline void cpuid(unsigned int leaf, unsigned int subleaf,
+                          unsigned int& eax, unsigned int& ebx, unsigned int& ecx, unsigned int& edx) noexcept
+        {
+#if defined(_MSC_VER)
+            int regs[4];
+            __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+            eax = static_cast<unsigned int>(regs[0]);
+            ebx = static_cast<unsigned int>(regs[1]);
+            ecx = static_cast<unsigned int>(regs[2]);
+            edx = static_cast<unsigned int>(regs[3]);
+#else
+            __cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+#endif
+        }
+
+        // Low half of the XCR0 register, the state components enabled by the OS
+        inline unsigned int xgetbv0() noexcept
+        {
+#if defined(_MSC_VER)
+            return static_cast<unsigned int>(_xgetbv(0));
+#else
+            unsigned int xcr0_lo = 0, xcr0_hi = 0;
+            __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            return xcr0_lo;
+#endif
+        }
+#endif
+
+        inline cpu_features detect_cpu_features()
+        {
+            cpu_features res;
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+            unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+            if (cpuid_max_leaf() < 1)
+            {
+                return res;
+            }
+            cpuid(1, 0, eax, ebx, ecx, edx);
+            res.sse2 = (edx >> 26) & 1u;
+            res.sse4_1 = (ecx >> 19) & 1u;
+            res.popcnt = (ecx >> 23) & 1u;
+
+            bool osxsave = (ecx >> 27) & 1u;
+            bool avx = (ecx >> 28) & 1u;
+            if (!osxsave || !avx)
+            {
+                return res;
+            }
+
+            unsigned int xcr0_lo = xgetbv0();
+            bool os_ymm = (xcr0_lo & 0x6u) == 0x6u;
+            bool os_zmm = (xcr0_lo & 0xE6u) == 0xE6u;
+            if (!os_ymm)
+            {
+                return res;
+            }
+            res.fma = (ecx >> 12) & 1u;
+            res.f16c = (ecx >> 29) & 1u;
+
+            if (cpuid_max_leaf() < 7)
+            {
+                return res;
+            }
+            cpuid(7, 0, eax, ebx, ecx, edx);
+            res.avx2 = (ebx >> 5) & 1u;
+            if (os_zmm)
+            {
+                res.avx512f = (ebx >> 16) & 1u;
+                res.avx512bw = res.avx512f && ((ebx >> 30) & 1u);
+                res.avx512dq = res.avx512f && ((ebx >> 17) & 1u);
+                res.avx512vl = res.avx512f && ((ebx >> 31) & 1u);
+                res.avx512_vpopcntdq = res.avx512f && ((ecx >> 14) & 1u);
+                res.avx512_fp16 = res.avx512bw && ((edx >> 23) & 1u);
+                unsigned int max_subleaf = eax;
+                if (max_subleaf >= 1)
+                {
+                    cpuid(7, 1, eax, ebx, ecx, edx);
+                    res.avx512_bf16 = res.avx512bw && ((eax >> 5) & 1u);
+                }
+            }
+#endif
+            return res;
+        }
+    }
+
+    inline const cpu_features& available_cpu_features()
+    {
+        static const cpu_features features = detail::detect_cpu_features();
+        return features;
+    }
 }
 
 #endif
@@ -0,0 +1,2047 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_XROARING_BITSET_HPP
+#define XTL_XROARING_BITSET_HPP
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "xclosure.hpp"
+#include "xdynamic_bitset.hpp"
+#include "xdynamic_bitset_kernels.hpp"
+#include "xiterator_base.hpp"
+#include "xtl_config.hpp"
+
+namespace xtl
+{
+    namespace detail_roaring
+    {
+        /*********************
+         * roaring_container *
+         *********************/
+
+        constexpr std::size_t chunk_bits = 65536;
+        constexpr std::size_t chunk_words = chunk_bits / 64;
+        constexpr std::size_t array_max_cardinality = 4096;
+        constexpr std::size_t run_max_count = 2048;
+
+        enum class container_kind : uint8_t
+        {
+            array,
+            bitmap,
+            run
+        };
+
+        // Set of 16-bit values, stored as a sorted array, a 2^16 bits bitmap
+        // or a sorted list of runs [first, last], whichever is smaller.
+        class roaring_container
+        {
+        public:
+
+            using words_type = std::array<uint64_t, chunk_words>;
+
+            roaring_container() = default;
+
+            static roaring_container from_words(const uint64_t* words);
+            static roaring_container range(uint32_t first, uint32_t last);
+
+            template <class OP>
+            static roaring_container combine(const roaring_container& lhs, const roaring_container& rhs);
+
+            container_kind kind() const noexcept;
+            uint32_t cardinality() const noexcept;
+
+            bool test(uint32_t v) const noexcept;
+            void set(uint32_t v);
+            void reset(uint32_t v);
+
+            uint32_t next_set(uint32_t v) const noexcept;
+
+            void to_words(uint64_t* words) const noexcept;
+            roaring_container complement(uint32_t limit) const;
+            roaring_container truncate(uint32_t limit) const;
+            void optimize();
+
+            template <class F>
+            void for_each(F&& f) const;
+            template <class F>
+            void for_each_word(F&& f) const;
+
+            std::size_t memory_usage() const noexcept;
+
+            bool operator==(const roaring_container& rhs) const noexcept;
+            bool operator!=(const roaring_container& rhs) const noexcept;
+
+        private:
+
+            std::size_t find_run(uint32_t v) const noexcept;
+
+            container_kind m_kind = container_kind::array;
+            uint32_t m_cardinality = 0;
+            // sorted values for arrays, (first, last) pairs for runs
+            std::vector<uint16_t> m_values;
+            std::vector<uint64_t> m_words;
+        };
+
+        constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        inline uint64_t range_mask(uint32_t first, uint32_t last) noexcept
+        {
+            // bits [first, last) of a word, last <= 64
+            uint64_t high = last == 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1;
+            return high & ~((uint64_t(1) << first) - 1);
+        }
+
+        inline void set_range(uint64_t* words, uint32_t first, uint32_t last) noexcept
+        {
+            while (first < last)
+            {
+                uint32_t end = std::min(last, (first / 64 + 1) * 64);
+                words[first / 64] |= range_mask(first % 64, end - (first / 64) * 64);
+                first = end;
+            }
+        }
+
+        // Index of the first bit equal to value at or after v, or chunk_bits
+        inline uint32_t next_bit(const uint64_t* words, uint32_t v, bool value) noexcept
+        {
+            if (v >= chunk_bits)
+            {
+                return chunk_bits;
+            }
+            std::size_t i = v / 64;
+            uint64_t w = (value ? words[i] : ~words[i]) & (~uint64_t(0) << (v % 64));
+            while (w == 0)
+            {
+                if (++i == chunk_words)
+                {
+                    return chunk_bits;
+                }
+                w = value ? words[i] : ~words[i];
+            }
+            return static_cast<uint32_t>(i * 64 + detail_bitset::countr_zero(w));
+        }
+
+        // Clears the bits at or after limit
+        inline void clear_from(uint64_t* words, uint32_t limit) noexcept
+        {
+            if (limit % 64 != 0)
+            {
+                words[limit / 64] &= range_mask(0, limit % 64);
+                limit += 64 - limit % 64;
+            }
+            std::fill(words + std::min<std::size_t>(limit / 64, chunk_words), words + chunk_words, uint64_t(0));
+        }
+
+        inline std::size_t count_runs(const uint64_t* words) noexcept
+        {
+            std::size_t res = 0;
+            uint64_t carry = 0;
+            for (std::size_t i = 0; i < chunk_words; ++i)
+            {
+                res += detail_bitset::popcount(words[i] & ~((words[i] << 1) | carry));
+                carry = words[i] >> 63;
+            }
+            return res;
+        }
+
+        // Key of the 2^16 bits chunk holding pos, and position in the chunk
+        inline std::size_t chunk_key(std::size_t pos) noexcept
+        {
+            return pos / chunk_bits;
+        }
+
+        inline uint32_t chunk_offset(std::size_t pos) noexcept
+        {
+            return static_cast<uint32_t>(pos % chunk_bits);
+        }
+
+        // 64-bit words of an xdynamic_bitset buffer, whatever its block type
+        template <class T>
+        inline uint64_t load_word(const T* data, std::size_t block_count, std::size_t w) noexcept
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+            constexpr std::size_t per_word = sizeof(uint64_t) / sizeof(T);
+            uint64_t res = 0;
+            for (std::size_t k = 0; k < per_word && w * per_word + k < block_count; ++k)
+            {
+                uint64_t block = static_cast<unsigned_type>(data[w * per_word + k]);
+                res |= block << (k * CHAR_BIT * sizeof(T));
+            }
+            return res;
+        }
+
+        template <class T>
+        inline void store_word(T* data, std::size_t block_count, std::size_t w, uint64_t value) noexcept
+        {
+            constexpr std::size_t per_word = sizeof(uint64_t) / sizeof(T);
+            for (std::size_t k = 0; k < per_word && w * per_word + k < block_count; ++k)
+            {
+                data[w * per_word + k] = static_cast<T>(value >> (k * CHAR_BIT * sizeof(T)));
+            }
+        }
+    }
+
+    /**********************
+     * xroaring_reference *
+     **********************/
+
+    class xroaring_bitset;
+
+    template <bool is_const>
+    class xroaring_reference
+    {
+    public:
+
+        using self_type = xroaring_reference<is_const>;
+        using pointer = std::conditional_t<is_const,
+                                           const xclosure_pointer<const self_type>,
+                                           xclosure_pointer<self_type>>;
+        using container_pointer = std::conditional_t<is_const, const xroaring_bitset*, xroaring_bitset*>;
+        using size_type = std::size_t;
+
+        xroaring_reference(container_pointer c, size_type pos) noexcept;
+
+        operator bool() const noexcept;
+
+        xroaring_reference(const self_type&) = default;
+        xroaring_reference(self_type&&) = default;
+
+        self_type& operator=(const self_type&);
+        self_type& operator=(self_type&&);
+        self_type& operator=(bool);
+
+        bool operator~() const noexcept;
+
+        self_type& operator&=(bool);
+        self_type& operator|=(bool);
+        self_type& operator^=(bool);
+        self_type& flip();
+
+        pointer operator&() noexcept;
+
+    private:
+
+        container_pointer p_container;
+        size_type m_pos;
+    };
+
+    /*********************
+     * xroaring_iterator *
+     *********************/
+
+    template <bool is_const>
+    class xroaring_iterator : public xrandom_access_iterator_base<xroaring_iterator<is_const>,
+                                                                  bool,
+                                                                  std::ptrdiff_t,
+                                                                  typename xroaring_reference<is_const>::pointer,
+                                                                  xroaring_reference<is_const>>
+    {
+    public:
+
+        using self_type = xroaring_iterator<is_const>;
+        using value_type = bool;
+        using reference = xroaring_reference<is_const>;
+        using pointer = typename reference::pointer;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using container_pointer = typename reference::container_pointer;
+
+        xroaring_iterator() noexcept;
+        xroaring_iterator(container_pointer c, size_type index) noexcept;
+
+        self_type& operator++();
+        self_type& operator--();
+
+        self_type& operator+=(difference_type n);
+        self_type& operator-=(difference_type n);
+
+        difference_type operator-(const self_type& rhs) const;
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const self_type& rhs) const;
+        bool operator<(const self_type& rhs) const;
+
+    private:
+
+        container_pointer p_container;
+        size_type m_index;
+    };
+
+    /*****************************
+     * xroaring_set_bit_iterator *
+     *****************************/
+
+    class xroaring_set_bit_iterator
+    {
+    public:
+
+        using self_type = xroaring_set_bit_iterator;
+        using size_type = std::size_t;
+        using value_type = size_type;
+        using reference = size_type;
+        using pointer = const size_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        xroaring_set_bit_iterator() noexcept;
+        xroaring_set_bit_iterator(const xroaring_bitset* c, size_type index) noexcept;
+
+        self_type& operator++();
+        self_type operator++(int);
+
+        reference operator*() const;
+
+        bool operator==(const self_type& rhs) const;
+        bool operator!=(const self_type& rhs) const;
+
+    private:
+
+        const xroaring_bitset* p_container;
+        size_type m_index;
+    };
+
+    class xroaring_set_bit_range
+    {
+    public:
+
+        using iterator = xroaring_set_bit_iterator;
+        using const_iterator = iterator;
+
+        explicit xroaring_set_bit_range(const xroaring_bitset& c) noexcept;
+
+        iterator begin() const noexcept;
+        iterator end() const noexcept;
+
+    private:
+
+        const xroaring_bitset* p_container;
+    };
+
+    /*******************
+     * xroaring_bitset *
+     *******************/
+
+    /**
+     * Compressed bitset with the interface of xdynamic_bitset.
+     *
+     * The bits are split in chunks of 2^16 bits, only non-empty chunks are
+     * stored, as a sorted array of positions, a plain bitmap or a list of
+     * runs, whichever is smaller. Bulk operations pick the representation
+     * of their result; point mutations keep the current one unless it
+     * overflows, optimize() recompresses all the chunks.
+     */
+    class xroaring_bitset
+    {
+    public:
+
+        using self_type = xroaring_bitset;
+        using block_type = uint64_t;
+        using value_type = bool;
+        using reference = xroaring_reference<false>;
+        using const_reference = xroaring_reference<true>;
+        using pointer = typename reference::pointer;
+        using const_pointer = typename const_reference::pointer;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using iterator = xroaring_iterator<false>;
+        using const_iterator = xroaring_iterator<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using set_bit_iterator = xroaring_set_bit_iterator;
+        using set_bit_range = xroaring_set_bit_range;
+
+        static constexpr size_type npos = static_cast<size_type>(-1);
+
+        xroaring_bitset() noexcept;
+        explicit xroaring_bitset(size_type count);
+        xroaring_bitset(size_type count, bool b);
+        xroaring_bitset(std::initializer_list<bool> init);
+
+        template <class B>
+        explicit xroaring_bitset(const xdynamic_bitset_base<B>& rhs);
+
+        template <class B = block_type>
+        xdynamic_bitset<B> to_dynamic_bitset() const;
+
+        bool empty() const noexcept;
+        size_type size() const noexcept;
+
+        void resize(size_type size, bool b = false);
+        void clear() noexcept;
+        void push_back(bool b);
+        void pop_back();
+
+        void swap(self_type& rhs) noexcept;
+
+        reference at(size_type i);
+        const_reference at(size_type i) const;
+
+        reference operator[](size_type i);
+        const_reference operator[](size_type i) const;
+
+        reference front();
+        const_reference front() const;
+
+        reference back();
+        const_reference back() const;
+
+        bool test(size_type pos) const noexcept;
+
+        iterator begin() noexcept;
+        iterator end() noexcept;
+
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+
+        const_iterator cbegin() const noexcept;
+        const_iterator cend() const noexcept;
+
+        reverse_iterator rbegin() noexcept;
+        reverse_iterator rend() noexcept;
+
+        const_reverse_iterator rbegin() const noexcept;
+        const_reverse_iterator rend() const noexcept;
+
+        const_reverse_iterator crbegin() const noexcept;
+        const_reverse_iterator crend() const noexcept;
+
+        self_type& operator&=(const self_type& rhs);
+        self_type& operator|=(const self_type& rhs);
+        self_type& operator^=(const self_type& rhs);
+
+        template <class B>
+        self_type& operator&=(const xdynamic_bitset_base<B>& rhs);
+        template <class B>
+        self_type& operator|=(const xdynamic_bitset_base<B>& rhs);
+        template <class B>
+        self_type& operator^=(const xdynamic_bitset_base<B>& rhs);
+
+        self_type operator<<(size_type pos) const;
+        self_type& operator<<=(size_type pos);
+        self_type operator>>(size_type pos) const;
+        self_type& operator>>=(size_type pos);
+
+        self_type& set();
+        self_type& set(size_type pos, value_type value = true);
+
+        self_type& reset();
+        self_type& reset(size_type pos);
+
+        self_type& flip();
+        self_type& flip(size_type pos);
+
+        bool all() const noexcept;
+        bool any() const noexcept;
+        bool none() const noexcept;
+        size_type count() const noexcept;
+
+        size_type find_first() const noexcept;
+        size_type find_next(size_type pos) const noexcept;
+
+        set_bit_range set_bits() const noexcept;
+
+        template <class F>
+        void for_each_set_bit(F&& f) const;
+        template <class F>
+        void for_each_set_block(F&& f) const;
+
+        void optimize();
+        size_type container_count() const noexcept;
+        size_type memory_usage() const noexcept;
+
+        bool operator==(const self_type& rhs) const noexcept;
+        bool operator!=(const self_type& rhs) const noexcept;
+
+        template <class B>
+        bool operator==(const xdynamic_bitset_base<B>& rhs) const;
+        template <class B>
+        bool operator!=(const xdynamic_bitset_base<B>& rhs) const;
+
+    private:
+
+        using container_type = detail_roaring::roaring_container;
+
+        size_type find_container(size_type key) const noexcept;
+        size_type chunk_limit(size_type key) const noexcept;
+        void append(size_type pos);
+
+        template <class OP>
+        void compute_assign(const self_type& rhs);
+
+        size_type m_size;
+        std::vector<size_type> m_keys;
+        std::vector<container_type> m_containers;
+    };
+
+    xroaring_bitset operator~(const xroaring_bitset& lhs);
+    xroaring_bitset operator&(const xroaring_bitset& lhs, const xroaring_bitset& rhs);
+    xroaring_bitset operator|(const xroaring_bitset& lhs, const xroaring_bitset& rhs);
+    xroaring_bitset operator^(const xroaring_bitset& lhs, const xroaring_bitset& rhs);
+
+    template <class B>
+    xroaring_bitset operator&(const xroaring_bitset& lhs, const xdynamic_bitset_base<B>& rhs);
+    template <class B>
+    xroaring_bitset operator|(const xroaring_bitset& lhs, const xdynamic_bitset_base<B>& rhs);
+    template <class B>
+    xroaring_bitset operator^(const xroaring_bitset& lhs, const xdynamic_bitset_base<B>& rhs);
+
+    template <class B>
+    xroaring_bitset operator&(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+    template <class B>
+    xroaring_bitset operator|(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+    template <class B>
+    xroaring_bitset operator^(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+
+    template <class B>
+    xdynamic_bitset_base<B>& operator&=(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+    template <class B>
+    xdynamic_bitset_base<B>& operator|=(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+    template <class B>
+    xdynamic_bitset_base<B>& operator^=(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+
+    template <class B>
+    bool operator==(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+    template <class B>
+    bool operator!=(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs);
+
+    void swap(xroaring_bitset& lhs, xroaring_bitset& rhs) noexcept;
+
+    /************************************
+     * roaring_container implementation *
+     ************************************/
+
+    namespace detail_roaring
+    {
+        inline roaring_container roaring_container::from_words(const uint64_t* words)
+        {
+            roaring_container res;
+            res.m_cardinality = static_cast<uint32_t>(detail_bitset::popcount(words, chunk_words));
+            if (res.m_cardinality == 0)
+            {
+                return res;
+            }
+
+            std::size_t runs = count_runs(words);
+            std::size_t array_bytes = res.m_cardinality <= array_max_cardinality ? 2 * res.m_cardinality : npos;
+            std::size_t run_bytes = 4 * runs;
+            if (run_bytes < std::min(array_bytes, chunk_bits / CHAR_BIT))
+            {
+                res.m_kind = container_kind::run;
+                res.m_values.reserve(2 * runs);
+                for (uint32_t first = next_bit(words, 0, true); first != chunk_bits;)
+                {
+                    uint32_t last = next_bit(words, first, false);
+                    res.m_values.push_back(static_cast<uint16_t>(first));
+                    res.m_values.push_back(static_cast<uint16_t>(last - 1));
+                    first = next_bit(words, last, true);
+                }
+            }
+            else if (res.m_cardinality <= array_max_cardinality)
+            {
+                res.m_kind = container_kind::array;
+                res.m_values.reserve(res.m_cardinality);
+                for (std::size_t i = 0; i < chunk_words; ++i)
+                {
+                    for (uint64_t w = words[i]; w != 0; w = detail_bitset::clear_lowest_bit(w))
+                    {
+                        res.m_values.push_back(static_cast<uint16_t>(i * 64 + detail_bitset::countr_zero(w)));
+                    }
+                }
+            }
+            else
+            {
+                res.m_kind = container_kind::bitmap;
+                res.m_words.assign(words, words + chunk_words);
+            }
+            return res;
+        }
+
+        // Container holding [first, last), first < last <= chunk_bits
+        inline roaring_container roaring_container::range(uint32_t first, uint32_t last)
+        {
+            roaring_container res;
+            res.m_kind = container_kind::run;
+            res.m_cardinality = last - first;
+            res.m_values = {static_cast<uint16_t>(first), static_cast<uint16_t>(last - 1)};
+            return res;
+        }
+
+        template <class OP>
+        inline roaring_container roaring_container::combine(const roaring_container& lhs, const roaring_container& rhs)
+        {
+            constexpr bool is_and = std::is_same<OP, detail_bitset::bitwise_and>::value;
+            if (lhs.m_kind == container_kind::array && rhs.m_kind == container_kind::array)
+            {
+                roaring_container res;
+                const auto& l = lhs.m_values;
+                const auto& r = rhs.m_values;
+                auto out = std::back_inserter(res.m_values);
+                if constexpr (is_and)
+                {
+                    std::set_intersection(l.cbegin(), l.cend(), r.cbegin(), r.cend(), out);
+                }
+                else if constexpr (std::is_same<OP, detail_bitset::bitwise_or>::value)
+                {
+                    std::set_union(l.cbegin(), l.cend(), r.cbegin(), r.cend(), out);
+                }
+                else
+                {
+                    std::set_symmetric_difference(l.cbegin(), l.cend(), r.cbegin(), r.cend(), out);
+                }
+                res.m_cardinality = static_cast<uint32_t>(res.m_values.size());
+                if (res.m_cardinality <= array_max_cardinality)
+                {
+                    return res;
+                }
+                words_type words = {};
+                res.to_words(words.data());
+                return from_words(words.data());
+            }
+
+            if constexpr (is_and)
+            {
+                // The intersection with an array is an array
+                if (lhs.m_kind == container_kind::array || rhs.m_kind == container_kind::array)
+                {
+                    const roaring_container& a = lhs.m_kind == container_kind::array ? lhs : rhs;
+                    const roaring_container& other = lhs.m_kind == container_kind::array ? rhs : lhs;
+                    roaring_container res;
+                    std::copy_if(a.m_values.cbegin(), a.m_values.cend(), std::back_inserter(res.m_values),
+                                 [&other](uint16_t v) { return other.test(v); });
+                    res.m_cardinality = static_cast<uint32_t>(res.m_values.size());
+                    return res;
+                }
+            }
+
+            words_type l, r;
+            lhs.to_words(l.data());
+            rhs.to_words(r.data());
+            detail_bitset::transform_blocks<OP>(l.data(), l.data(), r.data(), chunk_words);
+            return from_words(l.data());
+        }
+
+        inline container_kind roaring_container::kind() const noexcept
+        {
+            return m_kind;
+        }
+
+        inline uint32_t roaring_container::cardinality() const noexcept
+        {
+            return m_cardinality;
+        }
+
+        inline bool roaring_container::test(uint32_t v) const noexcept
+        {
+            switch (m_kind)
+            {
+            case container_kind::array:
+                return std::binary_search(m_values.cbegin(), m_values.cend(), static_cast<uint16_t>(v));
+            case container_kind::bitmap:
+                return (m_words[v / 64] >> (v % 64)) & 1;
+            default:
+            {
+                std::size_t r = find_run(v);
+                return r != npos && v <= m_values[2 * r + 1];
+            }
+            }
+        }
+
+        inline void roaring_container::set(uint32_t v)
+        {
+            switch (m_kind)
+            {
+            case container_kind::array:
+            {
+                auto it = std::lower_bound(m_values.begin(), m_values.end(), static_cast<uint16_t>(v));
+                if (it != m_values.end() && *it == v)
+                {
+                    return;
+                }
+                if (m_cardinality < array_max_cardinality)
+                {
+                    m_values.insert(it, static_cast<uint16_t>(v));
+                    ++m_cardinality;
+                    return;
+                }
+                words_type words = {};
+                to_words(words.data());
+                m_kind = container_kind::bitmap;
+                m_words.assign(words.cbegin(), words.cend());
+                std::vector<uint16_t>().swap(m_values);
+                set(v);
+                return;
+            }
+            case container_kind::bitmap:
+            {
+                uint64_t mask = uint64_t(1) << (v % 64);
+                if (!(m_words[v / 64] & mask))
+                {
+                    m_words[v / 64] |= mask;
+                    ++m_cardinality;
+                }
+                return;
+            }
+            default:
+            {
+                std::size_t r = find_run(v);
+                if (r != npos && v <= m_values[2 * r + 1])
+                {
+                    return;
+                }
+                std::size_t next = r == npos ? 0 : r + 1;
+                bool extends_prev = r != npos && m_values[2 * r + 1] + 1u == v;
+                bool extends_next = 2 * next < m_values.size() && m_values[2 * next] == v + 1;
+                if (extends_prev && extends_next)
+                {
+                    m_values[2 * r + 1] = m_values[2 * next + 1];
+                    m_values.erase(m_values.begin() + static_cast<std::ptrdiff_t>(2 * next),
+                                   m_values.begin() + static_cast<std::ptrdiff_t>(2 * next + 2));
+                }
+                else if (extends_prev)
+                {
+                    m_values[2 * r + 1] = static_cast<uint16_t>(v);
+                }
+                else if (extends_next)
+                {
+                    m_values[2 * next] = static_cast<uint16_t>(v);
+                }
+                else
+                {
+                    auto it = m_values.begin() + static_cast<std::ptrdiff_t>(2 * next);
+                    m_values.insert(it, {static_cast<uint16_t>(v), static_cast<uint16_t>(v)});
+                }
+                ++m_cardinality;
+                if (m_values.size() / 2 > run_max_count)
+                {
+                    optimize();
+                }
+                return;
+            }
+            }
+        }
+
+        inline void roaring_container::reset(uint32_t v)
+        {
+            switch (m_kind)
+            {
+            case container_kind::array:
+            {
+                auto it = std::lower_bound(m_values.begin(), m_values.end(), static_cast<uint16_t>(v));
+                if (it != m_values.end() && *it == v)
+                {
+                    m_values.erase(it);
+                    --m_cardinality;
+                }
+                return;
+            }
+            case container_kind::bitmap:
+            {
+                uint64_t mask = uint64_t(1) << (v % 64);
+                if (m_words[v / 64] & mask)
+                {
+                    m_words[v / 64] &= ~mask;
+                    if (--m_cardinality <= array_max_cardinality)
+                    {
+                        *this = from_words(m_words.data());
+                    }
+                }
+                return;
+            }
+            default:
+            {
+                std::size_t r = find_run(v);
+                if (r == npos || v > m_values[2 * r + 1])
+                {
+                    return;
+                }
+                uint16_t first = m_values[2 * r];
+                uint16_t last = m_values[2 * r + 1];
+                if (first == last)
+                {
+                    m_values.erase(m_values.begin() + static_cast<std::ptrdiff_t>(2 * r),
+                                   m_values.begin() + static_cast<std::ptrdiff_t>(2 * r + 2));
+                }
+                else if (v == first)
+                {
+                    ++m_values[2 * r];
+                }
+                else if (v == last)
+                {
+                    --m_values[2 * r + 1];
+                }
+                else
+                {
+                    m_values[2 * r + 1] = static_cast<uint16_t>(v - 1);
+                    auto it = m_values.begin() + static_cast<std::ptrdiff_t>(2 * r + 2);
+                    m_values.insert(it, {static_cast<uint16_t>(v + 1), last});
+                }
+                --m_cardinality;
+                if (m_values.size() / 2 > run_max_count)
+                {
+                    optimize();
+                }
+                return;
+            }
+            }
+        }
+
+        // Smallest value greater than or equal to v, or chunk_bits
+        inline uint32_t roaring_container::next_set(uint32_t v) const noexcept
+        {
+            switch (m_kind)
+            {
+            case container_kind::array:
+            {
+                if (v >= chunk_bits)
+                {
+                    return chunk_bits;
+                }
+                auto it = std::lower_bound(m_values.cbegin(), m_values.cend(), static_cast<uint16_t>(v));
+                return it == m_values.cend() ? static_cast<uint32_t>(chunk_bits) : *it;
+            }
+            case container_kind::bitmap:
+                return next_bit(m_words.data(), v, true);
+            default:
+            {
+                if (v >= chunk_bits)
+                {
+                    return chunk_bits;
+                }
+                std::size_t r = find_run(v);
+                if (r != npos && v <= m_values[2 * r + 1])
+                {
+                    return v;
+                }
+                std::size_t next = r == npos ? 0 : r + 1;
+                return 2 * next < m_values.size() ? m_values[2 * next] : static_cast<uint32_t>(chunk_bits);
+            }
+            }
+        }
+
+        inline void roaring_container::to_words(uint64_t* words) const noexcept
+        {
+            switch (m_kind)
+            {
+            case container_kind::array:
+                std::fill(words, words + chunk_words, uint64_t(0));
+                for (uint16_t v : m_values)
+                {
+                    words[v / 64] |= uint64_t(1) << (v % 64);
+                }
+                break;
+            case container_kind::bitmap:
+                std::copy(m_words.cbegin(), m_words.cend(), words);
+                break;
+            default:
+                std::fill(words, words + chunk_words, uint64_t(0));
+                for (std::size_t r = 0; r < m_values.size(); r += 2)
+                {
+                    set_range(words, m_values[r], m_values[r + 1] + 1u);
+                }
+                break;
+            }
+        }
+
+        // Values of [0, limit) that are not in the container
+        inline roaring_container roaring_container::complement(uint32_t limit) const
+        {
+            words_type words;
+            to_words(words.data());
+            for (auto& w : words)
+            {
+                w = ~w;
+            }
+            clear_from(words.data(), limit);
+            return from_words(words.data());
+        }
+
+        // Values of the container smaller than limit
+        inline roaring_container roaring_container::truncate(uint32_t limit) const
+        {
+            words_type words;
+            to_words(words.data());
+            clear_from(words.data(), limit);
+            return from_words(words.data());
+        }
+
+        inline void roaring_container::optimize()
+        {
+            words_type words;
+            to_words(words.data());
+            *this = from_words(words.data());
+        }
+
+        template <class F>
+        inline void roaring_container::for_each(F&& f) const
+        {
+            switch (m_kind)
+            {
+            case container_kind::array:
+                for (uint16_t v : m_values)
+                {
+                    f(uint32_t(v));
+                }
+                break;
+            case container_kind::bitmap:
+                for (std::size_t i = 0; i < chunk_words; ++i)
+                {
+                    for (uint64_t w = m_words[i]; w != 0; w = detail_bitset::clear_lowest_bit(w))
+                    {
+                        f(static_cast<uint32_t>(i * 64 + detail_bitset::countr_zero(w)));
+                    }
+                }
+                break;
+            default:
+                for (std::size_t r = 0; r < m_values.size(); r += 2)
+                {
+                    for (uint32_t v = m_values[r]; v <= m_values[r + 1]; ++v)
+                    {
+                        f(v);
+                    }
+                }
+                break;
+            }
+        }
+
+        // Calls f(word_index, word) for each non-zero 64-bit word
+        template <class F>
+        inline void roaring_container::for_each_word(F&& f) const
+        {
+            if (m_kind == container_kind::bitmap)
+            {
+                for (std::size_t i = 0; i < chunk_words; ++i)
+                {
+                    if (m_words[i] != 0)
+                    {
+                        f(i, m_words[i]);
+                    }
+                }
+                return;
+            }
+
+            std::size_t current = npos;
+            uint64_t word = 0;
+            auto add_range = [&](uint32_t first, uint32_t last) {
+                while (first < last)
+                {
+                    std::size_t i = first / 64;
+                    if (i != current)
+                    {
+                        if (current != npos)
+                        {
+                            f(current, word);
+                        }
+                        current = i;
+                        word = 0;
+                    }
+                    uint32_t end = std::min(last, static_cast<uint32_t>((i + 1) * 64));
+                    word |= range_mask(first % 64, static_cast<uint32_t>(end - i * 64));
+                    first = end;
+                }
+            };
+            if (m_kind == container_kind::array)
+            {
+                for (uint16_t v : m_values)
+                {
+                    add_range(v, v + 1u);
+                }
+            }
+            else
+            {
+                for (std::size_t r = 0; r < m_values.size(); r += 2)
+                {
+                    add_range(m_values[r], m_values[r + 1] + 1u);
+                }
+            }
+            if (current != npos)
+            {
+                f(current, word);
+            }
+        }
+
+        inline std::size_t roaring_container::memory_usage() const noexcept
+        {
+            return sizeof(roaring_container) + m_values.capacity() * sizeof(uint16_t) + m_words.capacity() * sizeof(uint64_t);
+        }
+
+        inline bool roaring_container::operator==(const roaring_container& rhs) const noexcept
+        {
+            if (m_cardinality != rhs.m_cardinality)
+            {
+                return false;
+            }
+            if (m_kind == rhs.m_kind)
+            {
+                return m_kind == container_kind::bitmap ? m_words == rhs.m_words : m_values == rhs.m_values;
+            }
+            words_type l, r;
+            to_words(l.data());
+            rhs.to_words(r.data());
+            return l == r;
+        }
+
+        inline bool roaring_container::operator!=(const roaring_container& rhs) const noexcept
+        {
+            return !(*this == rhs);
+        }
+
+        // Index of the last run starting at or before v, or npos
+        inline std::size_t roaring_container::find_run(uint32_t v) const noexcept
+        {
+            std::size_t lo = 0;
+            std::size_t hi = m_values.size() / 2;
+            while (lo < hi)
+            {
+                std::size_t mid = lo + (hi - lo) / 2;
+                if (m_values[2 * mid] <= v)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            return lo == 0 ? npos : lo - 1;
+        }
+    }
+
+    /*************************************
+     * xroaring_reference implementation *
+     *************************************/
+
+    template <bool C>
+    inline xroaring_reference<C>::xroaring_reference(container_pointer c, size_type pos) noexcept
+        : p_container(c), m_pos(pos)
+    {
+    }
+
+    template <bool C>
+    inline xroaring_reference<C>::operator bool() const noexcept
+    {
+        return p_container->test(m_pos);
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator=(const self_type& rhs) -> self_type&
+    {
+        return *this = bool(rhs);
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator=(self_type&& rhs) -> self_type&
+    {
+        return *this = bool(rhs);
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator=(bool rhs) -> self_type&
+    {
+        p_container->set(m_pos, rhs);
+        return *this;
+    }
+
+    template <bool C>
+    inline bool xroaring_reference<C>::operator~() const noexcept
+    {
+        return !bool(*this);
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator&=(bool rhs) -> self_type&
+    {
+        if (!rhs)
+        {
+            p_container->reset(m_pos);
+        }
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator|=(bool rhs) -> self_type&
+    {
+        if (rhs)
+        {
+            p_container->set(m_pos);
+        }
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator^=(bool rhs) -> self_type&
+    {
+        if (rhs)
+        {
+            p_container->flip(m_pos);
+        }
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::flip() -> self_type&
+    {
+        p_container->flip(m_pos);
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_reference<C>::operator&() noexcept -> pointer
+    {
+        return pointer(*this);
+    }
+
+    /************************************
+     * xroaring_iterator implementation *
+     ************************************/
+
+    template <bool C>
+    inline xroaring_iterator<C>::xroaring_iterator() noexcept
+        : p_container(nullptr), m_index(0)
+    {
+    }
+
+    template <bool C>
+    inline xroaring_iterator<C>::xroaring_iterator(container_pointer c, size_type index) noexcept
+        : p_container(c), m_index(index)
+    {
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator++() -> self_type&
+    {
+        ++m_index;
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator--() -> self_type&
+    {
+        --m_index;
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator+=(difference_type n) -> self_type&
+    {
+        m_index = static_cast<size_type>(static_cast<difference_type>(m_index) + n);
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator-=(difference_type n) -> self_type&
+    {
+        m_index = static_cast<size_type>(static_cast<difference_type>(m_index) - n);
+        return *this;
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator-(const self_type& rhs) const -> difference_type
+    {
+        return static_cast<difference_type>(m_index) - static_cast<difference_type>(rhs.m_index);
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator*() const -> reference
+    {
+        return reference(p_container, m_index);
+    }
+
+    template <bool C>
+    inline auto xroaring_iterator<C>::operator->() const -> pointer
+    {
+        return pointer(operator*());
+    }
+
+    template <bool C>
+    inline bool xroaring_iterator<C>::operator==(const self_type& rhs) const
+    {
+        return p_container == rhs.p_container && m_index == rhs.m_index;
+    }
+
+    template <bool C>
+    inline bool xroaring_iterator<C>::operator<(const self_type& rhs) const
+    {
+        return p_container == rhs.p_container && m_index < rhs.m_index;
+    }
+
+    /********************************************
+     * xroaring_set_bit_iterator implementation *
+     ********************************************/
+
+    inline xroaring_set_bit_iterator::xroaring_set_bit_iterator() noexcept
+        : p_container(nullptr), m_index(xroaring_bitset::npos)
+    {
+    }
+
+    inline xroaring_set_bit_iterator::xroaring_set_bit_iterator(const xroaring_bitset* c, size_type index) noexcept
+        : p_container(c), m_index(index)
+    {
+    }
+
+    inline auto xroaring_set_bit_iterator::operator++() -> self_type&
+    {
+        m_index = p_container->find_next(m_index);
+        return *this;
+    }
+
+    inline auto xroaring_set_bit_iterator::operator++(int) -> self_type
+    {
+        self_type tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+
+    inline auto xroaring_set_bit_iterator::operator*() const -> reference
+    {
+        return m_index;
+    }
+
+    inline bool xroaring_set_bit_iterator::operator==(const self_type& rhs) const
+    {
+        return p_container == rhs.p_container && m_index == rhs.m_index;
+    }
+
+    inline bool xroaring_set_bit_iterator::operator!=(const self_type& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    inline xroaring_set_bit_range::xroaring_set_bit_range(const xroaring_bitset& c) noexcept
+        : p_container(&c)
+    {
+    }
+
+    inline auto xroaring_set_bit_range::begin() const noexcept -> iterator
+    {
+        return iterator(p_container, p_container->find_first());
+    }
+
+    inline auto xroaring_set_bit_range::end() const noexcept -> iterator
+    {
+        return iterator(p_container, xroaring_bitset::npos);
+    }
+
+    /**********************************
+     * xroaring_bitset implementation *
+     **********************************/
+
+    inline xroaring_bitset::xroaring_bitset() noexcept
+        : m_size(0)
+    {
+    }
+
+    inline xroaring_bitset::xroaring_bitset(size_type count)
+        : m_size(count)
+    {
+    }
+
+    inline xroaring_bitset::xroaring_bitset(size_type count, bool b)
+        : m_size(count)
+    {
+        if (b)
+        {
+            set();
+        }
+    }
+
+    inline xroaring_bitset::xroaring_bitset(std::initializer_list<bool> init)
+        : m_size(init.size())
+    {
+        size_type i = 0;
+        for (bool b : init)
+        {
+            if (b)
+            {
+                append(i);
+            }
+            ++i;
+        }
+    }
+
+    template <class B>
+    inline xroaring_bitset::xroaring_bitset(const xdynamic_bitset_base<B>& rhs)
+        : m_size(rhs.size())
+    {
+        const auto* data = rhs.data();
+        size_type block_count = rhs.block_count();
+        typename container_type::words_type words;
+        for (size_type key = 0; key * detail_roaring::chunk_bits < m_size; ++key)
+        {
+            for (size_type i = 0; i < detail_roaring::chunk_words; ++i)
+            {
+                words[i] = detail_roaring::load_word(data, block_count, key * detail_roaring::chunk_words + i);
+            }
+            container_type c = container_type::from_words(words.data());
+            if (c.cardinality() != 0)
+            {
+                m_keys.push_back(key);
+                m_containers.push_back(std::move(c));
+            }
+        }
+    }
+
+    template <class B>
+    inline xdynamic_bitset<B> xroaring_bitset::to_dynamic_bitset() const
+    {
+        xdynamic_bitset<B> res(m_size, false);
+        B* data = res.data();
+        size_type block_count = res.block_count();
+        for (size_type i = 0; i < m_keys.size(); ++i)
+        {
+            size_type first_word = m_keys[i] * detail_roaring::chunk_words;
+            m_containers[i].for_each_word([&](std::size_t w, uint64_t word) {
+                detail_roaring::store_word(data, block_count, first_word + w, word);
+            });
+        }
+        return res;
+    }
+
+    inline bool xroaring_bitset::empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    inline auto xroaring_bitset::size() const noexcept -> size_type
+    {
+        return m_size;
+    }
+
+    inline void xroaring_bitset::resize(size_type size, bool b)
+    {
+        size_type old_size = m_size;
+        if (size < old_size)
+        {
+            size_type n = m_keys.size();
+            while (n != 0 && m_keys[n - 1] * detail_roaring::chunk_bits >= size)
+            {
+                --n;
+            }
+            m_keys.resize(n);
+            m_containers.resize(n);
+            if (n != 0 && chunk_limit(m_keys[n - 1]) > size)
+            {
+                uint32_t limit = detail_roaring::chunk_offset(size);
+                m_containers.back() = m_containers.back().truncate(limit);
+                if (m_containers.back().cardinality() == 0)
+                {
+                    m_keys.pop_back();
+                    m_containers.pop_back();
+                }
+            }
+            m_size = size;
+        }
+        else if (size > old_size)
+        {
+            m_size = size;
+            if (b)
+            {
+                self_type tail(size);
+                for (size_type key = detail_roaring::chunk_key(old_size); key * detail_roaring::chunk_bits < size; ++key)
+                {
+                    size_type first = std::max(old_size, key * detail_roaring::chunk_bits) - key * detail_roaring::chunk_bits;
+                    size_type last = chunk_limit(key) - key * detail_roaring::chunk_bits;
+                    tail.m_keys.push_back(key);
+                    tail.m_containers.push_back(container_type::range(static_cast<uint32_t>(first), static_cast<uint32_t>(last)));
+                }
+                *this |= tail;
+            }
+        }
+    }
+
+    inline void xroaring_bitset::clear() noexcept
+    {
+        m_size = 0;
+        m_keys.clear();
+        m_containers.clear();
+    }
+
+    inline void xroaring_bitset::push_back(bool b)
+    {
+        ++m_size;
+        if (b)
+        {
+            append(m_size - 1);
+        }
+    }
+
+    inline void xroaring_bitset::pop_back()
+    {
+        resize(m_size - 1);
+    }
+
+    inline void xroaring_bitset::swap(self_type& rhs) noexcept
+    {
+        std::swap(m_size, rhs.m_size);
+        m_keys.swap(rhs.m_keys);
+        m_containers.swap(rhs.m_containers);
+    }
+
+    inline auto xroaring_bitset::at(size_type i) -> reference
+    {
+        if (i >= m_size)
+        {
+            XTL_THROW(std::out_of_range, "xroaring_bitset::at");
+        }
+        return reference(this, i);
+    }
+
+    inline auto xroaring_bitset::at(size_type i) const -> const_reference
+    {
+        if (i >= m_size)
+        {
+            XTL_THROW(std::out_of_range, "xroaring_bitset::at");
+        }
+        return const_reference(this, i);
+    }
+
+    inline auto xroaring_bitset::operator[](size_type i) -> reference
+    {
+        return reference(this, i);
+    }
+
+    inline auto xroaring_bitset::operator[](size_type i) const -> const_reference
+    {
+        return const_reference(this, i);
+    }
+
+    inline auto xroaring_bitset::front() -> reference
+    {
+        return (*this)[0];
+    }
+
+    inline auto xroaring_bitset::front() const -> const_reference
+    {
+        return (*this)[0];
+    }
+
+    inline auto xroaring_bitset::back() -> reference
+    {
+        return (*this)[m_size - 1];
+    }
+
+    inline auto xroaring_bitset::back() const -> const_reference
+    {
+        return (*this)[m_size - 1];
+    }
+
+    inline bool xroaring_bitset::test(size_type pos) const noexcept
+    {
+        size_type i = find_container(detail_roaring::chunk_key(pos));
+        return i != npos && m_containers[i].test(detail_roaring::chunk_offset(pos));
+    }
+
+    inline auto xroaring_bitset::begin() noexcept -> iterator
+    {
+        return iterator(this, 0);
+    }
+
+    inline auto xroaring_bitset::end() noexcept -> iterator
+    {
+        return iterator(this, m_size);
+    }
+
+    inline auto xroaring_bitset::begin() const noexcept -> const_iterator
+    {
+        return cbegin();
+    }
+
+    inline auto xroaring_bitset::end() const noexcept -> const_iterator
+    {
+        return cend();
+    }
+
+    inline auto xroaring_bitset::cbegin() const noexcept -> const_iterator
+    {
+        return const_iterator(this, 0);
+    }
+
+    inline auto xroaring_bitset::cend() const noexcept -> const_iterator
+    {
+        return const_iterator(this, m_size);
+    }
+
+    inline auto xroaring_bitset::rbegin() noexcept -> reverse_iterator
+    {
+        return reverse_iterator(end());
+    }
+
+    inline auto xroaring_bitset::rend() noexcept -> reverse_iterator
+    {
+        return reverse_iterator(begin());
+    }
+
+    inline auto xroaring_bitset::rbegin() const noexcept -> const_reverse_iterator
+    {
+        return crbegin();
+    }
+
+    inline auto xroaring_bitset::rend() const noexcept -> const_reverse_iterator
+    {
+        return crend();
+    }
+
+    inline auto xroaring_bitset::crbegin() const noexcept -> const_reverse_iterator
+    {
+        return const_reverse_iterator(cend());
+    }
+
+    inline auto xroaring_bitset::crend() const noexcept -> const_reverse_iterator
+    {
+        return const_reverse_iterator(cbegin());
+    }
+
+    inline auto xroaring_bitset::operator&=(const self_type& rhs) -> self_type&
+    {
+        compute_assign<detail_bitset::bitwise_and>(rhs);
+        return *this;
+    }
+
+    inline auto xroaring_bitset::operator|=(const self_type& rhs) -> self_type&
+    {
+        compute_assign<detail_bitset::bitwise_or>(rhs);
+        return *this;
+    }
+
+    inline auto xroaring_bitset::operator^=(const self_type& rhs) -> self_type&
+    {
+        compute_assign<detail_bitset::bitwise_xor>(rhs);
+        return *this;
+    }
+
+    template <class B>
+    inline auto xroaring_bitset::operator&=(const xdynamic_bitset_base<B>& rhs) -> self_type&
+    {
+        return *this &= self_type(rhs);
+    }
+
+    template <class B>
+    inline auto xroaring_bitset::operator|=(const xdynamic_bitset_base<B>& rhs) -> self_type&
+    {
+        return *this |= self_type(rhs);
+    }
+
+    template <class B>
+    inline auto xroaring_bitset::operator^=(const xdynamic_bitset_base<B>& rhs) -> self_type&
+    {
+        return *this ^= self_type(rhs);
+    }
+
+    inline auto xroaring_bitset::operator<<(size_type pos) const -> self_type
+    {
+        self_type tmp(*this);
+        tmp <<= pos;
+        return tmp;
+    }
+
+    inline auto xroaring_bitset::operator<<=(size_type pos) -> self_type&
+    {
+        self_type res(m_size);
+        if (pos < m_size)
+        {
+            for_each_set_bit([&res, pos](size_type i) {
+                if (i + pos < res.m_size)
+                {
+                    res.append(i + pos);
+                }
+            });
+            res.optimize();
+        }
+        swap(res);
+        return *this;
+    }
+
+    inline auto xroaring_bitset::operator>>(size_type pos) const -> self_type
+    {
+        self_type tmp(*this);
+        tmp >>= pos;
+        return tmp;
+    }
+
+    inline auto xroaring_bitset::operator>>=(size_type pos) -> self_type&
+    {
+        self_type res(m_size);
+        if (pos < m_size)
+        {
+            for_each_set_bit([&res, pos](size_type i) {
+                if (i >= pos)
+                {
+                    res.append(i - pos);
+                }
+            });
+            res.optimize();
+        }
+        swap(res);
+        return *this;
+    }
+
+    inline auto xroaring_bitset::set() -> self_type&
+    {
+        m_keys.clear();
+        m_containers.clear();
+        for (size_type key = 0; key * detail_roaring::chunk_bits < m_size; ++key)
+        {
+            uint32_t last = static_cast<uint32_t>(chunk_limit(key) - key * detail_roaring::chunk_bits);
+            m_keys.push_back(key);
+            m_containers.push_back(container_type::range(0, last));
+        }
+        return *this;
+    }
+
+    inline auto xroaring_bitset::set(size_type pos, value_type value) -> self_type&
+    {
+        if (!value)
+        {
+            return reset(pos);
+        }
+        size_type key = detail_roaring::chunk_key(pos);
+        auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+        size_type i = static_cast<size_type>(it - m_keys.begin());
+        if (it == m_keys.end() || *it != key)
+        {
+            m_keys.insert(it, key);
+            m_containers.insert(m_containers.begin() + static_cast<difference_type>(i), container_type());
+        }
+        m_containers[i].set(detail_roaring::chunk_offset(pos));
+        return *this;
+    }
+
+    inline auto xroaring_bitset::reset() -> self_type&
+    {
+        m_keys.clear();
+        m_containers.clear();
+        return *this;
+    }
+
+    inline auto xroaring_bitset::reset(size_type pos) -> self_type&
+    {
+        size_type i = find_container(detail_roaring::chunk_key(pos));
+        if (i != npos)
+        {
+            m_containers[i].reset(detail_roaring::chunk_offset(pos));
+            if (m_containers[i].cardinality() == 0)
+            {
+                m_keys.erase(m_keys.begin() + static_cast<difference_type>(i));
+                m_containers.erase(m_containers.begin() + static_cast<difference_type>(i));
+            }
+        }
+        return *this;
+    }
+
+    inline auto xroaring_bitset::flip() -> self_type&
+    {
+        std::vector<size_type> keys;
+        std::vector<container_type> containers;
+        size_type i = 0;
+        for (size_type key = 0; key * detail_roaring::chunk_bits < m_size; ++key)
+        {
+            uint32_t last = static_cast<uint32_t>(chunk_limit(key) - key * detail_roaring::chunk_bits);
+            container_type c = i < m_keys.size() && m_keys[i] == key
+                ? m_containers[i++].complement(last)
+                : container_type::range(0, last);
+            if (c.cardinality() != 0)
+            {
+                keys.push_back(key);
+                containers.push_back(std::move(c));
+            }
+        }
+        m_keys.swap(keys);
+        m_containers.swap(containers);
+        return *this;
+    }
+
+    inline auto xroaring_bitset::flip(size_type pos) -> self_type&
+    {
+        return set(pos, !test(pos));
+    }
+
+    inline bool xroaring_bitset::all() const noexcept
+    {
+        return count() == m_size;
+    }
+
+    inline bool xroaring_bitset::any() const noexcept
+    {
+        return !m_containers.empty();
+    }
+
+    inline bool xroaring_bitset::none() const noexcept
+    {
+        return !any();
+    }
+
+    inline auto xroaring_bitset::count() const noexcept -> size_type
+    {
+        size_type res = 0;
+        for (const auto& c : m_containers)
+        {
+            res += c.cardinality();
+        }
+        return res;
+    }
+
+    inline auto xroaring_bitset::find_first() const noexcept -> size_type
+    {
+        return m_keys.empty() ? npos : m_keys.front() * detail_roaring::chunk_bits + m_containers.front().next_set(0);
+    }
+
+    /**
+     * Returns the index of the first set bit after pos, or npos.
+     */
+    inline auto xroaring_bitset::find_next(size_type pos) const noexcept -> size_type
+    {
+        if (pos == npos || ++pos >= m_size)
+        {
+            return npos;
+        }
+        size_type key = detail_roaring::chunk_key(pos);
+        auto it = std::lower_bound(m_keys.cbegin(), m_keys.cend(), key);
+        if (it == m_keys.cend())
+        {
+            return npos;
+        }
+        size_type i = static_cast<size_type>(it - m_keys.cbegin());
+        if (*it == key)
+        {
+            uint32_t v = m_containers[i].next_set(detail_roaring::chunk_offset(pos));
+            if (v != detail_roaring::chunk_bits)
+            {
+                return key * detail_roaring::chunk_bits + v;
+            }
+            if (++i == m_keys.size())
+            {
+                return npos;
+            }
+        }
+        return m_keys[i] * detail_roaring::chunk_bits + m_containers[i].next_set(0);
+    }
+
+    inline auto xroaring_bitset::set_bits() const noexcept -> set_bit_range
+    {
+        return set_bit_range(*this);
+    }
+
+    /**
+     * Calls f(index) for each set bit, in increasing order.
+     */
+    template <class F>
+    inline void xroaring_bitset::for_each_set_bit(F&& f) const
+    {
+        for (size_type i = 0; i < m_keys.size(); ++i)
+        {
+            size_type first = m_keys[i] * detail_roaring::chunk_bits;
+            m_containers[i].for_each([&f, first](uint32_t v) { f(first + v); });
+        }
+    }
+
+    /**
+     * Calls f(first, block) for each non-zero 64-bit block, where first is
+     * the index of the bit 0 of block.
+     */
+    template <class F>
+    inline void xroaring_bitset::for_each_set_block(F&& f) const
+    {
+        for (size_type i = 0; i < m_keys.size(); ++i)
+        {
+            size_type first = m_keys[i] * detail_roaring::chunk_bits;
+            m_containers[i].for_each_word([&f, first](std::size_t w, uint64_t word) { f(first + w * 64, word); });
+        }
+    }
+
+    /**
+     * Recompresses every chunk in its smallest representation.
+     */
+    inline void xroaring_bitset::optimize()
+    {
+        for (auto& c : m_containers)
+        {
+            c.optimize();
+        }
+    }
+
+    inline auto xroaring_bitset::container_count() const noexcept -> size_type
+    {
+        return m_containers.size();
+    }
+
+    /**
+     * Returns the number of bytes used by the bitset and its chunks.
+     */
+    inline auto xroaring_bitset::memory_usage() const noexcept -> size_type
+    {
+        size_type res = sizeof(self_type) + m_keys.capacity() * sizeof(size_type);
+        res += (m_containers.capacity() - m_containers.size()) * sizeof(container_type);
+        for (const auto& c : m_containers)
+        {
+            res += c.memory_usage();
+        }
+        return res;
+    }
+
+    inline bool xroaring_bitset::operator==(const self_type& rhs) const noexcept
+    {
+        return m_size == rhs.m_size && m_keys == rhs.m_keys && m_containers == rhs.m_containers;
+    }
+
+    inline bool xroaring_bitset::operator!=(const self_type& rhs) const noexcept
+    {
+        return !(*this == rhs);
+    }
+
+    template <class B>
+    inline bool xroaring_bitset::operator==(const xdynamic_bitset_base<B>& rhs) const
+    {
+        return *this == self_type(rhs);
+    }
+
+    template <class B>
+    inline bool xroaring_bitset::operator!=(const xdynamic_bitset_base<B>& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    inline auto xroaring_bitset::find_container(size_type key) const noexcept -> size_type
+    {
+        auto it = std::lower_bound(m_keys.cbegin(), m_keys.cend(), key);
+        return it != m_keys.cend() && *it == key ? static_cast<size_type>(it - m_keys.cbegin()) : npos;
+    }
+
+    // End of the valid bits of the chunk key
+    inline auto xroaring_bitset::chunk_limit(size_type key) const noexcept -> size_type
+    {
+        return std::min(m_size, (key + 1) * detail_roaring::chunk_bits);
+    }
+
+    // Sets pos, which must be greater than the last set bit
+    inline void xroaring_bitset::append(size_type pos)
+    {
+        size_type key = detail_roaring::chunk_key(pos);
+        if (m_keys.empty() || m_keys.back() != key)
+        {
+            m_keys.push_back(key);
+            m_containers.emplace_back();
+        }
+        m_containers.back().set(detail_roaring::chunk_offset(pos));
+    }
+
+    template <class OP>
+    inline void xroaring_bitset::compute_assign(const self_type& rhs)
+    {
+        constexpr bool is_and = std::is_same<OP, detail_bitset::bitwise_and>::value;
+        std::vector<size_type> keys;
+        std::vector<container_type> containers;
+        size_type i = 0, j = 0;
+        while (i < m_keys.size() || j < rhs.m_keys.size())
+        {
+            bool has_lhs = i < m_keys.size() && (j == rhs.m_keys.size() || m_keys[i] <= rhs.m_keys[j]);
+            bool has_rhs = j < rhs.m_keys.size() && (i == m_keys.size() || rhs.m_keys[j] <= m_keys[i]);
+            if (has_lhs && has_rhs)
+            {
+                container_type c = container_type::combine<OP>(m_containers[i], rhs.m_containers[j]);
+                if (c.cardinality() != 0)
+                {
+                    keys.push_back(m_keys[i]);
+                    containers.push_back(std::move(c));
+                }
+                ++i;
+                ++j;
+            }
+            else if (has_lhs)
+            {
+                if (!is_and)
+                {
+                    keys.push_back(m_keys[i]);
+                    containers.push_back(std::move(m_containers[i]));
+                }
+                ++i;
+            }
+            else
+            {
+                if (!is_and)
+                {
+                    keys.push_back(rhs.m_keys[j]);
+                    containers.push_back(rhs.m_containers[j]);
+                }
+                ++j;
+            }
+        }
+        m_keys.swap(keys);
+        m_containers.swap(containers);
+    }
+
+    /*********************************
+     * free functions implementation *
+     *********************************/
+
+    inline xroaring_bitset operator~(const xroaring_bitset& lhs)
+    {
+        xroaring_bitset res(lhs);
+        res.flip();
+        return res;
+    }
+
+    inline xroaring_bitset operator&(const xroaring_bitset& lhs, const xroaring_bitset& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res &= rhs;
+        return res;
+    }
+
+    inline xroaring_bitset operator|(const xroaring_bitset& lhs, const xroaring_bitset& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res |= rhs;
+        return res;
+    }
+
+    inline xroaring_bitset operator^(const xroaring_bitset& lhs, const xroaring_bitset& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res ^= rhs;
+        return res;
+    }
+
+    template <class B>
+    inline xroaring_bitset operator&(const xroaring_bitset& lhs, const xdynamic_bitset_base<B>& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res &= rhs;
+        return res;
+    }
+
+    template <class B>
+    inline xroaring_bitset operator|(const xroaring_bitset& lhs, const xdynamic_bitset_base<B>& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res |= rhs;
+        return res;
+    }
+
+    template <class B>
+    inline xroaring_bitset operator^(const xroaring_bitset& lhs, const xdynamic_bitset_base<B>& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res ^= rhs;
+        return res;
+    }
+
+    template <class B>
+    inline xroaring_bitset operator&(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res &= rhs;
+        return res;
+    }
+
+    template <class B>
+    inline xroaring_bitset operator|(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res |= rhs;
+        return res;
+    }
+
+    template <class B>
+    inline xroaring_bitset operator^(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        xroaring_bitset res(lhs);
+        res ^= rhs;
+        return res;
+    }
+
+    namespace detail_roaring
+    {
+        // Applies OP between the words of a flat bitset and the chunks of a
+        // compressed one, chunks missing in rhs count as zero.
+        template <class OP, class B>
+        inline void compute_assign(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+        {
+            constexpr bool is_and = std::is_same<OP, detail_bitset::bitwise_and>::value;
+            auto* data = lhs.data();
+            std::size_t block_count = lhs.block_count();
+            std::size_t word_count = (lhs.size() + 63) / 64;
+            std::size_t next_word = 0;
+            rhs.for_each_set_block([&](std::size_t first, uint64_t word) {
+                std::size_t w = first / 64;
+                if (w >= word_count)
+                {
+                    return;
+                }
+                if (is_and)
+                {
+                    for (; next_word < w; ++next_word)
+                    {
+                        store_word(data, block_count, next_word, uint64_t(0));
+                    }
+                    next_word = w + 1;
+                }
+                store_word(data, block_count, w, OP::apply(load_word(data, block_count, w), word));
+            });
+            if (is_and)
+            {
+                for (; next_word < word_count; ++next_word)
+                {
+                    store_word(data, block_count, next_word, uint64_t(0));
+                }
+            }
+        }
+    }
+
+    template <class B>
+    inline xdynamic_bitset_base<B>& operator&=(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        detail_roaring::compute_assign<detail_bitset::bitwise_and>(lhs, rhs);
+        return lhs;
+    }
+
+    template <class B>
+    inline xdynamic_bitset_base<B>& operator|=(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        detail_roaring::compute_assign<detail_bitset::bitwise_or>(lhs, rhs);
+        return lhs;
+    }
+
+    template <class B>
+    inline xdynamic_bitset_base<B>& operator^=(xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        detail_roaring::compute_assign<detail_bitset::bitwise_xor>(lhs, rhs);
+        return lhs;
+    }
+
+    template <class B>
+    inline bool operator==(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        return rhs == lhs;
+    }
+
+    template <class B>
+    inline bool operator!=(const xdynamic_bitset_base<B>& lhs, const xroaring_bitset& rhs)
+    {
+        return !(rhs == lhs);
+    }
+
+    inline void swap(xroaring_bitset& lhs, xroaring_bitset& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif
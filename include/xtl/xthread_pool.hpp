@@ -0,0 +1,222 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTL_THREAD_POOL_HPP
+#define XTL_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xtl
+{
+    /****************
+     * xthread_pool *
+     ****************/
+
+    /**
+     * Fixed-size pool of worker threads running fork-join loops.
+     *
+     * parallel_for(n, task) calls task(i) for every i in [0, n) and returns
+     * once all the calls have completed. The calling thread takes part in the
+     * loop, so a pool of concurrency() threads spawns concurrency() - 1
+     * workers. Loops submitted concurrently from different threads are run
+     * one after the other; a loop submitted from inside a task is run serially
+     * by the calling thread. Tasks must not throw.
+     *
+     * Any type providing the same parallel_for member can be used wherever
+     * xtl expects an executor.
+     */
+    class xthread_pool
+    {
+    public:
+
+        using size_type = std::size_t;
+
+        xthread_pool();
+        explicit xthread_pool(size_type thread_count);
+        ~xthread_pool();
+
+        xthread_pool(const xthread_pool&) = delete;
+        xthread_pool& operator=(const xthread_pool&) = delete;
+
+        xthread_pool(xthread_pool&&) = delete;
+        xthread_pool& operator=(xthread_pool&&) = delete;
+
+        size_type concurrency() const noexcept;
+
+        template <class F>
+        void parallel_for(size_type task_count, F&& task);
+
+    private:
+
+        using task_function = void (*)(void*, size_type);
+
+        void worker_loop();
+        void run_tasks() noexcept;
+
+        static bool& in_task() noexcept;
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_submit_mutex;
+        std::mutex m_mutex;
+        std::condition_variable m_start;
+        std::condition_variable m_done;
+
+        task_function p_function;
+        void* p_task;
+        size_type m_task_count;
+        std::atomic<size_type> m_next_task;
+        size_type m_busy_workers;
+        size_type m_generation;
+        bool m_stop;
+    };
+
+    xthread_pool& default_thread_pool();
+
+    /*******************************
+     * xthread_pool implementation *
+     *******************************/
+
+    /**
+     * Builds a pool using all the hardware threads.
+     */
+    inline xthread_pool::xthread_pool()
+        : xthread_pool(static_cast<size_type>(std::thread::hardware_concurrency()))
+    {
+    }
+
+    inline xthread_pool::xthread_pool(size_type thread_count)
+        : p_function(nullptr), p_task(nullptr), m_task_count(0), m_next_task(0),
+          m_busy_workers(0), m_generation(0), m_stop(false)
+    {
+        size_type worker_count = thread_count > 1 ? thread_count - 1 : 0;
+        m_workers.reserve(worker_count);
+        for (size_type i = 0; i < worker_count; ++i)
+        {
+            m_workers.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    inline xthread_pool::~xthread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * Returns the number of threads running the tasks, including the caller.
+     */
+    inline auto xthread_pool::concurrency() const noexcept -> size_type
+    {
+        return m_workers.size() + 1;
+    }
+
+    template <class F>
+    inline void xthread_pool::parallel_for(size_type task_count, F&& task)
+    {
+        if (task_count <= 1 || m_workers.empty() || in_task())
+        {
+            for (size_type i = 0; i < task_count; ++i)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        using task_type = std::remove_reference_t<F>;
+        std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            p_function = [](void* t, size_type i) { (*static_cast<task_type*>(t))(i); };
+            p_task = const_cast<void*>(static_cast<const void*>(std::addressof(task)));
+            m_task_count = task_count;
+            m_next_task.store(0, std::memory_order_relaxed);
+            m_busy_workers = m_workers.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+
+        run_tasks();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_busy_workers == 0; });
+    }
+
+    inline void xthread_pool::worker_loop()
+    {
+        size_type generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&]() { return m_stop || m_generation != generation; });
+                if (m_stop)
+                {
+                    return;
+                }
+                generation = m_generation;
+            }
+
+            run_tasks();
+
+            bool last = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                last = --m_busy_workers == 0;
+            }
+            if (last)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    inline void xthread_pool::run_tasks() noexcept
+    {
+        bool& flag = in_task();
+        flag = true;
+        for (size_type i = m_next_task.fetch_add(1, std::memory_order_relaxed); i < m_task_count;
+             i = m_next_task.fetch_add(1, std::memory_order_relaxed))
+        {
+            p_function(p_task, i);
+        }
+        flag = false;
+    }
+
+    inline bool& xthread_pool::in_task() noexcept
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    /**
+     * Returns the pool shared by the parallel algorithms of xtl when no
+     * executor is provided. It is built on first use.
+     */
+    inline xthread_pool& default_thread_pool()
+    {
+        static xthread_pool pool;
+        return pool;
+    }
+}
+
+#endif
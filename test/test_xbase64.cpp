@@ -9,7 +9,16 @@
 
 #include "xtl/xbase64.hpp"
 
+#include <algorithm>
 #include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "test_common_macros.hpp"
 
@@ -36,5 +45,430 @@ namespace xtl
        EXPECT_EQ(base64decode("Zm9vYmE="), "fooba");
        EXPECT_EQ(base64decode("Zm9vYmFy"), "foobar");
     }
-}
 
+    // Byte at a time implementation the kernels must agree with
+    inline std::string reference_base64decode(const std::string& input)
+    {
+        const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string output;
+        unsigned int val = 0;
+        int valb = -8;
+        for (char c : input)
+        {
+            std::size_t pos = alphabet.find(c);
+            if (pos == std::string::npos)
+            {
+                break;
+            }
+            val = ((val << 6) & 0xFFFFFFu) + static_cast<unsigned int>(pos);
+            valb += 6;
+            if (valb >= 0)
+            {
+                output.push_back(char((val >> valb) & 0xFF));
+                valb -= 8;
+            }
+        }
+        return output;
+    }
+
+    inline std::string make_base64_input(std::size_t size, uint32_t seed)
+    {
+        std::string res(size, '\0');
+        for (auto& c : res)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            c = static_cast<char>(seed >> 24);
+        }
+        return res;
+    }
+
+    TEST(xbase64, round_trip)
+    {
+        for (std::size_t size = 0; size < 300; ++size)
+        {
+            std::string input = make_base64_input(size, static_cast<uint32_t>(size));
+            std::string encoded = base64encode(input);
+            EXPECT_EQ(encoded.size(), (size + 2) / 3 * 4);
+            EXPECT_EQ(base64decode(encoded), input);
+            EXPECT_EQ(reference_base64decode(encoded), input);
+        }
+    }
+
+    TEST(xbase64, invalid_characters)
+    {
+        // Decoding stops at the first character outside of the alphabet
+        std::string encoded = base64encode(make_base64_input(150, 7u));
+        const char invalid[] = {'=', '\n', ' ', '-', '\0', static_cast<char>(0xC3)};
+        for (std::size_t pos = 0; pos < encoded.size(); pos += 3)
+        {
+            for (char c : invalid)
+            {
+                std::string input = encoded;
+                input[pos] = c;
+                EXPECT_EQ(base64decode(input), reference_base64decode(input));
+            }
+        }
+        EXPECT_EQ(base64decode("Zm9vYmFy\nZm9v"), "foobar");
+        EXPECT_EQ(base64decode("Zm9vYg"), "foob");
+    }
+
+    TEST(xbase64, kernels)
+    {
+        std::string input = make_base64_input(1000, 42u);
+        std::string expected = base64encode(input);
+        const auto* in = reinterpret_cast<const unsigned char*>(input.data());
+        const auto* encoded = reinterpret_cast<const unsigned char*>(expected.data());
+
+        std::string encode_res(expected.size(), '\0');
+        // Room for the padding characters, as in base64decode
+        std::size_t decode_size = expected.size() / 4 * 3;
+        std::string decode_res(decode_size, '\0');
+        auto* decode_out = reinterpret_cast<unsigned char*>(&decode_res[0]);
+
+        detail::base64_encode_scalar(in, input.size(), &encode_res[0]);
+        EXPECT_EQ(encode_res, expected);
+        EXPECT_EQ(detail::base64_decode_scalar(encoded, expected.size(), decode_out), input.size());
+        EXPECT_EQ(decode_res.substr(0, input.size()), input);
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        const cpu_features& features = available_cpu_features();
+        if (features.sse4_1)
+        {
+            encode_res.assign(expected.size(), '\0');
+            decode_res.assign(decode_size, '\0');
+            detail::base64_encode_sse41(in, input.size(), &encode_res[0]);
+            EXPECT_EQ(encode_res, expected);
+            EXPECT_EQ(detail::base64_decode_sse41(encoded, expected.size(), decode_out), input.size());
+            EXPECT_EQ(decode_res.substr(0, input.size()), input);
+        }
+        if (features.avx2)
+        {
+            encode_res.assign(expected.size(), '\0');
+            decode_res.assign(decode_size, '\0');
+            detail::base64_encode_avx2(in, input.size(), &encode_res[0]);
+            EXPECT_EQ(encode_res, expected);
+            EXPECT_EQ(detail::base64_decode_avx2(encoded, expected.size(), decode_out), input.size());
+            EXPECT_EQ(decode_res.substr(0, input.size()), input);
+        }
+#endif
+    }
+
+    TEST(xbase64, sizes)
+    {
+        EXPECT_EQ(base64_encoded_size(0), 0u);
+        EXPECT_EQ(base64_encoded_size(1), 4u);
+        EXPECT_EQ(base64_encoded_size(3), 4u);
+        EXPECT_EQ(base64_encoded_size(4), 8u);
+        for (std::size_t size = 0; size < 100; ++size)
+        {
+            std::string encoded = base64encode(make_base64_input(size, 3u));
+            EXPECT_EQ(base64_decoded_size(encoded), size);
+            // Without padding
+            std::string unpadded = encoded.substr(0, encoded.find('='));
+            EXPECT_EQ(base64_decoded_size(unpadded), size);
+        }
+    }
+
+    TEST(xbase64, span)
+    {
+        std::string input = make_base64_input(1000, 11u);
+        std::string expected = base64encode(input);
+
+        std::vector<char> encoded(base64_encoded_size(input.size()));
+        EXPECT_EQ(base64encode(input, span<char>(encoded)), expected.size());
+        EXPECT_EQ(std::string(encoded.begin(), encoded.end()), expected);
+
+        std::vector<std::byte> bytes(input.size());
+        std::memcpy(bytes.data(), input.data(), input.size());
+        std::vector<char> encoded_bytes(expected.size());
+        EXPECT_EQ(base64encode(span<const std::byte>(bytes), span<char>(encoded_bytes)), expected.size());
+        EXPECT_TRUE(encoded_bytes == encoded);
+
+        // Exact output size, the padding is not decoded
+        std::vector<char> decoded(base64_decoded_size(expected));
+        EXPECT_EQ(decoded.size(), input.size());
+        EXPECT_EQ(base64decode(expected, span<char>(decoded)), input.size());
+        EXPECT_EQ(std::string(decoded.begin(), decoded.end()), input);
+
+        std::vector<std::byte> decoded_bytes(input.size());
+        EXPECT_EQ(base64decode(expected, span<std::byte>(decoded_bytes)), input.size());
+        EXPECT_TRUE(decoded_bytes == bytes);
+
+        encoded.pop_back();
+        EXPECT_THROW(base64encode(input, span<char>(encoded)), std::length_error);
+        decoded.pop_back();
+        EXPECT_THROW(base64decode(expected, span<char>(decoded)), std::length_error);
+    }
+
+    TEST(xbase64, output_iterator)
+    {
+        for (std::size_t size : {0u, 5u, 767u, 768u, 769u, 5000u})
+        {
+            std::string input = make_base64_input(size, 5u);
+            std::string expected = base64encode(input);
+
+            std::string encoded;
+            base64encode(input, std::back_inserter(encoded));
+            EXPECT_EQ(encoded, expected);
+
+            std::vector<char> decoded;
+            base64decode(expected, std::back_inserter(decoded));
+            EXPECT_EQ(std::string(decoded.begin(), decoded.end()), input);
+        }
+
+        // Decoding stops at the first invalid character, as base64decode
+        std::string input = base64encode(make_base64_input(2000, 9u));
+        input[1500] = '*';
+        std::string decoded;
+        base64decode(input, std::back_inserter(decoded));
+        EXPECT_EQ(decoded, base64decode(input));
+        EXPECT_EQ(decoded.size(), 1125u);
+    }
+
+    TEST(xbase64, encoder)
+    {
+        std::string input = make_base64_input(10000, 13u);
+        std::string expected = base64encode(input);
+        for (std::size_t chunk : {1u, 2u, 5u, 64u, 1000u, 20000u})
+        {
+            xbase64_encoder encoder;
+            std::string encoded;
+            for (std::size_t i = 0; i < input.size(); i += chunk)
+            {
+                std::size_t count = std::min(chunk, input.size() - i);
+                std::size_t expected_size = encoded.size() + encoder.update_size(count);
+                encoder.update(span<const char>(input.data() + i, count), std::back_inserter(encoded));
+                EXPECT_EQ(encoded.size(), expected_size);
+            }
+            EXPECT_EQ(encoder.pending(), input.size() % 3);
+            encoder.finalize(std::back_inserter(encoded));
+            EXPECT_EQ(encoded, expected);
+            EXPECT_EQ(encoder.pending(), 0u);
+        }
+
+        // Raw pointer output
+        xbase64_encoder encoder;
+        std::vector<char> buffer(base64_encoded_size(input.size()));
+        char* last = encoder.update(span<const char>(input.data(), 4000), buffer.data());
+        last = encoder.update(span<const char>(input.data() + 4000, 6000), last);
+        last = encoder.finalize(last);
+        EXPECT_EQ(static_cast<std::size_t>(last - buffer.data()), expected.size());
+        EXPECT_EQ(std::string(buffer.begin(), buffer.end()), expected);
+    }
+
+    TEST(xbase64, decoder)
+    {
+        std::string input = make_base64_input(10000, 17u);
+        std::string encoded = base64encode(input);
+        for (std::size_t chunk : {1u, 3u, 7u, 64u, 1001u, 20000u})
+        {
+            xbase64_decoder decoder;
+            std::string decoded;
+            for (std::size_t i = 0; i < encoded.size(); i += chunk)
+            {
+                std::size_t count = std::min(chunk, encoded.size() - i);
+                decoder.update(span<const char>(encoded.data() + i, count), std::back_inserter(decoded));
+            }
+            EXPECT_TRUE(decoder.stopped());
+            decoder.finalize(std::back_inserter(decoded));
+            EXPECT_EQ(decoded, input);
+        }
+
+        // Same result as base64decode when stopping early or without padding
+        std::string broken = encoded;
+        broken[5001] = '.';
+        std::string unpadded = encoded.substr(0, encoded.find('='));
+        for (const std::string& text : {broken, unpadded})
+        {
+            for (std::size_t chunk : {1u, 6u, 999u})
+            {
+                xbase64_decoder decoder;
+                std::string decoded;
+                for (std::size_t i = 0; i < text.size(); i += chunk)
+                {
+                    std::size_t count = std::min(chunk, text.size() - i);
+                    decoder.update(span<const char>(text.data() + i, count), std::back_inserter(decoded));
+                }
+                decoder.finalize(std::back_inserter(decoded));
+                EXPECT_EQ(decoded, base64decode(text));
+            }
+        }
+    }
+
+    TEST(xbase64, stream)
+    {
+        std::string input = make_base64_input(100000, 19u);
+        std::string expected = base64encode(input);
+
+        std::ostringstream encoded;
+        {
+            xbase64_ostream stream(encoded);
+            for (std::size_t i = 0; i < input.size(); i += 777)
+            {
+                stream.write(input.data() + i, static_cast<std::streamsize>(std::min<std::size_t>(777, input.size() - i)));
+            }
+            stream.flush();
+            // Only complete groups are written before close
+            EXPECT_EQ(encoded.str().size(), input.size() / 3 * 4);
+            stream.close();
+            EXPECT_TRUE(stream.good());
+        }
+        EXPECT_EQ(encoded.str(), expected);
+
+        // Padding written on destruction
+        std::ostringstream destroyed;
+        {
+            xbase64_ostream stream(destroyed);
+            stream << "foob";
+        }
+        EXPECT_EQ(destroyed.str(), "Zm9vYg==");
+
+        std::istringstream source(expected);
+        xbase64_istream stream(source);
+        std::string decoded;
+        std::vector<char> buffer(1000);
+        while (stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || stream.gcount() > 0)
+        {
+            decoded.append(buffer.data(), static_cast<std::size_t>(stream.gcount()));
+        }
+        EXPECT_EQ(decoded, input);
+
+        std::istringstream text("Zm9vYmFy");
+        xbase64_istream word(text);
+        std::string res;
+        word >> res;
+        EXPECT_EQ(res, "foobar");
+    }
+
+    TEST(xbase64, codec)
+    {
+        using url_codec = xbase64_url_codec;
+        EXPECT_EQ(url_codec::encode("\xfb\xff"), "-_8");
+        EXPECT_EQ(url_codec::decode("-_8"), "\xfb\xff");
+        EXPECT_EQ(xbase64_codec<>::encode("\xfb\xff"), "+/8=");
+        EXPECT_EQ(xbase64_codec<base64_url_alphabet>::encode("\xfb\xff"), "-_8=");
+        EXPECT_EQ(url_codec::encoded_size(4), 6u);
+        EXPECT_EQ(xbase64_codec<>::encoded_size(4), 8u);
+
+        for (std::size_t size = 0; size < 300; ++size)
+        {
+            std::string input = make_base64_input(size, static_cast<uint32_t>(size));
+            std::string encoded = xbase64_codec<>::encode(input);
+            EXPECT_EQ(encoded, base64encode(input));
+            EXPECT_EQ(xbase64_codec<>::decode(encoded), input);
+
+            std::string url = url_codec::encode(input);
+            std::string expected = encoded.substr(0, encoded.find('='));
+            std::replace(expected.begin(), expected.end(), '+', '-');
+            std::replace(expected.begin(), expected.end(), '/', '_');
+            EXPECT_EQ(url, expected);
+            EXPECT_EQ(url_codec::decode(url), input);
+            EXPECT_EQ(url_codec::validate(url), url_codec::npos);
+        }
+
+        std::vector<char> output(2);
+        EXPECT_THROW(url_codec::encode(span<const char>("abc", 3), output), std::length_error);
+        EXPECT_THROW(url_codec::decode(span<const char>("YWJj", 4), output), std::length_error);
+    }
+
+    // Both extra characters share their high nibble with letters of another
+    // offset, which the lookups of the vector decoders cannot represent
+    struct base64_tilde_alphabet
+    {
+        static constexpr char value_62 = '~';
+        static constexpr char value_63 = '_';
+    };
+
+    TEST(xbase64, codec_custom_alphabet)
+    {
+        using codec = xbase64_codec<base64_tilde_alphabet>;
+        EXPECT_TRUE(detail::base64_tables<base64_standard_alphabet>::decode_luts.fits);
+        EXPECT_TRUE(detail::base64_tables<base64_url_alphabet>::decode_luts.fits);
+        EXPECT_FALSE(detail::base64_tables<base64_tilde_alphabet>::decode_luts.fits);
+        for (std::size_t size : {0u, 1u, 47u, 48u, 100u, 1000u})
+        {
+            std::string input = make_base64_input(size, static_cast<uint32_t>(size + 7));
+            std::string expected = base64encode(input);
+            std::replace(expected.begin(), expected.end(), '+', '~');
+            std::replace(expected.begin(), expected.end(), '/', '_');
+            std::string encoded = codec::encode(input);
+            EXPECT_EQ(encoded, expected);
+            EXPECT_EQ(codec::validate(encoded), codec::npos);
+            EXPECT_EQ(codec::decode(encoded), input);
+        }
+        std::string invalid = codec::encode(make_base64_input(300, 3u));
+        invalid[200] = '+';
+        EXPECT_EQ(codec::validate(invalid), 200u);
+    }
+
+    TEST(xbase64, codec_padding)
+    {
+        using required = xbase64_codec<base64_standard_alphabet, base64_padding::required>;
+        using optional = xbase64_codec<base64_standard_alphabet, base64_padding::optional>;
+        using omitted = xbase64_codec<base64_standard_alphabet, base64_padding::omitted>;
+
+        EXPECT_TRUE(required::is_valid(std::string("Zm8=")));
+        EXPECT_EQ(required::validate(std::string("Zm8")), 3u);
+        EXPECT_EQ(required::validate(std::string("Zm8==")), 4u);
+        EXPECT_EQ(required::validate(std::string("Zm9v=")), 4u);
+        EXPECT_EQ(required::validate(std::string("=")), 0u);
+
+        EXPECT_TRUE(optional::is_valid(std::string("Zm8=")));
+        EXPECT_TRUE(optional::is_valid(std::string("Zm8")));
+        EXPECT_EQ(optional::validate(std::string("Zg=")), 3u);
+        EXPECT_EQ(optional::decode("Zg"), "f");
+        EXPECT_EQ(optional::decode("Zg=="), "f");
+
+        EXPECT_TRUE(omitted::is_valid(std::string("Zg")));
+        EXPECT_EQ(omitted::validate(std::string("Zg==")), 2u);
+        EXPECT_EQ(omitted::decode("Zm9vYg"), "foob");
+        EXPECT_THROW(omitted::decode("Zm9vYg=="), std::runtime_error);
+
+        // Dangling character and non-zero trailing bits
+        EXPECT_EQ(optional::validate(std::string("Zm9vY")), 4u);
+        EXPECT_EQ(optional::validate(std::string("Zh")), 1u);
+        EXPECT_EQ(optional::validate(std::string("Zm9=")), 2u);
+        EXPECT_THROW(optional::decode("Zh=="), std::runtime_error);
+        EXPECT_TRUE(optional::is_valid(std::string("")));
+    }
+
+    TEST(xbase64, validate)
+    {
+        using codec = xbase64_codec<>;
+        std::string encoded = base64encode(make_base64_input(300, 5u));
+        EXPECT_EQ(codec::validate(encoded), codec::npos);
+        const char invalid[] = {'\n', ' ', '-', '_', '\0', '=', static_cast<char>(0xC3)};
+        for (std::size_t pos = 0; pos + 4 < encoded.size(); ++pos)
+        {
+            for (char c : invalid)
+            {
+                std::string input = encoded;
+                input[pos] = c;
+                input[pos + 3] = c;
+                EXPECT_EQ(codec::validate(input), pos);
+                EXPECT_THROW(codec::decode(input), std::runtime_error);
+            }
+        }
+        EXPECT_EQ(xbase64_url_codec::validate(std::string("ab+c")), 2u);
+        EXPECT_EQ(xbase64_url_codec::validate(std::string("ab/c")), 2u);
+
+        const auto* in = reinterpret_cast<const unsigned char*>(encoded.data());
+        std::string input = encoded;
+        input[201] = '.';
+        const auto* bad = reinterpret_cast<const unsigned char*>(input.data());
+        EXPECT_EQ(detail::base64_validate_scalar(in, encoded.size() - 1), encoded.size() - 1);
+        EXPECT_EQ(detail::base64_validate_scalar(bad, input.size()), 201u);
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        const cpu_features& features = available_cpu_features();
+        if (features.sse4_1)
+        {
+            EXPECT_EQ(detail::base64_validate_sse41(in, encoded.size() - 1), encoded.size() - 1);
+            EXPECT_EQ(detail::base64_validate_sse41(bad, input.size()), 201u);
+        }
+        if (features.avx2)
+        {
+            EXPECT_EQ(detail::base64_validate_avx2(in, encoded.size() - 1), encoded.size() - 1);
+            EXPECT_EQ(detail::base64_validate_avx2(bad, input.size()), 201u);
+        }
+#endif
+    }
+}
@@ -7,6 +7,10 @@
 ****************************************************************************/
 
 
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
 #include "xtl/xbasic_fixed_string.hpp"
 
 #ifdef HAVE_NLOHMANN_JSON
@@ -1166,6 +1170,64 @@ namespace xtl
         EXPECT_TRUE(res != std::size_t(0));
     }
 
+    TEST(xfixed_string, transparent_hash)
+    {
+        string_type s = "transparent";
+        std::string str = "transparent";
+        std::string_view sv = str;
+        const char* cstr = "transparent";
+
+        xstring_hash h;
+        std::size_t expected = std::hash<string_type>()(s);
+        EXPECT_EQ(h(s), expected);
+        EXPECT_EQ(h(str), expected);
+        EXPECT_EQ(h(sv), expected);
+        EXPECT_EQ(h(cstr), expected);
+        EXPECT_NE(h("transparenT"), expected);
+
+        xstring_equal eq;
+        EXPECT_TRUE(eq(s, sv));
+        EXPECT_TRUE(eq(cstr, s));
+        EXPECT_TRUE(eq(str, cstr));
+        EXPECT_FALSE(eq(s, "transparen"));
+
+        xu16fixed_string<16> ws = u"wide";
+        EXPECT_EQ(std::hash<xu16fixed_string<16>>()(ws), xbasic_string_hash<char16_t>()(std::u16string_view(u"wide")));
+        EXPECT_NE(std::hash<xu16fixed_string<16>>()(ws), std::hash<xu16fixed_string<16>>()(u"wida"));
+
+        std::unordered_map<string_type, int, xstring_hash, xstring_equal> map;
+        map[s] = 1;
+        map["other"] = 2;
+#if defined(__cpp_lib_generic_unordered_lookup)
+        auto it = map.find(sv);
+        EXPECT_TRUE(it != map.end());
+        EXPECT_EQ(it->second, 1);
+        EXPECT_TRUE(map.find("missing") == map.end());
+#endif
+        EXPECT_EQ(map.at(s), 1);
+    }
+
+    TEST(xfixed_string, hashed_string)
+    {
+        using key_type = xhashed_string<string_type>;
+        key_type key(string_type("cached"));
+        xhashed_string<std::string_view> probe(std::string_view("cached"));
+        EXPECT_EQ(key.hash(), std::hash<string_type>()(key.str()));
+        EXPECT_EQ(probe.hash(), key.hash());
+        EXPECT_EQ(xstring_hash()(key), key.hash());
+        EXPECT_EQ(std::hash<key_type>()(key), key.hash());
+        EXPECT_TRUE(key == probe);
+        EXPECT_TRUE(key != key_type(string_type("cacheD")));
+        EXPECT_TRUE(xstring_equal()(key, "cached"));
+        EXPECT_TRUE(xstring_equal()(probe, key));
+        EXPECT_EQ(key_type().hash(), xstring_hash()(""));
+
+        std::unordered_map<key_type, int> map;
+        map[key] = 3;
+        EXPECT_EQ(map[key_type(string_type("cached"))], 3);
+        EXPECT_EQ(map.size(), 1u);
+    }
+
     TEST(numpy_string, constructor)
     {
         std::string s = "thisisatest";
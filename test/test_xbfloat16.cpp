@@ -0,0 +1,193 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "xtl/xbfloat16.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    inline float float_from_bits(uint32_t bits)
+    {
+        float res;
+        std::memcpy(&res, &bits, sizeof(res));
+        return res;
+    }
+
+    // Reference rounding through double arithmetic on the exact value.
+    inline uint16_t reference_bfloat16_bits(float f)
+    {
+        if (std::isnan(f))
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            return static_cast<uint16_t>((bits >> 16) | 0x40);
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        float down = float_from_bits(bits & 0xFFFF0000u);
+        float up = float_from_bits((bits & 0xFFFF0000u) + 0x10000u);
+        double ddown = std::fabs(static_cast<double>(f) - static_cast<double>(down));
+        // the successor of the largest finite value stands for 2^128
+        double dup = std::isinf(up) ? std::fabs(std::copysign(std::ldexp(1., 128), f) - static_cast<double>(f))
+                                    : std::fabs(static_cast<double>(up) - static_cast<double>(f));
+        uint16_t res = static_cast<uint16_t>(bits >> 16);
+        if ((bits & 0xFFFFu) != 0 && (dup < ddown || (dup == ddown && (res & 1) != 0)))
+        {
+            ++res;
+        }
+        return res;
+    }
+
+    TEST(bfloat16, traits)
+    {
+        EXPECT_TRUE(xtl::is_scalar<bfloat16>::value);
+        EXPECT_TRUE(xtl::is_arithmetic<bfloat16>::value);
+        EXPECT_TRUE(xtl::is_signed<bfloat16>::value);
+        EXPECT_TRUE(xtl::is_floating_point<bfloat16>::value);
+        EXPECT_EQ(sizeof(bfloat16), 2u);
+    }
+
+    TEST(bfloat16, numeric_limits)
+    {
+        using limits = std::numeric_limits<bfloat16>;
+        EXPECT_TRUE(limits::is_specialized);
+        EXPECT_EQ(float(limits::max()), float_from_bits(0x7F7F0000u));
+        EXPECT_EQ(float(limits::lowest()), -float(limits::max()));
+        EXPECT_EQ(float(limits::min()), std::numeric_limits<float>::min());
+        EXPECT_EQ(float(limits::epsilon()), std::ldexp(1.f, 1 - limits::digits));
+        EXPECT_EQ(float(limits::round_error()), 0.5f);
+        EXPECT_EQ(float(limits::denorm_min()), std::ldexp(1.f, -133));
+        EXPECT_TRUE(std::isinf(float(limits::infinity())));
+        EXPECT_TRUE(std::isnan(float(limits::quiet_NaN())));
+        EXPECT_TRUE(std::isnan(float(limits::signaling_NaN())));
+        EXPECT_EQ(limits::min_exponent, std::numeric_limits<float>::min_exponent);
+        EXPECT_EQ(limits::max_exponent, std::numeric_limits<float>::max_exponent);
+        EXPECT_EQ(bfloat16(1.f + float(limits::epsilon())).bits(), 0x3F81);
+    }
+
+    TEST(bfloat16, hash)
+    {
+        std::hash<bfloat16> h;
+        EXPECT_EQ(h(bfloat16(0.f)), h(bfloat16(-0.f)));
+        EXPECT_EQ(h(bfloat16(1.5f)), h(bfloat16::from_bits(0x3FC0)));
+        EXPECT_NE(h(bfloat16(1.5f)), h(bfloat16(-1.5f)));
+    }
+
+    TEST(bfloat16, scalar_conversion)
+    {
+        EXPECT_EQ(bfloat16().bits(), 0);
+        EXPECT_EQ(bfloat16(1.f).bits(), 0x3F80);
+        EXPECT_EQ(float(bfloat16(-2.5f)), -2.5f);
+
+        // ties to even, in both directions
+        EXPECT_EQ(bfloat16(float_from_bits(0x3F808000u)).bits(), 0x3F80);
+        EXPECT_EQ(bfloat16(float_from_bits(0x3F818000u)).bits(), 0x3F82);
+        EXPECT_EQ(bfloat16(float_from_bits(0x3F808001u)).bits(), 0x3F81);
+        EXPECT_EQ(bfloat16::truncate(float_from_bits(0x3F81FFFFu)).bits(), 0x3F81);
+
+        // overflow rounds to infinity, truncation saturates at max
+        float big = std::numeric_limits<float>::max();
+        EXPECT_EQ(bfloat16(big).bits(), 0x7F80);
+        EXPECT_EQ(bfloat16::truncate(big).bits(), 0x7F7F);
+
+        // signaling NaNs with payload in the low bits are quieted
+        float snan = float_from_bits(0x7F800001u);
+        EXPECT_TRUE(std::isnan(float(bfloat16(snan))));
+        EXPECT_TRUE(std::isnan(float(bfloat16::truncate(snan))));
+
+        bfloat16 x = 1.f;
+        x += 2.f;
+        x *= 3.f;
+        x -= 1.f;
+        x /= 4.f;
+        EXPECT_EQ(float(x), 2.f);
+        EXPECT_TRUE(bfloat16(3.f) > bfloat16(2.f));
+        EXPECT_EQ(bfloat16(2.f) + bfloat16(3.f), 5.f);
+
+        for (uint32_t hi = 0; hi < 0x10000u; hi += 0x101u)
+        {
+            for (uint32_t lo : {0x0000u, 0x0001u, 0x7FFFu, 0x8000u, 0x8001u, 0xFFFFu})
+            {
+                float f = float_from_bits((hi << 16) | lo);
+                EXPECT_EQ(bfloat16(f).bits(), reference_bfloat16_bits(f));
+            }
+        }
+    }
+
+    TEST(bfloat16, convert)
+    {
+        // every bfloat16 round-trips through float
+        std::vector<bfloat16> all(0x10000);
+        for (std::size_t i = 0; i < all.size(); ++i)
+        {
+            all[i] = bfloat16::from_bits(static_cast<uint16_t>(i));
+        }
+        std::vector<float> wide(all.size());
+        convert(all, wide);
+        std::vector<bfloat16> nearest(all.size());
+        std::vector<bfloat16> truncated(all.size());
+        convert(wide, nearest);
+        convert(wide, truncated, bfloat16_rounding::truncate);
+        for (std::size_t i = 0; i < all.size(); ++i)
+        {
+            uint32_t wide_bits;
+            std::memcpy(&wide_bits, &wide[i], sizeof(float));
+            EXPECT_EQ(wide_bits, uint32_t(i) << 16);
+            uint16_t expected = std::isnan(wide[i]) ? static_cast<uint16_t>(i | 0x40) : static_cast<uint16_t>(i);
+            EXPECT_EQ(nearest[i].bits(), expected);
+            EXPECT_EQ(truncated[i].bits(), expected);
+        }
+
+        // low halves that exercise rounding, with every tail length
+        std::vector<float> input;
+        for (uint32_t hi = 0; hi < 0x10000u; hi += 0x3F1u)
+        {
+            for (uint32_t lo : {0x0001u, 0x7FFFu, 0x8000u, 0xC000u, 0xFFFFu})
+            {
+                input.push_back(float_from_bits((hi << 16) | lo));
+            }
+        }
+        for (std::size_t size : {std::size_t(0), std::size_t(1), std::size_t(7), std::size_t(15),
+                                 std::size_t(17), std::size_t(31), input.size()})
+        {
+            span<const float> in(input.data(), size);
+            std::vector<bfloat16> rounded(size + 1, bfloat16::from_bits(0x1234));
+            std::vector<bfloat16> chopped(size + 1, bfloat16::from_bits(0x1234));
+            std::vector<float> back(size + 1, 42.f);
+            convert(in, rounded);
+            convert(in, chopped, bfloat16_rounding::truncate);
+            convert(span<const bfloat16>(rounded.data(), size), back);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                EXPECT_EQ(rounded[i].bits(), bfloat16(input[i]).bits());
+                EXPECT_EQ(chopped[i].bits(), bfloat16::truncate(input[i]).bits());
+                if (!std::isnan(back[i]))
+                {
+                    EXPECT_EQ(back[i], float(rounded[i]));
+                }
+            }
+            EXPECT_EQ(rounded[size].bits(), 0x1234);
+            EXPECT_EQ(chopped[size].bits(), 0x1234);
+            EXPECT_EQ(back[size], 42.f);
+        }
+
+        std::vector<float> small(3);
+        EXPECT_THROW(convert(all, small), std::length_error);
+        EXPECT_THROW(convert(wide, span<bfloat16>(nearest.data(), 2)), std::length_error);
+    }
+}
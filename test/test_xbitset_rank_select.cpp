@@ -0,0 +1,135 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xtl/xbitset_rank_select.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    using bitset = xdynamic_bitset<uint64_t>;
+    using bitset_view = xdynamic_bitset_view<uint64_t>;
+
+    // Sets roughly one bit out of density, with dense and empty stretches
+    template <class B>
+    void fill_rank_select(B& b, uint64_t seed, uint64_t density)
+    {
+        uint64_t state = seed;
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            bool dense = (i / 3000) % 5 == 1;
+            bool empty = (i / 3000) % 5 == 3;
+            b[i] = !empty && (dense || (state >> 33) % density == 0);
+        }
+    }
+
+    template <class B>
+    void test_rank_select(const B& b)
+    {
+        xbitset_rank_select<B> rs(b);
+        EXPECT_EQ(b.size(), rs.size());
+        EXPECT_EQ(b.count(), rs.count());
+
+        std::size_t rank = 0;
+        bool rank_ok = true;
+        bool select_ok = true;
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            rank_ok = rank_ok && rs.rank(i) == rank;
+            if (b[i])
+            {
+                select_ok = select_ok && rs.select(rank) == i;
+                ++rank;
+            }
+        }
+        EXPECT_TRUE(rank_ok);
+        EXPECT_TRUE(select_ok);
+        EXPECT_EQ(rank, rs.rank(b.size()));
+        EXPECT_EQ(decltype(rs)::npos, rs.select(rank));
+    }
+
+    TEST(xbitset_rank_select, rank_select)
+    {
+        for (std::size_t size : {0u, 1u, 511u, 512u, 2048u, 2049u, 70000u})
+        {
+            for (uint64_t density : {1u, 3u, 100u})
+            {
+                bitset b(size);
+                fill_rank_select(b, size + density, density);
+                test_rank_select(b);
+            }
+        }
+    }
+
+    TEST(xbitset_rank_select, view)
+    {
+        std::vector<uint64_t> blocks(100);
+        bitset_view b(blocks.data(), 6333u);
+        fill_rank_select(b, 7u, 2u);
+        test_rank_select(b);
+    }
+
+    TEST(xbitset_rank_select, small_blocks)
+    {
+        std::vector<uint8_t> blocks(1000);
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            blocks[i] = static_cast<uint8_t>(i * 37u);
+        }
+        xdynamic_bitset<uint8_t> b(blocks.cbegin(), blocks.cend());
+        xbitset_rank_select<xdynamic_bitset<uint8_t>> rs(b);
+
+        std::size_t rank = 0;
+        bool ok = true;
+        for (std::size_t i = 0; i < blocks.size() * 8; ++i)
+        {
+            ok = ok && rs.rank(i) == rank;
+            if ((blocks[i / 8] >> (i % 8)) & 1)
+            {
+                ok = ok && rs.select(rank) == i;
+                ++rank;
+            }
+        }
+        EXPECT_TRUE(ok);
+        EXPECT_EQ(rank, rs.count());
+    }
+
+    TEST(xbitset_rank_select, rebuild)
+    {
+        bitset b(5000u, false);
+        xbitset_rank_select<bitset> rs(b);
+        EXPECT_EQ(0u, rs.count());
+        EXPECT_EQ(bitset::npos, rs.select(0u));
+
+        b[10] = true;
+        b[4000] = true;
+        rs.rebuild();
+        EXPECT_EQ(2u, rs.count());
+        EXPECT_EQ(1u, rs.rank(11u));
+        EXPECT_EQ(4000u, rs.select(1u));
+
+        bitset c(100u, true);
+        rs.rebuild(c);
+        EXPECT_EQ(100u, rs.count());
+        EXPECT_EQ(42u, rs.select(42u));
+    }
+
+    TEST(xbitset_rank_select, memory_usage)
+    {
+        bitset b(1u << 22, true);
+        xbitset_rank_select<bitset> rs(b);
+        double overhead = double(rs.memory_usage()) / double(b.block_count() * sizeof(uint64_t));
+        EXPECT_LT(overhead, 0.04);
+    }
+}
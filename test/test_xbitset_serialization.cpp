@@ -0,0 +1,233 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "xtl/xbitset_serialization.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    using bitset = xdynamic_bitset<uint64_t>;
+
+    inline bitset make_serialization_bitset(std::size_t size)
+    {
+        bitset b(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            b[i] = (i * 2654435761u) % 7 < 3;
+        }
+        return b;
+    }
+
+    // Stream buffer that cannot be repositioned, like a pipe
+    class forward_only_buffer : public std::streambuf
+    {
+    public:
+
+        explicit forward_only_buffer(std::string data)
+            : m_data(std::move(data))
+        {
+            setg(&m_data[0], &m_data[0], &m_data[0] + m_data.size());
+        }
+
+    private:
+
+        std::string m_data;
+    };
+
+    TEST(xbitset_serialization, buffer)
+    {
+        bitset b = make_serialization_bitset(1000);
+        std::size_t size = serialized_size(b);
+        EXPECT_EQ(size, bitset_header_size + 16 * sizeof(uint64_t));
+
+        std::vector<uint64_t> buffer(size / sizeof(uint64_t));
+        EXPECT_EQ(serialize(b, buffer.data(), size), size);
+
+        xbitset_header header = read_bitset_header(buffer.data(), size);
+        EXPECT_EQ(header.size, 1000u);
+        EXPECT_EQ(header.block_count, 16u);
+        EXPECT_EQ(header.block_size, sizeof(uint64_t));
+        EXPECT_TRUE(header.byte_order == endianness());
+
+        bitset res = deserialize_bitset<uint64_t>(buffer.data(), size);
+        EXPECT_TRUE(res == b);
+
+        // Zero-copy view over the buffer
+        auto view = deserialize_bitset_view<uint64_t>(buffer.data(), size);
+        EXPECT_EQ(view.size(), 1000u);
+        EXPECT_EQ(view.data(), buffer.data() + bitset_header_size / sizeof(uint64_t));
+        EXPECT_TRUE(view == b);
+
+        // Read-only view over a const buffer
+        const std::vector<uint64_t>& const_buffer = buffer;
+        auto const_view = deserialize_bitset_view<uint64_t>(const_buffer.data(), size);
+        bool is_const_view = std::is_same<decltype(const_view), xdynamic_bitset_view<const uint64_t>>::value;
+        EXPECT_TRUE(is_const_view);
+        EXPECT_EQ(const_view.data(), view.data());
+        EXPECT_TRUE(const_view == b);
+        EXPECT_EQ(const_view.count(), b.count());
+        EXPECT_EQ(bool(const_view[999]), bool(b[999]));
+
+        // Bits set past the size are cleared by a mutable view, and rejected by a const one
+        buffer.back() |= uint64_t(1) << 63;
+        EXPECT_THROW(deserialize_bitset_view<uint64_t>(const_buffer.data(), size), std::runtime_error);
+        EXPECT_TRUE(deserialize_bitset_view<uint64_t>(buffer.data(), size) == b);
+        EXPECT_TRUE(deserialize_bitset_view<uint64_t>(const_buffer.data(), size) == b);
+
+        bitset empty;
+        std::vector<uint64_t> empty_buffer(bitset_header_size / sizeof(uint64_t));
+        EXPECT_EQ(serialize(empty, empty_buffer.data(), bitset_header_size), bitset_header_size);
+        EXPECT_TRUE(deserialize_bitset<uint64_t>(empty_buffer.data(), bitset_header_size).empty());
+    }
+
+    TEST(xbitset_serialization, stream)
+    {
+        bitset b = make_serialization_bitset(12345);
+        std::stringstream stream;
+        serialize(stream, b);
+        EXPECT_EQ(stream.str().size(), serialized_size(b));
+
+        bitset res = deserialize_bitset<uint64_t>(stream);
+        EXPECT_TRUE(res == b);
+
+        std::stringstream truncated(stream.str().substr(0, 100));
+        EXPECT_THROW(deserialize_bitset<uint64_t>(truncated), std::runtime_error);
+
+        // Streams that cannot be repositioned are read by chunks
+        forward_only_buffer native_buffer(stream.str());
+        std::istream native_stream(&native_buffer);
+        EXPECT_TRUE(deserialize_bitset<uint64_t>(native_stream) == b);
+        forward_only_buffer converted_buffer(stream.str());
+        std::istream converted_stream(&converted_buffer);
+        xdynamic_bitset<uint32_t> converted = deserialize_bitset<uint32_t>(converted_stream);
+        EXPECT_EQ(converted.size(), b.size());
+        EXPECT_EQ(converted.count(), b.count());
+        EXPECT_EQ(converted.find_first(), b.find_first());
+        forward_only_buffer truncated_buffer(stream.str().substr(0, 100));
+        std::istream truncated_stream(&truncated_buffer);
+        EXPECT_THROW(deserialize_bitset<uint64_t>(truncated_stream), std::runtime_error);
+
+        // A header announcing a huge bitset must not be trusted before the blocks are read
+        std::string huge = stream.str().substr(0, 100);
+        uint64_t huge_size = uint64_t(1) << 62;
+        uint64_t huge_block_count = huge_size / 64;
+        std::memcpy(&huge[8], &huge_size, sizeof(huge_size));
+        std::memcpy(&huge[16], &huge_block_count, sizeof(huge_block_count));
+        std::stringstream huge_stream(huge);
+        EXPECT_THROW(deserialize_bitset<uint64_t>(huge_stream), std::runtime_error);
+        forward_only_buffer huge_buffer(huge);
+        std::istream huge_forward_stream(&huge_buffer);
+        EXPECT_THROW(deserialize_bitset<uint64_t>(huge_forward_stream), std::runtime_error);
+    }
+
+    TEST(xbitset_serialization, conversion)
+    {
+        // Written with 8-bit blocks, read with 64-bit blocks and conversely
+        std::size_t size = 1000;
+        bitset b = make_serialization_bitset(size);
+        xdynamic_bitset<uint8_t> b8(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            b8.set(i, b[i]);
+        }
+
+        std::vector<unsigned char> buffer(serialized_size(b8));
+        serialize(b8, buffer.data(), buffer.size());
+        EXPECT_TRUE(deserialize_bitset<uint64_t>(buffer.data(), buffer.size()) == b);
+        EXPECT_THROW(deserialize_bitset_view<uint64_t>(buffer.data(), buffer.size()), std::runtime_error);
+
+        buffer.resize(serialized_size(b));
+        serialize(b, buffer.data(), buffer.size());
+        auto res8 = deserialize_bitset<uint8_t>(buffer.data(), buffer.size());
+        EXPECT_TRUE(res8 == b8);
+
+        // Same bitset written by a big endian machine
+        std::vector<unsigned char> big(buffer);
+        big[5] = 1;
+        for (std::size_t i = 8; i < big.size(); i += 8)
+        {
+            std::reverse(big.begin() + static_cast<std::ptrdiff_t>(i), big.begin() + static_cast<std::ptrdiff_t>(i + 8));
+        }
+        if (endianness() == endian::little_endian)
+        {
+            EXPECT_TRUE(deserialize_bitset<uint64_t>(big.data(), big.size()) == b);
+            EXPECT_TRUE(deserialize_bitset<uint8_t>(big.data(), big.size()) == b8);
+        }
+    }
+
+    TEST(xbitset_serialization, invalid)
+    {
+        bitset b = make_serialization_bitset(1000);
+        std::vector<unsigned char> buffer(serialized_size(b));
+        serialize(b, buffer.data(), buffer.size());
+
+        EXPECT_THROW(serialize(b, buffer.data(), buffer.size() - 1), std::length_error);
+        EXPECT_THROW(read_bitset_header(buffer.data(), buffer.size() - 1), std::runtime_error);
+        EXPECT_THROW(read_bitset_header(buffer.data(), 16), std::runtime_error);
+
+        std::vector<unsigned char> bad(buffer);
+        bad[0] = 'Y';
+        EXPECT_THROW(read_bitset_header(bad.data(), bad.size()), std::runtime_error);
+        bad = buffer;
+        bad[4] = 2;
+        EXPECT_THROW(read_bitset_header(bad.data(), bad.size()), std::runtime_error);
+        bad = buffer;
+        bad[6] = 3;
+        EXPECT_THROW(read_bitset_header(bad.data(), bad.size()), std::runtime_error);
+
+        // Blocks not aligned for a zero-copy view
+        std::vector<unsigned char> shifted(buffer.size() + 1);
+        std::memcpy(shifted.data() + 1, buffer.data(), buffer.size());
+        EXPECT_TRUE(deserialize_bitset<uint64_t>(shifted.data() + 1, buffer.size()) == b);
+        EXPECT_THROW(deserialize_bitset_view<uint64_t>(shifted.data() + 1, buffer.size()), std::runtime_error);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    TEST(xbitset_serialization, mmap)
+    {
+        bitset b = make_serialization_bitset(100003);
+        char path[] = "/tmp/xtl_bitset_XXXXXX";
+        int fd = mkstemp(path);
+        EXPECT_NE(fd, -1);
+        std::vector<unsigned char> buffer(serialized_size(b));
+        serialize(b, buffer.data(), buffer.size());
+        EXPECT_EQ(write(fd, buffer.data(), buffer.size()), static_cast<ssize_t>(buffer.size()));
+
+        // Read-only mapping: building the view must not write to the blocks
+        void* region = mmap(nullptr, buffer.size(), PROT_READ, MAP_SHARED, fd, 0);
+        EXPECT_NE(region, MAP_FAILED);
+        auto view = deserialize_bitset_view<uint64_t>(static_cast<const void*>(region), buffer.size());
+        EXPECT_TRUE(view == b);
+        EXPECT_EQ(view.count(), b.count());
+
+        munmap(region, buffer.size());
+        close(fd);
+        std::remove(path);
+    }
+#endif
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "xtl/xconcurrent_bitset.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    using bitset = xdynamic_bitset<uint64_t>;
+    using bitset_view = xdynamic_bitset_view<uint64_t>;
+
+    constexpr std::size_t concurrent_thread_count = 4;
+
+    template <class F>
+    void run_concurrently(F f)
+    {
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < concurrent_thread_count; ++t)
+        {
+            threads.emplace_back(f, t);
+        }
+        for (auto& th : threads)
+        {
+            th.join();
+        }
+    }
+
+    TEST(xconcurrent_bitset, single_thread)
+    {
+        xconcurrent_bitset<bitset> b(100);
+        EXPECT_EQ(b.size(), 100u);
+        EXPECT_EQ(b.block_count(), 2u);
+
+        b.set(3);
+        b.set(70, true);
+        EXPECT_TRUE(b.test(3));
+        EXPECT_TRUE(b[70]);
+        EXPECT_FALSE(b.test(4, std::memory_order_relaxed));
+
+        EXPECT_TRUE(b.test_and_set(3));
+        EXPECT_FALSE(b.test_and_set(4));
+        EXPECT_TRUE(b.test_and_reset(4));
+        EXPECT_FALSE(b.test_and_reset(4));
+        EXPECT_FALSE(b.test_and_flip(99));
+        EXPECT_TRUE(b.test_and_flip(99));
+        b.flip(5);
+        b.reset(70);
+        b.set(3, false);
+
+        const bitset& ref = b.bitset();
+        EXPECT_EQ(ref.count(), 1u);
+        EXPECT_TRUE(ref[5]);
+        EXPECT_EQ(b.view().data(), ref.data());
+        EXPECT_TRUE(b.view() == ref);
+
+        bitset moved = std::move(b).bitset();
+        EXPECT_EQ(moved.count(), 1u);
+    }
+
+    TEST(xconcurrent_bitset, concurrent_set)
+    {
+        // Interleaved bits, so that all the threads write to every block
+        constexpr std::size_t size = 100000;
+        xconcurrent_bitset<bitset> b(size);
+        run_concurrently([&b](std::size_t t) {
+            for (std::size_t i = t; i < size; i += concurrent_thread_count)
+            {
+                b.set(i, std::memory_order_relaxed);
+            }
+        });
+        EXPECT_EQ(b.bitset().count(), size);
+        EXPECT_TRUE(b.bitset().all());
+
+        run_concurrently([&b](std::size_t t) {
+            for (std::size_t i = t; i < size; i += 2 * concurrent_thread_count)
+            {
+                b.reset(i);
+            }
+        });
+        EXPECT_EQ(b.bitset().count(), size / 2);
+    }
+
+    TEST(xconcurrent_bitset, concurrent_test_and_set)
+    {
+        // Every bit is claimed by exactly one thread
+        constexpr std::size_t size = 50000;
+        xconcurrent_bitset<bitset> b(size);
+        std::atomic<std::size_t> claimed(0);
+        run_concurrently([&b, &claimed](std::size_t) {
+            std::size_t local = 0;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                local += b.test_and_set(i) ? 0u : 1u;
+            }
+            claimed += local;
+        });
+        EXPECT_EQ(claimed.load(), size);
+        EXPECT_TRUE(b.bitset().all());
+    }
+
+    TEST(xconcurrent_bitset, view)
+    {
+        std::vector<uint64_t> blocks(4, 0);
+        xconcurrent_bitset<bitset_view> b(bitset_view(blocks.data(), 256));
+        run_concurrently([&b](std::size_t t) {
+            for (std::size_t i = t; i < 256; i += concurrent_thread_count)
+            {
+                b.set(i);
+            }
+        });
+        for (auto block : blocks)
+        {
+            EXPECT_EQ(block, ~uint64_t(0));
+        }
+        EXPECT_TRUE(b.bitset().all());
+    }
+}
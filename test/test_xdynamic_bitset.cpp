@@ -7,6 +7,12 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <vector>
+
 #include "xtl/xdynamic_bitset.hpp"
 
 #include "test_common_macros.hpp"
@@ -473,6 +479,78 @@ namespace xtl
         test_count(b);
     }
 
+    // Fills the bitset with a pseudo-random pattern and returns the number of set bits
+    template <class B>
+    std::size_t fill_pattern(B& b, uint64_t seed)
+    {
+        std::size_t res = 0;
+        uint64_t state = seed;
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            bool value = (state >> 61) < 3;
+            b[i] = value;
+            res += value ? 1u : 0u;
+        }
+        return res;
+    }
+
+    TEST(xdynamic_bitset, count_long)
+    {
+        for (std::size_t size : {0u, 1u, 63u, 64u, 65u, 4095u, 4096u, 5000u, 65537u, 200003u})
+        {
+            bitset b(size);
+            std::size_t expected = fill_pattern(b, size);
+            EXPECT_EQ(expected, b.count());
+
+            std::vector<uint8_t> bytes(size / 8u, uint8_t(0x5A));
+            xdynamic_bitset<uint8_t> b8(bytes.begin(), bytes.end());
+            EXPECT_EQ(4u * bytes.size(), b8.count());
+
+            xdynamic_bitset<uint32_t> b32(size, true);
+            EXPECT_EQ(size, b32.count());
+        }
+    }
+
+    TEST(xdynamic_bitset, popcount_kernels)
+    {
+        std::vector<uint64_t> buffer(1031);
+        uint64_t state = 42;
+        for (auto& v : buffer)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            v = state;
+        }
+        std::size_t expected = 0;
+        for (auto v : buffer)
+        {
+            for (; v != 0; v &= v - 1)
+            {
+                ++expected;
+            }
+        }
+        EXPECT_EQ(expected, detail_bitset::popcount_scalar(buffer.data(), buffer.size()));
+        EXPECT_EQ(expected, detail_bitset::popcount(buffer.data(), buffer.size()));
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        const cpu_features& features = available_cpu_features();
+        if (features.popcnt)
+        {
+            EXPECT_EQ(expected, detail_bitset::popcount_popcnt(buffer.data(), buffer.size()));
+        }
+        // 1031 words = 257 32-byte chunks + 3 words
+        std::size_t tail = detail_bitset::popcount_scalar(buffer.data() + 1028, 3);
+        if (features.avx2)
+        {
+            EXPECT_EQ(expected, detail_bitset::popcount_avx2(buffer.data(), 257) + tail);
+        }
+        if (features.avx512_vpopcntdq)
+        {
+            tail += detail_bitset::popcount_scalar(buffer.data() + 1024, 4);
+            EXPECT_EQ(expected, detail_bitset::popcount_avx512(buffer.data(), 128) + tail);
+        }
+#endif
+    }
+
     template <class B>
     void test_bitwise_not(B& b1)
     {
@@ -604,6 +682,293 @@ namespace xtl
         test_bitwise_xor(b1, b2);
     }
 
+    TEST(xdynamic_bitset, bitwise_long)
+    {
+        for (std::size_t size : {1u, 70u, 511u, 512u, 1000u, 4099u, 65600u})
+        {
+            bitset a(size), b(size);
+            fill_pattern(a, size);
+            fill_pattern(b, size + 1);
+
+            bitset and_res = a & b;
+            bitset or_res = a | b;
+            bitset xor_res = a ^ b;
+            bitset not_res = ~a;
+            bool res = true;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res = res && and_res[i] == (a[i] && b[i]);
+                res = res && or_res[i] == (a[i] || b[i]);
+                res = res && xor_res[i] == (a[i] != b[i]);
+                res = res && not_res[i] == !a[i];
+            }
+            EXPECT_TRUE(res);
+            EXPECT_EQ(size - a.count(), not_res.count());
+
+            bitset c = a;
+            c &= b;
+            EXPECT_TRUE(c == and_res);
+            c = a;
+            c |= b;
+            EXPECT_TRUE(c == or_res);
+            c = a;
+            c ^= b;
+            EXPECT_TRUE(c == xor_res);
+            c = a;
+            c.flip();
+            EXPECT_TRUE(c == not_res);
+            c.flip();
+            EXPECT_TRUE(c == a);
+
+            // unused bits stay cleared
+            EXPECT_EQ(size, (a | not_res).count());
+            EXPECT_TRUE((a | not_res).all());
+
+            c.flip(size - 1);
+            EXPECT_FALSE(c == a);
+            EXPECT_TRUE(c != a);
+
+            std::vector<uint64_t> blocks(a.block_begin(), a.block_end());
+            bitset_view v(blocks.data(), size);
+            EXPECT_TRUE(v == a);
+            v ^= b;
+            EXPECT_TRUE(v == xor_res);
+        }
+    }
+
+    TEST(xdynamic_bitset, bitwise_kernels)
+    {
+        std::size_t n = 67;
+        std::vector<uint64_t> lhs(n), rhs(n), expected(n), res(n);
+        uint64_t state = 7;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            lhs[i] = state;
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            rhs[i] = state;
+            expected[i] = lhs[i] & ~rhs[i];
+        }
+        detail_bitset::transform_blocks<detail_bitset::bitwise_not>(res.data(), res.data(), rhs.data(), n);
+        detail_bitset::transform_blocks<detail_bitset::bitwise_and>(res.data(), lhs.data(), res.data(), n);
+        EXPECT_TRUE(res == expected);
+        EXPECT_TRUE(detail_bitset::equal_blocks(res.data(), expected.data(), n));
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        const cpu_features& features = available_cpu_features();
+        std::size_t bytes = n * sizeof(uint64_t);
+        std::vector<uint64_t> ref(n);
+        detail_bitset::transform_blocks_scalar<detail_bitset::bitwise_xor>(ref.data(), lhs.data(), rhs.data(), n);
+
+        std::fill(res.begin(), res.end(), uint64_t(0));
+        EXPECT_EQ(528u, detail_bitset::transform_bytes_sse2<detail_bitset::bitwise_xor>(res.data(), lhs.data(), rhs.data(), bytes));
+        EXPECT_TRUE(std::equal(ref.begin(), ref.begin() + 66, res.begin()));
+        bool equal = false;
+        detail_bitset::equal_bytes_sse2(res.data(), ref.data(), 528u, equal);
+        EXPECT_TRUE(equal);
+        if (features.avx2)
+        {
+            std::fill(res.begin(), res.end(), uint64_t(0));
+            EXPECT_EQ(512u, detail_bitset::transform_bytes_avx2<detail_bitset::bitwise_xor>(res.data(), lhs.data(), rhs.data(), bytes));
+            EXPECT_TRUE(std::equal(ref.begin(), ref.begin() + 64, res.begin()));
+            detail_bitset::equal_bytes_avx2(res.data(), ref.data(), 512u, equal);
+            EXPECT_TRUE(equal);
+            res[40] ^= 1u;
+            detail_bitset::equal_bytes_avx2(res.data(), ref.data(), 512u, equal);
+            EXPECT_FALSE(equal);
+        }
+        if (features.avx512f)
+        {
+            std::fill(res.begin(), res.end(), uint64_t(0));
+            EXPECT_EQ(512u, detail_bitset::transform_bytes_avx512<detail_bitset::bitwise_xor>(res.data(), lhs.data(), rhs.data(), bytes));
+            EXPECT_TRUE(std::equal(ref.begin(), ref.begin() + 64, res.begin()));
+            detail_bitset::equal_bytes_avx512(res.data(), ref.data(), 512u, equal);
+            EXPECT_TRUE(equal);
+            res[63] ^= 1u;
+            detail_bitset::equal_bytes_avx512(res.data(), ref.data(), 512u, equal);
+            EXPECT_FALSE(equal);
+        }
+#endif
+    }
+
+    TEST(xdynamic_bitset, expression)
+    {
+        for (std::size_t size : {0u, 5u, 64u, 130u, 20000u, 70001u})
+        {
+            bitset a(size), b(size), c(size), d(size);
+            fill_pattern(a, 1);
+            fill_pattern(b, 2);
+            fill_pattern(c, 3);
+            fill_pattern(d, 4);
+
+            auto e = (a & b) | (~c ^ d);
+            EXPECT_EQ(size, e.size());
+
+            bitset expected(size);
+            bool res = true;
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                bool value = (a[i] && b[i]) || (!c[i] != d[i]);
+                expected[i] = value;
+                count += value ? 1u : 0u;
+                res = res && e[i] == value;
+            }
+            EXPECT_TRUE(res);
+
+            bitset r = e;
+            EXPECT_TRUE(r == expected);
+            EXPECT_TRUE(e == expected);
+            EXPECT_TRUE(expected == e);
+            EXPECT_FALSE(e != r);
+            EXPECT_EQ(count, e.count());
+            EXPECT_EQ(count != 0, e.any());
+            EXPECT_EQ(count == size, e.all());
+
+            // reductions see the unused bits as cleared
+            EXPECT_EQ(size, (a | ~a).count());
+            EXPECT_TRUE((a | ~a).all());
+            EXPECT_FALSE((a & ~a).any());
+            EXPECT_TRUE((~(~a)) == a);
+
+            // assignment to an operand of the expression
+            bitset a2 = a;
+            a2 = (a2 & b) | a2;
+            EXPECT_TRUE(a2 == a);
+            a2 = ~a2 & c;
+            EXPECT_TRUE(a2 == (~a & c));
+
+            bitset c2 = c;
+            c2 &= a ^ b;
+            EXPECT_TRUE(c2 == (c & (a ^ b)));
+            c2 |= ~a;
+            EXPECT_TRUE(c2 == ((c & (a ^ b)) | ~a));
+            c2 ^= ~c2;
+            EXPECT_EQ(size, c2.count());
+
+            std::vector<uint64_t> blocks(d.block_count());
+            bitset_view v(blocks.data(), size);
+            v = a ^ (b | d);
+            EXPECT_TRUE(v == (a ^ (b | d)));
+
+            // temporaries are held by value
+            auto f = bitset(a) & ~bitset(b);
+            EXPECT_TRUE(f == (a & ~b));
+        }
+    }
+
+    TEST(xdynamic_bitset, expression_resize)
+    {
+        bitset a(100u, true);
+        bitset b(200u, false);
+        b = ~a;
+        EXPECT_EQ(100u, b.size());
+        EXPECT_TRUE(b.none());
+        b = a & a;
+        EXPECT_TRUE(b.all());
+    }
+
+    template <class B>
+    std::vector<std::size_t> set_bit_indices(const B& b)
+    {
+        std::vector<std::size_t> res;
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            if (b[i])
+            {
+                res.push_back(i);
+            }
+        }
+        return res;
+    }
+
+    TEST(xdynamic_bitset, find)
+    {
+        for (std::size_t size : {0u, 1u, 64u, 130u, 20000u})
+        {
+            bitset b(size);
+            fill_pattern(b, size);
+            // sparse region so that whole zero blocks are skipped
+            for (std::size_t i = size / 4; i < size / 2; ++i)
+            {
+                b[i] = false;
+            }
+            std::vector<std::size_t> expected = set_bit_indices(b);
+            std::vector<std::size_t> res;
+            for (std::size_t i = b.find_first(); i != bitset::npos; i = b.find_next(i))
+            {
+                res.push_back(i);
+            }
+            EXPECT_EQ(expected, res);
+        }
+
+        bitset b(130u, false);
+        EXPECT_EQ(bitset::npos, b.find_first());
+        EXPECT_EQ(bitset::npos, b.find_next(0u));
+        b[0] = true;
+        b[129] = true;
+        EXPECT_EQ(0u, b.find_first());
+        EXPECT_EQ(129u, b.find_next(0u));
+        EXPECT_EQ(129u, b.find_next(64u));
+        EXPECT_EQ(bitset::npos, b.find_next(129u));
+        EXPECT_EQ(bitset::npos, b.find_next(bitset::npos));
+    }
+
+    template <class B>
+    void test_set_bits(const B& b, const std::vector<std::size_t>& expected)
+    {
+        auto range = b.set_bits();
+        std::vector<std::size_t> res(range.begin(), range.end());
+        EXPECT_EQ(expected, res);
+
+        res.clear();
+        b.for_each_set_bit([&res](std::size_t i) { res.push_back(i); });
+        EXPECT_EQ(expected, res);
+
+        res.clear();
+        std::size_t count = 0;
+        b.for_each_set_block([&](std::size_t first, typename B::block_type block) {
+            EXPECT_NE(block, typename B::block_type(0));
+            for (std::size_t i = 0; i < CHAR_BIT * sizeof(block); ++i)
+            {
+                if (((block >> i) & 1) != 0)
+                {
+                    res.push_back(first + i);
+                    ++count;
+                }
+            }
+        });
+        EXPECT_EQ(expected, res);
+        EXPECT_EQ(b.count(), count);
+    }
+
+    TEST(xdynamic_bitset, set_bits)
+    {
+        for (std::size_t size : {0u, 3u, 64u, 130u, 20000u})
+        {
+            bitset b(size);
+            fill_pattern(b, size + 7);
+            for (std::size_t i = 0; i < size / 2; ++i)
+            {
+                b[i] = false;
+            }
+            test_set_bits(b, set_bit_indices(b));
+        }
+
+        std::vector<uint8_t> blocks = {0x00, 0x81, 0x00, 0x00, 0x10};
+        xdynamic_bitset<uint8_t> b8(blocks.cbegin(), blocks.cend());
+        test_set_bits(b8, {8u, 15u, 36u});
+    }
+
+    TEST(xdynamic_bitset_view, set_bits)
+    {
+        std::array<uint64_t, 3> blocks = {0u, 0x8000000000000001u, 0xFFu};
+        bitset_view b(blocks.data(), 130u);
+        EXPECT_EQ(64u, b.find_first());
+        EXPECT_EQ(127u, b.find_next(64u));
+        EXPECT_EQ(bitset::npos, b.find_next(129u));
+        test_set_bits(b, {64u, 127u, 128u, 129u});
+    }
+
     template <class B>
     void test_shift_left(B& b1)
     {
@@ -670,6 +1035,98 @@ namespace xtl
         test_shift_right(b1);
     }
 
+    // Reference shift, bit by bit; positive shifts go towards higher indices
+    inline bitset naive_shift(const bitset& b, std::ptrdiff_t shift)
+    {
+        bitset res(b.size(), false);
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            std::ptrdiff_t j = static_cast<std::ptrdiff_t>(i) + shift;
+            if (b[i] && j >= 0 && static_cast<std::size_t>(j) < b.size())
+            {
+                res[static_cast<std::size_t>(j)] = true;
+            }
+        }
+        return res;
+    }
+
+    TEST(xdynamic_bitset, shift_long)
+    {
+        for (std::size_t size : {1u, 63u, 64u, 700u, 5000u})
+        {
+            bitset b(size);
+            fill_pattern(b, size);
+            bool ok = true;
+            for (std::size_t pos : {0u, 1u, 31u, 64u, 65u, 130u, 699u, 4097u})
+            {
+                std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(pos);
+                bitset left = naive_shift(b, shift);
+                bitset right = naive_shift(b, -shift);
+                ok = ok && (b << pos) == left && (b >> pos) == right;
+
+                bitset c = b;
+                c <<= pos;
+                ok = ok && c == left;
+                c = b;
+                c >>= pos;
+                ok = ok && c == right;
+                c = b;
+                bitset_view v(c.data(), size);
+                v <<= pos;
+                ok = ok && v == left;
+            }
+            EXPECT_TRUE(ok);
+        }
+    }
+
+    TEST(xdynamic_bitset, shift_small_blocks)
+    {
+        bitset b(1000u);
+        fill_pattern(b, 3);
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(b.data());
+        xdynamic_bitset<uint8_t> b8(bytes, bytes + b.block_count() * sizeof(uint64_t));
+        b8.resize(1000u);
+        for (std::size_t pos : {3u, 64u, 77u})
+        {
+            bitset left = b << pos;
+            xdynamic_bitset<uint8_t> left8 = b8 << pos;
+            EXPECT_TRUE(std::equal(left8.block_begin(), left8.block_end(), reinterpret_cast<const uint8_t*>(left.data())));
+            bitset right = b >> pos;
+            xdynamic_bitset<uint8_t> right8 = b8 >> pos;
+            EXPECT_TRUE(std::equal(right8.block_begin(), right8.block_end(), reinterpret_cast<const uint8_t*>(right.data())));
+        }
+    }
+
+    TEST(xdynamic_bitset, shift_and_or)
+    {
+        for (std::size_t size : {10u, 64u, 3000u})
+        {
+            bitset a(size), b(size);
+            fill_pattern(a, 1);
+            fill_pattern(b, 2);
+            bool ok = true;
+            for (std::ptrdiff_t shift : {0, 1, -1, 63, -64, 65, -200, 2999, -3000, 5000})
+            {
+                bitset shifted = naive_shift(b, shift);
+                bitset c = a;
+                c.shift_and(b, shift);
+                ok = ok && c == bitset(a & shifted);
+                c = a;
+                c.shift_or(b, shift);
+                ok = ok && c == bitset(a | shifted);
+
+                // in place, as in a sliding window
+                c = a;
+                c.shift_or(c, shift);
+                ok = ok && c == bitset(a | naive_shift(a, shift));
+                c = a;
+                c.shift_and(c, shift);
+                ok = ok && c == bitset(a & naive_shift(a, shift));
+            }
+            EXPECT_TRUE(ok);
+        }
+    }
+
     template <class B>
     void test_comparison(B& b1)
     {
@@ -0,0 +1,153 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xtl/xdynamic_bitset_parallel.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    using bitset = xdynamic_bitset<uint64_t>;
+
+    // Large enough to be split in several tasks, with a partial last block
+    constexpr std::size_t parallel_bitset_size = (std::size_t(1) << 24) + 37;
+
+    // Runs the tasks serially and records how many were submitted
+    struct serial_executor
+    {
+        template <class F>
+        void parallel_for(std::size_t task_count, F&& task)
+        {
+            m_task_count += task_count;
+            for (std::size_t i = 0; i < task_count; ++i)
+            {
+                task(i);
+            }
+        }
+
+        std::size_t m_task_count = 0;
+    };
+
+    inline bitset make_parallel_bitset(uint64_t seed)
+    {
+        bitset b(parallel_bitset_size);
+        uint64_t state = seed;
+        for (std::size_t i = 0; i < b.block_count(); ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            b.data()[i] = state ^ (state >> 29);
+        }
+        b.data()[b.block_count() - 1] &= (uint64_t(1) << (parallel_bitset_size % 64)) - 1;
+        return b;
+    }
+
+    TEST(xthread_pool, parallel_for)
+    {
+        xthread_pool pool(4);
+        EXPECT_EQ(pool.concurrency(), 4u);
+
+        std::vector<std::size_t> res(1000, 0);
+        pool.parallel_for(res.size(), [&res](std::size_t i) { res[i] = i * i; });
+        for (std::size_t i = 0; i < res.size(); ++i)
+        {
+            EXPECT_EQ(res[i], i * i);
+        }
+
+        // Nested loops run serially in the calling task
+        std::atomic<std::size_t> sum(0);
+        pool.parallel_for(8, [&pool, &sum](std::size_t) {
+            pool.parallel_for(8, [&sum](std::size_t j) { sum += j; });
+        });
+        EXPECT_EQ(sum.load(), 8u * 28u);
+
+        xthread_pool single(1);
+        EXPECT_EQ(single.concurrency(), 1u);
+        std::size_t count = 0;
+        single.parallel_for(5, [&count](std::size_t) { ++count; });
+        EXPECT_EQ(count, 5u);
+    }
+
+    TEST(xdynamic_bitset_parallel, reductions)
+    {
+        bitset b = make_parallel_bitset(1);
+        xthread_pool pool(4);
+        serial_executor serial;
+
+        EXPECT_EQ(parallel_count(b, pool), b.count());
+        EXPECT_EQ(parallel_count(b, serial), b.count());
+        EXPECT_EQ(parallel_count(b), b.count());
+        EXPECT_GT(serial.m_task_count, 1u);
+        EXPECT_TRUE(parallel_any(b, pool));
+        EXPECT_FALSE(parallel_none(b, pool));
+        EXPECT_FALSE(parallel_all(b, pool));
+
+        bitset empty(parallel_bitset_size, false);
+        EXPECT_EQ(parallel_count(empty, pool), 0u);
+        EXPECT_FALSE(parallel_any(empty, pool));
+        EXPECT_TRUE(parallel_none(empty));
+        empty.set(parallel_bitset_size - 1);
+        EXPECT_TRUE(parallel_any(empty, pool));
+
+        bitset full(parallel_bitset_size, true);
+        EXPECT_EQ(parallel_count(full, pool), parallel_bitset_size);
+        EXPECT_TRUE(parallel_all(full, pool));
+        EXPECT_TRUE(parallel_all(full));
+        full.reset(parallel_bitset_size / 3);
+        EXPECT_FALSE(parallel_all(full, pool));
+        full.set(parallel_bitset_size / 3);
+        full.reset(parallel_bitset_size - 1);
+        EXPECT_FALSE(parallel_all(full, pool));
+
+        // Small bitsets are processed serially
+        serial_executor small_serial;
+        bitset small(1000, true);
+        EXPECT_EQ(parallel_count(small, small_serial), 1000u);
+        EXPECT_TRUE(parallel_all(small, small_serial));
+        EXPECT_EQ(small_serial.m_task_count, 0u);
+    }
+
+    TEST(xdynamic_bitset_parallel, compound_assign)
+    {
+        bitset a = make_parallel_bitset(1);
+        bitset b = make_parallel_bitset(2);
+        bitset c = make_parallel_bitset(3);
+        xthread_pool pool(4);
+
+        bitset res = a;
+        parallel_and_assign(res, b, pool);
+        EXPECT_TRUE(res == (a & b));
+
+        res = a;
+        parallel_or_assign(res, b);
+        EXPECT_TRUE(res == (a | b));
+
+        res = a;
+        parallel_xor_assign(res, b, pool);
+        EXPECT_TRUE(res == (a ^ b));
+
+        bitset expected = a;
+        expected |= ~b & c;
+        res = a;
+        parallel_or_assign(res, ~b & c, pool);
+        EXPECT_TRUE(res == expected);
+        EXPECT_EQ(parallel_count(res, pool), expected.count());
+
+        // Expressions referring to the assigned bitset
+        expected = a;
+        expected ^= a | ~b;
+        res = a;
+        parallel_xor_assign(res, res | ~b, pool);
+        EXPECT_TRUE(res == expected);
+    }
+}
@@ -0,0 +1,337 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "xtl/xbasic_fixed_string.hpp"
+#include "xtl/xflat_hash_map.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    TEST(xflat_hash_map, basic)
+    {
+        xflat_hash_map<int, int> map;
+        EXPECT_TRUE(map.empty());
+        EXPECT_EQ(map.bucket_count(), 0u);
+        EXPECT_TRUE(map.begin() == map.end());
+        EXPECT_TRUE(map.find(1) == map.end());
+        EXPECT_EQ(map.erase(1), 0u);
+
+        auto res = map.insert({1, 10});
+        EXPECT_TRUE(res.second);
+        EXPECT_EQ(res.first->first, 1);
+        EXPECT_EQ(res.first->second, 10);
+        res = map.insert({1, 20});
+        EXPECT_FALSE(res.second);
+        EXPECT_EQ(res.first->second, 10);
+
+        map[2] = 20;
+        map.emplace(3, 30);
+        EXPECT_FALSE(map.try_emplace(3, 31).second);
+        EXPECT_FALSE(map.insert_or_assign(3, 33).second);
+        EXPECT_EQ(map.size(), 3u);
+        EXPECT_EQ(map.at(3), 33);
+        EXPECT_THROW(map.at(4), std::out_of_range);
+        EXPECT_TRUE(map.contains(2));
+        EXPECT_EQ(map.count(4), 0u);
+
+        int sum = 0;
+        for (const auto& p : map)
+        {
+            sum += p.second;
+        }
+        EXPECT_EQ(sum, 63);
+
+        EXPECT_EQ(map.erase(2), 1u);
+        EXPECT_FALSE(map.contains(2));
+        EXPECT_EQ(map.size(), 2u);
+
+        map.clear();
+        EXPECT_TRUE(map.empty());
+        EXPECT_TRUE(map.begin() == map.end());
+        EXPECT_NE(map.bucket_count(), 0u);
+    }
+
+    TEST(xflat_hash_map, reference)
+    {
+        // Random inserts and erases checked against std::unordered_map,
+        // sequential keys with std::hash<int> being the identity
+        xflat_hash_map<int, std::string> map;
+        std::unordered_map<int, std::string> ref;
+        uint32_t state = 12345u;
+        for (int i = 0; i < 50000; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            int key = static_cast<int>((state >> 8) % 3000u);
+            if ((state >> 4) % 3u == 0u)
+            {
+                EXPECT_EQ(map.erase(key), ref.erase(key));
+            }
+            else
+            {
+                std::string value = std::to_string(i);
+                EXPECT_EQ(map.try_emplace(key, value).second, ref.emplace(key, value).second);
+            }
+        }
+        EXPECT_EQ(map.size(), ref.size());
+        for (const auto& p : ref)
+        {
+            auto it = map.find(p.first);
+            EXPECT_TRUE(it != map.end());
+            EXPECT_EQ(it->second, p.second);
+        }
+        std::size_t count = 0;
+        for (auto it = map.begin(); it != map.end(); ++it)
+        {
+            EXPECT_EQ(ref.at(it->first), it->second);
+            ++count;
+        }
+        EXPECT_EQ(count, ref.size());
+        EXPECT_TRUE(map.load_factor() <= map.max_load_factor());
+    }
+
+    TEST(xflat_hash_map, erase_iterator)
+    {
+        xflat_hash_map<int, int> map;
+        for (int i = 0; i < 1000; ++i)
+        {
+            map[i] = i;
+        }
+        for (auto it = map.begin(); it != map.end();)
+        {
+            it = it->first % 2 == 0 ? map.erase(it) : std::next(it);
+        }
+        EXPECT_EQ(map.size(), 500u);
+        for (int i = 0; i < 1000; ++i)
+        {
+            EXPECT_EQ(map.contains(i), i % 2 == 1);
+        }
+
+        // Tombstones are reclaimed without growing the table
+        std::size_t capacity = map.bucket_count();
+        for (int i = 0; i < 100000; ++i)
+        {
+            map[1000 + i] = i;
+            map.erase(1000 + i);
+        }
+        EXPECT_EQ(map.size(), 500u);
+        EXPECT_EQ(map.bucket_count(), capacity);
+    }
+
+    TEST(xflat_hash_map, capacity)
+    {
+        xflat_hash_map<int, int> map;
+        map.reserve(4000);
+        std::size_t capacity = map.bucket_count();
+        EXPECT_TRUE(capacity >= 4000u);
+        EXPECT_EQ((capacity + 1) & capacity, 0u);
+        for (int i = 0; i < 1000; ++i)
+        {
+            map[i] = i;
+        }
+        EXPECT_EQ(map.bucket_count(), capacity);
+
+        map.rehash(0);
+        EXPECT_TRUE(map.bucket_count() < capacity);
+        for (int i = 0; i < 1000; ++i)
+        {
+            EXPECT_EQ(map.at(i), i);
+        }
+
+        map.clear();
+        map.rehash(0);
+        EXPECT_EQ(map.bucket_count(), 0u);
+        map[1] = 1;
+        EXPECT_EQ(map.size(), 1u);
+    }
+
+    // Allocator that throws on slot arrays larger than a limit, and counts
+    // the live allocations to detect leaks
+    template <class T>
+    struct limited_allocator
+    {
+        using value_type = T;
+
+        limited_allocator(std::size_t* live, std::size_t limit) noexcept
+            : p_live(live), m_limit(limit)
+        {
+        }
+
+        template <class U>
+        limited_allocator(const limited_allocator<U>& rhs) noexcept
+            : p_live(rhs.p_live), m_limit(rhs.m_limit)
+        {
+        }
+
+        T* allocate(std::size_t n)
+        {
+            if (sizeof(T) > 1 && n > m_limit)
+            {
+                throw std::bad_alloc();
+            }
+            ++*p_live;
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept
+        {
+            --*p_live;
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template <class U>
+        bool operator==(const limited_allocator<U>& rhs) const noexcept
+        {
+            return p_live == rhs.p_live;
+        }
+
+        template <class U>
+        bool operator!=(const limited_allocator<U>& rhs) const noexcept
+        {
+            return p_live != rhs.p_live;
+        }
+
+        std::size_t* p_live;
+        std::size_t m_limit;
+    };
+
+    TEST(xflat_hash_map, failed_allocation)
+    {
+        using allocator_type = limited_allocator<std::pair<const int, int>>;
+        using map_type = xflat_hash_map<int, int, std::hash<int>, std::equal_to<int>, allocator_type>;
+        std::size_t live = 0;
+        {
+            map_type map(0, std::hash<int>(), std::equal_to<int>(), allocator_type(&live, 64));
+            for (int i = 0; i < 20; ++i)
+            {
+                map[i] = i;
+            }
+            std::size_t capacity = map.bucket_count();
+            std::size_t allocations = live;
+
+            EXPECT_THROW(map.reserve(1000), std::bad_alloc);
+            EXPECT_EQ(live, allocations);
+            EXPECT_EQ(map.bucket_count(), capacity);
+            EXPECT_EQ(map.size(), 20u);
+
+            // Growing past the limit on insertion leaves the table unchanged too
+            int i = 20;
+            bool failed = false;
+            for (; i < 1000 && !failed; ++i)
+            {
+                try
+                {
+                    map[i] = i;
+                }
+                catch (const std::bad_alloc&)
+                {
+                    failed = true;
+                }
+            }
+            --i;
+            EXPECT_TRUE(failed);
+            EXPECT_EQ(live, 2u);
+            EXPECT_EQ(map.size(), static_cast<std::size_t>(i));
+            for (int j = 0; j < i; ++j)
+            {
+                EXPECT_EQ(map.at(j), j);
+            }
+            EXPECT_TRUE(map.find(i) == map.end());
+            map[0] = 42;
+            EXPECT_EQ(map.at(0), 42);
+        }
+        EXPECT_EQ(live, 0u);
+    }
+
+    TEST(xflat_hash_map, copy_move)
+    {
+        xflat_hash_map<std::string, std::unique_ptr<int>> moved;
+        moved["a"] = std::make_unique<int>(1);
+        xflat_hash_map<std::string, std::unique_ptr<int>> target(std::move(moved));
+        EXPECT_TRUE(moved.empty());
+        EXPECT_EQ(*target.at("a"), 1);
+        moved = std::move(target);
+        EXPECT_EQ(*moved.at("a"), 1);
+
+        xflat_hash_map<std::string, int> map = {{"one", 1}, {"two", 2}, {"three", 3}};
+        xflat_hash_map<std::string, int> copy(map);
+        EXPECT_TRUE(copy == map);
+        copy["four"] = 4;
+        EXPECT_TRUE(copy != map);
+        map = copy;
+        EXPECT_TRUE(copy == map);
+        copy["four"] = 5;
+        EXPECT_TRUE(copy != map);
+        swap(copy, map);
+        EXPECT_EQ(map.at("four"), 5);
+        EXPECT_EQ(copy.at("four"), 4);
+    }
+
+    TEST(xflat_hash_map, fixed_string_keys)
+    {
+        using key_type = xfixed_string<15>;
+        xflat_hash_map<key_type, int, xstring_hash, xstring_equal> map;
+        for (int i = 0; i < 200; ++i)
+        {
+            map[key_type(("key_" + std::to_string(i)).c_str())] = i;
+        }
+        EXPECT_EQ(map.at(key_type("key_42")), 42);
+
+        // Lookups without building a key
+        std::string str = "key_199";
+        EXPECT_EQ(map.at(std::string_view(str)), 199);
+        EXPECT_TRUE(map.find(std::string_view("key_200")) == map.end());
+        EXPECT_TRUE(map.contains(str));
+        EXPECT_EQ(map.erase(std::string_view("key_0")), 1u);
+        EXPECT_EQ(map.size(), 199u);
+
+        // The same key as a hashed string
+        xhashed_string<key_type> hashed(key_type("key_7"));
+        EXPECT_EQ(map.at(hashed), 7);
+    }
+
+    TEST(xflat_hash_set, basic)
+    {
+        xflat_hash_set<int64_t> set = {1, 2, 3};
+        EXPECT_EQ(set.size(), 3u);
+        EXPECT_FALSE(set.insert(2).second);
+        EXPECT_TRUE(set.emplace(4).second);
+        std::vector<int64_t> values = {5, 6, 7, 1};
+        set.insert(values.begin(), values.end());
+        EXPECT_EQ(set.size(), 7u);
+
+        xflat_hash_set<int64_t>::const_iterator it = set.find(3);
+        EXPECT_EQ(*it, 3);
+        set.erase(it);
+        EXPECT_FALSE(set.contains(3));
+
+        int64_t sum = 0;
+        for (int64_t v : set)
+        {
+            sum += v;
+        }
+        EXPECT_EQ(sum, 25);
+
+        xflat_hash_set<xfixed_string<7>, xstring_hash, xstring_equal> strings = {"a", "b"};
+        EXPECT_TRUE(strings.contains(std::string_view("a")));
+        EXPECT_FALSE(strings.contains(std::string_view("c")));
+    }
+}
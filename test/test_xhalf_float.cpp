@@ -7,6 +7,12 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
 #include "test_common_macros.hpp"
 
 #ifdef __GNUC__
@@ -38,6 +44,463 @@ namespace xtl
         EXPECT_EQ((half_float)f0*(half_float)f1, (float)(h0*h1));
         EXPECT_EQ((half_float)f0/(half_float)f1, (float)(h0/h1));
     }
+
+    inline half_float make_half(uint16_t bits)
+    {
+        half_float res;
+        std::memcpy(static_cast<void*>(&res), &bits, sizeof(bits));
+        return res;
+    }
+
+    inline uint32_t float_bits(float f)
+    {
+        uint32_t res;
+        std::memcpy(&res, &f, sizeof(f));
+        return res;
+    }
+
+    // Every half value, against the conversion operator
+    inline void check_half_to_float(void (*kernel)(const half_float*, std::size_t, float*) noexcept)
+    {
+        std::vector<half_float> input(65536);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            input[i] = make_half(static_cast<uint16_t>(i));
+        }
+        for (std::size_t size : {std::size_t(65536), std::size_t(37), std::size_t(5)})
+        {
+            std::vector<float> output(size + 1, -1.f);
+            kernel(input.data(), size, output.data());
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                float expected = input[i];
+                if (std::isnan(expected))
+                {
+                    EXPECT_TRUE(std::isnan(output[i]));
+                }
+                else
+                {
+                    EXPECT_EQ(float_bits(output[i]), float_bits(expected));
+                }
+            }
+            EXPECT_EQ(output[size], -1.f);
+        }
+    }
+
+    // Values around every rounding boundary, against the float constructor
+    inline void check_float_to_half(void (*kernel)(const float*, std::size_t, half_float*) noexcept)
+    {
+        std::vector<float> input;
+        for (uint32_t i = 0; i < 65536; ++i)
+        {
+            for (uint32_t low : {0u, 0xFFFu, 0x1000u, 0x1001u, 0x1FFFu})
+            {
+                uint32_t bits = (i << 16) | (low << 1);
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                input.push_back(f);
+            }
+        }
+        for (std::size_t size : {input.size(), std::size_t(29), std::size_t(3)})
+        {
+            std::vector<half_float> output(size + 1, make_half(0x1234));
+            kernel(input.data(), size, output.data());
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                half_float expected(input[i]);
+                if (std::isnan(input[i]))
+                {
+                    EXPECT_TRUE((output[i].get_data() & 0x7FFF) > 0x7C00);
+                }
+                else
+                {
+                    EXPECT_EQ(output[i].get_data(), expected.get_data());
+                }
+            }
+            EXPECT_EQ(output[size].get_data(), 0x1234);
+        }
+    }
+
+    TEST(half_float, convert_kernels)
+    {
+        check_half_to_float(&detail::half_to_float_scalar);
+        check_float_to_half(&detail::float_to_half_scalar);
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        const cpu_features& features = available_cpu_features();
+        if (features.f16c)
+        {
+            check_half_to_float(&detail::half_to_float_f16c);
+            check_float_to_half(&detail::float_to_half_f16c);
+        }
+        if (features.avx512f && features.f16c)
+        {
+            check_half_to_float(&detail::half_to_float_avx512);
+            check_float_to_half(&detail::float_to_half_avx512);
+        }
+#endif
+    }
+
+    TEST(half_float, convert)
+    {
+        std::vector<float> input = {0.f, -1.5f, 65504.f, 1e-7f, 70000.f, 0.1f, 3.f, -2.f, 1.f / 3.f};
+        std::vector<half_float> halves(input.size());
+        convert(input, halves);
+        std::vector<float> output(input.size());
+        convert(halves, output);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            EXPECT_EQ(halves[i].get_data(), half_float(input[i]).get_data());
+            EXPECT_EQ(output[i], static_cast<float>(half_float(input[i])));
+        }
+        EXPECT_TRUE(std::isinf(output[4]) || detail::half_round_style != std::round_to_nearest);
+
+        std::vector<float> small(2);
+        EXPECT_THROW(convert(halves, small), std::length_error);
+    }
+
+    inline std::vector<half_float> make_half_input(std::size_t size, uint32_t seed, bool finite)
+    {
+        std::vector<half_float> res(size);
+        for (auto& h : res)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint16_t bits = static_cast<uint16_t>(seed >> 16);
+            if (finite && (bits & 0x7C00) == 0x7C00)
+            {
+                bits = static_cast<uint16_t>(bits & 0xBFFF);
+            }
+            h = make_half(bits);
+        }
+        return res;
+    }
+
+    inline bool same_half(half_float a, half_float b)
+    {
+        bool nan_a = (a.get_data() & 0x7FFF) > 0x7C00;
+        bool nan_b = (b.get_data() & 0x7FFF) > 0x7C00;
+        return nan_a || nan_b ? nan_a == nan_b : a.get_data() == b.get_data();
+    }
+
+    using half_binary_kernel = void (*)(const half_float*, const half_float*, std::size_t, half_float*);
+    using half_ternary_kernel = void (*)(const half_float*, const half_float*, const half_float*, std::size_t, half_float*);
+
+    // Against the scalar operators, on every bit pattern and on products
+    // cancelled by the addend
+    inline void check_half_arithmetic(half_binary_kernel add_kernel, half_binary_kernel multiply_kernel, half_ternary_kernel fma_kernel)
+    {
+        std::size_t size = 1 << 18;
+        std::vector<half_float> x = make_half_input(size, 1u, false);
+        std::vector<half_float> y = make_half_input(size, 2u, false);
+        std::vector<half_float> z = make_half_input(size, 3u, false);
+        for (std::size_t i = 0; i < size / 2; ++i)
+        {
+            half_float p = -(x[i] * y[i]);
+            z[i] = i % 3 == 0 ? p : make_half(static_cast<uint16_t>(p.get_data() + i % 5 - 2));
+        }
+        std::vector<half_float> res(size + 3);
+        add_kernel(x.data(), y.data(), size - 3, res.data());
+        for (std::size_t i = 0; i < size - 3; ++i)
+        {
+            EXPECT_TRUE(same_half(res[i], x[i] + y[i]));
+        }
+        multiply_kernel(x.data(), y.data(), size - 5, res.data());
+        for (std::size_t i = 0; i < size - 5; ++i)
+        {
+            EXPECT_TRUE(same_half(res[i], x[i] * y[i]));
+        }
+        fma_kernel(x.data(), y.data(), z.data(), size - 7, res.data());
+        for (std::size_t i = 0; i < size - 7; ++i)
+        {
+            EXPECT_TRUE(same_half(res[i], fma(x[i], y[i], z[i])));
+        }
+    }
+
+    TEST(half_float, literal)
+    {
+        using namespace literals;
+        constexpr half_float table[] = {0.0_h, 1.5_h, 0.1_h, 65504.0_h, 1e10_h, 6e-8_h};
+        static_assert(table[1].get_data() == 0x3E00, "half literals are constant expressions");
+        const long double values[] = {0.0L, 1.5L, 0.1L, 65504.0L, 1e10L, 6e-8L};
+        for (std::size_t i = 0; i < 6; ++i)
+        {
+            EXPECT_EQ(table[i].get_data(), ::half_float::detail::float2half<detail::half_round_style>(values[i]));
+        }
+
+        // Every finite half, the midpoints between them and their neighbours
+        for (uint32_t i = 0; i < 0x7C00; ++i)
+        {
+            long double value = float(make_half(static_cast<uint16_t>(i)));
+            long double next = i == 0x7BFF ? 65536.0L : float(make_half(static_cast<uint16_t>(i + 1)));
+            long double mid = (value + next) / 2;
+            for (long double v : {value, mid, std::nextafter(mid, 0.0L), std::nextafter(mid, next)})
+            {
+                EXPECT_EQ(::half_float::detail::literal2half<detail::half_round_style>(v),
+                          ::half_float::detail::float2half<detail::half_round_style>(v));
+            }
+        }
+
+#if HALF_ENABLE_CONSTEXPR_CONVERSION
+        constexpr half_float third = 0.333f;
+        constexpr half_float tiny = -1e-6f;
+        constexpr float widened = 0.1_h;
+        static_assert(float(1.5_h) == 1.5f, "half to float is a constant expression");
+        volatile float runtime_third = 0.333f;
+        volatile float runtime_tiny = -1e-6f;
+        // constant expressions truncate when the rounding is indeterminate
+        if (detail::half_round_style != std::round_indeterminate)
+        {
+            EXPECT_EQ(third.get_data(), half_float(runtime_third).get_data());
+            EXPECT_EQ(tiny.get_data(), half_float(runtime_tiny).get_data());
+        }
+        EXPECT_EQ(widened, float(table[2]));
+#endif
+    }
+
+    TEST(half_float, arithmetic_kernels)
+    {
+        check_half_arithmetic(&detail::half_add_scalar, &detail::half_multiply_scalar, &detail::half_fma_scalar);
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        // The vector kernels are only selected for round to nearest
+        const cpu_features& features = available_cpu_features();
+        bool nearest = detail::half_round_style == std::round_to_nearest;
+        if (nearest && features.avx2 && features.f16c)
+        {
+            check_half_arithmetic(&detail::half_add_avx2, &detail::half_multiply_avx2, &detail::half_fma_avx2);
+        }
+        if (nearest && features.avx512f && features.avx2 && features.f16c)
+        {
+            check_half_arithmetic(&detail::half_add_avx512, &detail::half_multiply_avx512, &detail::half_fma_avx512);
+        }
+#endif
+    }
+
+    TEST(half_float, reduction_kernels)
+    {
+        std::vector<half_float> x = make_half_input(1003, 4u, true);
+        std::vector<half_float> y = make_half_input(1003, 5u, true);
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = make_half(static_cast<uint16_t>(x[i].get_data() & 0xDFFF));
+            y[i] = make_half(static_cast<uint16_t>(y[i].get_data() & 0xDFFF));
+        }
+        std::size_t size = x.size();
+        float dot_res = detail::half_dot_scalar(x.data(), y.data(), size);
+        float sum_res = detail::half_sum_scalar(x.data(), size);
+        double dot_ref = 0.;
+        double sum_ref = 0.;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            dot_ref += static_cast<double>(x[i]) * static_cast<double>(y[i]);
+            sum_ref += static_cast<double>(x[i]);
+        }
+        EXPECT_TRUE(std::abs(dot_res - dot_ref) < 1e-3 * std::abs(dot_ref) + 1e-3);
+        EXPECT_TRUE(std::abs(sum_res - sum_ref) < 1e-3 * std::abs(sum_ref) + 1e-3);
+
+        std::vector<half_float> finite = x;
+        x[10] = make_half(0xFE01);
+        x[20] = make_half(0x8000);
+        x[30] = make_half(0x0000);
+        uint16_t min_key;
+        uint16_t max_key;
+        detail::half_minmax_scalar(x.data(), size, min_key, max_key);
+        half_float lowest = x[0];
+        half_float highest = x[0];
+        for (std::size_t i = 1; i < size; ++i)
+        {
+            lowest = fmin(lowest, x[i]);
+            highest = fmax(highest, x[i]);
+        }
+        EXPECT_EQ(min_key, detail::half_order_key(lowest.get_data()));
+        EXPECT_EQ(max_key, detail::half_order_key(highest.get_data()));
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        const cpu_features& features = available_cpu_features();
+        for (std::size_t n : {size, std::size_t(40), std::size_t(7)})
+        {
+            uint16_t ref_min;
+            uint16_t ref_max;
+            detail::half_minmax_scalar(x.data(), n, ref_min, ref_max);
+            float ref_dot = detail::half_dot_scalar(finite.data(), y.data(), n);
+            float ref_sum = detail::half_sum_scalar(y.data(), n);
+            if (features.avx2 && features.f16c)
+            {
+                EXPECT_EQ(detail::half_dot_avx2(finite.data(), y.data(), n), ref_dot);
+                EXPECT_EQ(detail::half_sum_avx2(y.data(), n), ref_sum);
+                detail::half_minmax_avx2(x.data(), n, min_key, max_key);
+                EXPECT_EQ(min_key, ref_min);
+                EXPECT_EQ(max_key, ref_max);
+            }
+            if (features.avx512f && features.avx2 && features.f16c)
+            {
+                EXPECT_EQ(detail::half_dot_avx512(finite.data(), y.data(), n), ref_dot);
+                EXPECT_EQ(detail::half_sum_avx512(y.data(), n), ref_sum);
+            }
+            if (features.avx512bw)
+            {
+                detail::half_minmax_avx512(x.data(), n, min_key, max_key);
+                EXPECT_EQ(min_key, ref_min);
+                EXPECT_EQ(max_key, ref_max);
+            }
+        }
+#endif
+    }
+
+    TEST(half_float, array_functions)
+    {
+        std::vector<half_float> x = {half_float(1.f), half_float(-2.5f), half_float(0.5f)};
+        std::vector<half_float> y = {half_float(3.f), half_float(0.5f), half_float(-0.25f)};
+        std::vector<half_float> res(3);
+        add(x, y, res);
+        EXPECT_EQ(static_cast<float>(res[0]), 4.f);
+        EXPECT_EQ(static_cast<float>(res[1]), -2.f);
+        multiply(x, y, res);
+        EXPECT_EQ(static_cast<float>(res[1]), -1.25f);
+        fma(x, y, x, res);
+        EXPECT_EQ(static_cast<float>(res[0]), 4.f);
+        EXPECT_EQ(dot(x, y), 1.625f);
+        EXPECT_EQ(sum(y), 3.25f);
+
+        auto range = minmax(x);
+        EXPECT_EQ(static_cast<float>(range.first), -2.5f);
+        EXPECT_EQ(static_cast<float>(range.second), 1.f);
+        std::vector<half_float> empty;
+        EXPECT_TRUE(std::isnan(static_cast<float>(minmax(empty).first)));
+
+        std::vector<half_float> small(2);
+        EXPECT_THROW(add(x, y, small), std::length_error);
+        EXPECT_THROW(multiply(x, small, res), std::invalid_argument);
+    }
+
+    // Distance in ULPs, -0 and +0 are the same value
+    inline int half_ulp_distance(half_float x, uint16_t bits)
+    {
+        auto key = [](uint16_t b) { return (b & 0x8000) ? -int(b & 0x7FFF) : int(b); };
+        return std::abs(key(x.get_data()) - key(bits));
+    }
+
+    // The fast policy against the correctly rounded double precision result.
+    // Signaling NaN arguments may give NaN where quiet ones do not, as in
+    // pow(sNaN, 0).
+    inline bool fast_math_within_bound(half_float res, double expected, bool nan_argument = false)
+    {
+        if (std::isnan(expected) || (nan_argument && (res.get_data() & 0x7FFF) > 0x7C00))
+        {
+            return (res.get_data() & 0x7FFF) > 0x7C00;
+        }
+        uint16_t bits = static_cast<uint16_t>(::half_float::detail::float2half<detail::half_round_style>(expected));
+        return half_ulp_distance(res, bits) <= 1;
+    }
+
+    template <class F, class S, class R>
+    inline void check_fast_unary(F fast, S fast_span, R reference)
+    {
+        std::vector<half_float> input(65536);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            input[i] = make_half(static_cast<uint16_t>(i));
+        }
+        std::vector<half_float> res(input.size());
+        fast_span(input, res);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            double expected = reference(static_cast<double>(static_cast<float>(input[i])));
+            EXPECT_TRUE(fast_math_within_bound(fast(input[i]), expected));
+            EXPECT_TRUE(fast_math_within_bound(res[i], expected));
+        }
+    }
+
+    template <class F, class S, class R>
+    inline void check_fast_binary(F fast, S fast_span, R reference)
+    {
+        std::vector<half_float> x;
+        std::vector<half_float> y;
+        for (uint32_t i = 0; i < 65536; i += 0x1F3)
+        {
+            for (uint32_t j = 0; j < 65536; j += 0x65)
+            {
+                x.push_back(make_half(static_cast<uint16_t>(i)));
+                y.push_back(make_half(static_cast<uint16_t>(j)));
+            }
+        }
+        std::vector<half_float> res(x.size());
+        fast_span(x, y, res);
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            double expected = reference(static_cast<double>(static_cast<float>(x[i])), static_cast<double>(static_cast<float>(y[i])));
+            bool nan_argument = (x[i].get_data() & 0x7FFF) > 0x7C00 || (y[i].get_data() & 0x7FFF) > 0x7C00;
+            EXPECT_TRUE(fast_math_within_bound(fast(x[i], y[i]), expected, nan_argument));
+            EXPECT_TRUE(fast_math_within_bound(res[i], expected, nan_argument));
+        }
+    }
+
+#define CHECK_FAST_UNARY(NAME)                                                                                   \
+    check_fast_unary([](half_float x) { return NAME(x, half_fast_math()); },                                     \
+                     [](span<const half_float> x, span<half_float> res) { NAME(x, res, half_fast_math()); },   \
+                     [](double x) { return std::NAME(x); })
+
+#define CHECK_FAST_BINARY(NAME)                                                                                  \
+    check_fast_binary([](half_float x, half_float y) { return NAME(x, y, half_fast_math()); },                   \
+                      [](span<const half_float> x, span<const half_float> y, span<half_float> res)             \
+                      { NAME(x, y, res, half_fast_math()); },                                                  \
+                      [](double x, double y) { return std::NAME(x, y); })
+
+    TEST(half_float, fast_math)
+    {
+        CHECK_FAST_UNARY(exp);
+        CHECK_FAST_UNARY(exp2);
+        CHECK_FAST_UNARY(expm1);
+        CHECK_FAST_UNARY(log);
+        CHECK_FAST_UNARY(log10);
+        CHECK_FAST_UNARY(log2);
+        CHECK_FAST_UNARY(log1p);
+        CHECK_FAST_UNARY(sqrt);
+        CHECK_FAST_UNARY(cbrt);
+        CHECK_FAST_UNARY(sin);
+        CHECK_FAST_UNARY(cos);
+        CHECK_FAST_UNARY(tan);
+        CHECK_FAST_UNARY(asin);
+        CHECK_FAST_UNARY(acos);
+        CHECK_FAST_UNARY(atan);
+        CHECK_FAST_UNARY(sinh);
+        CHECK_FAST_UNARY(cosh);
+        CHECK_FAST_UNARY(tanh);
+        CHECK_FAST_UNARY(asinh);
+        CHECK_FAST_UNARY(acosh);
+        CHECK_FAST_UNARY(atanh);
+        CHECK_FAST_UNARY(erf);
+        CHECK_FAST_UNARY(erfc);
+        CHECK_FAST_UNARY(tgamma);
+        CHECK_FAST_UNARY(lgamma);
+        CHECK_FAST_BINARY(pow);
+        CHECK_FAST_BINARY(atan2);
+        CHECK_FAST_BINARY(hypot);
+
+        std::vector<half_float> small(2);
+        std::vector<half_float> x(3);
+        EXPECT_THROW(exp(x, small, half_fast_math()), std::length_error);
+        EXPECT_THROW(pow(x, small, x, half_fast_math()), std::invalid_argument);
+    }
+
+#undef CHECK_FAST_BINARY
+#undef CHECK_FAST_UNARY
+
+    TEST(half_float, exact_math)
+    {
+        std::vector<half_float> x;
+        for (uint32_t i = 0; i < 65536; i += 0x11)
+        {
+            x.push_back(make_half(static_cast<uint16_t>(i)));
+        }
+        std::vector<half_float> res(x.size());
+        std::vector<half_float> res2(x.size());
+        exp(x, res, half_exact_math());
+        pow(x, res, res2, half_exact_math());
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            EXPECT_EQ(res[i].get_data(), ::half_float::exp(x[i]).get_data());
+            EXPECT_EQ(res[i].get_data(), exp(x[i], half_exact_math()).get_data());
+            EXPECT_EQ(res2[i].get_data(), ::half_float::pow(x[i], res[i]).get_data());
+        }
+    }
 }
 
 #ifdef GCC
@@ -10,9 +10,16 @@
 #include "xtl/xhash.hpp"
 #include "xtl/xplatform.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 #include "test_common_macros.hpp"
 
@@ -173,5 +180,313 @@ namespace xtl
     {
         EXPECT_TRUE(sanity_test(&hash_bytes, sizeof(std::size_t)));
     }
-}
 
+    TEST(hash, alignment)
+    {
+        // Same keys at every offset, through the aligned and unaligned loads
+        std::vector<uint8_t> buffer(128);
+        for (std::size_t length = 0; length <= 40; ++length)
+        {
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                buffer[i] = static_cast<uint8_t>(i * 151 + 3);
+            }
+            std::size_t expected = hash_bytes(buffer.data(), length, 5);
+            uint32_t expected32 = murmur2_x86(buffer.data(), length, 5);
+            for (std::size_t offset = 1; offset < 16; ++offset)
+            {
+                std::memmove(buffer.data() + offset, buffer.data() + offset - 1, length);
+                EXPECT_EQ(hash_bytes(buffer.data() + offset, length, 5), expected);
+                EXPECT_EQ(murmur2_x86(buffer.data() + offset, length, 5), expected32);
+            }
+        }
+    }
+
+    constexpr std::string_view hash_text = "The quick brown fox jumps over the lazy dog";
+
+    constexpr std::array<std::size_t, hash_text.size() + 1> constexpr_hashes()
+    {
+        std::array<std::size_t, hash_text.size() + 1> res = {};
+        for (std::size_t i = 0; i < res.size(); ++i)
+        {
+            res[i] = hash_string(hash_text.substr(0, i), 3);
+        }
+        return res;
+    }
+
+    TEST(hash, constexpr_hash)
+    {
+        constexpr std::size_t literal = hash_string("xtl", 0);
+        EXPECT_EQ(literal, hash_bytes("xtl", 3u, 0));
+
+        constexpr auto hashes = constexpr_hashes();
+        for (std::size_t i = 0; i < hashes.size(); ++i)
+        {
+            EXPECT_EQ(hashes[i], hash_bytes(hash_text.data(), i, 3));
+            EXPECT_EQ(hash_string(hash_text.substr(0, i), 3), hashes[i]);
+        }
+    }
+
+    struct hash_key
+    {
+        uint64_t id;
+        uint32_t group;
+        uint32_t version;
+    };
+
+    TEST(hash, hash_object)
+    {
+        std::array<uint32_t, 3> a = {1u, 2u, 3u};
+        EXPECT_EQ(hash_object(a, 9), hash_bytes(a.data(), sizeof(a), 9));
+
+        std::array<uint8_t, 23> b = {};
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            b[i] = static_cast<uint8_t>(i * 7);
+        }
+        EXPECT_EQ(hash_object(b, 9), hash_bytes(b.data(), b.size(), 9));
+
+        hash_key key = {0x0123456789abcdefULL, 17u, 4u};
+        EXPECT_EQ(hash_object(key, 0), hash_bytes(&key, sizeof(key), 0));
+    }
+
+    TEST(hash, xhasher)
+    {
+        std::vector<uint8_t> input(300);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            input[i] = static_cast<uint8_t>(i * 151 + 3);
+        }
+
+        // Every length, fed in chunks of every size
+        for (std::size_t length = 0; length <= 40; ++length)
+        {
+            std::size_t expected = hash_bytes(input.data(), length, 17);
+            for (std::size_t chunk = 1; chunk <= length + 1; ++chunk)
+            {
+                xhasher hasher(length, 17);
+                for (std::size_t i = 0; i < length; i += chunk)
+                {
+                    hasher.update(input.data() + i, std::min(chunk, length - i));
+                }
+                EXPECT_EQ(hasher.finalize(), expected);
+            }
+        }
+
+        // Irregular chunks, including empty ones
+        xhasher hasher(input.size(), 0);
+        std::size_t pos = 0;
+        for (std::size_t chunk = 0; pos != input.size(); chunk = (chunk * 7 + 5) % 23)
+        {
+            std::size_t n = std::min(chunk, input.size() - pos);
+            hasher.update(input.data() + pos, n);
+            pos += n;
+        }
+        EXPECT_EQ(hasher.finalize(), hash_bytes(input.data(), input.size(), 0));
+
+        xhasher partial(10, 0);
+        partial.update(input.data(), 6);
+        EXPECT_THROW(partial.finalize(), std::length_error);
+        EXPECT_THROW(partial.update(input.data(), 5), std::length_error);
+    }
+
+    TEST(hash, hash_bytes_batch)
+    {
+        std::vector<uint8_t> input(1000);
+        for (std::size_t i = 0; i < input.size(); ++i)
+        {
+            input[i] = static_cast<uint8_t>(i * 151 + 3);
+        }
+
+        for (std::size_t key_size : {1u, 3u, 4u, 8u, 12u, 16u, 20u})
+        {
+            for (std::size_t count : {0u, 1u, 3u, 4u, 7u, 8u, 9u, 31u})
+            {
+                std::vector<std::size_t> res(count);
+                hash_bytes_batch(input.data() + 1, key_size, res, 42);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    EXPECT_EQ(res[i], hash_bytes(input.data() + 1 + i * key_size, key_size, 42));
+                }
+            }
+        }
+
+        std::vector<int32_t> offsets32 = {0, 0, 5, 13, 29, 30, 94, 200, 201};
+        std::vector<int64_t> offsets64(offsets32.begin(), offsets32.end());
+        std::vector<std::size_t> res32(offsets32.size() - 1);
+        std::vector<std::size_t> res64(offsets64.size() - 1);
+        hash_bytes_batch(offsets32, input.data(), res32, 7);
+        hash_bytes_batch(offsets64, input.data(), res64, 7);
+        for (std::size_t i = 0; i < res32.size(); ++i)
+        {
+            std::size_t length = static_cast<std::size_t>(offsets32[i + 1] - offsets32[i]);
+            std::size_t expected = hash_bytes(input.data() + offsets32[i], length, 7);
+            EXPECT_EQ(res32[i], expected);
+            EXPECT_EQ(res64[i], expected);
+        }
+        EXPECT_THROW(hash_bytes_batch(offsets32, input.data(), span<std::size_t>(res32.data(), 3), 7), std::length_error);
+
+        // Decreasing or negative offsets would describe strings of negative length
+        std::vector<std::size_t> untouched(res32);
+        std::vector<int32_t> decreasing = {0, 5, 13, 12, 29, 30, 94, 200, 201};
+        EXPECT_THROW(hash_bytes_batch(decreasing, input.data(), res32, 7), std::length_error);
+        EXPECT_TRUE(res32 == untouched);
+        std::vector<int64_t> negative = {-1, 0, 5, 13, 29, 30, 94, 200, 201};
+        EXPECT_THROW(hash_bytes_batch(negative, input.data(), res64, 7), std::length_error);
+    }
+
+    /********
+     * xxh3 *
+     ********/
+
+    // Reference values computed with the xxHash library
+    struct xxh3_reference
+    {
+        std::size_t length;
+        uint64_t seed;
+        uint64_t hash64;
+        uint64_t hash128_low;
+        uint64_t hash128_high;
+    };
+
+    constexpr xxh3_reference xxh3_references[] = {
+        {0, 0, 0x2d06800538d394c2ULL, 0x6001c324468d497fULL, 0x99aa06d3014798d8ULL},
+        {0, 42, 0xb029411ff43d84d2ULL, 0x3c1d09e9fe249164ULL, 0x16c20acd33f7af2fULL},
+        {3, 0, 0x6e3e2670e61106acULL, 0x6e3e2670e61106acULL, 0x390cdc5b4a895dd7ULL},
+        {3, 42, 0x06be808a0f1e13d6ULL, 0x06be808a0f1e13d6ULL, 0x307572e8ae2fb3ebULL},
+        {8, 0, 0xf9fd4dd0b04d78f5ULL, 0x61ddbe7f31a6100dULL, 0x6a86a3bda6af4e3dULL},
+        {8, 42, 0x859ee438a590e13dULL, 0x93a3e4d1d6db2f9cULL, 0xd57d3e54d7389077ULL},
+        {16, 0, 0x86abf6baccea0858ULL, 0xe2ce54a7c19c730dULL, 0x7f9a218b0425449aULL},
+        {16, 42, 0x3dfb7c5ae85844feULL, 0x6fbadfeb3524a71bULL, 0x68b3467254351145ULL},
+        {100, 0, 0x5da67eac6d4093d5ULL, 0x580b061a98a5a9b4ULL, 0x76b536586de98b82ULL},
+        {100, 42, 0xe58af440ea2c90e3ULL, 0xff98e0299d4aae18ULL, 0xdd187ff8d3f8f46fULL},
+        {200, 0, 0xc0fbc0f4e181c826ULL, 0xa4773493fbbe3543ULL, 0x26d28d07860728f6ULL},
+        {200, 42, 0x64b909d01384cf14ULL, 0x089ca45b03774335ULL, 0x80359eb3fbc705dcULL},
+        {1000, 0, 0x571d5cbfef44331bULL, 0x571d5cbfef44331bULL, 0x622239c5c47a6910ULL},
+        {1000, 42, 0xd63ebcf17f51057bULL, 0xd63ebcf17f51057bULL, 0x5da36eae3ce8e4aaULL},
+        {5000, 0, 0xe4007929540f095cULL, 0xe4007929540f095cULL, 0x61bedb627e4a5fdfULL},
+        {5000, 42, 0xa25f97afc34a44faULL, 0xa25f97afc34a44faULL, 0x335d228333a96dc1ULL},
+    };
+
+    inline std::vector<uint8_t> xxh3_reference_input()
+    {
+        std::vector<uint8_t> res(5000);
+        for (std::size_t i = 0; i < res.size(); ++i)
+        {
+            res[i] = static_cast<uint8_t>(i * 131 + 7);
+        }
+        return res;
+    }
+
+    // Largest deviation from 1/2 of the probability that an output bit
+    // flips when an input bit flips, over all input and output bits.
+    template <class F>
+    double avalanche_bias(F f, std::size_t length, std::size_t trials)
+    {
+        constexpr std::size_t out_bits = 64;
+        std::vector<uint8_t> key(length);
+        std::vector<std::size_t> flips(length * 8 * out_bits, 0);
+        for (std::size_t t = 0; t < trials; ++t)
+        {
+            rand_p(key.data(), static_cast<int>(length));
+            uint64_t h = f(key.data(), length);
+            for (std::size_t bit = 0; bit < length * 8; ++bit)
+            {
+                flipbit(key.data(), static_cast<int>(length), static_cast<uint32_t>(bit));
+                uint64_t d = h ^ f(key.data(), length);
+                flipbit(key.data(), static_cast<int>(length), static_cast<uint32_t>(bit));
+                for (std::size_t j = 0; j < out_bits; ++j)
+                {
+                    flips[bit * out_bits + j] += (d >> j) & 1;
+                }
+            }
+        }
+        double res = 0.;
+        for (std::size_t c : flips)
+        {
+            double p = static_cast<double>(c) / static_cast<double>(trials);
+            res = std::max(res, p > 0.5 ? p - 0.5 : 0.5 - p);
+        }
+        return res;
+    }
+
+    // Number of collisions when hashing the keys of length bytes with at
+    // most two bits set.
+    template <class F>
+    std::size_t sparse_collisions(F f, std::size_t length)
+    {
+        std::vector<uint8_t> key(length, 0);
+        std::unordered_set<uint64_t> hashes;
+        std::size_t count = 0;
+        std::size_t bits = length * 8;
+        hashes.insert(f(key.data(), length));
+        ++count;
+        for (std::size_t i = 0; i < bits; ++i)
+        {
+            flipbit(key.data(), static_cast<int>(length), static_cast<uint32_t>(i));
+            hashes.insert(f(key.data(), length));
+            ++count;
+            for (std::size_t j = i + 1; j < bits; ++j)
+            {
+                flipbit(key.data(), static_cast<int>(length), static_cast<uint32_t>(j));
+                hashes.insert(f(key.data(), length));
+                ++count;
+                flipbit(key.data(), static_cast<int>(length), static_cast<uint32_t>(j));
+            }
+            flipbit(key.data(), static_cast<int>(length), static_cast<uint32_t>(i));
+        }
+        return count - hashes.size();
+    }
+
+    TEST(hash, xxh3_reference)
+    {
+        std::vector<uint8_t> input = xxh3_reference_input();
+        for (const auto& ref : xxh3_references)
+        {
+            EXPECT_EQ(xxh3_64(input.data(), ref.length, ref.seed), ref.hash64);
+            hash128 h = xxh3_128(input.data(), ref.length, ref.seed);
+            EXPECT_EQ(h.low, ref.hash128_low);
+            EXPECT_EQ(h.high, ref.hash128_high);
+        }
+
+        // Unaligned input
+        std::vector<uint8_t> shifted(input.size() + 1);
+        std::copy(input.begin(), input.end(), shifted.begin() + 1);
+        EXPECT_EQ(xxh3_64(shifted.data() + 1, 5000, 0), 0xe4007929540f095cULL);
+        EXPECT_TRUE(xxh3_128(shifted.data() + 1, 1000, 42) == xxh3_128(input.data(), 1000, 42));
+    }
+
+    TEST(hash, xxh3_sanity)
+    {
+        auto h64 = [](const void* buffer, std::size_t length, std::size_t seed) {
+            return static_cast<std::size_t>(xxh3_64(buffer, length, seed));
+        };
+        EXPECT_TRUE(sanity_test(h64, sizeof(std::size_t)));
+    }
+
+    TEST(hash, xxh3_avalanche)
+    {
+        std::srand(1234);
+        auto h64 = [](const void* buffer, std::size_t length) { return xxh3_64(buffer, length, 0); };
+        auto h128_low = [](const void* buffer, std::size_t length) { return xxh3_128(buffer, length, 0).low; };
+        auto h128_high = [](const void* buffer, std::size_t length) { return xxh3_128(buffer, length, 0).high; };
+        // Covers each length class of the algorithm
+        for (std::size_t length : {3u, 8u, 16u, 24u, 100u, 200u, 300u})
+        {
+            EXPECT_LT(avalanche_bias(h64, length, 500), 0.12);
+            EXPECT_LT(avalanche_bias(h128_low, length, 500), 0.12);
+            EXPECT_LT(avalanche_bias(h128_high, length, 500), 0.12);
+        }
+    }
+
+    TEST(hash, xxh3_sparse)
+    {
+        auto h64 = [](const void* buffer, std::size_t length) { return xxh3_64(buffer, length, 0); };
+        auto h128 = [](const void* buffer, std::size_t length) { return xxh3_128(buffer, length, 0).low; };
+        for (std::size_t length : {4u, 16u, 64u})
+        {
+            EXPECT_EQ(sparse_collisions(h64, length), 0u);
+            EXPECT_EQ(sparse_collisions(h128, length), 0u);
+        }
+    }
+}
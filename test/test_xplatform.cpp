@@ -24,5 +24,18 @@ namespace xtl
         EXPECT_TRUE(endianness() == endian::little_endian);
 #endif
     }
-}
 
+    TEST(platform, cpu_features)
+    {
+        const cpu_features& features = available_cpu_features();
+        EXPECT_EQ(&features, &available_cpu_features());
+#if defined(XTL_X86_RUNTIME_DISPATCH)
+        // x86-64 guarantees SSE2
+        EXPECT_TRUE(features.sse2);
+#endif
+        if (features.avx512bw)
+        {
+            EXPECT_TRUE(features.avx512f);
+        }
+    }
+}
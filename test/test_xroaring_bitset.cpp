@@ -0,0 +1,311 @@
+/***************************************************************************
+* Copyright (c) Johan Mabille, Sylvain Corlay and Wolf Vollprecht          *
+* Copyright (c) QuantStack                                                 *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xtl/xoptional_sequence.hpp"
+#include "xtl/xroaring_bitset.hpp"
+
+#include "test_common_macros.hpp"
+
+namespace xtl
+{
+    using bitset = xdynamic_bitset<uint64_t>;
+    using roaring = xroaring_bitset;
+
+    // Sparse chunk, dense chunk, runs and an empty chunk
+    inline bitset make_mixed_bitset(std::size_t size, uint64_t seed)
+    {
+        bitset res(size, false);
+        uint64_t state = seed;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            std::size_t chunk = (i >> 16) % 4;
+            bool value = chunk == 0 ? (state >> 33) % 1000 == 0
+                       : chunk == 1 ? (state >> 33) % 2 == 0
+                       : chunk == 2 ? (i / 1000 + seed) % 3 == 0
+                       : false;
+            res[i] = value;
+        }
+        return res;
+    }
+
+    template <class B1, class B2>
+    bool same_bits(const B1& lhs, const B2& rhs)
+    {
+        bool res = lhs.size() == rhs.size();
+        for (std::size_t i = 0; res && i < lhs.size(); ++i)
+        {
+            res = bool(lhs[i]) == bool(rhs[i]);
+        }
+        return res;
+    }
+
+    TEST(xroaring_bitset, constructors)
+    {
+        roaring r0;
+        EXPECT_TRUE(r0.empty());
+        EXPECT_EQ(0u, r0.size());
+
+        roaring r1(200000u);
+        EXPECT_EQ(200000u, r1.size());
+        EXPECT_TRUE(r1.none());
+
+        roaring r2(200000u, true);
+        EXPECT_TRUE(r2.all());
+        EXPECT_EQ(200000u, r2.count());
+        EXPECT_LT(r2.memory_usage(), 512u);
+
+        roaring r3 = {true, false, true, true};
+        EXPECT_EQ(4u, r3.size());
+        EXPECT_TRUE(r3[0]);
+        EXPECT_FALSE(r3[1]);
+        EXPECT_EQ(3u, r3.count());
+        EXPECT_THROW(r3.at(4), std::out_of_range);
+    }
+
+    TEST(xroaring_bitset, conversion)
+    {
+        for (std::size_t size : {0u, 100u, 65536u, 300000u})
+        {
+            bitset b = make_mixed_bitset(size, 1);
+            roaring r(b);
+            EXPECT_EQ(b.count(), r.count());
+            EXPECT_TRUE(same_bits(b, r));
+            EXPECT_TRUE(r == b);
+            EXPECT_TRUE(b == r);
+            EXPECT_TRUE(r.to_dynamic_bitset() == b);
+
+            xdynamic_bitset<uint8_t> b8 = r.to_dynamic_bitset<uint8_t>();
+            EXPECT_EQ(b.count(), b8.count());
+            EXPECT_TRUE(roaring(b8) == r);
+        }
+    }
+
+    TEST(xroaring_bitset, set_reset)
+    {
+        bitset b = make_mixed_bitset(300000u, 2);
+        roaring r(b);
+        uint64_t state = 3;
+        for (std::size_t k = 0; k < 20000; ++k)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            std::size_t i = (state >> 20) % b.size();
+            bool value = (state >> 7) & 1;
+            b[i] = value;
+            r[i] = value;
+            if (k % 3 == 0)
+            {
+                b[i].flip();
+                r.flip(i);
+            }
+        }
+        EXPECT_EQ(b.count(), r.count());
+        EXPECT_TRUE(same_bits(b, r));
+        r.optimize();
+        EXPECT_TRUE(r == b);
+
+        // run container splits and merges
+        roaring runs(1000u, true);
+        runs.reset(10u);
+        runs.reset(11u);
+        runs[500] = false;
+        EXPECT_EQ(997u, runs.count());
+        EXPECT_FALSE(runs.test(11u));
+        runs.set(10u);
+        runs.set(11u);
+        runs.set(500u);
+        EXPECT_TRUE(runs.all());
+    }
+
+    TEST(xroaring_bitset, bitwise)
+    {
+        bitset a = make_mixed_bitset(300000u, 4);
+        bitset b = make_mixed_bitset(300000u, 5);
+        roaring ra(a), rb(b);
+
+        EXPECT_TRUE((ra & rb) == bitset(a & b));
+        EXPECT_TRUE((ra | rb) == bitset(a | b));
+        EXPECT_TRUE((ra ^ rb) == bitset(a ^ b));
+        EXPECT_TRUE(~ra == bitset(~a));
+        EXPECT_TRUE((ra & b) == bitset(a & b));
+        EXPECT_TRUE((ra | b) == bitset(a | b));
+        EXPECT_TRUE((ra ^ b) == bitset(a ^ b));
+        EXPECT_TRUE((a & rb) == bitset(a & b));
+        EXPECT_TRUE((a | rb) == bitset(a | b));
+        EXPECT_TRUE((a ^ rb) == bitset(a ^ b));
+
+        xdynamic_bitset_view<uint64_t> va(a.data(), a.size());
+        EXPECT_TRUE((va & rb) == bitset(a & b));
+        EXPECT_TRUE((va | rb) == bitset(a | b));
+        EXPECT_TRUE((va ^ rb) == bitset(a ^ b));
+
+        bitset c = a;
+        c &= rb;
+        EXPECT_TRUE(c == bitset(a & b));
+        c = a;
+        c |= rb;
+        EXPECT_TRUE(c == bitset(a | b));
+        c = a;
+        c ^= rb;
+        EXPECT_TRUE(c == bitset(a ^ b));
+
+        roaring rc = ra;
+        rc ^= ra;
+        EXPECT_TRUE(rc.none());
+        EXPECT_EQ(0u, rc.container_count());
+    }
+
+    TEST(xroaring_bitset, flip)
+    {
+        for (std::size_t size : {1u, 70000u, 131072u})
+        {
+            bitset b = make_mixed_bitset(size, 6);
+            roaring r(b);
+            b.flip();
+            r.flip();
+            EXPECT_TRUE(r == b);
+            EXPECT_EQ(b.all(), r.all());
+            EXPECT_EQ(b.any(), r.any());
+            EXPECT_EQ(b.none(), r.none());
+        }
+    }
+
+    TEST(xroaring_bitset, resize)
+    {
+        roaring r;
+        bitset b;
+        for (std::size_t i = 0; i < 1000; ++i)
+        {
+            r.push_back(i % 7 == 0);
+            b.push_back(i % 7 == 0);
+        }
+        EXPECT_TRUE(r == b);
+        r.pop_back();
+        b.pop_back();
+        EXPECT_TRUE(r == b);
+
+        r.resize(150000u, true);
+        b.resize(150000u, true);
+        EXPECT_TRUE(r == b);
+        r.resize(70000u);
+        b.resize(70000u);
+        EXPECT_TRUE(r == b);
+        r.resize(80000u);
+        b.resize(80000u);
+        EXPECT_TRUE(r == b);
+        r.clear();
+        EXPECT_TRUE(r.empty());
+        EXPECT_TRUE(r.none());
+    }
+
+    TEST(xroaring_bitset, set_bits)
+    {
+        bitset b = make_mixed_bitset(300000u, 7);
+        roaring r(b);
+
+        std::vector<std::size_t> expected;
+        b.for_each_set_bit([&expected](std::size_t i) { expected.push_back(i); });
+
+        auto range = r.set_bits();
+        std::vector<std::size_t> res(range.begin(), range.end());
+        EXPECT_EQ(expected, res);
+
+        res.clear();
+        for (std::size_t i = r.find_first(); i != roaring::npos; i = r.find_next(i))
+        {
+            res.push_back(i);
+        }
+        EXPECT_EQ(expected, res);
+
+        res.clear();
+        r.for_each_set_bit([&res](std::size_t i) { res.push_back(i); });
+        EXPECT_EQ(expected, res);
+
+        bitset blocks(b.size(), false);
+        r.for_each_set_block([&blocks](std::size_t first, uint64_t block) {
+            blocks.data()[first / 64] = block;
+        });
+        EXPECT_TRUE(blocks == b);
+    }
+
+    TEST(xroaring_bitset, shift)
+    {
+        bitset b = make_mixed_bitset(200000u, 8);
+        roaring r(b);
+        EXPECT_TRUE((r << 70000u) == bitset(b << 70000u));
+        EXPECT_TRUE((r >> 3u) == bitset(b >> 3u));
+        EXPECT_TRUE((r << 300000u).none());
+    }
+
+    TEST(xroaring_bitset, iterator)
+    {
+        roaring r(130000u);
+        r[3] = true;
+        r[129999] = true;
+        std::size_t count = 0;
+        for (auto it = r.cbegin(); it != r.cend(); ++it)
+        {
+            count += *it ? 1u : 0u;
+        }
+        EXPECT_EQ(2u, count);
+        EXPECT_TRUE(*r.crbegin());
+        EXPECT_EQ(r.size(), static_cast<std::size_t>(r.cend() - r.cbegin()));
+        *(r.begin() + 4) = true;
+        EXPECT_TRUE(r[4]);
+    }
+
+    TEST(xroaring_bitset, memory_usage)
+    {
+        std::size_t size = 1u << 24;
+        roaring sparse(size);
+        for (std::size_t i = 0; i < size; i += 5000)
+        {
+            sparse.set(i);
+        }
+        roaring dense(size, true);
+        for (std::size_t i = 0; i < size; i += 5000)
+        {
+            dense.reset(i);
+        }
+        dense.optimize();
+        std::size_t flat = size / 8;
+        EXPECT_LT(sparse.memory_usage(), flat / 50);
+        EXPECT_LT(dense.memory_usage(), flat / 50);
+        EXPECT_EQ(size - sparse.count(), dense.count());
+    }
+
+    TEST(xroaring_bitset, xoptional_vector)
+    {
+        using vector_type = xoptional_vector<double, std::allocator<double>, roaring>;
+        vector_type v(100000u, 2.0);
+        EXPECT_TRUE(v.has_value().all());
+        v[3] = missing<double>();
+        v[70000] = missing<double>();
+        EXPECT_FALSE(v[3].has_value());
+        EXPECT_TRUE(v[4].has_value());
+        EXPECT_EQ(99998u, v.has_value().count());
+        v[3] = 1.0;
+        EXPECT_TRUE(v[3].has_value());
+        EXPECT_EQ(1.0, v[3].value());
+
+        v.resize(100010u);
+        EXPECT_FALSE(v.back().has_value());
+
+        std::size_t missing_count = 0;
+        for (auto it = v.cbegin(); it != v.cend(); ++it)
+        {
+            missing_count += it->has_value() ? 0u : 1u;
+        }
+        EXPECT_EQ(11u, missing_count);
+    }
+}